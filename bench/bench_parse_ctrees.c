@@ -0,0 +1,857 @@
+/* File: bench_parse_ctrees.c */
+/*
+  This file is a part of the ``parse_ctrees`` package
+  Copyright (C) 2018-- Manodeep Sinha (manodeep@gmail.com)
+  License: MIT LICENSE. See LICENSE file under the top-level
+  directory at https://github.com/manodeep/parse_ctrees/
+*/
+
+/* Throughput benchmark for `parse_ctrees.h`.
+
+   Generates a synthetic Consistent-Trees `tree_?_?_?.dat` file (the real v1.01 header and
+   comment block, with a configurable tree-size distribution, number of columns and float
+   formatting) and then measures the throughput (in MB/s and rows/s) of
+
+   - `parse_header_ctrees`
+   - `parse_line_ctrees` (on lines that are already in memory)
+   - `read_single_tree_ctrees`, `read_single_tree_buffered_ctrees` (for several buffer sizes)
+     and `read_single_tree_mmap_ctrees`
+
+   for several column-subset sizes, into both structure-of-arrays (one base pointer per column)
+   and array-of-structures (one base pointer, one 8-byte slot per column) destinations.
+   Every measurement is repeated and the fastest repeat is reported; the file is read from the
+   page-cache (i.e., these numbers measure the parsing and not the disk).
+
+   Compile (from the top-level directory of the repo) with:
+
+   gcc -O3 -march=native -I. bench/bench_parse_ctrees.c -o bench_parse_ctrees -lm
+
+   and run with `./bench_parse_ctrees -h` to see the options. Use `-i` to benchmark
+   an existing `tree_?_?_?.dat` file instead of a synthetic one.
+*/
+
+#include <math.h>
+#include <time.h>
+#include <getopt.h>
+#include <errno.h>
+
+#include "parse_ctrees.h"
+
+#define BENCH_MAX_NSUBSETS   8
+#define BENCH_MAX_NBUFSIZES  8
+
+/* The columns of a Consistent-Trees (v1.01) `tree_?_?_?.dat` file, in order */
+static const char * const ctrees_v101_columns[] = {
+    "scale", "id", "desc_scale", "desc_id", "num_prog", "pid", "upid", "desc_pid", "phantom", "sam_mvir",
+    "mvir", "rvir", "rs", "vrms", "mmp?", "scale_of_last_MM", "vmax", "x", "y", "z",
+    "vx", "vy", "vz", "Jx", "Jy", "Jz", "Spin", "Breadth_first_ID", "Depth_first_ID", "Tree_root_ID",
+    "Orig_halo_ID", "Snap_num", "Next_coprogenitor_depthfirst_ID", "Last_progenitor_depthfirst_ID",
+    "Last_mainleaf_depthfirst_ID", "Tidal_Force", "Tidal_ID", "Rs_Klypin", "Mvir_all", "M200b",
+    "M200c", "M500c", "M2500c", "Xoff", "Voff", "Spin_Bullock", "b_to_a", "c_to_a", "A[x]", "A[y]",
+    "A[z]", "b_to_a(500c)", "c_to_a(500c)", "A[x](500c)", "A[y](500c)", "A[z](500c)", "T/|U|",
+    "M_pe_Behroozi", "M_pe_Diemer", "Halfmass_Radius", "Macc", "Mpeak", "Vacc", "Vpeak",
+    "Halfmass_Scale", "Acc_Rate_Inst", "Acc_Rate_100Myr", "Acc_Rate_1*Tdyn", "Acc_Rate_2*Tdyn",
+    "Acc_Rate_Mpeak", "Mpeak_Scale", "Acc_Scale", "First_Acc_Scale", "First_Acc_Mvir", "First_Acc_Vmax",
+    "Vmax\\@Mpeak", "Tidal_Force_Tdyn", "Log_(Vmax/Vmax_max(Tdyn;Tmpeak))", "Time_to_future_merger",
+    "Future_merger_MMP_ID",
+};
+#define CTREES_V101_NCOLS  ((int) (sizeof(ctrees_v101_columns)/sizeof(ctrees_v101_columns[0])))
+
+/* The comment block that follows the column names in the Consistent-Trees output */
+static const char ctrees_v101_comments[] =
+    "#a = 1.0/(1.0+z)\n"
+    "#Omega_M = 0.307115; Omega_L = 0.692885; h0 = 0.677700\n"
+    "#Full box size = 62.500000 Mpc/h\n"
+    "#Scale: Scale factor of halo.\n"
+    "#ID: ID of halo (unique across entire simulation).\n"
+    "#Desc_Scale: Scale of descendant halo, if applicable.\n"
+    "#Descid: ID of descendant halo, if applicable.\n"
+    "#Num_prog: Number of progenitors.\n"
+    "#Pid: ID of least massive host halo (-1 if distinct halo).\n"
+    "#Upid: ID of most massive host halo (different from Pid when the halo is within two or more larger halos).\n"
+    "#Desc_pid: Pid of descendant halo (if applicable).\n"
+    "#Phantom: Nonzero for halos interpolated across timesteps.\n"
+    "#SAM_Mvir: Halo mass, smoothed across accretion history; always greater than sum of halo masses of contributing progenitors (Msun/h).  Only for use with select semi-analytic models.\n"
+    "#Mvir: Halo mass (Msun/h).\n"
+    "#Rvir: Halo radius (kpc/h comoving).\n"
+    "#Rs: Scale radius (kpc/h comoving).\n"
+    "#Vrms: Velocity dispersion (km/s physical).\n"
+    "#mmp?: whether the halo is the most massive progenitor or not.\n"
+    "#scale_of_last_MM: scale factor of the last major merger (Mass ratio > 0.3).\n"
+    "#Vmax: Maxmimum circular velocity (km/s physical).\n"
+    "#X/Y/Z: Halo position (Mpc/h comoving).\n"
+    "#VX/VY/VZ: Halo velocity (km/s physical).\n"
+    "#JX/JY/JZ: Halo angular momenta ((Msun/h) * (Mpc/h) * km/s (physical)).\n"
+    "#Spin: Halo spin parameter.\n"
+    "#Breadth_first_ID: breadth-first ordering of halos within a tree.\n"
+    "#Depth_first_ID: depth-first ordering of halos within a tree.\n"
+    "#Tree_root_ID: ID of the halo at the last timestep in the tree.\n"
+    "#Orig_halo_ID: Original halo ID from halo finder.\n"
+    "#Snap_num: Snapshot number from which halo originated.\n"
+    "#Next_coprogenitor_depthfirst_ID: Depthfirst ID of next coprogenitor.\n"
+    "#Last_progenitor_depthfirst_ID: Depthfirst ID of last progenitor.\n"
+    "#Last_mainleaf_depthfirst_ID: Depthfirst ID of last progenitor on main progenitor branch.\n"
+    "#Tidal_Force: Strongest tidal force from any nearby halo, in dimensionless units (Rhalo / Rhill).\n"
+    "#Tidal_ID: ID of halo exerting strongest tidal force.\n"
+    "#Rs_Klypin: Scale radius determined using Vmax and Mvir (see Rockstar paper)\n"
+    "#Mvir_all: Mass enclosed within the specified overdensity, including unbound particles (Msun/h)\n"
+    "#M200b--M2500c: Mass enclosed within specified overdensities (Msun/h)\n"
+    "#Xoff: Offset of density peak from average particle position (kpc/h comoving)\n"
+    "#Voff: Offset of density peak from average particle velocity (km/s physical)\n"
+    "#Spin_Bullock: Bullock spin parameter (J/(sqrt(2)*GMVR))\n"
+    "#b_to_a, c_to_a: Ratio of second and third largest shape ellipsoid axes (B and C) to largest shape ellipsoid axis (A) (dimensionless).\n"
+    "#  Shapes are determined by the method in Allgood et al. (2006).\n"
+    "#  (500c) indicates that only particles within R500c are considered.\n"
+    "#A[x],A[y],A[z]: Largest shape ellipsoid axis (kpc/h comoving)\n"
+    "#T/|U|: ratio of kinetic to potential energies\n"
+    "#M_pe_*: Pseudo-evolution corrected masses (very experimental)\n"
+    "#Consistent Trees Version 1.01\n"
+    "#Includes fix for Rockstar spins & T/|U| (assuming T/|U| = column 56)\n";
+
+/* The columns that are requested first (i.e., the typical columns read by a semi-analytic model).
+   After these, the remaining columns in the file are requested in the header order */
+static const char * const preferred_columns[] = {
+    "mvir", "id", "desc_id", "upid", "x", "y", "z", "scale", "snap_num", "vmax", "rvir",
+    "vx", "vy", "vz", "Spin", "Tree_root_ID",
+};
+#define NUM_PREFERRED_COLUMNS  ((int) (sizeof(preferred_columns)/sizeof(preferred_columns[0])))
+
+enum bench_column_kinds
+{
+    BENCH_SCALE = 0,/* scale factor in (0, 1] */
+    BENCH_ID,/* (large) halo id, or -1 */
+    BENCH_SMALL_INT,/* number of progenitors, snapshot number etc */
+    BENCH_POSITION,/* in Mpc/h */
+    BENCH_VELOCITY,/* in km/s */
+    BENCH_POSITIVE,/* masses, radii etc spanning many decades */
+    BENCH_SIGNED,/* angular momenta etc spanning many decades */
+    BENCH_RATIO,/* dimensionless ratios in (0, 1] */
+};
+
+enum bench_float_formats
+{
+    BENCH_FORMAT_CTREES = 0,/* as written by Consistent-Trees, i.e., %.5f for scales/positions/velocities, %.5e otherwise */
+    BENCH_FORMAT_FIXED,/* %.6f for every float */
+    BENCH_FORMAT_SCIENTIFIC,/* %.6e for every float */
+};
+
+enum bench_tree_distributions
+{
+    BENCH_TREES_CONSTANT = 0,/* every tree has `min_nhalos` halos */
+    BENCH_TREES_UNIFORM,/* uniform in [min_nhalos, max_nhalos] */
+    BENCH_TREES_POWERLAW,/* dN/dn ~ n^(-slope) in [min_nhalos, max_nhalos] */
+};
+
+struct bench_options {
+    const char *filename;
+    int generate;/* 0 when benchmarking an existing file (`-i`) */
+    int64_t ntrees;
+    int64_t min_nhalos;
+    int64_t max_nhalos;
+    double slope;
+    enum bench_tree_distributions distribution;
+    int ncols;
+    enum bench_float_formats format;
+    uint64_t seed;
+    int nrepeats;
+    int nsubsets;
+    int64_t subset_ncols[BENCH_MAX_NSUBSETS];/* -1 means every (unique) column in the file */
+    int nbufsizes;
+    size_t bufsizes[BENCH_MAX_NBUFSIZES];
+};
+
+/* the destinations for one column subset. The SoA layout uses one array per column,
+   the AoS layout uses one array of records with one 8-byte slot per column */
+struct bench_destination {
+    int64_t ncols;
+    char (*names)[PARSE_CTREES_MAX_COLNAME_LEN];
+    enum parse_numeric_types types[PARSE_CTREES_MAX_NCOLS];
+    int64_t base_ptr_idx[PARSE_CTREES_MAX_NCOLS];
+    size_t dest_offset_to_element[PARSE_CTREES_MAX_NCOLS];
+    void *arrays[PARSE_CTREES_MAX_NCOLS];
+    struct base_ptr_info base_ptr_info;
+    struct ctrees_column_to_ptr column_info;
+};
+
+static inline double get_time_bench(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+/* xorshift64* -> the generated files only depend on the seed */
+static inline uint64_t next_random_bench(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * UINT64_C(2685821657736338717);
+}
+
+/* uniform in [0, 1) */
+static inline double uniform_random_bench(uint64_t *state)
+{
+    return (next_random_bench(state) >> 11) * (1.0/9007199254740992.0);
+}
+
+static inline int is_integer_column_bench(const char *name)
+{
+    const char *integer_columns[] = {"id", "desc_id", "num_prog", "pid", "upid", "desc_pid", "phantom", "mmp?",
+                                     "Breadth_first_ID", "Depth_first_ID", "Tree_root_ID", "Orig_halo_ID", "Snap_num",
+                                     "snap_num", "snap_idx", "Next_coprogenitor_depthfirst_ID",
+                                     "Last_progenitor_depthfirst_ID", "Last_mainleaf_depthfirst_ID", "Tidal_ID",
+                                     "Future_merger_MMP_ID"};
+    for(size_t i=0;i<sizeof(integer_columns)/sizeof(integer_columns[0]);i++) {
+        if(strcmp(name, integer_columns[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+static inline enum bench_column_kinds get_column_kind_bench(const char *name)
+{
+    if(strcmp(name, "num_prog") == 0 || strcmp(name, "phantom") == 0 ||
+       strcmp(name, "mmp?") == 0 || strcmp(name, "Snap_num") == 0) {
+        return BENCH_SMALL_INT;
+    }
+    if(is_integer_column_bench(name)) return BENCH_ID;
+    if(strstr(name, "scale") != NULL || strstr(name, "Scale") != NULL) return BENCH_SCALE;
+    if(strcmp(name, "x") == 0 || strcmp(name, "y") == 0 || strcmp(name, "z") == 0) return BENCH_POSITION;
+    if(strcmp(name, "vx") == 0 || strcmp(name, "vy") == 0 || strcmp(name, "vz") == 0) return BENCH_VELOCITY;
+    if(name[0] == 'J' || strncmp(name, "Acc_Rate", 8) == 0 || strncmp(name, "Log_", 4) == 0) return BENCH_SIGNED;
+    if(strncmp(name, "b_to_a", 6) == 0 || strncmp(name, "c_to_a", 6) == 0 ||
+       strcmp(name, "Spin") == 0 || strcmp(name, "Spin_Bullock") == 0 || strcmp(name, "T/|U|") == 0) {
+        return BENCH_RATIO;
+    }
+    return BENCH_POSITIVE;
+}
+
+static inline int64_t draw_tree_nhalos_bench(const struct bench_options *options, uint64_t *state)
+{
+    const double lo = (double) options->min_nhalos, hi = (double) options->max_nhalos;
+    double n = lo;
+    switch(options->distribution) {
+    case BENCH_TREES_UNIFORM:
+        n = lo + uniform_random_bench(state) * (hi - lo + 1.0);
+        break;
+    case BENCH_TREES_POWERLAW:
+        {
+            /* inverse transform of the truncated power-law */
+            const double u = uniform_random_bench(state);
+            if(fabs(options->slope - 1.0) < 1e-6) {
+                n = lo * pow(hi/lo, u);
+            } else {
+                const double e = 1.0 - options->slope;
+                n = pow(pow(lo, e) + u * (pow(hi, e) - pow(lo, e)), 1.0/e);
+            }
+        }
+        break;
+    default:
+        break;
+    }
+    int64_t nhalos = (int64_t) n;
+    if(nhalos < options->min_nhalos) nhalos = options->min_nhalos;
+    if(nhalos > options->max_nhalos) nhalos = options->max_nhalos;
+    return nhalos;
+}
+
+static inline int write_value_bench(char *buf, const size_t bufsize, const enum bench_column_kinds kind, const enum bench_float_formats format,
+                                    const int64_t halo_id, const int64_t root_id, const int64_t ihalo, uint64_t *state)
+{
+    double value = 0.0;
+    int fixed = 0;
+    switch(kind) {
+    case BENCH_ID:
+        {
+            /* roughly a quarter of the ids are -1 (e.g., pid/upid of a distinct halo) */
+            const uint64_t r = next_random_bench(state);
+            if((r & 3) == 0 || (ihalo == 0 && (r & 4))) {
+                return snprintf(buf, bufsize, "-1");
+            }
+            return snprintf(buf, bufsize, "%"PRId64, (r & 8) ? halo_id : root_id + (int64_t) ((r >> 8) % (uint64_t) (ihalo + 1)));
+        }
+    case BENCH_SMALL_INT:
+        return snprintf(buf, bufsize, "%d", (int) (next_random_bench(state) % 200));
+    case BENCH_SCALE:
+        value = 0.02 + 0.98 * uniform_random_bench(state);
+        fixed = 1;
+        break;
+    case BENCH_POSITION:
+        value = 62.5 * uniform_random_bench(state);
+        fixed = 1;
+        break;
+    case BENCH_VELOCITY:
+        value = 2000.0 * uniform_random_bench(state) - 1000.0;
+        fixed = 1;
+        break;
+    case BENCH_RATIO:
+        value = uniform_random_bench(state);
+        fixed = 1;
+        break;
+    case BENCH_SIGNED:
+        value = ((next_random_bench(state) & 1) ? -1.0:1.0) * pow(10.0, 14.0 * uniform_random_bench(state) - 2.0);
+        break;
+    default:
+        value = pow(10.0, 14.0 * uniform_random_bench(state) - 2.0);
+        break;
+    }
+
+    if(format == BENCH_FORMAT_FIXED || (format == BENCH_FORMAT_CTREES && fixed)) {
+        return snprintf(buf, bufsize, format == BENCH_FORMAT_FIXED ? "%.6f":"%.5f", value);
+    }
+    return snprintf(buf, bufsize, format == BENCH_FORMAT_SCIENTIFIC ? "%.6e":"%.5e", value);
+}
+
+/* Writes the synthetic `tree_?_?_?.dat` file. Returns the total number of halos (-1 on error) */
+static inline int64_t generate_file_bench(const struct bench_options *options)
+{
+    FILE *fp = fopen(options->filename, "w");
+    if(fp == NULL) {
+        fprintf(stderr,"Error: Could not open file `%s` for writing\n", options->filename);
+        perror(NULL);
+        return -1;
+    }
+
+    enum bench_column_kinds kinds[CTREES_V101_NCOLS];
+    for(int i=0;i<options->ncols;i++) {
+        fprintf(fp, "%s%s(%d)", i == 0 ? "#":" ", ctrees_v101_columns[i], i);
+        kinds[i] = get_column_kind_bench(ctrees_v101_columns[i]);
+    }
+    fprintf(fp, "\n%s%"PRId64"\n", ctrees_v101_comments, options->ntrees);
+
+    uint64_t state = options->seed == 0 ? 1 : options->seed;
+    int64_t halo_id = 0;
+    char line[PARSE_CTREES_MAX_NCOLS * PARSE_CTREES_MAX_TOKEN_LEN];
+    for(int64_t itree=0;itree<options->ntrees;itree++) {
+        const int64_t nhalos = draw_tree_nhalos_bench(options, &state);
+        const int64_t root_id = halo_id;
+        fprintf(fp, "#tree %"PRId64"\n", root_id);
+        for(int64_t ihalo=0;ihalo<nhalos;ihalo++) {
+            size_t len = 0;
+            for(int i=0;i<options->ncols;i++) {
+                if(i > 0) line[len++] = ' ';
+                int nwritten;
+                if(i == 1) {
+                    /* the halo id is always the second column */
+                    nwritten = snprintf(&line[len], sizeof(line) - len, "%"PRId64, halo_id);
+                } else {
+                    nwritten = write_value_bench(&line[len], sizeof(line) - len, kinds[i], options->format, halo_id, root_id, ihalo, &state);
+                }
+                len += nwritten;
+            }
+            line[len++] = '\n';
+            if(fwrite(line, 1, len, fp) != len) {
+                fprintf(stderr,"Error: Could not write to file `%s`\n", options->filename);
+                perror(NULL);
+                fclose(fp);
+                return -1;
+            }
+            halo_id++;
+        }
+    }
+    fclose(fp);
+    return halo_id;
+}
+
+static inline void free_destination_bench(struct bench_destination *dest)
+{
+    for(int64_t i=0;i<dest->base_ptr_info.num_base_ptrs;i++) {
+        free(dest->arrays[i]);
+        dest->arrays[i] = NULL;
+    }
+    dest->base_ptr_info.num_base_ptrs = 0;
+    free_column_to_ptr_ctrees(&(dest->column_info));
+}
+
+/* Sets up the destinations for the first ``ncols`` of the requested ``names``, either as SoA or AoS,
+   with space for ``nrows`` rows. Also parses the header of ``filename`` */
+static inline int setup_destination_bench(char (*names)[PARSE_CTREES_MAX_COLNAME_LEN], const int64_t ncols, const int aos,
+                                          const int64_t nrows, const char *filename, struct bench_destination *dest)
+{
+    memset(dest, 0, sizeof(*dest));
+    dest->ncols = ncols;
+    dest->names = names;
+    struct base_ptr_info *b = &(dest->base_ptr_info);
+    b->num_base_ptrs = aos ? 1 : ncols;
+    for(int64_t i=0;i<ncols;i++) {
+        dest->types[i] = is_integer_column_bench(names[i]) ? I64 : F64;
+        dest->base_ptr_idx[i] = aos ? 0 : i;
+        dest->dest_offset_to_element[i] = aos ? i * sizeof(double) : 0;
+    }
+    for(int64_t i=0;i<b->num_base_ptrs;i++) {
+        b->base_element_size[i] = aos ? ncols * sizeof(double) : sizeof(double);
+        dest->arrays[i] = malloc(nrows * b->base_element_size[i]);
+        if(dest->arrays[i] == NULL) {
+            fprintf(stderr,"Error: Could not allocate memory for %"PRId64" rows\n", nrows);
+            perror(NULL);
+            free_destination_bench(dest);
+            return EXIT_FAILURE;
+        }
+        b->base_ptrs[i] = &(dest->arrays[i]);
+    }
+    b->nallocated = nrows;
+    b->N = 0;
+
+    return parse_header_ctrees(names, dest->types, dest->base_ptr_idx, dest->dest_offset_to_element,
+                               ncols, filename, &(dest->column_info));
+}
+
+/* Reads the entire file into memory and NUL-terminates every halo line. Returns the number of lines,
+   with the start of each line in ``*lines`` (-1 on error) */
+static inline int64_t load_lines_bench(const char *filename, char **contents, char ***lines, int64_t *nbytes)
+{
+    struct stat st;
+    if(stat(filename, &st) != 0) {
+        fprintf(stderr,"Error: Could not stat file `%s`\n", filename);
+        perror(NULL);
+        return -1;
+    }
+    char *buf = malloc(st.st_size + 1);
+    int fd = open(filename, O_RDONLY);
+    if(buf == NULL || fd < 0 || pread_all_ctrees(fd, buf, st.st_size, 0) != EXIT_SUCCESS) {
+        fprintf(stderr,"Error: Could not read file `%s` into memory\n", filename);
+        perror(NULL);
+        free(buf);
+        if(fd >= 0) close(fd);
+        return -1;
+    }
+    close(fd);
+    buf[st.st_size] = '\0';
+
+    int64_t nlines = 0, nallocated = 1024;
+    char **start = malloc(nallocated * sizeof(*start));
+    int seen_ntrees = 0;
+    *nbytes = 0;
+    char *p = buf, *end = buf + st.st_size;
+    while(p < end && start != NULL) {
+        char *eol = memchr(p, '\n', end - p);
+        if(eol == NULL) eol = end;
+        *eol = '\0';
+        if(p[0] != '#' && eol > p) {
+            if(seen_ntrees) {
+                if(nlines == nallocated) {
+                    nallocated *= 2;
+                    char **tmp = realloc(start, nallocated * sizeof(*start));
+                    if(tmp == NULL) {
+                        free(start);
+                        start = NULL;
+                        break;
+                    }
+                    start = tmp;
+                }
+                start[nlines++] = p;
+                *nbytes += (eol - p) + 1;
+            }
+            seen_ntrees = 1;/* the first non-comment line is the number of trees */
+        }
+        p = eol + 1;
+    }
+    if(start == NULL) {
+        fprintf(stderr,"Error: Could not allocate memory for the start of every line\n");
+        free(buf);
+        return -1;
+    }
+    *contents = buf;
+    *lines = start;
+    return nlines;
+}
+
+static inline void print_result_bench(const char *benchmark, const char *layout, const int64_t ncols, const size_t bufsize,
+                                      const double nbytes, const double nrows, const double seconds)
+{
+    char bufstr[32] = "-";
+    if(bufsize > 0) {
+        if(bufsize % (1024*1024) == 0) {
+            snprintf(bufstr, sizeof(bufstr), "%zuM", bufsize/(1024*1024));
+        } else {
+            snprintf(bufstr, sizeof(bufstr), "%zuK", bufsize/1024);
+        }
+    }
+    fprintf(stdout, "%-34s %-6s %5"PRId64" %7s %12.2f %14.0f %12.6f\n", benchmark, layout, ncols, bufstr,
+            nbytes / (seconds * 1024.0 * 1024.0), nrows / seconds, seconds);
+    fflush(stdout);
+}
+
+/* Checks that the destination contains every halo of the tree */
+static inline int check_nhalos_bench(const char *benchmark, const struct ctrees_tree_index_entry *tree, const struct base_ptr_info *b)
+{
+    if(b->N != tree->nhalos) {
+        fprintf(stderr,"Error: `%s` read %"PRId64" halos for tree id = %"PRId64" but the tree contains %"PRId64" halos\n",
+                benchmark, b->N, tree->tree_id, tree->nhalos);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+enum bench_tree_readers
+{
+    BENCH_READ_SINGLE_TREE = 0,
+    BENCH_READ_BUFFERED,
+    BENCH_READ_MMAP,
+};
+
+/* Reads every tree in the ``index`` (nrepeats times) and returns the fastest time */
+static inline int time_tree_reader_bench(const enum bench_tree_readers which, const struct ctrees_tree_index *index, const int fd,
+                                         const struct ctrees_mmap_file *mfile, struct ctrees_buffered_reader *reader,
+                                         struct bench_destination *dest, const int nrepeats, double *best)
+{
+    const char *benchmarks[] = {"read_single_tree_ctrees", "read_single_tree_buffered_ctrees", "read_single_tree_mmap_ctrees"};
+    *best = HUGE_VAL;
+    for(int irep=0;irep<nrepeats;irep++) {
+        const double t0 = get_time_bench();
+        for(int64_t itree=0;itree<index->ntrees;itree++) {
+            const struct ctrees_tree_index_entry *tree = &(index->trees[itree]);
+            dest->base_ptr_info.N = 0;
+            int status;
+            switch(which) {
+            case BENCH_READ_BUFFERED:
+                status = read_single_tree_buffered_ctrees(fd, tree->offset, &(dest->column_info), &(dest->base_ptr_info), reader);
+                break;
+            case BENCH_READ_MMAP:
+                status = read_single_tree_mmap_ctrees(mfile, tree->offset, &(dest->column_info), &(dest->base_ptr_info));
+                break;
+            default:
+                status = read_single_tree_ctrees(fd, tree->offset, &(dest->column_info), &(dest->base_ptr_info));
+                break;
+            }
+            if(status != EXIT_SUCCESS) {
+                return status;
+            }
+            status = check_nhalos_bench(benchmarks[which], tree, &(dest->base_ptr_info));
+            if(status != EXIT_SUCCESS) {
+                return status;
+            }
+        }
+        const double t = get_time_bench() - t0;
+        if(t < *best) *best = t;
+    }
+    return EXIT_SUCCESS;
+}
+
+/* Collects the (unique) column names to request -- the preferred columns first, followed by
+   every other column in the header order. Returns the number of columns (-1 on error) */
+static inline int64_t get_requested_columns_bench(const char *filename, char (**requested)[PARSE_CTREES_MAX_COLNAME_LEN],
+                                                  int64_t *header_nbytes)
+{
+    char (*names)[PARSE_CTREES_MAX_COLNAME_LEN] = NULL;
+    int totncols = 0;
+    if(read_header_column_names_ctrees(filename, &names, &totncols) != EXIT_SUCCESS) {
+        return -1;
+    }
+    char *header_line = NULL;
+    if(read_first_line_ctrees(filename, &header_line) != EXIT_SUCCESS) {
+        free(names);
+        return -1;
+    }
+    *header_nbytes = (int64_t) strlen(header_line);
+    free(header_line);
+
+    char (*wanted)[PARSE_CTREES_MAX_COLNAME_LEN] = calloc(totncols + NUM_PREFERRED_COLUMNS, sizeof(*wanted));
+    if(wanted == NULL) {
+        fprintf(stderr,"Error: Could not allocate memory for the requested column names\n");
+        free(names);
+        return -1;
+    }
+    int64_t nwanted = 0;
+    for(int i=0;i<NUM_PREFERRED_COLUMNS + totncols && nwanted < PARSE_CTREES_MAX_NCOLS;i++) {
+        const char *name = i < NUM_PREFERRED_COLUMNS ? preferred_columns[i] : names[i - NUM_PREFERRED_COLUMNS];
+        int found = 0, duplicate = 0;
+        for(int j=0;j<totncols && !found;j++) {
+            found = (strcasecmp(name, names[j]) == 0);
+        }
+        /* the names are compared case-insensitively, i.e., `Snap_num` in the header is a duplicate of `snap_num` */
+        for(int64_t j=0;j<nwanted && !duplicate;j++) {
+            duplicate = (strcasecmp(name, wanted[j]) == 0);
+        }
+        if(found && !duplicate) {
+            snprintf(wanted[nwanted], PARSE_CTREES_MAX_COLNAME_LEN, "%s", name);
+            nwanted++;
+        }
+    }
+    free(names);
+    *requested = wanted;
+    return nwanted;
+}
+
+static inline int run_benchmarks_bench(const struct bench_options *options)
+{
+    const char *filename = options->filename;
+    char (*requested)[PARSE_CTREES_MAX_COLNAME_LEN] = NULL;
+    int64_t header_nbytes = 0;
+    const int64_t nrequested = get_requested_columns_bench(filename, &requested, &header_nbytes);
+    if(nrequested <= 0) {
+        fprintf(stderr,"Error: Could not find any of the requested columns in the header of file `%s`\n", filename);
+        free(requested);
+        return EXIT_FAILURE;
+    }
+
+    struct ctrees_tree_index index;
+    memset(&index, 0, sizeof(index));
+    int status = build_tree_index_ctrees(filename, &index);
+    if(status != EXIT_SUCCESS) {
+        free(requested);
+        return status;
+    }
+    int64_t nhalos = 0, max_nhalos = 1, nbytes_trees = 0;
+    for(int64_t i=0;i<index.ntrees;i++) {
+        nhalos += index.trees[i].nhalos;
+        nbytes_trees += index.trees[i].nbytes;
+        if(index.trees[i].nhalos > max_nhalos) max_nhalos = index.trees[i].nhalos;
+    }
+
+    char *contents = NULL;
+    char **lines = NULL;
+    int64_t nbytes_lines = 0;
+    const int64_t nlines = load_lines_bench(filename, &contents, &lines, &nbytes_lines);
+    if(nlines < 0) {
+        free(requested);
+        free_tree_index_ctrees(&index);
+        return EXIT_FAILURE;
+    }
+
+    int fd = open(filename, O_RDONLY);
+    struct ctrees_mmap_file mfile;
+    if(fd < 0 || open_mmap_file_ctrees(filename, &mfile) != EXIT_SUCCESS) {
+        fprintf(stderr,"Error: Could not open file `%s`\n", filename);
+        perror(NULL);
+        free(requested);
+        free(contents);
+        free(lines);
+        free_tree_index_ctrees(&index);
+        if(fd >= 0) close(fd);
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stdout, "# file = `%s` with %"PRId64" trees, %"PRId64" halos (max. %"PRId64" halos per tree) "
+            "and %"PRId64" requestable columns; %.2f MB of halos\n",
+            filename, index.ntrees, nhalos, max_nhalos, nrequested, nbytes_trees / (1024.0 * 1024.0));
+    fprintf(stdout, "# best of %d repeat(s). MB/s is MiB of the file (halo lines or header line) parsed per second\n", options->nrepeats);
+    fprintf(stdout, "#%-33s %-6s %5s %7s %12s %14s %12s\n", "benchmark", "layout", "ncols", "bufsize", "MB/s", "rows/s", "seconds");
+
+    int64_t prev_ncols = 0;
+    for(int isub=0;isub<options->nsubsets && status == EXIT_SUCCESS;isub++) {
+        int64_t ncols = options->subset_ncols[isub];
+        if(ncols < 0 || ncols > nrequested) ncols = nrequested;
+        if(ncols == prev_ncols) continue;
+        prev_ncols = ncols;
+
+        for(int aos=0;aos<=1 && status == EXIT_SUCCESS;aos++) {
+            const char *layout = aos ? "AoS" : "SoA";
+            const int64_t nrows = nlines > max_nhalos ? nlines : max_nhalos;
+            struct bench_destination dest;
+            status = setup_destination_bench(requested, ncols, aos, nrows, filename, &dest);
+            if(status != EXIT_SUCCESS) {
+                free_destination_bench(&dest);
+                break;
+            }
+
+            /* parse_header_ctrees -> the header is only measured once per column subset */
+            if(aos == 0) {
+                const int ncalls = 200;
+                double best = HUGE_VAL;
+                for(int irep=0;irep<options->nrepeats && status == EXIT_SUCCESS;irep++) {
+                    const double t0 = get_time_bench();
+                    for(int icall=0;icall<ncalls && status == EXIT_SUCCESS;icall++) {
+                        free_column_to_ptr_ctrees(&(dest.column_info));
+                        status = parse_header_ctrees(requested, dest.types, dest.base_ptr_idx, dest.dest_offset_to_element,
+                                                     ncols, filename, &(dest.column_info));
+                    }
+                    const double t = get_time_bench() - t0;
+                    if(t < best) best = t;
+                }
+                if(status == EXIT_SUCCESS) {
+                    print_result_bench("parse_header_ctrees", "-", ncols, 0, (double) header_nbytes * ncalls, ncalls, best);
+                }
+            }
+
+            /* parse_line_ctrees on the lines that are already in memory */
+            if(status == EXIT_SUCCESS) {
+                double best = HUGE_VAL;
+                for(int irep=0;irep<options->nrepeats && status == EXIT_SUCCESS;irep++) {
+                    dest.base_ptr_info.N = 0;
+                    const double t0 = get_time_bench();
+                    for(int64_t iline=0;iline<nlines && status == EXIT_SUCCESS;iline++) {
+                        status = parse_line_ctrees(lines[iline], &(dest.column_info), &(dest.base_ptr_info));
+                    }
+                    const double t = get_time_bench() - t0;
+                    if(t < best) best = t;
+                }
+                if(status == EXIT_SUCCESS) {
+                    print_result_bench("parse_line_ctrees", layout, ncols, 0, (double) nbytes_lines, (double) nlines, best);
+                }
+            }
+
+            /* read every tree with each of the tree readers */
+            double best;
+            if(status == EXIT_SUCCESS) {
+                status = time_tree_reader_bench(BENCH_READ_SINGLE_TREE, &index, fd, &mfile, NULL, &dest, options->nrepeats, &best);
+                if(status == EXIT_SUCCESS) {
+                    print_result_bench("read_single_tree_ctrees", layout, ncols, 0, (double) nbytes_trees, (double) nhalos, best);
+                }
+            }
+            for(int ibuf=0;ibuf<options->nbufsizes && status == EXIT_SUCCESS;ibuf++) {
+                struct ctrees_buffered_reader reader;
+                status = init_buffered_reader_ctrees(&reader, options->bufsizes[ibuf]);
+                if(status != EXIT_SUCCESS) break;
+                status = time_tree_reader_bench(BENCH_READ_BUFFERED, &index, fd, &mfile, &reader, &dest, options->nrepeats, &best);
+                if(status == EXIT_SUCCESS) {
+                    print_result_bench("read_single_tree_buffered_ctrees", layout, ncols, reader.bufsize, (double) nbytes_trees, (double) nhalos, best);
+                }
+                free_buffered_reader_ctrees(&reader);
+            }
+            if(status == EXIT_SUCCESS) {
+                status = time_tree_reader_bench(BENCH_READ_MMAP, &index, fd, &mfile, NULL, &dest, options->nrepeats, &best);
+                if(status == EXIT_SUCCESS) {
+                    print_result_bench("read_single_tree_mmap_ctrees", layout, ncols, 0, (double) nbytes_trees, (double) nhalos, best);
+                }
+            }
+            free_destination_bench(&dest);
+        }
+    }
+
+    close_mmap_file_ctrees(&mfile);
+    close(fd);
+    free(lines);
+    free(contents);
+    free(requested);
+    free_tree_index_ctrees(&index);
+    return status;
+}
+
+/* Parses a comma-separated list of sizes (with optional K/M suffixes, or `all` for -1) */
+static inline int parse_size_list_bench(const char *arg, int64_t *values, const int maxvalues)
+{
+    char *copy = strdup(arg), *string = copy, *token;
+    int n = 0;
+    while(copy != NULL && (token = strsep(&string, ",")) != NULL) {
+        if(token[0] == '\0') continue;
+        if(n == maxvalues) {
+            fprintf(stderr,"Error: Only %d values can be specified (list = `%s`)\n", maxvalues, arg);
+            free(copy);
+            return -1;
+        }
+        if(strcmp(token, "all") == 0) {
+            values[n++] = -1;
+            continue;
+        }
+        char *suffix = NULL;
+        errno = 0;
+        int64_t value = strtoll(token, &suffix, 10);
+        if(errno != 0 || suffix == token || value <= 0) {
+            fprintf(stderr,"Error: Could not parse `%s` (within `%s`) as a positive integer\n", token, arg);
+            free(copy);
+            return -1;
+        }
+        if(*suffix == 'K' || *suffix == 'k') value *= 1024;
+        else if(*suffix == 'M' || *suffix == 'm') value *= 1024*1024;
+        values[n++] = value;
+    }
+    free(copy);
+    return n;
+}
+
+static inline void usage_bench(const char *progname)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -o <file>     name of the synthetic file to generate (default `bench_tree_0_0_0.dat`)\n"
+            "  -i <file>     benchmark an existing `tree_?_?_?.dat` file instead (no file is generated)\n"
+            "  -n <ntrees>   number of trees (default 2000)\n"
+            "  -d <dist>     tree-size distribution: `constant`, `uniform` or `powerlaw` (default)\n"
+            "  -m <nhalos>   minimum number of halos per tree (default 1)\n"
+            "  -M <nhalos>   maximum number of halos per tree (default 20000)\n"
+            "  -a <slope>    slope of the power-law distribution, dN/dn ~ n^-slope (default 1.8)\n"
+            "  -c <ncols>    number of columns in the file, between 2 and %d (default %d)\n"
+            "  -f <format>   float formatting: `ctrees` (default), `fixed` (%%.6f) or `scientific` (%%.6e)\n"
+            "  -s <seed>     random seed (default 42)\n"
+            "  -r <nrepeat>  number of repeats; the fastest is reported (default 3)\n"
+            "  -k <list>     comma-separated column-subset sizes (default `1,4,16,all`)\n"
+            "  -b <list>     comma-separated buffer sizes for `read_single_tree_buffered_ctrees` (default `64K,1M,4M`)\n"
+            "  -g            only generate the file\n",
+            progname, CTREES_V101_NCOLS, CTREES_V101_NCOLS);
+}
+
+int main(int argc, char **argv)
+{
+    struct bench_options options = {.filename = "bench_tree_0_0_0.dat", .generate = 1, .ntrees = 2000,
+                                     .min_nhalos = 1, .max_nhalos = 20000, .slope = 1.8,
+                                     .distribution = BENCH_TREES_POWERLAW, .ncols = CTREES_V101_NCOLS,
+                                     .format = BENCH_FORMAT_CTREES, .seed = 42, .nrepeats = 3,
+                                     .nsubsets = 4, .subset_ncols = {1, 4, 16, -1},
+                                     .nbufsizes = 3, .bufsizes = {64*1024, 1024*1024, 4*1024*1024}};
+    int generate_only = 0;
+    int64_t values[BENCH_MAX_NBUFSIZES > BENCH_MAX_NSUBSETS ? BENCH_MAX_NBUFSIZES:BENCH_MAX_NSUBSETS];
+    int opt, n;
+    while((opt = getopt(argc, argv, "o:i:n:d:m:M:a:c:f:s:r:k:b:gh")) != -1) {
+        switch(opt) {
+        case 'o': options.filename = optarg; options.generate = 1; break;
+        case 'i': options.filename = optarg; options.generate = 0; break;
+        case 'n': options.ntrees = atoll(optarg); break;
+        case 'm': options.min_nhalos = atoll(optarg); break;
+        case 'M': options.max_nhalos = atoll(optarg); break;
+        case 'a': options.slope = atof(optarg); break;
+        case 'c': options.ncols = atoi(optarg); break;
+        case 's': options.seed = strtoull(optarg, NULL, 10); break;
+        case 'r': options.nrepeats = atoi(optarg); break;
+        case 'g': generate_only = 1; break;
+        case 'd':
+            if(strcmp(optarg, "constant") == 0) options.distribution = BENCH_TREES_CONSTANT;
+            else if(strcmp(optarg, "uniform") == 0) options.distribution = BENCH_TREES_UNIFORM;
+            else if(strcmp(optarg, "powerlaw") == 0) options.distribution = BENCH_TREES_POWERLAW;
+            else {
+                fprintf(stderr,"Error: Unknown tree-size distribution `%s`\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'f':
+            if(strcmp(optarg, "ctrees") == 0) options.format = BENCH_FORMAT_CTREES;
+            else if(strcmp(optarg, "fixed") == 0) options.format = BENCH_FORMAT_FIXED;
+            else if(strcmp(optarg, "scientific") == 0) options.format = BENCH_FORMAT_SCIENTIFIC;
+            else {
+                fprintf(stderr,"Error: Unknown float format `%s`\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'k':
+            n = parse_size_list_bench(optarg, values, BENCH_MAX_NSUBSETS);
+            if(n <= 0) return EXIT_FAILURE;
+            options.nsubsets = n;
+            for(int i=0;i<n;i++) options.subset_ncols[i] = values[i];
+            break;
+        case 'b':
+            n = parse_size_list_bench(optarg, values, BENCH_MAX_NBUFSIZES);
+            if(n <= 0) return EXIT_FAILURE;
+            options.nbufsizes = n;
+            for(int i=0;i<n;i++) options.bufsizes[i] = (size_t) values[i];
+            break;
+        default:
+            usage_bench(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if(options.ncols < 2 || options.ncols > CTREES_V101_NCOLS || options.ntrees <= 0 || options.min_nhalos <= 0 ||
+       options.max_nhalos < options.min_nhalos || options.nrepeats <= 0 || options.slope < 0.0) {
+        fprintf(stderr,"Error: Invalid options. Please check that 2 <= ncols <= %d, ntrees > 0, 0 < min_nhalos <= max_nhalos, "
+                "nrepeats > 0 and slope >= 0\n", CTREES_V101_NCOLS);
+        usage_bench(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if(options.generate) {
+        const double t0 = get_time_bench();
+        const int64_t nhalos = generate_file_bench(&options);
+        if(nhalos < 0) {
+            return EXIT_FAILURE;
+        }
+        fprintf(stdout, "# generated `%s` with %"PRId64" trees and %"PRId64" halos in %.2f seconds\n",
+                options.filename, options.ntrees, nhalos, get_time_bench() - t0);
+    }
+    if(generate_only) {
+        return EXIT_SUCCESS;
+    }
+
+    return run_benchmarks_bench(&options);
+}
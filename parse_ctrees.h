@@ -14,26 +14,196 @@
 #include <string.h>
 #include <sys/types.h>
 #include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <stddef.h> /* for offsetof macro*/
+#include <stdarg.h> /* for the log messages */
+#include <libgen.h> /* for dirname */
+#include <float.h> /* for FLT_EVAL_METHOD */
+#include <errno.h> /* for ERANGE */
 
 #include "sglib.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* The NUMA placement of the parallel readers (see `init_numa_topology_ctrees`) reads the topology from
+   `/sys/devices/system/node` and pins the threads with the raw `sched_setaffinity` system call, i.e., neither
+   libnuma nor _GNU_SOURCE are required. On other platforms, there is a single node and the threads are not pinned */
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+/* Optional support for compressed `tree_?_?_?.dat` files (see `open_compressed_file_ctrees`).
+   Define PARSE_CTREES_USE_ZLIB for (multi-member/BGZF) gzip and PARSE_CTREES_USE_ZSTD for
+   seekable zstd, and link with -lz and -lzstd respectively */
+#ifdef PARSE_CTREES_USE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef PARSE_CTREES_USE_ZSTD
+#include <zstd.h>
+#endif
+
+/* Define PARSE_CTREES_USE_PTHREADS (and compile with -pthread) for the background I/O
+   thread that reads ahead while the trees are being parsed (see `init_prefetcher_ctrees`) */
+#ifdef PARSE_CTREES_USE_PTHREADS
+#include <pthread.h>
+#endif
+
+/* Define PARSE_CTREES_USE_HDF5 (and compile with h5cc, or link with -lhdf5) to also write the converted
+   forests as chunked HDF5 datasets (see `init_forest_writer_ctrees`) */
+#ifdef PARSE_CTREES_USE_HDF5
+#include <hdf5.h>
+#endif
+
+/* Define PARSE_CTREES_USE_PERF_COUNTERS to collect the performance counters (bytes read, lines parsed, time
+   spent in the I/O etc) within `struct ctrees_reader` (see `struct ctrees_perf_counters`) */
+#ifdef PARSE_CTREES_USE_PERF_COUNTERS
+#include <time.h>
+#endif
+
+/* Define PARSE_CTREES_USE_MPI (and compile with mpicc) to distribute the trees of many `tree_?_?_?.dat`
+   files over the MPI ranks (see `read_trees_mpi_ctrees`) */
+#ifdef PARSE_CTREES_USE_MPI
+#include <mpi.h>
+#endif
+
+/* SIMD scanning for new-lines and column delimiters. The instruction set is selected at runtime
+   (see `get_simd_level_ctrees`). Define PARSE_CTREES_NO_SIMD to only use the scalar code */
+#if !defined(PARSE_CTREES_NO_SIMD) && defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define PARSE_CTREES_USE_X86_SIMD
+#include <immintrin.h>
+#elif !defined(PARSE_CTREES_NO_SIMD) && defined(__aarch64__) && defined(__ARM_NEON) && (defined(__GNUC__) || defined(__clang__))
+#define PARSE_CTREES_USE_NEON_SIMD
+#include <arm_neon.h>
+#endif
 
-/* this is the maximum number of CTREES columns that can be requested
-   (note: it is okay for the ctrees `tree_?_?_?.dat` files themselves to contain more columns)
+
+/* this is the maximum number of base pointers (in `struct base_ptr_info`). The number of requested CTREES columns is
+   not limited, except by the batched readers and writers, which store every column in its own base pointer
+   (note: it is okay for the ctrees `tree_?_?_?.dat` files themselves to contain more columns,
+   and the lines and the header can be of any length)
 */
+#ifndef PARSE_CTREES_MAX_NCOLS
 #define PARSE_CTREES_MAX_NCOLS      128
+#endif
 
 /* max. number of characters in a CTREES column name in the `tree_?_?_?.dat` file */
 #define PARSE_CTREES_MAX_COLNAME_LEN 64
 
-/* max. number of bytes to read at one call. Probably should
-   be larger than the number of characters in one line in the `tree_?_?_?.dat` file
-   Since the reads are unbuffered, increasing this value
-   may lead to better performance  */
+/* size of the (small) scratch buffers on the stack, e.g., for the error messages and for the lines in the
+   `locations.dat` and the `forests.list` files. Also the minimum size of the read buffer in `struct ctrees_buffered_reader`.
+   The lines (and the header) in the `tree_?_?_?.dat` file may be longer -- the read buffer grows as required */
 #define PARSE_CTREES_MAXBUFSIZE      1240
 
+/* default size (in bytes) of the re-usable buffer in `struct ctrees_buffered_reader`.
+   Each `pread` call reads (up to) this many bytes, so larger values
+   mean fewer syscalls per tree. Can be over-ridden at runtime via the
+   `bufsize` parameter to `init_buffered_reader_ctrees` */
+#ifndef PARSE_CTREES_DEFAULT_READ_BUFSIZE
+#define PARSE_CTREES_DEFAULT_READ_BUFSIZE  (4*1024*1024)
+#endif
+
+/* initial size (in bytes) of the read buffer allocated by `read_single_tree_ctrees`. The buffer
+   grows (by doubling) whenever a line does not fit */
+#ifndef PARSE_CTREES_SINGLE_TREE_BUFSIZE
+#define PARSE_CTREES_SINGLE_TREE_BUFSIZE  (64*1024)
+#endif
+
+/* max. number of bytes (beyond the current parsing position) that `read_single_tree_mmap_ctrees`
+   asks the kernel to pre-fault, via `madvise(MADV_WILLNEED)`, while parsing a tree */
+#ifndef PARSE_CTREES_MMAP_WILLNEED_BYTES
+#define PARSE_CTREES_MMAP_WILLNEED_BYTES  (8*1024*1024)
+#endif
+
+/* number of bytes pre-faulted first when the size of the tree is not known (doubled for every
+   following window, up to PARSE_CTREES_MMAP_WILLNEED_BYTES) */
+#ifndef PARSE_CTREES_MMAP_WILLNEED_MIN_BYTES
+#define PARSE_CTREES_MMAP_WILLNEED_MIN_BYTES  (64*1024)
+#endif
+
+/* max. number of bytes between two requested lines for `read_rows_ctrees` to fetch both lines with the same `pread` */
+#ifndef PARSE_CTREES_ROWS_MAX_GAP_BYTES
+#define PARSE_CTREES_ROWS_MAX_GAP_BYTES  (64*1024)
+#endif
+
+/* max. number of characters in any one (numeric) column in the `tree_?_?_?.dat` file */
+#ifndef PARSE_CTREES_MAX_TOKEN_LEN
+#define PARSE_CTREES_MAX_TOKEN_LEN   64
+#endif
+
+/* minimum number of columns that need to be skipped (between two requested columns) before the
+   SIMD token skipping is used. For fewer columns, the scalar loop is faster */
+#ifndef PARSE_CTREES_SIMD_MIN_SKIP_NCOLS
+#define PARSE_CTREES_SIMD_MIN_SKIP_NCOLS  4
+#endif
+
+/* the split of the parsing time into the tokenizing and the numeric conversion is measured on one
+   out of every PARSE_CTREES_PERF_SAMPLE_INTERVAL lines (and extrapolated to all the lines) */
+#ifndef PARSE_CTREES_PERF_SAMPLE_INTERVAL
+#define PARSE_CTREES_PERF_SAMPLE_INTERVAL 64
+#endif
+
+/* levels of the (non-error) diagnostic messages. Only the messages with a level <= PARSE_CTREES_LOG_LEVEL are compiled
+   in, and only those with a level <= the runtime level (see `set_log_level_ctrees`) are emitted */
+#define PARSE_CTREES_LOG_NONE      0
+#define PARSE_CTREES_LOG_ERROR     1
+#define PARSE_CTREES_LOG_WARNING   2
+#define PARSE_CTREES_LOG_INFO      3
+#define PARSE_CTREES_LOG_DEBUG     4
+
+#ifndef PARSE_CTREES_LOG_LEVEL
+#define PARSE_CTREES_LOG_LEVEL     PARSE_CTREES_LOG_DEBUG
+#endif
+
+/* the runtime log level, before any call to `set_log_level_ctrees` */
+#ifndef PARSE_CTREES_DEFAULT_LOG_LEVEL
+#define PARSE_CTREES_DEFAULT_LOG_LEVEL  PARSE_CTREES_LOG_WARNING
+#endif
+
+/* max. number of row filters (see `parse_header_with_filters_ctrees`) */
+#ifndef PARSE_CTREES_MAX_NFILTERS
+#define PARSE_CTREES_MAX_NFILTERS 16
+#endif
+
+/* number of decompressed frames (of a compressed file) that are kept in memory. Neighbouring
+   trees usually share a frame, so only a few frames are required for sequential access */
+#ifndef PARSE_CTREES_FRAME_CACHE_NFRAMES
+#define PARSE_CTREES_FRAME_CACHE_NFRAMES  8
+#endif
+
+/* max. uncompressed size (in bytes) of any one frame (gzip member or zstd frame) in a compressed file */
+#ifndef PARSE_CTREES_MAX_FRAME_BYTES
+#define PARSE_CTREES_MAX_FRAME_BYTES  (256*1024*1024)
+#endif
+
+/* max. number of read-ahead buffers in `struct ctrees_prefetcher` */
+#ifndef PARSE_CTREES_PREFETCH_MAX_NBUFFERS
+#define PARSE_CTREES_PREFETCH_MAX_NBUFFERS  8
+#endif
+
+/* max. number of batches queued for the writer thread in `struct ctrees_forest_writer` */
+#ifndef PARSE_CTREES_FOREST_MAX_NSLOTS
+#define PARSE_CTREES_FOREST_MAX_NSLOTS  8
+#endif
+
+/* min. number of halos for `build_tree_links_ctrees` to use multiple threads (smaller trees are linked serially) */
+#ifndef PARSE_CTREES_LINKS_MIN_PARALLEL_NHALOS
+#define PARSE_CTREES_LINKS_MIN_PARALLEL_NHALOS  (64*1024)
+#endif
+
+/* max. number of bytes that each rank reads in one collective read (see `read_trees_mpi_ctrees`) */
+#ifndef PARSE_CTREES_MPI_COLLECTIVE_BUFSIZE
+#define PARSE_CTREES_MPI_COLLECTIVE_BUFSIZE  (64*1024*1024)
+#endif
+
+/* max. number of characters in the (path of a) filename stored in `struct ctrees_tree_index` */
+#ifndef PARSE_CTREES_MAX_FILENAME_LEN
+#define PARSE_CTREES_MAX_FILENAME_LEN 1024
+#endif
+
 #if PARSE_CTREES_MAX_COLNAME_LEN < 64
 #error Some of the Consistent-Trees column names are long. Please increase PARSE_CTREES_MAX_COLNAME_LEN to be at least 64
 #endif
@@ -60,6 +230,78 @@
 #endif
 
 
+/* Sorts the ``max`` elements of the array ``a`` (same arguments as `SGLIB_ARRAY_QUICK_SORT`). The sglib quicksort
+   always picks the first element as the pivot, and is therefore quadratic for inputs that are already (nearly) sorted --
+   which is the common case for the tree indices and lists. An already sorted array is left untouched, and any other
+   array is heap-sorted (i.e., O(N log N) for every input). The sort is not stable */
+#define PARSE_CTREES_ARRAY_SORT(type, a, max, comparator, elem_exchanger) { \
+        int _is_sorted_ = 1;                                            \
+        for(int64_t _s_=1;_s_<(max);_s_++) {                            \
+            if(comparator(((a)[_s_-1]),((a)[_s_])) > 0) {               \
+                _is_sorted_ = 0;                                        \
+                break;                                                  \
+            }                                                           \
+        }                                                               \
+        if(_is_sorted_ == 0) {                                          \
+            SGLIB_ARRAY_HEAP_SORT(type, a, max, comparator, elem_exchanger); \
+        }                                                               \
+    }
+
+#define PARSE_CTREES_ARRAY_SINGLE_SORT(type, a, max, comparator) {      \
+        PARSE_CTREES_ARRAY_SORT(type, a, max, comparator, SGLIB_ARRAY_ELEMENTS_EXCHANGER); \
+    }
+
+
+/* The diagnostic messages are written to stderr, or passed (as one formatted string) to the user ``callback``
+   (see `set_log_callback_ctrees`). The settings are per translation unit, and should be changed before
+   any other threads start reading */
+typedef void (*ctrees_log_fn)(const int level, const char *message, void *userdata);
+
+struct ctrees_log_settings {
+    int level;
+    ctrees_log_fn callback;
+    void *userdata;
+};
+
+static struct ctrees_log_settings ctrees_log_settings = {.level = PARSE_CTREES_DEFAULT_LOG_LEVEL, .callback = NULL, .userdata = NULL};
+
+/* Sets the runtime log level (one of PARSE_CTREES_LOG_NONE ... PARSE_CTREES_LOG_DEBUG) and returns the previous level */
+static inline int set_log_level_ctrees(const int level)
+{
+    const int previous = ctrees_log_settings.level;
+    ctrees_log_settings.level = level;
+    return previous;
+}
+
+/* Redirects the diagnostic messages to ``callback`` (NULL for stderr) */
+static inline void set_log_callback_ctrees(ctrees_log_fn callback, void *userdata)
+{
+    ctrees_log_settings.callback = callback;
+    ctrees_log_settings.userdata = userdata;
+}
+
+static inline void log_message_ctrees(const int level, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    if(ctrees_log_settings.callback != NULL) {
+        char message[PARSE_CTREES_MAXBUFSIZE];
+        vsnprintf(message, sizeof(message), format, args);
+        ctrees_log_settings.callback(level, message, ctrees_log_settings.userdata);
+    } else {
+        vfprintf(stderr, format, args);
+    }
+    va_end(args);
+}
+
+#define PARSE_CTREES_LOG(LEVEL, ...)                                    \
+    do {                                                                \
+        if((LEVEL) <= PARSE_CTREES_LOG_LEVEL && (LEVEL) <= ctrees_log_settings.level) { \
+            log_message_ctrees((LEVEL), __VA_ARGS__);                   \
+        }                                                               \
+    } while (0)
+
+
 
 /* valid numeric types for the destination for any CTrees column.
    An 'int' in CTrees could be read into a 'double' pointer. These
@@ -78,10 +320,106 @@ enum parse_numeric_types
     U64 = 3, /* uint64_t */
     F32 = 4, /* float */
     F64 = 5, /* double */
+
+    /* narrow destinations -- integer values outside the range of the destination
+       type are reported as errors (never silently truncated) */
+    I8  = 6, /* int8_t */
+    I16 = 7, /* int16_t */
+    U8  = 8, /* uint8_t */
+    U16 = 9, /* uint16_t */
+    BOOL = 10, /* uint8_t -- any non-zero value is stored as 1 (e.g., 'mmp?') */
+    F16 = 11, /* IEEE 754 binary16 (half-precision), stored as the raw bits in a uint16_t.
+                 Use `half_to_float_ctrees` to recover the value */
+
+    /* fixed-point (quantized) destinations -- the value is linearly mapped from
+       [lo, hi] onto the full range of the unsigned integer, i.e.,
+       q = round((value - lo)/(hi - lo) * (2^nbits - 1)). The range *must* be set per
+       column with `set_column_quantization_ctrees` after parsing the header, and values
+       outside the range are reported as errors. Use `dequantize_q16_ctrees`/`dequantize_q32_ctrees`
+       to recover the value */
+    Q16 = 12, /* uint16_t */
+    Q32 = 13, /* uint32_t */
     num_numeric_types
 };
 
 
+/* how the string in each column is converted into the destination numeric type.
+
+   PARSE_CTREES_FAST_CONVERSION uses the built-in parsers that are tuned for the
+   `%d`/`%f`/`%e` type outputs written by Consistent-Trees (no locale, no hex).
+   The result is always identical to the corresponding libc routine -- any value that
+   the fast parser can not convert exactly is automatically delegated to the libc routine.
+
+   PARSE_CTREES_LIBC_CONVERSION always uses the libc routines (strtof, strtod, strtol etc) */
+enum parse_conversion_methods
+{
+    PARSE_CTREES_FAST_CONVERSION = 0,
+    PARSE_CTREES_LIBC_CONVERSION = 1,
+    num_conversion_methods
+};
+
+/* comparison operators for the row filters. The ``value`` in each column is compared against
+   ``lo`` (and ``hi`` for PARSE_CTREES_FILTER_IN_RANGE, where the range is inclusive at both ends) */
+enum parse_ctrees_filter_ops
+{
+    PARSE_CTREES_FILTER_EQ = 0,/* value == lo */
+    PARSE_CTREES_FILTER_NE = 1,/* value != lo */
+    PARSE_CTREES_FILTER_LT = 2,/* value < lo */
+    PARSE_CTREES_FILTER_LE = 3,/* value <= lo */
+    PARSE_CTREES_FILTER_GT = 4,/* value > lo */
+    PARSE_CTREES_FILTER_GE = 5,/* value >= lo */
+    PARSE_CTREES_FILTER_IN_RANGE = 6,/* lo <= value <= hi */
+    num_filter_ops
+};
+
+
+/* A pluggable allocator for the memory of the base pointers (see `struct ctrees_alloc_context`).
+   ``realloc`` has the same semantics as the libc `realloc`, but also receives the current size of the
+   allocation (``old_nbytes``, 0 for a NULL ``ptr``). See `struct ctrees_arena` for a slab-based allocator */
+struct ctrees_allocator {
+    void * (*realloc)(void *ptr, size_t old_nbytes, size_t new_nbytes, void *userdata);
+    void *userdata;
+};
+
+/* The allocator and the (re-)allocation counters for the base pointers. Only the functions that take this
+   context as an argument (the `*_alloc_ctrees` variants and `struct ctrees_reader`) use the allocator -- every
+   other function (re-)allocates the base pointers with the libc `realloc`. Zero-initialise for the libc `realloc` */
+struct ctrees_alloc_context {
+    struct ctrees_allocator *allocator;/* NULL uses the libc `realloc` */
+
+    /* diagnostic counters, updated by every (re-)allocation of the base pointers */
+    int64_t nreallocations;
+    int64_t nbytes_reallocated;/* bytes that the (re-)allocations may have to copy (i.e., the previously used sizes), summed over all the base pointers */
+};
+
+
+/* A slab (arena) allocator for the base pointers of many (small) trees. The memory for the base
+   pointers is carved out of large slabs and is released all at once by `reset_arena_ctrees` (typically
+   before every tree), i.e., the slabs are re-used and there is no malloc/free churn per tree.
+
+   Initialise with `init_arena_ctrees`, assign ``&arena.allocator`` to ``ctrees_alloc_context.allocator`` (and pass that
+   context to the `*_alloc_ctrees` functions), and release with `free_arena_ctrees`. The memory must *not* be freed
+   (or re-allocated by any function that does not take the context) by the user. Not thread-safe -- use one arena per thread */
+struct ctrees_arena_slab {
+    char *base;
+    size_t size;/* in bytes */
+    size_t used;/* in bytes */
+};
+
+struct ctrees_arena {
+    struct ctrees_allocator allocator;/* points to the arena */
+    size_t slab_size;/* (minimum) size of every slab in bytes */
+    int use_hugepages;/* back the slabs with (explicit or transparent) hugepages */
+    int64_t nslabs;
+    int64_t nallocated;
+    struct ctrees_arena_slab *slabs;
+    int64_t current;/* the slab that allocations are carved from */
+    char *last_alloc;/* the most recent allocation (can be grown in-place) */
+    size_t nbytes_in_use;/* since the last reset */
+    size_t max_nbytes_in_use;/* high-water mark over all the resets */
+};
+
+
 /* because, we do not know apriori how many halos will be in a tree,
    we will have to re-allocate as and when necessary. Therefore, we
    do need to keep a count of "independent" arrays, all of which need to be
@@ -126,17 +464,20 @@ struct base_ptr_info {
    which one of the base_ptrs each one of the columns needs to be assigned to (base_ptr_idx),
    and how to access the relevant memory address within the base_ptr_idx[N] (dest_offset_to_element)
 
-  By storing the struct elements on the stack, I avoid pesky issues of malloc/free
+  The per-column arrays are allocated to hold ``ncols`` elements, i.e., there is no limit on the number of
+  requested columns. The struct is an output of the header parsing (any previous contents are overwritten), and has to be
+  released with `free_column_to_ptr_ctrees`. Use `copy_column_to_ptr_ctrees` to duplicate it -- a plain struct
+  assignment shares the arrays
 
   The code will populate this struct in the function `parse_header_ctrees`, based on the columns requested in the
   user-specified variable `wanted_columns`
 */
 struct ctrees_column_to_ptr {
     int64_t ncols;/* number of columns that need to be parsed on each line (all these columns *DO* exist) */
-    int32_t column_number[PARSE_CTREES_MAX_NCOLS];/* column number in CTREES data */
-    enum parse_numeric_types field_types[PARSE_CTREES_MAX_NCOLS];/* destination data-type, i.e, how to parse the string into a valid numeric value */
+    int32_t *column_number;/* column number in CTREES data */
+    enum parse_numeric_types *field_types;/* destination data-type, i.e, how to parse the string into a valid numeric value */
     
-    int64_t base_ptr_idx[PARSE_CTREES_MAX_NCOLS];/* index into the base_ptr array within base_ptr_info struct */
+    int64_t *base_ptr_idx;/* index into the base_ptr array within base_ptr_info struct */
 
     /* dest_offset_to_element:
        For array-of-structures (AOS) type base-ptrs, this is the offsetof(field-name-within-struct-definition)
@@ -145,458 +486,8546 @@ struct ctrees_column_to_ptr {
        this offset must be >= 0 and < size of each element of the base ptr
        For offset values that are not 0, absolutely use the OFFSETOF macro
        to derive the byte offset of each field */
-    size_t dest_offset_to_element[PARSE_CTREES_MAX_NCOLS];/* in bytes */
+    size_t *dest_offset_to_element;/* in bytes */
+
+    /* how to convert each column -- set to PARSE_CTREES_FAST_CONVERSION by `parse_header_ctrees`
+       but can be changed (per column) by the user afterwards */
+    enum parse_conversion_methods *conversion_method;
+
+    /* range for the fixed-point (Q16/Q32) destinations -- set with `set_column_quantization_ctrees`.
+       Unused for the other destination types */
+    double *quant_lo;
+    double *quant_hi;
+    void *storage;/* for internal use: the single allocation that holds all of the per-column arrays above */
+
+    /* row filters -- set by `parse_header_with_filters_ctrees` (`parse_header_ctrees` sets nfilters to 0).
+       Only the rows that satisfy *all* of the filters are stored. The filters are sorted by the column number */
+    int64_t nfilters;
+    int32_t filter_column_number[PARSE_CTREES_MAX_NFILTERS];/* column number in CTREES data */
+    enum parse_ctrees_filter_ops filter_op[PARSE_CTREES_MAX_NFILTERS];
+    double filter_lo[PARSE_CTREES_MAX_NFILTERS];
+    double filter_hi[PARSE_CTREES_MAX_NFILTERS];
 };
 
 
+/* A row filter on one column, e.g., {"Mvir", PARSE_CTREES_FILTER_GT, 1e10, 0} or
+   {"snap_idx", PARSE_CTREES_FILTER_IN_RANGE, 100, 150}. The column values are converted
+   to double before the comparison (i.e., integer columns are compared exactly up to 2^53) */
+struct ctrees_filter {
+    char column_name[PARSE_CTREES_MAX_COLNAME_LEN];
+    enum parse_ctrees_filter_ops op;
+    double lo;
+    double hi;/* only used by PARSE_CTREES_FILTER_IN_RANGE */
+};
 
-/* This function takes the array of wanted CTREES columns (``wanted_columns``) and matches those against
- the column names that were found in the CTREEs output (``names``)
- ``nwanted`` is the number of elements in ``wanted_columns``
- ``totncols`` is the number of elements in ``names``
 
- Returns a integer array of ``nwanted`` elements, where each element of this array contains the column number
- in CTREES output if a match was found, otherwise contains a -1.
+/* A cache of the parsed headers (see `parse_header_cached_ctrees`), for reading many files that (mostly) share
+   the same header. Must be zero-initialised, and freed with `free_header_cache_ctrees` */
+struct ctrees_header_cache_entry {
+    uint64_t header_hash;/* of the entire header line */
+    uint64_t request_hash;/* of the requested columns (and their destinations) and the row filters */
+    size_t header_len;
+    char *header;/* the header line -- compared in full on a hash match */
+    size_t request_len;
+    char *request;/* the serialized request (see `pack_header_request_ctrees`) -- compared in full on a hash match */
+    struct ctrees_column_to_ptr column_info;
+};
 
- The performed string matching of column-names between ``wanted_columns`` and ``names`` is case-insensitive.
-*/
-static inline int * match_column_name(const char (*wanted_columns)[PARSE_CTREES_MAX_COLNAME_LEN], const int nwanted, const char (*names)[PARSE_CTREES_MAX_COLNAME_LEN], const int totncols)
-{
-    int *columns = calloc(nwanted, sizeof(*columns));
-    PARSE_CTREES_XASSERT(columns != NULL,
-                         NULL,
-                         "Error: Could not allocate memory for reading in the columns for each of the %d fields\n",
-                         nwanted);
-    for(int i=0;i<nwanted;i++) {
-        columns[i] = -1;
-    }
-    int nfound=0;
-    for(int i=0;i<nwanted;i++) {
-        const char *wanted_colname = wanted_columns[i];
-        int found=0;
-        for(int j=0;j<totncols;j++) {
-            const char *file_colname = names[j];
-            if (strcasecmp(wanted_colname, file_colname) == 0) {
-                fprintf(stderr, "Found `%s` in column # %d as with name `%s`\n", wanted_colname, j, file_colname);
-                columns[i] = j;
-                nfound++;
-                found = 1;
-                break;
-            }
-        }
-        if(found == 0) {
-            fprintf(stderr,"Did not find requested column `%s'\n", wanted_colname);
-        }
-    }
-    fprintf(stderr,"Found %d columns out of the requested %d\n", nfound, nwanted);
-    return columns;
-}
+struct ctrees_header_cache {
+    int64_t nentries;
+    int64_t nallocated;
+    struct ctrees_header_cache_entry *entries;
+    int64_t nhits;
+    int64_t nmisses;
+};
 
 
-/* Reallocates each one of the base pointers to the new requested number of elements */
-static inline int reallocate_base_ptrs(struct base_ptr_info *base_info, const int64_t new_N)
-{
-    fprintf(stderr,"reallocating from %"PRId64" elements to a %"PRId64" elements. current N = %"PRId64"\n",
-            base_info->nallocated, new_N, base_info->N);
-    for(int64_t i=0;i<base_info->num_base_ptrs;i++) {
-        void **this_ptr = base_info->base_ptrs[i];
-        const size_t size = base_info->base_element_size[i];
-        void *tmp = realloc(*this_ptr, size*new_N);
-        if(tmp == NULL) {
-            fprintf(stderr,"Error: Failed to re-allocated memory to go from %"PRId64" to %"PRId64" elements, each of size = %zu bytes\n",
-                    base_info->nallocated, new_N, size);
-            perror(NULL);
-            return EXIT_FAILURE;
-        }
 
-        /* we have successfully re-allocted => assign the new pointer address */
-        *(base_info->base_ptrs[i]) = tmp;
-    }
-    base_info->nallocated = new_N;
-    return EXIT_SUCCESS;
-}
+/* Performance counters, collected (per tree and cumulatively) by `struct ctrees_reader` when the library is
+   compiled with PARSE_CTREES_USE_PERF_COUNTERS. Use `write_perf_counters_json_ctrees` to dump the counters.
 
+   All the times are wall-clock seconds. The ``tokenize_seconds`` and ``convert_seconds`` are estimated by timing
+   one out of every PARSE_CTREES_PERF_SAMPLE_INTERVAL lines. The time spent otherwise (e.g., looking for
+   new-lines, growing the arrays, copying from the columnar cache) is the remainder of ``total_seconds`` */
+struct ctrees_perf_counters {
+    int64_t ntrees;
+    int64_t nbytes_read;/* from the input source (or the memory-map) */
+    int64_t nreads;/* reads from the input source (i.e., `pread` system calls for uncompressed files) */
+    int64_t nlines_parsed;/* halo lines (including the lines rejected by the row filters) */
+    int64_t nlines_rejected;/* by the row filters */
+    int64_t ntokens_skipped;/* columns that were stepped over without being converted */
+    int64_t ntokens_converted;
+    int64_t nreallocations;/* of the base pointers */
+    int64_t nbytes_reallocated;/* the existing contents of the base pointers that the reallocations may have copied */
+    double io_seconds;
+    double tokenize_seconds;
+    double convert_seconds;
+    double total_seconds;
+};
 
 
 
-static inline int parse_header_ctrees(char (*column_names)[PARSE_CTREES_MAX_COLNAME_LEN], enum parse_numeric_types *field_types,
-                                      int64_t *base_ptr_idx, size_t *dest_offset_to_element,
-                                      const int64_t nfields, const char *filename, struct ctrees_column_to_ptr *column_info)
-{
-    /* Because the struct elements (of column_info) are stored on the stack,
-       need to check that nfields can fit */
-    if(nfields > PARSE_CTREES_MAX_NCOLS) {
-        fprintf(stderr,"Error: You have requested %"PRId64" columns but there is only space to store %"PRId64"\n",nfields, (int64_t) PARSE_CTREES_MAX_NCOLS);
-        fprintf(stderr,"Please define the macro variable `PARSE_CTREES_MAX_NCOLS' to be larger than %"PRId64" (before including the file `%s')\n",
-                nfields, __FILE__);
-                
-        return EXIT_FAILURE;
-    } 
+/* signature for the functions that read (up to) ``nbytes`` into ``buf``, starting at the (uncompressed) ``offset``.
+   Same semantics as `pread`, i.e., returns the number of bytes read, 0 at the end of the file and -1 on error */
+typedef ssize_t (*ctrees_pread_fn)(void *handle, void *buf, size_t nbytes, off_t offset);
 
+/* Any input that can be read at random offsets, e.g., a file descriptor (see `get_fd_source_ctrees`)
+   or a compressed file (see `get_compressed_source_ctrees`). Used by `read_single_tree_source_ctrees` */
+struct ctrees_input_source {
+    ctrees_pread_fn pread;
+    void *handle;
+};
 
-    FILE *fp = fopen(filename, "rt");
-    if(fp == NULL) {
-        fprintf(stderr,"Error: Could not open file `%s'\n",filename);
-        perror(NULL);
-        return EXIT_FAILURE;
-    }
 
-    char linebuf[PARSE_CTREES_MAXBUFSIZE];
-    if(fgets(linebuf, PARSE_CTREES_MAXBUFSIZE, fp) == NULL) {
-        fprintf(stderr,"Error: Could not read the first line (the header) in the file `%s'\n", filename);
-        perror(NULL);
-        return EXIT_FAILURE;
-    }
+/* Identifies the input that the bytes held in a `struct ctrees_buffered_reader` came from. For a file descriptor,
+   the file itself (device, inode, size and modification time) is recorded rather than the descriptor, i.e., the
+   bytes are never re-used for a different file that happens to be opened with the same descriptor */
+struct ctrees_source_key {
+    ctrees_pread_fn pread;
+    const void *handle;/* NULL for file descriptors */
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    time_t mtime;
+};
 
-    /* file read was successful */
-    /* only need the first line -> close the file */
-    fclose(fp);
 
-    /* first check that the first character is a '#' */
-    if(linebuf[0] != '#') {
-        fprintf(stderr,"Error: Consistent-Trees output always contain '#' as the comment character\n"
-                "However, the first character in the buffer is '%c'\nEntire line is `%s'", linebuf[0], linebuf);
-        return EXIT_FAILURE;
-    }
-    char *tofree, *string;
-        
-    tofree = string = strdup(linebuf);
-    PARSE_CTREES_XASSERT(string != NULL,
-                         EXIT_FAILURE,
-                         "Error: Could not duplicate the header line (header: = `%s`\n)",
-                         linebuf);
-        
-    int totncols = 0;
-    char *token = NULL;
-        
-    /* CTREES currently uses white-space but this parsing will also
-       use the comma to break (i.e., if, in the future, the CTREES format changes
-       to using comma's, the code will still work) */
-    while ((token = strsep(&string, " ,")) != NULL) {
-        /* fprintf(stderr,"%35s %zu\n", token, strlen(token)); */
-        totncols++;
-    }
-    free(tofree);
+/* This struct holds the read-buffer for `read_single_tree_buffered_ctrees`.
 
+   The buffer is allocated once (via `init_buffered_reader_ctrees`) and
+   can then be re-used for reading any number of trees. Any line that is
+   only partially contained within one read is moved to the front of the
+   buffer and completed by the next read. The bytes that are left in the
+   buffer after a tree (i.e., the beginning of the following trees) are
+   kept, and the next tree is parsed directly from them if it starts within
+   the buffer. Therefore, reading consecutive trees from the same input reads
+   every byte (close to) once, regardless of the size of the buffer and of the trees.
 
-    /* read succeeded -> now parse the column names */
-    const char delimiters[] = " ,\n#";/* space, comma, new-line, and #*/
-    char (*names)[PARSE_CTREES_MAX_COLNAME_LEN] = calloc(totncols, sizeof(*names));
-    PARSE_CTREES_XASSERT(names != NULL,
-                         EXIT_FAILURE,
-                         "Error: Could not allocate memory to store each column name (total size requested = %zu bytes\n)",
-                         totncols * sizeof(*names));
+   Lines longer than the buffer grow the buffer (see `grow_buffered_reader_ctrees`).
+   Free the buffer with `free_buffered_reader_ctrees` */
+struct ctrees_buffered_reader {
+    char *buffer;
+    size_t bufsize;/* in bytes */
 
-    /* ``tofree`` is simply there to free the memory malloc'ed by strdup. ``string`` itself will get modified */
-    tofree = string = strdup(linebuf);
-    PARSE_CTREES_XASSERT(string != NULL,
-                         EXIT_FAILURE,
-                         "Error: Could not duplicate the header line (header: = `%s`\n)",
-                         linebuf);
-        
-    int col = 0;
-    while ((token = strsep(&string, delimiters)) != NULL) {
-        size_t size=0, totlen = strlen(token);
-        if(totlen == 0) continue;
-        /* fprintf(stderr,"[%d] -- '%s' -- ", col, token); */
-        PARSE_CTREES_XASSERT(totlen > 0 && totlen < PARSE_CTREES_MAX_COLNAME_LEN,
-                             EXIT_FAILURE,
-                             "totlen = %zu should be between (0, %d)\n",
-                             totlen, (int) PARSE_CTREES_MAX_COLNAME_LEN);
-        char *colname = names[col];
-        for(size_t i=0;i<totlen;i++) {
-            if(token[i] == '(') {
+    /* running totals over all the trees read via `read_tree_from_index_ctrees`. Used to
+       estimate the number of halos in a tree from the number of bytes */
+    int64_t nbytes_parsed;
+    int64_t nrows_parsed;
 
-#if 0
-                /* locate the ending ')' -- this while loop is only for additional
-                   testing and can be commented out */
-                size_t j = i+1;
-                while(j < totlen) {
-                    if(token[j] == ')') {
-                        token[j] = '\0';
-                        /* fprintf(stderr," `token = %s` ", &token[i+1]); */
-                        int ctrees_colnum = atoi(&(token[i+1]));
-                        PARSE_CTREES_XASSERT(ctrees_colnum == col, 
-                                             EXIT_FAILURE,
-                                             "ctrees_colnum = %d should equal col = %d\n",
-                                             ctrees_colnum, col);
-                        break;
-                    }
-                    j++;
-                }
-#endif
-                break;
-            }
-            colname[size] = token[i];
-            size++;
-        }
-        colname[size] = '\0';
-        /* fprintf(stderr, " `%s` \n", names[col]); */
-        col++;
-    }
-    PARSE_CTREES_XASSERT(col == totncols,
-                         EXIT_FAILURE,
-                         "Error: Previous parsing indicated %d columns in the header but only found %d actual column names\n"
-                         "Please check that the delimiters spefied to `strsep` are the same in all calls\n",
-                         totncols, col);
-    free(tofree);
+    /* the I/O counters are updated if not NULL (requires PARSE_CTREES_USE_PERF_COUNTERS) */
+    struct ctrees_perf_counters *perf;
 
-    int * matched_columns = match_column_name((const char (*)[PARSE_CTREES_MAX_COLNAME_LEN])column_names, nfields, (const char (*)[PARSE_CTREES_MAX_COLNAME_LEN]) names, totncols);
-    if(matched_columns == NULL) {
-        return EXIT_FAILURE;
+    /* offset (within the source) of the first byte in ``buffer``, updated after every read */
+    off_t buffer_offset;
+
+    /* the bytes [buffer_offset, buffer_offset + buffer_nbytes) of the input ``buffer_source`` are in ``buffer``
+       (0 if nothing can be re-used, see `invalidate_buffered_reader_ctrees`) */
+    size_t buffer_nbytes;
+    struct ctrees_source_key buffer_source;
+};
+
+
+
+/* This struct holds a read-only memory-map of an entire `tree_?_?_?.dat` file.
+   Populated by `open_mmap_file_ctrees` and released by `close_mmap_file_ctrees`.
+   Any number of trees can then be parsed (directly from the mapping) with
+   `read_single_tree_mmap_ctrees` */
+struct ctrees_mmap_file {
+    int fd;
+    const char *data;/* starting address of the mapping */
+    size_t size;/* size of the file (and the mapping) in bytes */
+};
+
+
+
+enum parse_ctrees_compression_formats
+{
+    PARSE_CTREES_UNCOMPRESSED = 0,
+    PARSE_CTREES_GZIP = 1,/* gzip with many (independently decompressible) members, e.g., BGZF written by `bgzip` */
+    PARSE_CTREES_ZSTD = 2,/* zstd with a seek table, e.g., written with `t2sz` or `zstd --seekable`-type tools */
+    num_compression_formats
+};
+
+/* one independently decompressible frame within a compressed file */
+struct ctrees_compressed_frame {
+    int64_t compressed_offset;/* in bytes, within the compressed file */
+    int64_t compressed_size;
+    int64_t offset;/* in bytes, within the uncompressed contents */
+    int64_t size;/* uncompressed size in bytes */
+};
+
+/* A compressed `tree_?_?_?.dat` file that can be read at random (uncompressed) offsets. Only the frames
+   covering the requested bytes are decompressed, and the most recently used
+   PARSE_CTREES_FRAME_CACHE_NFRAMES frames are kept in memory (i.e., neighbouring trees share the decompressed frames).
+   Populated by `open_compressed_file_ctrees` and freed by `close_compressed_file_ctrees`. Not thread-safe -- use one
+   struct per thread */
+struct ctrees_compressed_file {
+    int fd;
+    enum parse_ctrees_compression_formats format;
+    int64_t nframes;
+    int64_t nallocated;
+    struct ctrees_compressed_frame *frames;/* sorted by offset */
+    int64_t size;/* total uncompressed size in bytes */
+
+    char *compressed_buffer;
+    size_t compressed_bufsize;
+    char *cache_data[PARSE_CTREES_FRAME_CACHE_NFRAMES];
+    size_t cache_bufsize[PARSE_CTREES_FRAME_CACHE_NFRAMES];
+    int64_t cache_frame[PARSE_CTREES_FRAME_CACHE_NFRAMES];/* -1 for an empty slot */
+    uint64_t cache_last_used[PARSE_CTREES_FRAME_CACHE_NFRAMES];
+    uint64_t cache_clock;
+    int64_t nframes_decompressed;/* total number of frames decompressed (i.e., cache misses) */
+};
+
+
+#ifdef PARSE_CTREES_USE_PTHREADS
+/* A background I/O thread that reads ahead (sequentially) from an input ``source`` into ``nbuffers``
+   buffers, while the previous bytes are being parsed, i.e., the I/O and the parsing overlap. Reading from
+   any offset outside the read-ahead window discards the buffers and restarts the read-ahead at that offset.
+
+   Populated by `init_prefetcher_ctrees` and freed by `free_prefetcher_ctrees`. Use as an input source via
+   `get_prefetch_source_ctrees`. Only one thread may read from the prefetcher at a time */
+struct ctrees_prefetch_block {
+    int64_t offset;
+    int64_t nbytes;/* valid bytes (less than the buffer size only at the end of the source) */
+    int state;/* 0: empty, 1: being read, 2: ready */
+    char *data;
+};
+
+struct ctrees_prefetcher {
+    struct ctrees_input_source source;
+    int nbuffers;
+    size_t bufsize;/* in bytes, per buffer */
+    struct ctrees_prefetch_block blocks[PARSE_CTREES_PREFETCH_MAX_NBUFFERS];
+
+    int64_t next_offset;/* the next offset to be read by the I/O thread */
+    uint64_t generation;/* incremented every time the read-ahead is restarted */
+    int reached_eof;
+    int stop;
+    int io_error;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    int64_t nrestarts;/* number of times the read-ahead was restarted (i.e., non-sequential access) */
+    int64_t nwaits;/* number of times the parser had to wait for the I/O */
+};
+#endif /* PARSE_CTREES_USE_PTHREADS */
+
+
+
+/* signature for the functions that convert one token (not NUL-terminated) and write the value to ``dest`` */
+typedef int (*ctrees_converter_fn)(const char *token, const size_t toklen, void *dest);
+
+/* signature for the functions that skip over ``ntokens`` columns starting at ``this``. Returns the
+   address just past the last skipped column (and the starting address of that column in ``token``),
+   or NULL if the line (ending at ``end``) does not contain enough columns */
+typedef const char * (*ctrees_skip_tokens_fn)(const char *this, const char *end, int32_t ntokens, const char **token);
+
+/* This struct contains a "compiled" version of `struct ctrees_column_to_ptr`, specific to one
+   `struct base_ptr_info`. All the validation (of base_ptr_idx, strides, offsets and the field types) happens
+   once, within `compile_column_plan_ctrees`, so that parsing each line only needs to skip
+   tokens, locate the destination and call the converter.
+
+   The destination base pointers are stored as 'void **'. Therefore, the plan remains valid
+   even after the base pointers are re-allocated. The plan does need to be re-compiled if
+   the ``column_info`` or the ``base_ptr_info`` are changed in any other way. The per-column
+   arrays are allocated by `compile_column_plan_ctrees` and released with `free_column_plan_ctrees` */
+struct ctrees_column_plan {
+    int64_t ncols;
+    int32_t *column_number;/* column number in CTREES data */
+    int32_t *ncols_to_advance;/* number of tokens to move forward from the previous requested column (0 for a duplicate column) */
+    void ***dest_base_ptr;/* resolved from base_ptr_info->base_ptrs[base_ptr_idx] */
+    size_t *dest_stride;/* in bytes */
+    size_t *dest_offset;/* in bytes */
+    ctrees_converter_fn *convert;
+
+    /* the fixed-point (Q16/Q32) columns are converted as doubles and then quantized over [quant_lo, quant_hi] */
+    int8_t *is_quantized;
+    enum parse_numeric_types *quant_type;
+    double *quant_lo;
+    double *quant_hi;
+    void *storage;/* the single allocation that holds all of the per-column arrays above (released with `free_column_plan_ctrees`) */
+    ctrees_skip_tokens_fn skip_tokens;/* SIMD (or scalar) token skipping for the available instruction set */
+
+    /* the row filters are evaluated (in a separate pass over the line) before any of the columns are
+       converted, i.e., the rejected rows never reach the (more expensive) conversion of all the columns */
+    int64_t nfilters;
+    int32_t filter_column_number[PARSE_CTREES_MAX_NFILTERS];
+    int32_t filter_ncols_to_advance[PARSE_CTREES_MAX_NFILTERS];/* same as ncols_to_advance but for the filter columns */
+    enum parse_ctrees_filter_ops filter_op[PARSE_CTREES_MAX_NFILTERS];
+    double filter_lo[PARSE_CTREES_MAX_NFILTERS];
+    double filter_hi[PARSE_CTREES_MAX_NFILTERS];
+
+    /* the parsing counters are updated if not NULL (requires PARSE_CTREES_USE_PERF_COUNTERS). Set to NULL by
+       `compile_column_plan_ctrees`. The number of tokens per line are the same for every line and are computed once */
+    struct ctrees_perf_counters *perf;
+    int64_t *nlines_for_sampling;/* every PARSE_CTREES_PERF_SAMPLE_INTERVAL'th line counted here is timed. Unlike ``perf``, not reset
+                                    per tree (e.g., owned by `struct ctrees_reader`), so that small trees are sampled too. NULL uses ``perf->nlines_parsed`` */
+
+    /* the base pointers are grown with this context (see `grow_base_ptrs_alloc_ctrees`). Set to NULL (i.e., the libc `realloc`)
+       by `compile_column_plan_ctrees` */
+    struct ctrees_alloc_context *alloc_context;
+    int64_t ntokens_skipped_per_line;
+    int64_t ntokens_converted_per_line;
+    int64_t nfilter_tokens_skipped_per_line;
+    int64_t nfilter_tokens_converted_per_line;
+};
+
+
+
+/* Location of one tree within the `tree_?_?_?.dat` files. The ``offset`` is the byte offset of the
+   `#tree <tree_id>` line that precedes the halos of each tree (i.e., the same convention as in the
+   Consistent-Trees `locations.dat` file). This offset can be passed directly to any of
+   the `read_single_tree_*` functions.
+
+   Any field that is not known is set to -1 */
+struct ctrees_tree_index_entry {
+    int64_t tree_id;/* the (root) id of the tree */
+    int64_t forest_id;/* from `forests.list` */
+    int64_t offset;/* in bytes, within the file with the id `file_id` */
+    int64_t nbytes;/* total number of bytes in this tree (including the `#tree` line) */
+    int64_t nhalos;/* number of halos (i.e., lines) in this tree */
+    int32_t file_id;/* index into the `filenames` within `struct ctrees_tree_index` */
+};
+
+
+/* An index of all the trees, possibly spread over many `tree_?_?_?.dat` files. Populated by
+   `load_locations_ctrees`, `build_tree_index_ctrees` or `read_tree_index_ctrees`
+   and freed with `free_tree_index_ctrees`
+
+   The trees are stored sorted by (file_id, offset), i.e., in the order that they appear on disk */
+struct ctrees_tree_index {
+    int64_t ntrees;
+    int64_t nallocated;
+    struct ctrees_tree_index_entry *trees;
+
+    int32_t nfiles;
+    char (*filenames)[PARSE_CTREES_MAX_FILENAME_LEN];/* indexed by file_id */
+};
+
+
+
+/* Callbacks for reading many trees in parallel (see `read_trees_parallel_ctrees`). The
+   callbacks are invoked from the thread (with id = ``thread_id``) that reads the tree, and
+   therefore must be thread-safe. Each thread has its own `struct base_ptr_info` that persists across
+   all the trees read by that thread (initially zeroed), with N reset to 0 before every tree.
+
+   init_base_ptrs: Called before the tree is read. Must populate ``base_ptr_info``, i.e., point the
+                   base pointers to memory owned by this thread (either fresh allocations or re-used
+                   from the previous tree)
+   process_tree:   Called after the tree has been read (may be NULL). The ``base_ptr_info->N``
+                   halos of the tree are available in the base pointers
+
+   Returning anything other than EXIT_SUCCESS from either callback stops the reading */
+struct ctrees_parallel_callbacks {
+    int (*init_base_ptrs)(const struct ctrees_tree_index_entry *tree, struct base_ptr_info *base_ptr_info, const int thread_id, void *userdata);
+    int (*process_tree)(const struct ctrees_tree_index_entry *tree, struct base_ptr_info *base_ptr_info, const int thread_id, void *userdata);
+    void *userdata;
+};
+
+
+/* The NUMA nodes and their CPUs (see `init_numa_topology_ctrees`). The CPUs of the i'th node are
+   cpus[cpu_start[i]] ... cpus[cpu_start[i+1] - 1]. Freed with `free_numa_topology_ctrees` */
+struct ctrees_numa_topology {
+    int32_t nnodes;
+    int32_t *node_id;/* the (OS) id of the i'th node, nnodes elements */
+    int32_t *cpu_start;/* nnodes + 1 elements */
+    int32_t *cpus;/* cpu_start[nnodes] elements */
+    int32_t max_cpu;/* the largest CPU id (on any node) */
+};
+
+
+/* The row ranges of every tree, as found by the single-pass scan of an entire file (`read_all_trees_ctrees`).
+   The halos of all the trees are stored one after the other in the same base pointers, i.e., the halos of the
+   i'th tree are the rows [row_start[i], row_start[i] + nhalos[i]). Every array has ``ntrees`` valid elements,
+   in the order that the trees appear in the file. Freed with `free_tree_ranges_ctrees` */
+struct ctrees_tree_ranges {
+    int64_t ntrees;
+    int64_t nallocated;
+    int64_t *tree_id;/* from the `#tree <tree_id>` line */
+    int64_t *offset;/* in bytes, of the `#tree` line within the (uncompressed) file */
+    int64_t *row_start;/* index of the first halo of the tree within the base pointers */
+    int64_t *nhalos;/* number of halos stored (i.e., that passed the row filters) */
+};
+
+
+/* The id columns that `build_tree_links_ctrees` converts into row indices. All the columns are read with the same
+   ``stride`` (in bytes, 0 means sizeof(int64_t)), i.e., either all the columns are separate arrays (SOA) or all
+   the columns are fields of the same array of structures (AOS, then use the address of the field in the first element) */
+struct ctrees_link_columns {
+    int64_t nhalos;
+    size_t stride;
+    const int64_t *id;/* required */
+    const int64_t *desc_id;/* optional (NULL) -- the descendant and progenitor links are then not built */
+    const int64_t *pid;/* optional (NULL) -- the host links are then not built */
+    const int64_t *upid;/* optional (NULL) -- the fof_host links are then not built */
+    const double *mass;/* optional (NULL) -- the progenitors of every halo are ordered by decreasing mass (i.e., the most massive
+                          progenitor is the first progenitor), otherwise by the order of the rows */
+};
+
+/* The row indices (within the same set of halos) derived from the id columns by `build_tree_links_ctrees`.
+   Each array contains ``nhalos`` elements (or is NULL, if the corresponding id column was not supplied).
+   A missing link is denoted by -1. Freed with `free_tree_links_ctrees` */
+struct ctrees_tree_links {
+    int64_t nhalos;
+    int64_t *descendant;/* row of the halo with id == desc_id */
+    int64_t *first_progenitor;/* row of the first halo that has this halo as the descendant */
+    int64_t *next_progenitor;/* row of the next halo with the same descendant */
+    int64_t *host;/* row of the halo with id == pid */
+    int64_t *fof_host;/* row of the halo with id == upid, or the row of the halo itself for a (fof) host halo */
+    int64_t nunmatched;/* number of non-negative desc_id/pid/upid values that do not match any id */
+};
+
+/* The location of every stored halo line within the (uncompressed) file, recorded by the indexed readers
+   (e.g., `read_single_tree_indexed_ctrees`) such that more columns can be parsed later, for selected rows
+   only (see `read_rows_ctrees`). Row ``i`` of the line index is row ``i`` of the base pointers that were
+   read alongside, i.e., reset ``nrows`` whenever ``N`` of the base pointers is reset. Freed with `free_line_index_ctrees` */
+struct ctrees_line_index {
+    int64_t nrows;
+    int64_t nallocated;
+    int64_t *offset;/* in bytes, of the first character of the line */
+    uint32_t *length;/* in bytes, excluding the new-line */
+};
+
+
+
+/* A fixed-size block of parsed halos, handed to the user callback by the streaming readers
+   (`stream_single_tree_buffered_ctrees` and `stream_single_tree_mmap_ctrees`).
+   Allocated with `init_batch_ctrees` and freed with `free_batch_ctrees`.
+
+   Every requested column is stored as a separate (contiguous) array of ``batch_rows`` elements in
+   ``columns``, in the same order as within the `struct ctrees_column_to_ptr` used to initialise the
+   batch, i.e., ``columns[i]`` holds ``nrows`` values of type ``field_types[i]``. Use `find_batch_column_ctrees`
+   to locate the column that would have been written to (base_ptr_idx, dest_offset_to_element).
+
+   Only the first ``nrows`` rows are valid, and the contents are overwritten by the next batch. The
+   struct must not be copied (or moved) after initialisation */
+struct ctrees_batch {
+    int64_t ncols;
+    int64_t batch_rows;/* max. number of rows in one batch */
+    int64_t nrows;/* number of valid rows in the current batch */
+    int64_t first_row;/* row number (within the current tree) of the first row in this batch */
+    int32_t column_number[PARSE_CTREES_MAX_NCOLS];/* column number in CTREES data */
+    enum parse_numeric_types field_types[PARSE_CTREES_MAX_NCOLS];
+    int64_t base_ptr_idx[PARSE_CTREES_MAX_NCOLS];/* copied from the `struct ctrees_column_to_ptr` */
+    size_t dest_offset_to_element[PARSE_CTREES_MAX_NCOLS];/* copied from the `struct ctrees_column_to_ptr` */
+    void *columns[PARSE_CTREES_MAX_NCOLS];
+
+    /* for internal use: every column is parsed into its own base pointer */
+    struct base_ptr_info base_ptr_info;
+    struct ctrees_column_plan plan;
+};
+
+/* signature for the callback that consumes each (full, or the last partial) batch of halos of a tree.
+   Returning anything other than EXIT_SUCCESS stops the reading */
+typedef int (*ctrees_batch_callback_fn)(const struct ctrees_batch *batch, void *userdata);
+
+
+
+/* Layout of the columnar binary cache written by `write_columnar_cache_ctrees`. All the fields are
+   64-bit (native byte order) so that the structs can be directly used from the memory-map:
+
+   struct ctrees_cache_file_header
+   struct ctrees_cache_column[ncols]
+   struct ctrees_cache_tree[ntrees] (sorted by offset within the source file)
+   column data -- for every column, ``nrows`` contiguous elements of the type ``field_type``
+                  (each column starts at a 64-byte aligned offset)
+
+   The cache is stale if the size or the modification time of the source file have changed, or if the
+   header of the source file (i.e., the column names) differs from the one used to build the cache */
+struct ctrees_cache_file_header {
+    char magic[8];
+    int64_t version;
+    int64_t source_size;/* in bytes */
+    int64_t source_mtime_sec;
+    int64_t source_mtime_nsec;
+    uint64_t header_hash;/* FNV-1a hash of the first line (the header) of the source file */
+    uint64_t filter_hash;/* hash of the row filters that were applied while building the cache */
+    int64_t ncols;
+    int64_t ntrees;
+    int64_t nrows;/* total number of rows (in every column) */
+};
+
+struct ctrees_cache_column {
+    int64_t column_number;/* column number in CTREES data */
+    int64_t field_type;/* enum parse_numeric_types */
+    int64_t element_size;/* in bytes */
+    int64_t data_offset;/* in bytes, from the beginning of the cache file */
+    double quant_lo;/* quantization range for the fixed-point (Q16/Q32) columns, 0 otherwise */
+    double quant_hi;
+};
+
+struct ctrees_cache_tree {
+    int64_t tree_id;
+    int64_t forest_id;
+    int64_t offset;/* offset of the `#tree` line within the source file */
+    int64_t data_offset;/* offset of the first halo within the source file */
+    int64_t nbytes;/* within the source file */
+    int64_t row_start;/* index of the first row of this tree in the column data */
+    int64_t nrows;
+};
+
+/* A memory-mapped columnar cache. Populated by `open_columnar_cache_ctrees` and released by `close_columnar_cache_ctrees` */
+struct ctrees_columnar_cache {
+    struct ctrees_mmap_file mfile;
+    const struct ctrees_cache_file_header *header;
+    const struct ctrees_cache_column *columns;
+    const struct ctrees_cache_tree *trees;
+};
+
+
+/* Output formats for the converted forests (see `init_forest_writer_ctrees`) */
+enum parse_ctrees_forest_formats
+{
+    PARSE_CTREES_FOREST_BINARY = 0,/* the chunked columnar binary file described below */
+    PARSE_CTREES_FOREST_HDF5 = 1,/* one chunked (extendible) dataset per column, requires PARSE_CTREES_USE_HDF5 */
+    num_forest_formats
+};
+
+/* Layout of the binary forest file written by `struct ctrees_forest_writer`. The batches of halos are appended to
+   chunks of (at most) ``batch_rows`` rows, and every chunk is written as soon as it is full, i.e., the file is only ever
+   appended to. Consecutive trees share a chunk (a batch is never split), so that many small trees do not each occupy
+   (and pad) a chunk of their own, while a large tree spans several consecutive chunks. Within a chunk, the ``nrows``
+   values of every column are stored one column after the other (each column starts at a 64-byte aligned offset, see
+   `get_forest_column_offset_ctrees`). All the fields are 64-bit (native byte order):
+
+   struct ctrees_forest_file_header
+   chunks, from offset 64 onwards
+   struct ctrees_forest_column[ncols] (at ``footer_offset``)
+   struct ctrees_forest_tree[ntrees] (in the order that the trees were written)
+   struct ctrees_forest_chunk[nchunks]
+
+   The header is written last, i.e., an incomplete file is never considered valid */
+struct ctrees_forest_file_header {
+    char magic[8];
+    int64_t version;
+    int64_t ncols;
+    int64_t ntrees;
+    int64_t nchunks;
+    int64_t nrows;/* total number of rows (in every column) */
+    int64_t footer_offset;/* in bytes, from the beginning of the file */
+};
+
+struct ctrees_forest_column {
+    char name[PARSE_CTREES_MAX_COLNAME_LEN];
+    int64_t column_number;/* column number in CTREES data */
+    int64_t field_type;/* enum parse_numeric_types */
+    int64_t element_size;/* in bytes */
+    double quant_lo;/* quantization range for the fixed-point (Q16/Q32) columns, 0 otherwise */
+    double quant_hi;
+};
+
+struct ctrees_forest_tree {
+    int64_t tree_id;
+    int64_t forest_id;
+    int64_t row_start;/* index of the first row of this tree (over all the chunks) */
+    int64_t nrows;
+    int64_t first_chunk;/* the chunks of one tree are consecutive (and may also hold the rows of the neighbouring trees) */
+    int64_t nchunks;
+};
+
+struct ctrees_forest_chunk {
+    int64_t first_tree;/* the chunk holds (some of) the rows of the trees [first_tree, first_tree + ntrees) */
+    int64_t ntrees;
+    int64_t row_start;/* index of the first row of this chunk (over all the chunks) */
+    int64_t nrows;
+    int64_t data_offset;/* in bytes, from the beginning of the file */
+};
+
+/* A memory-mapped binary forest file (see `open_forest_file_ctrees`) */
+struct ctrees_forest_file {
+    struct ctrees_mmap_file mfile;
+    const struct ctrees_forest_file_header *header;
+    const struct ctrees_forest_column *columns;
+    const struct ctrees_forest_tree *trees;
+    const struct ctrees_forest_chunk *chunks;
+};
+
+/* one chunk waiting to be written by the writer thread */
+struct ctrees_forest_slot {
+    char *data;/* the columns, with the same layout as the chunk in the binary file (``batch_rows`` apart while being filled) */
+    size_t nbytes;
+    struct ctrees_forest_chunk chunk;
+    int state;/* 0: empty, 1: ready to be written, 2: being written */
+};
+
+/* Writes the batches of halos (from the streaming readers, e.g., `stream_single_tree_buffered_ctrees` with the callback
+   `write_batch_to_forest_ctrees`) straight into the output file. Therefore, the memory use is bounded by a few batches,
+   regardless of the size of the trees. With PARSE_CTREES_USE_PTHREADS, a writer thread writes the queued batches while the
+   next ones are being parsed, i.e., the parsing and the writing overlap.
+
+   Populated by `init_forest_writer_ctrees`, and the output is completed (and the writer freed) by `close_forest_writer_ctrees` */
+struct ctrees_forest_writer {
+    int format;/* enum parse_ctrees_forest_formats */
+    char filename[PARSE_CTREES_MAX_FILENAME_LEN];
+    int fd;/* for PARSE_CTREES_FOREST_BINARY */
+#ifdef PARSE_CTREES_USE_HDF5
+    hid_t h5_file;/* for PARSE_CTREES_FOREST_HDF5 */
+    hid_t h5_datasets[PARSE_CTREES_MAX_NCOLS];
+#endif
+    int64_t ncols;
+    struct ctrees_forest_column columns[PARSE_CTREES_MAX_NCOLS];
+
+    int64_t ntrees;
+    int64_t ntrees_allocated;
+    struct ctrees_forest_tree *trees;
+    int64_t nchunks;
+    int64_t nchunks_allocated;
+    struct ctrees_forest_chunk *chunks;
+    int64_t nrows;
+    int64_t file_offset;/* where the next chunk is written */
+
+    int64_t batch_rows;/* max. number of rows in one batch (and in one chunk) */
+    struct ctrees_forest_chunk pending_chunk;/* the chunk being filled (in slots[next_slot]), empty if nrows == 0 */
+    int nslots;
+    int next_slot;/* the next slot to be filled */
+    size_t slot_nbytes;/* space for one full batch */
+    struct ctrees_forest_slot slots[PARSE_CTREES_FOREST_MAX_NSLOTS];
+    int io_error;
+    int64_t nwaits;/* number of times the parser had to wait for the writer thread */
+#ifdef PARSE_CTREES_USE_PTHREADS
+    int next_write_slot;/* the next slot to be written */
+    int use_thread;
+    int stop;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+#endif
+};
+
+
+/* A reader for one `tree_?_?_?.dat` file (optionally compressed), holding all the state that is otherwise
+   re-established on every call: the parsed header (``column_info``), the open file, the read buffer, the tree index,
+   the compiled column plan and (optionally) the memory-map, the columnar cache and the read-ahead thread.
+
+   Opened with `open_reader_ctrees`, the trees are then read with `read_tree_with_reader_ctrees` (at random) or
+   `read_next_tree_ctrees` (in file order), and all the resources are released with `close_reader_ctrees`.
+   Only ``column_info``, ``index`` and ``stats`` are meant to be read by the user -- all the other fields are internal.
+   The struct must not be copied (or moved) after opening. Not thread-safe -- use one reader per thread */
+struct ctrees_reader_options {
+    const char *index_file;/* binary tree index -- re-used if up-to-date, otherwise written (see `load_or_build_tree_index_ctrees`). May be NULL */
+    const char *cache_file;/* columnar cache -- built if necessary (see `load_or_build_columnar_cache_ctrees`). May be NULL. Only for uncompressed files */
+    size_t bufsize;/* read buffer in bytes, 0 for PARSE_CTREES_DEFAULT_READ_BUFSIZE */
+    int use_mmap;/* parse directly from a memory-map of the file. Only for uncompressed files */
+    int prefetch_nbuffers;/* > 0 reads ahead with a background thread (requires PARSE_CTREES_USE_PTHREADS) */
+    struct ctrees_header_cache *header_cache;/* shared between the readers of files with the same header (see `parse_header_cached_ctrees`). May be NULL */
+    struct ctrees_allocator *allocator;/* (re-)allocates the base pointers (e.g., ``&arena.allocator``). NULL for the libc `realloc` */
+};
+
+struct ctrees_reader_stats {
+    int64_t ntrees_read;
+    int64_t nhalos_read;/* number of halos stored (i.e., after the row filters) */
+    int64_t nbytes_read;/* total size of the trees read, within the (uncompressed) file */
+    int64_t ntrees_from_cache;/* number of trees copied from the columnar cache */
+    int64_t nplans_compiled;/* number of times the column plan had to be (re-)compiled */
+};
+
+struct ctrees_reader {
+    char filename[PARSE_CTREES_MAX_FILENAME_LEN];
+    struct ctrees_column_to_ptr column_info;
+    struct ctrees_tree_index index;
+    struct ctrees_reader_stats stats;
+    /* only collected with PARSE_CTREES_USE_PERF_COUNTERS */
+    struct ctrees_perf_counters tree_perf;/* for the most recently read tree */
+    int64_t nlines_for_sampling;/* cumulative over all the trees (see `ctrees_column_plan.nlines_for_sampling`) */
+    struct ctrees_perf_counters total_perf;/* summed over all the trees read */
+    struct ctrees_alloc_context alloc_context;/* the allocator from the options, and the (re-)allocations summed over all the trees read */
+
+    int64_t next_tree;/* position within index.trees of the tree returned by `read_next_tree_ctrees` */
+    int64_t *tree_order_by_id;/* positions within index.trees sorted by the tree id (built on first use) */
+    enum parse_ctrees_compression_formats format;
+    int fd;
+    int cfile_is_open;
+    int use_mmap;
+    int use_cache;
+    struct ctrees_compressed_file cfile;
+    struct ctrees_mmap_file mfile;
+    struct ctrees_columnar_cache cache;
+    struct ctrees_buffered_reader buffered_reader;
+    struct ctrees_input_source source;/* the file, the compressed file or the read-ahead thread */
+#ifdef PARSE_CTREES_USE_PTHREADS
+    int use_prefetch;
+    struct ctrees_prefetcher prefetcher;
+#endif
+
+    /* the column plan is compiled for one set of base pointers and is re-used while those remain the same */
+    int plan_is_valid;
+    struct ctrees_column_plan plan;
+    int64_t plan_num_base_ptrs;
+    void **plan_base_ptrs[PARSE_CTREES_MAX_NCOLS];
+    size_t plan_base_element_size[PARSE_CTREES_MAX_NCOLS];
+};
+
+
+
+#define PARSE_CTREES_FNV1A_OFFSET_BASIS      UINT64_C(14695981039346656037)
+#define PARSE_CTREES_FNV1A_PRIME             UINT64_C(1099511628211)
+
+/* Updates the 64-bit FNV-1a ``hash`` with ``nbytes`` bytes from ``data``. Start with PARSE_CTREES_FNV1A_OFFSET_BASIS */
+static inline uint64_t fnv1a_hash_ctrees(const void *data, const size_t nbytes, uint64_t hash)
+{
+    const unsigned char *bytes = (const unsigned char *) data;
+    for(size_t i=0;i<nbytes;i++) {
+        hash ^= bytes[i];
+        hash *= PARSE_CTREES_FNV1A_PRIME;
+    }
+    return hash;
+}
+
+/* Returns the (case-insensitive) 64-bit FNV-1a hash of the NUL-terminated column ``name`` */
+static inline uint64_t hash_column_name_ctrees(const char *name)
+{
+    uint64_t hash = PARSE_CTREES_FNV1A_OFFSET_BASIS;
+    for(const unsigned char *c = (const unsigned char *) name; *c != '\0'; c++) {
+        const unsigned char folded = (*c >= 'A' && *c <= 'Z') ? (unsigned char) (*c - 'A' + 'a') : *c;
+        hash ^= folded;
+        hash *= PARSE_CTREES_FNV1A_PRIME;
+    }
+    return hash;
+}
+
+
+/* Known alternative names for the same column, across the versions of Consistent-Trees (and the codes that
+   post-process the trees). A requested column that does not exist (under its own name) in the file is matched
+   with any other name within the same (NULL-terminated) group. The matching is case-insensitive, so the groups
+   only list the names that differ beyond the case */
+static const char * const ctrees_column_aliases[][4] = {/* at most 3 names per group */
+    {"snap_num", "snap_idx", "snapnum", NULL},
+    {"mmp?", "mmp", NULL},
+    {"Tree_root_ID", "TreeRootID", NULL},
+    {"Orig_halo_ID", "OrigHaloID", NULL},
+    {"Breadth_first_ID", "BreadthFirstID", NULL},
+    {"Depth_first_ID", "DepthFirstID", NULL},
+    {"Next_coprogenitor_depthfirst_ID", "NextCoprogenitorDepthFirstID", NULL},
+    {"Last_progenitor_depthfirst_ID", "LastProgenitorDepthFirstID", NULL},
+    {"Last_mainleaf_depthfirst_ID", "LastMainleafDepthFirstID", NULL},
+    {"scale_of_last_MM", "scale_of_last_major_merger", NULL},
+    {"num_prog", "nprog", NULL},
+    {"Vmax@Mpeak", "Vmax\\@Mpeak", "Vmax_at_Mpeak", NULL},
+    {"Halfmass_Scale", "Halfmass_a", NULL},
+};
+
+
+/* Returns the group (row) within `ctrees_column_aliases` that contains ``name``, or -1 */
+static inline int find_column_alias_group_ctrees(const char *name)
+{
+    const int ngroups = (int) (sizeof(ctrees_column_aliases)/sizeof(ctrees_column_aliases[0]));
+    for(int i=0;i<ngroups;i++) {
+        for(int j=0;ctrees_column_aliases[i][j] != NULL;j++) {
+            if(strcasecmp(name, ctrees_column_aliases[i][j]) == 0) return i;
+        }
+    }
+    return -1;
+}
+
+
+/* Returns the column number of ``name`` within the hash ``table`` (of ``tablesize`` elements, a power of 2) of
+   the column ``names`` in the file, or -1 if not found. On duplicate names, the first column is returned */
+static inline int find_column_in_table_ctrees(const char *name, const int *table, const uint64_t tablesize,
+                                              const char (*names)[PARSE_CTREES_MAX_COLNAME_LEN])
+{
+    for(uint64_t slot = hash_column_name_ctrees(name) & (tablesize - 1); table[slot] != -1; slot = (slot + 1) & (tablesize - 1)) {
+        if(strcasecmp(name, names[table[slot]]) == 0) return table[slot];
+    }
+    return -1;
+}
+
+
+/* This function takes the array of wanted CTREES columns (``wanted_columns``) and matches those against
+ the column names that were found in the CTREEs output (``names``)
+ ``nwanted`` is the number of elements in ``wanted_columns``
+ ``totncols`` is the number of elements in ``names``
+
+ Returns a integer array of ``nwanted`` elements, where each element of this array contains the column number
+ in CTREES output if a match was found, otherwise contains a -1.
+
+ The performed string matching of column-names between ``wanted_columns`` and ``names`` is case-insensitive. The
+ names in the file are stored in a hash table, so each lookup takes constant time. Columns that are not found under
+ the requested name are looked up under their known aliases (see `ctrees_column_aliases`), e.g., `snap_idx` matches `Snap_num`
+*/
+static inline int * match_column_name(const char (*wanted_columns)[PARSE_CTREES_MAX_COLNAME_LEN], const int nwanted, const char (*names)[PARSE_CTREES_MAX_COLNAME_LEN], const int totncols)
+{
+    int *columns = calloc(nwanted + 1, sizeof(*columns));
+    PARSE_CTREES_XASSERT(columns != NULL,
+                         NULL,
+                         "Error: Could not allocate memory for reading in the columns for each of the %d fields\n",
+                         nwanted);
+    /* open addressing with linear probing, at most half full */
+    uint64_t tablesize = 16;
+    while(tablesize < 2 * (uint64_t) totncols) tablesize *= 2;
+    int *table = malloc(tablesize * sizeof(*table));
+    if(table == NULL) {
+        fprintf(stderr,"Error: Could not allocate memory for the hash table of %d column names\n", totncols);
+        free(columns);
+        return NULL;
+    }
+    for(uint64_t i=0;i<tablesize;i++) {
+        table[i] = -1;
+    }
+    for(int j=0;j<totncols;j++) {
+        uint64_t slot = hash_column_name_ctrees(names[j]) & (tablesize - 1);
+        while(table[slot] != -1) slot = (slot + 1) & (tablesize - 1);
+        table[slot] = j;
+    }
+
+    int nfound=0;
+    for(int i=0;i<nwanted;i++) {
+        const char *wanted_colname = wanted_columns[i];
+        columns[i] = find_column_in_table_ctrees(wanted_colname, table, tablesize, names);
+        const char *alias = NULL;
+        if(columns[i] == -1) {
+            const int group = find_column_alias_group_ctrees(wanted_colname);
+            for(int j=0;group >= 0 && ctrees_column_aliases[group][j] != NULL && columns[i] == -1;j++) {
+                alias = ctrees_column_aliases[group][j];
+                columns[i] = find_column_in_table_ctrees(alias, table, tablesize, names);
+            }
+        }
+        if(columns[i] == -1) {
+            PARSE_CTREES_LOG(PARSE_CTREES_LOG_WARNING, "Did not find requested column `%s'\n", wanted_colname);
+            continue;
+        }
+        if(alias != NULL) {
+            PARSE_CTREES_LOG(PARSE_CTREES_LOG_INFO, "Found `%s` in column # %d as with name `%s` (via the alias `%s`)\n", wanted_colname, columns[i], names[columns[i]], alias);
+        } else {
+            PARSE_CTREES_LOG(PARSE_CTREES_LOG_INFO, "Found `%s` in column # %d as with name `%s`\n", wanted_colname, columns[i], names[columns[i]]);
+        }
+        nfound++;
+    }
+    free(table);
+    PARSE_CTREES_LOG(PARSE_CTREES_LOG_INFO, "Found %d columns out of the requested %d\n", nfound, nwanted);
+    return columns;
+}
+
+
+/* Initialises ``base_info`` (no base pointers and no elements). Optional -- provided for convenience */
+static inline void init_base_ptr_info_ctrees(struct base_ptr_info *base_info)
+{
+    memset(base_info, 0, sizeof(*base_info));
+}
+
+
+/* Same as `reallocate_base_ptrs` but with the allocator (and the counters) in ``alloc_context``.
+   A NULL ``alloc_context`` uses the libc `realloc` */
+static inline int reallocate_base_ptrs_alloc_ctrees(struct base_ptr_info *base_info, struct ctrees_alloc_context *alloc_context, const int64_t new_N)
+{
+    const struct ctrees_allocator *allocator = (alloc_context == NULL) ? NULL : alloc_context->allocator;
+    PARSE_CTREES_LOG(PARSE_CTREES_LOG_DEBUG, "reallocating from %"PRId64" elements to a %"PRId64" elements. current N = %"PRId64"\n",
+                     base_info->nallocated, new_N, base_info->N);
+    for(int64_t i=0;i<base_info->num_base_ptrs;i++) {
+        void **this_ptr = base_info->base_ptrs[i];
+        const size_t size = base_info->base_element_size[i];
+        void *tmp = (allocator == NULL) ? realloc(*this_ptr, size*new_N)
+            : allocator->realloc(*this_ptr, size*base_info->nallocated, size*new_N, allocator->userdata);
+        if(tmp == NULL) {
+            fprintf(stderr,"Error: Failed to re-allocated memory to go from %"PRId64" to %"PRId64" elements, each of size = %zu bytes\n",
+                    base_info->nallocated, new_N, size);
+            perror(NULL);
+            return EXIT_FAILURE;
+        }
+
+        /* we have successfully re-allocted => assign the new pointer address */
+        *(base_info->base_ptrs[i]) = tmp;
+        if(alloc_context != NULL) {
+            alloc_context->nbytes_reallocated += size*((new_N < base_info->nallocated) ? new_N : base_info->nallocated);
+        }
+    }
+    base_info->nallocated = new_N;
+    if(alloc_context != NULL) {
+        alloc_context->nreallocations++;
+    }
+    return EXIT_SUCCESS;
+}
+
+/* Reallocates each one of the base pointers to the new requested number of elements */
+static inline int reallocate_base_ptrs(struct base_ptr_info *base_info, const int64_t new_N)
+{
+    return reallocate_base_ptrs_alloc_ctrees(base_info, NULL, new_N);
+}
+
+
+
+
+/* Returns a new slab of (at least) ``size`` bytes, mapped directly from the kernel. With ``use_hugepages``,
+   explicit hugepages (MAP_HUGETLB) are tried first, and then transparent hugepages (MADV_HUGEPAGE) are requested */
+static inline int add_arena_slab_ctrees(struct ctrees_arena *arena, const size_t size)
+{
+    if(arena->nslabs == arena->nallocated) {
+        const int64_t new_N = (arena->nallocated < 16) ? 16 : 2*arena->nallocated;
+        struct ctrees_arena_slab *tmp = realloc(arena->slabs, new_N * sizeof(*tmp));
+        if(tmp == NULL) {
+            fprintf(stderr,"Error: Could not allocate memory for %"PRId64" arena slabs\n", new_N);
+            return EXIT_FAILURE;
+        }
+        arena->slabs = tmp;
+        arena->nallocated = new_N;
+    }
+    const size_t hugepage_size = 2*1024*1024;
+    const size_t nbytes = (size + hugepage_size - 1) / hugepage_size * hugepage_size;
+    void *base = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if(arena->use_hugepages) {
+        base = mmap(NULL, nbytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+#endif
+    if(base == MAP_FAILED) {
+        base = mmap(NULL, nbytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(base == MAP_FAILED) {
+            fprintf(stderr,"Error: Could not map an arena slab of %zu bytes\n", nbytes);
+            perror(NULL);
+            return EXIT_FAILURE;
+        }
+#ifdef MADV_HUGEPAGE
+        if(arena->use_hugepages) {
+            madvise(base, nbytes, MADV_HUGEPAGE);
+        }
+#endif
+    }
+    struct ctrees_arena_slab *slab = &(arena->slabs[arena->nslabs]);
+    slab->base = (char *) base;
+    slab->size = nbytes;
+    slab->used = 0;
+    arena->nslabs++;
+    return EXIT_SUCCESS;
+}
+
+
+/* The `ctrees_allocator.realloc` for the arena. The most recent allocation is grown in-place (if there is space
+   in the slab); otherwise a new block is carved out and the contents are copied. Memory is only released by `reset_arena_ctrees` */
+static inline void *arena_realloc_ctrees(void *ptr, size_t old_nbytes, size_t new_nbytes, void *userdata)
+{
+    struct ctrees_arena *arena = (struct ctrees_arena *) userdata;
+    const size_t alignment = 64;
+    if(new_nbytes == 0) {
+        return NULL;
+    }
+    new_nbytes = (new_nbytes + alignment - 1) & ~(alignment - 1);
+    if(new_nbytes <= old_nbytes && ptr != NULL) {
+        return ptr;
+    }
+
+    struct ctrees_arena_slab *slab = (arena->current < arena->nslabs) ? &(arena->slabs[arena->current]) : NULL;
+    if(ptr != NULL && ptr == arena->last_alloc && slab != NULL) {
+        const size_t start = (char *) ptr - slab->base;
+        if(start + new_nbytes <= slab->size) {
+            arena->nbytes_in_use += new_nbytes - (slab->used - start);
+            slab->used = start + new_nbytes;
+            if(arena->nbytes_in_use > arena->max_nbytes_in_use) arena->max_nbytes_in_use = arena->nbytes_in_use;
+            return ptr;
+        }
+    }
+
+    /* carve a new block out of the current slab, or the next slab that has enough space */
+    while(slab != NULL && slab->used + new_nbytes > slab->size) {
+        arena->current++;
+        slab = (arena->current < arena->nslabs) ? &(arena->slabs[arena->current]) : NULL;
+    }
+    if(slab == NULL) {
+        const size_t size = (new_nbytes > arena->slab_size) ? new_nbytes : arena->slab_size;
+        if(add_arena_slab_ctrees(arena, size) != EXIT_SUCCESS) {
+            return NULL;
+        }
+        arena->current = arena->nslabs - 1;
+        slab = &(arena->slabs[arena->current]);
+    }
+    char *block = slab->base + slab->used;
+    slab->used += new_nbytes;
+    arena->nbytes_in_use += new_nbytes;
+    if(arena->nbytes_in_use > arena->max_nbytes_in_use) arena->max_nbytes_in_use = arena->nbytes_in_use;
+    if(ptr != NULL && old_nbytes > 0) {
+        memcpy(block, ptr, old_nbytes);
+    }
+    arena->last_alloc = block;
+    return block;
+}
+
+
+/* Initialises an (empty) arena with slabs of at least ``slab_size`` bytes (0 for 64 MB) */
+static inline int init_arena_ctrees(struct ctrees_arena *arena, const size_t slab_size, const int use_hugepages)
+{
+    memset(arena, 0, sizeof(*arena));
+    arena->slab_size = (slab_size == 0) ? (size_t) 64*1024*1024 : slab_size;
+    arena->use_hugepages = use_hugepages;
+    arena->allocator.realloc = arena_realloc_ctrees;
+    arena->allocator.userdata = arena;
+    return EXIT_SUCCESS;
+}
+
+
+/* Releases all the allocations in the arena at once (the slabs are kept for re-use). If the previous
+   allocations needed more than one slab, the slabs are replaced by one slab that can hold all of them */
+static inline int reset_arena_ctrees(struct ctrees_arena *arena)
+{
+    size_t total = 0;
+    int64_t nused = 0;
+    for(int64_t i=0;i<arena->nslabs;i++) {
+        total += arena->slabs[i].size;
+        nused += (arena->slabs[i].used > 0);
+        arena->slabs[i].used = 0;
+    }
+    arena->current = 0;
+    arena->last_alloc = NULL;
+    arena->nbytes_in_use = 0;
+    if(nused > 1) {
+        for(int64_t i=0;i<arena->nslabs;i++) {
+            munmap(arena->slabs[i].base, arena->slabs[i].size);
+        }
+        arena->nslabs = 0;
+        return add_arena_slab_ctrees(arena, total);
+    }
+    return EXIT_SUCCESS;
+}
+
+
+static inline void free_arena_ctrees(struct ctrees_arena *arena)
+{
+    for(int64_t i=0;i<arena->nslabs;i++) {
+        munmap(arena->slabs[i].base, arena->slabs[i].size);
+    }
+    free(arena->slabs);
+    arena->slabs = NULL;
+    arena->nslabs = 0;
+    arena->nallocated = 0;
+    arena->current = 0;
+    arena->last_alloc = NULL;
+    arena->nbytes_in_use = 0;
+}
+
+
+/* Prepares ``base_ptr_info`` for the next tree when the base pointers are allocated from the ``arena`` (i.e., via a
+   `struct ctrees_alloc_context` with ``&arena->allocator``): resets the arena and sets every base pointer to NULL (with N = nallocated = 0) */
+static inline int reset_base_ptrs_arena_ctrees(struct base_ptr_info *base_ptr_info, struct ctrees_arena *arena)
+{
+    for(int64_t i=0;i<base_ptr_info->num_base_ptrs;i++) {
+        *(base_ptr_info->base_ptrs[i]) = NULL;
+    }
+    base_ptr_info->nallocated = 0;
+    base_ptr_info->N = 0;
+    return reset_arena_ctrees(arena);
+}
+
+
+/* Same as `reserve_base_ptrs_ctrees` but with the allocator (and the counters) in ``alloc_context`` (may be NULL) */
+static inline int reserve_base_ptrs_alloc_ctrees(struct base_ptr_info *base_info, struct ctrees_alloc_context *alloc_context, const int64_t nrows)
+{
+    if(nrows <= base_info->nallocated) {
+        return EXIT_SUCCESS;
+    }
+    return reallocate_base_ptrs_alloc_ctrees(base_info, alloc_context, nrows);
+}
+
+/* Ensures that each one of the base pointers has space for at least ``nrows`` elements (never shrinks),
+   i.e., allocates once when the number of halos is known in advance */
+static inline int reserve_base_ptrs_ctrees(struct base_ptr_info *base_info, const int64_t nrows)
+{
+    return reserve_base_ptrs_alloc_ctrees(base_info, NULL, nrows);
+}
+
+
+/* Same as `shrink_base_ptrs_to_fit_ctrees` but with the allocator (and the counters) in ``alloc_context`` (may be NULL) */
+static inline int shrink_base_ptrs_to_fit_alloc_ctrees(struct base_ptr_info *base_info, struct ctrees_alloc_context *alloc_context)
+{
+    if(base_info->N == base_info->nallocated || base_info->N == 0) {
+        return EXIT_SUCCESS;
+    }
+    return reallocate_base_ptrs_alloc_ctrees(base_info, alloc_context, base_info->N);
+}
+
+/* Releases any unused memory, i.e., re-allocates each of the base pointers to exactly N elements */
+static inline int shrink_base_ptrs_to_fit_ctrees(struct base_ptr_info *base_info)
+{
+    return shrink_base_ptrs_to_fit_alloc_ctrees(base_info, NULL);
+}
+
+
+static inline uint32_t read_le32_ctrees(const unsigned char *p)
+{
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+/* `pread` for the input sources that are regular file descriptors (``handle`` points to the 'int' fd) */
+static inline ssize_t pread_fd_ctrees(void *handle, void *buf, size_t nbytes, off_t offset)
+{
+    return pread(*((int *) handle), buf, nbytes, offset);
+}
+
+static inline struct ctrees_input_source get_fd_source_ctrees(int *fd)
+{
+    struct ctrees_input_source source = {.pread = pread_fd_ctrees, .handle = fd};
+    return source;
+}
+
+/* Fills ``key`` for the input ``source`` (see `struct ctrees_source_key`). Returns EXIT_FAILURE if the
+   file behind a file descriptor can not be identified, i.e., nothing should be re-used for that source */
+static inline int get_source_key_ctrees(const struct ctrees_input_source *source, struct ctrees_source_key *key)
+{
+    memset(key, 0, sizeof(*key));
+    key->pread = source->pread;
+    if(source->pread != pread_fd_ctrees) {
+        key->handle = source->handle;
+        return EXIT_SUCCESS;
+    }
+    struct stat st;
+    if(fstat(*((const int *) source->handle), &st) != 0) {
+        return EXIT_FAILURE;
+    }
+    key->dev = st.st_dev;
+    key->ino = st.st_ino;
+    key->size = st.st_size;
+    key->mtime = st.st_mtime;
+    return EXIT_SUCCESS;
+}
+
+/* Reads exactly ``nbytes`` from ``fd`` at ``offset`` (retrying short reads) */
+static inline int pread_all_ctrees(int fd, void *buf, const size_t nbytes, off_t offset)
+{
+    size_t nread = 0;
+    while(nread < nbytes) {
+        ssize_t n = pread(fd, (char *) buf + nread, nbytes - nread, offset + nread);
+        if(n <= 0) {
+            return EXIT_FAILURE;
+        }
+        nread += n;
+    }
+    return EXIT_SUCCESS;
+}
+
+
+/* Detects the compression format of ``filename`` from the magic bytes at the beginning of the file */
+static inline int get_compression_format_ctrees(const char *filename, enum parse_ctrees_compression_formats *format)
+{
+    int fd = open(filename, O_RDONLY);
+    if(fd < 0) {
+        fprintf(stderr,"Error: Could not open file `%s'\n", filename);
+        perror(NULL);
+        return EXIT_FAILURE;
+    }
+    unsigned char magic[4] = {0};
+    const ssize_t nread = pread(fd, magic, sizeof(magic), 0);
+    close(fd);
+    *format = PARSE_CTREES_UNCOMPRESSED;
+    if(nread >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        *format = PARSE_CTREES_GZIP;
+    } else if(nread == 4 && read_le32_ctrees(magic) == 0xFD2FB528U) {
+        *format = PARSE_CTREES_ZSTD;
+    }
+    return EXIT_SUCCESS;
+}
+
+
+static inline int add_compressed_frame_ctrees(struct ctrees_compressed_file *cfile, const int64_t compressed_offset,
+                                              const int64_t compressed_size, const int64_t size)
+{
+    if(size < 0 || size > PARSE_CTREES_MAX_FRAME_BYTES || compressed_size <= 0) {
+        fprintf(stderr,"Error: Frame # %"PRId64" (at compressed offset = %"PRId64") contains %"PRId64" uncompressed bytes but at most %"PRId64" "
+                "bytes are supported per frame. Please re-compress the file with smaller (independent) frames, e.g., with `bgzip`, "
+                "or define PARSE_CTREES_MAX_FRAME_BYTES to be larger\n",
+                cfile->nframes, compressed_offset, size, (int64_t) PARSE_CTREES_MAX_FRAME_BYTES);
+        return EXIT_FAILURE;
+    }
+    if(cfile->nframes == cfile->nallocated) {
+        const int64_t new_N = (cfile->nallocated < 1024) ? 1024 : 2*cfile->nallocated;
+        struct ctrees_compressed_frame *tmp = realloc(cfile->frames, new_N * sizeof(*tmp));
+        if(tmp == NULL) {
+            fprintf(stderr,"Error: Could not allocate memory for %"PRId64" compressed frames\n", new_N);
+            perror(NULL);
+            return EXIT_FAILURE;
+        }
+        cfile->frames = tmp;
+        cfile->nallocated = new_N;
+    }
+    struct ctrees_compressed_frame *frame = &(cfile->frames[cfile->nframes]);
+    frame->compressed_offset = compressed_offset;
+    frame->compressed_size = compressed_size;
+    frame->offset = cfile->size;
+    frame->size = size;
+    cfile->size += size;
+    cfile->nframes++;
+    return EXIT_SUCCESS;
+}
+
+
+#ifdef PARSE_CTREES_USE_ZLIB
+/* Locates every member of the gzip file. For BGZF files, only the block headers are read (the
+   compressed size is in the `BC` extra field and the uncompressed size in the trailer). Otherwise, the
+   entire file is decompressed once to locate the member boundaries */
+static inline int index_gzip_members_ctrees(struct ctrees_compressed_file *cfile, const int64_t filesize)
+{
+    unsigned char hdr[18];
+    int64_t pos = 0;
+    int is_bgzf = 1;
+    while(pos < filesize && is_bgzf) {
+        if(pos + (int64_t) sizeof(hdr) > filesize || pread_all_ctrees(cfile->fd, hdr, sizeof(hdr), pos) != EXIT_SUCCESS) {
+            is_bgzf = 0;
+            break;
+        }
+        /* BGZF: FLG.FEXTRA set, XLEN=6, SI1='B', SI2='C', SLEN=2, followed by BSIZE (total block size - 1) */
+        if(hdr[0] != 0x1f || hdr[1] != 0x8b || (hdr[3] & 4) == 0 || hdr[10] != 6 || hdr[11] != 0 ||
+           hdr[12] != 'B' || hdr[13] != 'C' || hdr[14] != 2 || hdr[15] != 0) {
+            is_bgzf = 0;
+            break;
+        }
+        const int64_t block_size = (int64_t) (hdr[16] | (hdr[17] << 8)) + 1;
+        unsigned char isize[4];
+        if(pos + block_size > filesize || pread_all_ctrees(cfile->fd, isize, sizeof(isize), pos + block_size - 4) != EXIT_SUCCESS) {
+            is_bgzf = 0;
+            break;
+        }
+        const int64_t size = read_le32_ctrees(isize);
+        /* the (empty) EOF marker block of BGZF files is skipped */
+        if(size > 0 && add_compressed_frame_ctrees(cfile, pos, block_size, size) != EXIT_SUCCESS) {
+            return EXIT_FAILURE;
+        }
+        pos += block_size;
+    }
+    if(is_bgzf) {
+        return EXIT_SUCCESS;
+    }
+
+    /* generic multi-member gzip -> decompress everything once */
+    cfile->nframes = 0;
+    cfile->size = 0;
+    const size_t chunk = 1024*1024;
+    unsigned char *in = malloc(chunk), *out = malloc(chunk);
+    if(in == NULL || out == NULL) {
+        fprintf(stderr,"Error: Could not allocate memory for scanning the gzip file\n");
+        free(in);
+        free(out);
+        return EXIT_FAILURE;
+    }
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if(inflateInit2(&strm, 16 + MAX_WBITS) != Z_OK) {
+        fprintf(stderr,"Error: Could not initialise zlib\n");
+        free(in);
+        free(out);
+        return EXIT_FAILURE;
+    }
+    int status = EXIT_SUCCESS;
+    int64_t member_start = 0, in_offset = 0;
+    while(status == EXIT_SUCCESS) {
+        if(strm.avail_in == 0) {
+            const ssize_t nread = pread(cfile->fd, in, chunk, in_offset);
+            if(nread < 0) {
+                perror(NULL);
+                status = EXIT_FAILURE;
+                break;
+            }
+            if(nread == 0) {
+                /* the last member must be complete -- otherwise the file was truncated */
+                if(in_offset > member_start) {
+                    fprintf(stderr,"Error: The gzip file is truncated (the member at compressed offset = %"PRId64" is incomplete)\n", member_start);
+                    status = EXIT_FAILURE;
+                }
+                break;
+            }
+            strm.next_in = in;
+            strm.avail_in = (uInt) nread;
+            in_offset += nread;
+        }
+        strm.next_out = out;
+        strm.avail_out = (uInt) chunk;
+        const int ret = inflate(&strm, Z_NO_FLUSH);
+        if(ret == Z_STREAM_END) {
+            const int64_t member_end = in_offset - strm.avail_in;
+            status = add_compressed_frame_ctrees(cfile, member_start, member_end - member_start, (int64_t) strm.total_out);
+            member_start = member_end;
+            /* stop at any trailing garbage (e.g., zero-padding) after the last member */
+            if(strm.avail_in == 0) {
+                unsigned char next[2];
+                if(pread(cfile->fd, next, 2, in_offset) != 2 || next[0] != 0x1f || next[1] != 0x8b) break;
+            } else if(strm.avail_in < 2 || strm.next_in[0] != 0x1f || strm.next_in[1] != 0x8b) {
+                break;
+            }
+            inflateReset(&strm);
+        } else if(ret != Z_OK && ret != Z_BUF_ERROR) {
+            fprintf(stderr,"Error: Could not decompress the gzip file (zlib error = %d)\n", ret);
+            status = EXIT_FAILURE;
+        }
+    }
+    inflateEnd(&strm);
+    free(in);
+    free(out);
+    return status;
+}
+#endif /* PARSE_CTREES_USE_ZLIB */
+
+
+#ifdef PARSE_CTREES_USE_ZSTD
+/* Reads the seek table of a seekable zstd file. The seek table is a skippable frame at the end of the file:
+   [entries: Compressed_Size(4) Decompressed_Size(4) [Checksum(4)]] followed by
+   Number_Of_Frames(4) Seek_Table_Descriptor(1) Seekable_Magic_Number(4) */
+static inline int index_seekable_zstd_ctrees(struct ctrees_compressed_file *cfile, const int64_t filesize)
+{
+    const uint32_t seekable_magic = 0x8F92EAB1U;
+    const uint32_t skippable_magic = 0x184D2A5EU;
+    unsigned char footer[9];
+    if(filesize < (int64_t) (8 + sizeof(footer)) || pread_all_ctrees(cfile->fd, footer, sizeof(footer), filesize - sizeof(footer)) != EXIT_SUCCESS ||
+       read_le32_ctrees(footer + 5) != seekable_magic) {
+        fprintf(stderr,"Error: The zstd file does not contain a seek table. Please compress with a seekable zstd tool "
+                "(random access into a plain zstd stream is not supported)\n");
+        return EXIT_FAILURE;
+    }
+    const int64_t nframes = read_le32_ctrees(footer);
+    const int64_t entry_size = (footer[4] & 0x80) ? 12:8;
+    const int64_t table_size = nframes * entry_size;
+    const int64_t table_start = filesize - (int64_t) sizeof(footer) - table_size;
+    unsigned char skippable_header[8];
+    if(table_start < 8 || pread_all_ctrees(cfile->fd, skippable_header, sizeof(skippable_header), table_start - 8) != EXIT_SUCCESS ||
+       read_le32_ctrees(skippable_header) != skippable_magic ||
+       read_le32_ctrees(skippable_header + 4) != (uint32_t) (table_size + sizeof(footer))) {
+        fprintf(stderr,"Error: The seek table in the zstd file is corrupt\n");
+        return EXIT_FAILURE;
+    }
+    unsigned char *table = malloc(table_size + 1);
+    if(table == NULL || pread_all_ctrees(cfile->fd, table, table_size, table_start) != EXIT_SUCCESS) {
+        fprintf(stderr,"Error: Could not read the seek table (%"PRId64" frames) from the zstd file\n", nframes);
+        free(table);
+        return EXIT_FAILURE;
+    }
+    int64_t compressed_offset = 0;
+    int status = EXIT_SUCCESS;
+    for(int64_t i=0;i<nframes && status == EXIT_SUCCESS;i++) {
+        const int64_t compressed_size = read_le32_ctrees(table + i*entry_size);
+        const int64_t size = read_le32_ctrees(table + i*entry_size + 4);
+        status = add_compressed_frame_ctrees(cfile, compressed_offset, compressed_size, size);
+        compressed_offset += compressed_size;
+    }
+    free(table);
+    if(status == EXIT_SUCCESS && compressed_offset > table_start - 8) {
+        fprintf(stderr,"Error: The frames in the seek table extend beyond the beginning of the seek table\n");
+        status = EXIT_FAILURE;
+    }
+    return status;
+}
+#endif /* PARSE_CTREES_USE_ZSTD */
+
+
+static inline int close_compressed_file_ctrees(struct ctrees_compressed_file *cfile)
+{
+    if(cfile->fd >= 0) {
+        close(cfile->fd);
+    }
+    cfile->fd = -1;
+    free(cfile->frames);
+    free(cfile->compressed_buffer);
+    cfile->frames = NULL;
+    cfile->compressed_buffer = NULL;
+    cfile->compressed_bufsize = 0;
+    for(int i=0;i<PARSE_CTREES_FRAME_CACHE_NFRAMES;i++) {
+        free(cfile->cache_data[i]);
+        cfile->cache_data[i] = NULL;
+        cfile->cache_bufsize[i] = 0;
+        cfile->cache_frame[i] = -1;
+    }
+    cfile->nframes = 0;
+    cfile->nallocated = 0;
+    cfile->size = 0;
+    return EXIT_SUCCESS;
+}
+
+
+/* Opens the compressed ``filename`` and locates all the (independently decompressible) frames. The
+   format is detected from the contents of the file. Uncompressed files are rejected -- use the other readers */
+static inline int open_compressed_file_ctrees(const char *filename, struct ctrees_compressed_file *cfile)
+{
+    memset(cfile, 0, sizeof(*cfile));
+    cfile->fd = -1;
+    for(int i=0;i<PARSE_CTREES_FRAME_CACHE_NFRAMES;i++) {
+        cfile->cache_frame[i] = -1;
+    }
+    int status = get_compression_format_ctrees(filename, &(cfile->format));
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    if(cfile->format == PARSE_CTREES_UNCOMPRESSED) {
+        fprintf(stderr,"Error: File `%s' is not compressed (with gzip or zstd)\n", filename);
+        return EXIT_FAILURE;
+    }
+    cfile->fd = open(filename, O_RDONLY);
+    struct stat st;
+    if(cfile->fd < 0 || fstat(cfile->fd, &st) != 0) {
+        fprintf(stderr,"Error: Could not open file `%s'\n", filename);
+        perror(NULL);
+        close_compressed_file_ctrees(cfile);
+        return EXIT_FAILURE;
+    }
+
+    status = EXIT_FAILURE;
+    if(cfile->format == PARSE_CTREES_GZIP) {
+#ifdef PARSE_CTREES_USE_ZLIB
+        status = index_gzip_members_ctrees(cfile, st.st_size);
+#else
+        fprintf(stderr,"Error: File `%s' is gzip compressed. Please define PARSE_CTREES_USE_ZLIB (and link with -lz)\n", filename);
+#endif
+    } else if(cfile->format == PARSE_CTREES_ZSTD) {
+#ifdef PARSE_CTREES_USE_ZSTD
+        status = index_seekable_zstd_ctrees(cfile, st.st_size);
+#else
+        fprintf(stderr,"Error: File `%s' is zstd compressed. Please define PARSE_CTREES_USE_ZSTD (and link with -lzstd)\n", filename);
+#endif
+    }
+    if(status != EXIT_SUCCESS) {
+        close_compressed_file_ctrees(cfile);
+    }
+    return status;
+}
+
+
+/* Decompresses the frame ``iframe`` into ``dest`` (at least frame->size bytes) */
+static inline int decompress_frame_ctrees(struct ctrees_compressed_file *cfile, const int64_t iframe, char *dest)
+{
+    const struct ctrees_compressed_frame *frame = &(cfile->frames[iframe]);
+    if((size_t) frame->compressed_size > cfile->compressed_bufsize) {
+        char *tmp = realloc(cfile->compressed_buffer, frame->compressed_size);
+        if(tmp == NULL) {
+            fprintf(stderr,"Error: Could not allocate memory for a compressed frame of %"PRId64" bytes\n", frame->compressed_size);
+            return EXIT_FAILURE;
+        }
+        cfile->compressed_buffer = tmp;
+        cfile->compressed_bufsize = frame->compressed_size;
+    }
+    if(pread_all_ctrees(cfile->fd, cfile->compressed_buffer, frame->compressed_size, frame->compressed_offset) != EXIT_SUCCESS) {
+        fprintf(stderr,"Error: Could not read %"PRId64" compressed bytes at offset = %"PRId64"\n", frame->compressed_size, frame->compressed_offset);
+        perror(NULL);
+        return EXIT_FAILURE;
+    }
+    cfile->nframes_decompressed++;
+
+    int status = EXIT_FAILURE;
+    switch(cfile->format) {
+#ifdef PARSE_CTREES_USE_ZLIB
+    case PARSE_CTREES_GZIP: {
+        z_stream strm;
+        memset(&strm, 0, sizeof(strm));
+        if(inflateInit2(&strm, 16 + MAX_WBITS) != Z_OK) break;
+        strm.next_in = (unsigned char *) cfile->compressed_buffer;
+        strm.avail_in = (uInt) frame->compressed_size;
+        strm.next_out = (unsigned char *) dest;
+        strm.avail_out = (uInt) frame->size;
+        const int ret = inflate(&strm, Z_FINISH);
+        if(ret == Z_STREAM_END && strm.total_out == (uLong) frame->size) {
+            status = EXIT_SUCCESS;
+        }
+        inflateEnd(&strm);
+        break;
+    }
+#endif
+#ifdef PARSE_CTREES_USE_ZSTD
+    case PARSE_CTREES_ZSTD: {
+        const size_t ret = ZSTD_decompress(dest, frame->size, cfile->compressed_buffer, frame->compressed_size);
+        if(ZSTD_isError(ret)) {
+            fprintf(stderr,"Error: zstd error = `%s'\n", ZSTD_getErrorName(ret));
+        } else if(ret == (size_t) frame->size) {
+            status = EXIT_SUCCESS;
+        }
+        break;
+    }
+#endif
+    default:
+        (void) dest;/* no decompressor compiled in */
+        break;
+    }
+    if(status != EXIT_SUCCESS) {
+        fprintf(stderr,"Error: Could not decompress frame # %"PRId64" (compressed offset = %"PRId64", expected %"PRId64" bytes)\n",
+                iframe, frame->compressed_offset, frame->size);
+    }
+    return status;
+}
+
+
+/* Returns the decompressed contents of the frame ``iframe``, either from the cache or by
+   decompressing the frame into the least recently used cache slot (NULL on error) */
+static inline const char *get_frame_ctrees(struct ctrees_compressed_file *cfile, const int64_t iframe)
+{
+    int slot = -1;/* an empty slot, or the least recently used one */
+    for(int i=0;i<PARSE_CTREES_FRAME_CACHE_NFRAMES;i++) {
+        if(cfile->cache_frame[i] == iframe) {
+            cfile->cache_last_used[i] = ++(cfile->cache_clock);
+            return cfile->cache_data[i];
+        }
+        if(slot < 0 || (cfile->cache_frame[slot] >= 0 &&
+                        (cfile->cache_frame[i] < 0 || cfile->cache_last_used[i] < cfile->cache_last_used[slot]))) {
+            slot = i;
+        }
+    }
+
+    const size_t size = cfile->frames[iframe].size;
+    if(size > cfile->cache_bufsize[slot]) {
+        char *tmp = realloc(cfile->cache_data[slot], size);
+        if(tmp == NULL) {
+            fprintf(stderr,"Error: Could not allocate memory for a decompressed frame of %zu bytes\n", size);
+            return NULL;
+        }
+        cfile->cache_data[slot] = tmp;
+        cfile->cache_bufsize[slot] = size;
+    }
+    cfile->cache_frame[slot] = -1;
+    if(decompress_frame_ctrees(cfile, iframe, cfile->cache_data[slot]) != EXIT_SUCCESS) {
+        return NULL;
+    }
+    cfile->cache_frame[slot] = iframe;
+    cfile->cache_last_used[slot] = ++(cfile->cache_clock);
+    return cfile->cache_data[slot];
+}
+
+
+/* `pread` for compressed files (``handle`` points to a `struct ctrees_compressed_file`). The
+   ``offset`` is within the *uncompressed* contents, i.e., the offsets from `locations.dat` can be directly used */
+static inline ssize_t pread_compressed_ctrees(void *handle, void *buf, size_t nbytes, off_t offset)
+{
+    struct ctrees_compressed_file *cfile = (struct ctrees_compressed_file *) handle;
+    if(offset < 0) return -1;
+    if(offset >= cfile->size || nbytes == 0) return 0;
+
+    /* locate the frame containing the offset */
+    int64_t lo = 0, hi = cfile->nframes - 1;
+    while(lo < hi) {
+        const int64_t mid = lo + (hi - lo + 1)/2;
+        if(cfile->frames[mid].offset <= (int64_t) offset) lo = mid;
+        else hi = mid - 1;
+    }
+
+    size_t nread = 0;
+    for(int64_t iframe=lo;iframe<cfile->nframes && nread < nbytes;iframe++) {
+        const struct ctrees_compressed_frame *frame = &(cfile->frames[iframe]);
+        const char *data = get_frame_ctrees(cfile, iframe);
+        if(data == NULL) return -1;
+        const int64_t start = (int64_t) offset + nread - frame->offset;
+        size_t ncopy = frame->size - start;
+        if(ncopy > nbytes - nread) ncopy = nbytes - nread;
+        memcpy((char *) buf + nread, data + start, ncopy);
+        nread += ncopy;
+    }
+    return (ssize_t) nread;
+}
+
+static inline struct ctrees_input_source get_compressed_source_ctrees(struct ctrees_compressed_file *cfile)
+{
+    struct ctrees_input_source source = {.pread = pread_compressed_ctrees, .handle = cfile};
+    return source;
+}
+
+
+/* Reads the first line of the input ``source`` into a newly allocated buffer ``*line`` (NUL-terminated, including the
+   new-line). The buffer grows until the entire line fits, i.e., there is no limit on the length of the header.
+   The caller is responsible for freeing ``*line`` */
+static inline int read_first_line_source_ctrees(const struct ctrees_input_source *source, const char *filename, char **line)
+{
+    size_t bufsize = PARSE_CTREES_MAXBUFSIZE;
+    size_t nread = 0;
+    char *linebuf = malloc(bufsize);
+    while(linebuf != NULL) {
+        const ssize_t n = source->pread(source->handle, linebuf + nread, bufsize - 1 - nread, nread);
+        if(n < 0) {
+            fprintf(stderr,"Error: Could not read the first line (the header) in the file `%s'\n", filename);
+            perror(NULL);
+            free(linebuf);
+            return EXIT_FAILURE;
+        }
+        char *newline = memchr(linebuf + nread, '\n', n);
+        nread += n;
+        if(newline != NULL || n == 0) {
+            if(newline != NULL) nread = newline - linebuf + 1;
+            break;
+        }
+        if(nread == bufsize - 1) {
+            bufsize *= 2;
+            char *tmp = realloc(linebuf, bufsize);
+            if(tmp == NULL) free(linebuf);
+            linebuf = tmp;
+        }
+    }
+    if(linebuf == NULL) {
+        fprintf(stderr,"Error: Could not allocate memory for the first line (the header) in the file `%s' (requested %zu bytes)\n",
+                filename, bufsize);
+        perror(NULL);
+        return EXIT_FAILURE;
+    }
+    if(nread == 0) {
+        fprintf(stderr,"Error: Could not read the first line (the header) in the file `%s'\n", filename);
+        free(linebuf);
+        return EXIT_FAILURE;
+    }
+    linebuf[nread] = '\0';
+    *line = linebuf;
+    return EXIT_SUCCESS;
+}
+
+#ifdef PARSE_CTREES_USE_ZLIB
+/* Reads the first line of the gzip compressed ``filename`` by inflating only until the first new-line, i.e., without
+   locating the members (`open_compressed_file_ctrees` decompresses an entire non-BGZF file to do so) */
+static inline int read_first_line_gzip_ctrees(const char *filename, char **line)
+{
+    int fd = open(filename, O_RDONLY);
+    if(fd < 0) {
+        fprintf(stderr,"Error: Could not open file `%s'\n",filename);
+        perror(NULL);
+        return EXIT_FAILURE;
+    }
+    const size_t chunk = 64*1024;
+    size_t bufsize = PARSE_CTREES_MAXBUFSIZE, nread = 0;
+    unsigned char *in = malloc(chunk);
+    char *linebuf = malloc(bufsize);
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if(in == NULL || linebuf == NULL || inflateInit2(&strm, 16 + MAX_WBITS) != Z_OK) {
+        fprintf(stderr,"Error: Could not initialise the decompression of the gzip file `%s'\n", filename);
+        free(in);
+        free(linebuf);
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    int status = EXIT_SUCCESS, done = 0;
+    int64_t in_offset = 0;
+    while(status == EXIT_SUCCESS && !done) {
+        if(strm.avail_in == 0) {
+            const ssize_t n = pread(fd, in, chunk, in_offset);
+            if(n <= 0) {
+                /* the stream ended (or could not be read) before the last member was complete */
+                fprintf(stderr,"Error: Could not read the first line (the header) in the file `%s' -- the gzip stream is truncated\n", filename);
+                if(n < 0) perror(NULL);
+                status = EXIT_FAILURE;
+                break;
+            }
+            strm.next_in = in;
+            strm.avail_in = (uInt) n;
+            in_offset += n;
+        }
+        if(nread == bufsize - 1) {
+            bufsize *= 2;
+            char *tmp = realloc(linebuf, bufsize);
+            if(tmp == NULL) {
+                fprintf(stderr,"Error: Could not allocate memory for the first line (the header) in the file `%s' (requested %zu bytes)\n",
+                        filename, bufsize);
+                status = EXIT_FAILURE;
+                break;
+            }
+            linebuf = tmp;
+        }
+        strm.next_out = (unsigned char *) linebuf + nread;
+        strm.avail_out = (uInt) (bufsize - 1 - nread);
+        const int ret = inflate(&strm, Z_NO_FLUSH);
+        const size_t n = (bufsize - 1 - nread) - strm.avail_out;
+        char *newline = memchr(linebuf + nread, '\n', n);
+        nread += n;
+        if(newline != NULL) {
+            nread = newline - linebuf + 1;
+            done = 1;
+        } else if(ret == Z_STREAM_END) {
+            /* continue with the next member, if there is one */
+            unsigned char next[2];
+            if(strm.avail_in >= 2) {
+                memcpy(next, strm.next_in, 2);
+            } else if(strm.avail_in == 1) {
+                next[0] = strm.next_in[0];
+                if(pread(fd, next + 1, 1, in_offset) != 1) next[1] = 0;
+            } else if(pread(fd, next, 2, in_offset) != 2) {
+                next[0] = 0;
+            }
+            if(next[0] != 0x1f || next[1] != 0x8b) {
+                done = 1;
+            } else {
+                inflateReset(&strm);
+            }
+        } else if(ret != Z_OK && ret != Z_BUF_ERROR) {
+            fprintf(stderr,"Error: Could not decompress the gzip file `%s' (zlib error = %d)\n", filename, ret);
+            status = EXIT_FAILURE;
+        }
+    }
+    inflateEnd(&strm);
+    free(in);
+    close(fd);
+    if(status == EXIT_SUCCESS && nread == 0) {
+        fprintf(stderr,"Error: Could not read the first line (the header) in the file `%s'\n", filename);
+        status = EXIT_FAILURE;
+    }
+    if(status != EXIT_SUCCESS) {
+        free(linebuf);
+        return status;
+    }
+    linebuf[nread] = '\0';
+    *line = linebuf;
+    return EXIT_SUCCESS;
+}
+#endif /* PARSE_CTREES_USE_ZLIB */
+
+/* Same as `read_first_line_source_ctrees` for the (possibly compressed) ``filename`` */
+static inline int read_first_line_ctrees(const char *filename, char **line)
+{
+    enum parse_ctrees_compression_formats format;
+    int status = get_compression_format_ctrees(filename, &format);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    if(format == PARSE_CTREES_UNCOMPRESSED) {
+        int fd = open(filename, O_RDONLY);
+        if(fd < 0) {
+            fprintf(stderr,"Error: Could not open file `%s'\n",filename);
+            perror(NULL);
+            return EXIT_FAILURE;
+        }
+        const struct ctrees_input_source source = get_fd_source_ctrees(&fd);
+        status = read_first_line_source_ctrees(&source, filename, line);
+        close(fd);
+        return status;
+    }
+#ifdef PARSE_CTREES_USE_ZLIB
+    if(format == PARSE_CTREES_GZIP) {
+        return read_first_line_gzip_ctrees(filename, line);
+    }
+#endif
+
+    struct ctrees_compressed_file cfile;
+    status = open_compressed_file_ctrees(filename, &cfile);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    const struct ctrees_input_source source = get_compressed_source_ctrees(&cfile);
+    status = read_first_line_source_ctrees(&source, filename, line);
+    close_compressed_file_ctrees(&cfile);
+    return status;
+}
+
+
+/* Splits the header line (i.e., the first line of a `tree_?_?_?.dat` file) in ``linebuf`` and returns the name of every column
+   (without the trailing `(column number)`) in ``column_names_in_file`` -- an array of ``totncols_in_file`` elements.
+   The caller is responsible for freeing ``*column_names_in_file`` */
+static inline int split_header_line_ctrees(const char *linebuf, char (**column_names_in_file)[PARSE_CTREES_MAX_COLNAME_LEN],
+                                           int *totncols_in_file)
+{
+    /* first check that the first character is a '#' */
+    if(linebuf[0] != '#') {
+        fprintf(stderr,"Error: Consistent-Trees output always contain '#' as the comment character\n"
+                "However, the first character in the buffer is '%c'\nEntire line is `%s'", linebuf[0], linebuf);
+        return EXIT_FAILURE;
+    }
+    char *tofree, *string;
+        
+    tofree = string = strdup(linebuf);
+    PARSE_CTREES_XASSERT(string != NULL,
+                         EXIT_FAILURE,
+                         "Error: Could not duplicate the header line (header: = `%s`\n)",
+                         linebuf);
+        
+    int totncols = 0;
+    char *token = NULL;
+        
+    /* CTREES currently uses white-space but this parsing will also
+       use the comma to break (i.e., if, in the future, the CTREES format changes
+       to using comma's, the code will still work) */
+    while ((token = strsep(&string, " ,")) != NULL) {
+        /* fprintf(stderr,"%35s %zu\n", token, strlen(token)); */
+        totncols++;
+    }
+    free(tofree);
+
+
+    /* read succeeded -> now parse the column names */
+    const char delimiters[] = " ,\n#";/* space, comma, new-line, and #*/
+    char (*names)[PARSE_CTREES_MAX_COLNAME_LEN] = calloc(totncols, sizeof(*names));
+    PARSE_CTREES_XASSERT(names != NULL,
+                         EXIT_FAILURE,
+                         "Error: Could not allocate memory to store each column name (total size requested = %zu bytes\n)",
+                         totncols * sizeof(*names));
+
+    /* ``tofree`` is simply there to free the memory malloc'ed by strdup. ``string`` itself will get modified */
+    tofree = string = strdup(linebuf);
+    PARSE_CTREES_XASSERT(string != NULL,
+                         EXIT_FAILURE,
+                         "Error: Could not duplicate the header line (header: = `%s`\n)",
+                         linebuf);
+        
+    int col = 0;
+    while ((token = strsep(&string, delimiters)) != NULL) {
+        size_t size=0, totlen = strlen(token);
+        if(totlen == 0) continue;
+        /* fprintf(stderr,"[%d] -- '%s' -- ", col, token); */
+        /* only the name is stored, i.e., the `(column number)` suffix does not count towards the limit */
+        const size_t namelen = strcspn(token, "(");
+        if(namelen >= PARSE_CTREES_MAX_COLNAME_LEN) {
+            fprintf(stderr,"Error: The name of the column `%s' has %zu characters but at most %d characters are supported\n",
+                    token, namelen, (int) PARSE_CTREES_MAX_COLNAME_LEN - 1);
+            free(names);
+            free(tofree);
+            return EXIT_FAILURE;
+        }
+        char *colname = names[col];
+        for(size_t i=0;i<totlen;i++) {
+            if(token[i] == '(') {
+
+#if 0
+                /* locate the ending ')' -- this while loop is only for additional
+                   testing and can be commented out */
+                size_t j = i+1;
+                while(j < totlen) {
+                    if(token[j] == ')') {
+                        token[j] = '\0';
+                        /* fprintf(stderr," `token = %s` ", &token[i+1]); */
+                        int ctrees_colnum = atoi(&(token[i+1]));
+                        PARSE_CTREES_XASSERT(ctrees_colnum == col, 
+                                             EXIT_FAILURE,
+                                             "ctrees_colnum = %d should equal col = %d\n",
+                                             ctrees_colnum, col);
+                        break;
+                    }
+                    j++;
+                }
+#endif
+                break;
+            }
+            colname[size] = token[i];
+            size++;
+        }
+        colname[size] = '\0';
+        /* fprintf(stderr, " `%s` \n", names[col]); */
+        col++;
+    }
+    PARSE_CTREES_XASSERT(col == totncols,
+                         EXIT_FAILURE,
+                         "Error: Previous parsing indicated %d columns in the header but only found %d actual column names\n"
+                         "Please check that the delimiters spefied to `strsep` are the same in all calls\n",
+                         totncols, col);
+    free(tofree);
+
+    *column_names_in_file = names;
+    *totncols_in_file = totncols;
+    return EXIT_SUCCESS;
+}
+
+
+/* Reads the header (i.e., the first line) of ``filename`` and returns the name of every column in the file
+   (see `split_header_line_ctrees`). The caller is responsible for freeing ``*column_names_in_file`` */
+static inline int read_header_column_names_ctrees(const char *filename, char (**column_names_in_file)[PARSE_CTREES_MAX_COLNAME_LEN],
+                                                  int *totncols_in_file)
+{
+    /* only need the first line */
+    char *linebuf = NULL;
+    if(read_first_line_ctrees(filename, &linebuf) != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    const int status = split_header_line_ctrees(linebuf, column_names_in_file, totncols_in_file);
+    free(linebuf);
+    return status;
+}
+
+
+/* Allocates the per-column arrays of ``column_info`` for ``ncols`` columns (zeroed, with ncols and nfilters set to 0).
+   Any previous contents of ``column_info`` are discarded without being freed */
+static inline int alloc_column_to_ptr_ctrees(struct ctrees_column_to_ptr *column_info, const int64_t ncols)
+{
+    memset(column_info, 0, sizeof(*column_info));
+    const int64_t n = (ncols > 0) ? ncols:1;
+    /* the 8-byte elements first, so that every array is aligned */
+    const size_t nbytes_per_column = sizeof(*(column_info->base_ptr_idx)) + sizeof(*(column_info->dest_offset_to_element)) +
+        sizeof(*(column_info->quant_lo)) + sizeof(*(column_info->quant_hi)) + sizeof(*(column_info->column_number)) +
+        sizeof(*(column_info->field_types)) + sizeof(*(column_info->conversion_method));
+    char *storage = calloc(n, nbytes_per_column);
+    if(storage == NULL) {
+        fprintf(stderr,"Error: Could not allocate memory for %"PRId64" requested columns\n", ncols);
+        perror(NULL);
+        return EXIT_FAILURE;
+    }
+    column_info->storage = storage;
+    column_info->base_ptr_idx = (int64_t *) storage;
+    column_info->dest_offset_to_element = (size_t *) (column_info->base_ptr_idx + n);
+    column_info->quant_lo = (double *) (column_info->dest_offset_to_element + n);
+    column_info->quant_hi = column_info->quant_lo + n;
+    column_info->column_number = (int32_t *) (column_info->quant_hi + n);
+    column_info->field_types = (enum parse_numeric_types *) (column_info->column_number + n);
+    column_info->conversion_method = (enum parse_conversion_methods *) (column_info->field_types + n);
+    return EXIT_SUCCESS;
+}
+
+static inline void free_column_to_ptr_ctrees(struct ctrees_column_to_ptr *column_info)
+{
+    free(column_info->storage);
+    memset(column_info, 0, sizeof(*column_info));
+}
+
+/* Copies ``src`` into ``dst`` (including the row filters). ``dst`` gets its own per-column arrays, and has to be
+   released independently with `free_column_to_ptr_ctrees` */
+static inline int copy_column_to_ptr_ctrees(struct ctrees_column_to_ptr *dst, const struct ctrees_column_to_ptr *src)
+{
+    if(alloc_column_to_ptr_ctrees(dst, src->ncols) != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    const int64_t n = src->ncols;
+    memcpy(dst->column_number, src->column_number, n * sizeof(*(src->column_number)));
+    memcpy(dst->field_types, src->field_types, n * sizeof(*(src->field_types)));
+    memcpy(dst->base_ptr_idx, src->base_ptr_idx, n * sizeof(*(src->base_ptr_idx)));
+    memcpy(dst->dest_offset_to_element, src->dest_offset_to_element, n * sizeof(*(src->dest_offset_to_element)));
+    memcpy(dst->conversion_method, src->conversion_method, n * sizeof(*(src->conversion_method)));
+    memcpy(dst->quant_lo, src->quant_lo, n * sizeof(*(src->quant_lo)));
+    memcpy(dst->quant_hi, src->quant_hi, n * sizeof(*(src->quant_hi)));
+    dst->ncols = n;
+    dst->nfilters = src->nfilters;
+    memcpy(dst->filter_column_number, src->filter_column_number, sizeof(src->filter_column_number));
+    memcpy(dst->filter_op, src->filter_op, sizeof(src->filter_op));
+    memcpy(dst->filter_lo, src->filter_lo, sizeof(src->filter_lo));
+    memcpy(dst->filter_hi, src->filter_hi, sizeof(src->filter_hi));
+    return EXIT_SUCCESS;
+}
+
+
+/* Matches the requested columns against the ``names`` of all the ``totncols`` columns in the header and populates
+   ``column_info`` (see `parse_header_ctrees`, which also reads the header) */
+static inline int match_header_columns_ctrees(const char (*names)[PARSE_CTREES_MAX_COLNAME_LEN], const int totncols,
+                                              char (*column_names)[PARSE_CTREES_MAX_COLNAME_LEN], enum parse_numeric_types *field_types,
+                                              int64_t *base_ptr_idx, size_t *dest_offset_to_element,
+                                              const int64_t nfields, struct ctrees_column_to_ptr *column_info)
+{
+    if(nfields < 0) {
+        fprintf(stderr,"Error: The number of requested columns must be non-negative. Got nfields = %"PRId64" instead\n", nfields);
+        return EXIT_FAILURE;
+    }
+
+    int * matched_columns = match_column_name((const char (*)[PARSE_CTREES_MAX_COLNAME_LEN])column_names, nfields, names, totncols);
+    if(matched_columns == NULL) {
+        return EXIT_FAILURE;
+    }
+    if(alloc_column_to_ptr_ctrees(column_info, nfields) != EXIT_SUCCESS) {
+        free(matched_columns);
+        return EXIT_FAILURE;
+    }
+
+        
+    /* now sort the matched columns */
+#define SGLIB_CHAR_ARRAY_ELEMENTS_EXCHANGER(maxlen, a, i, j) {char _sgl_aee_tmp_[maxlen]; memmove(_sgl_aee_tmp_, (a)[(i)], maxlen);memmove((a)[(i)], (a)[(j)], maxlen); memmove((a)[(j)], _sgl_aee_tmp_, maxlen);}
+        
+    /* sort the matched_columns in ascending order */
+#define MULTIPLE_ARRAY_EXCHANGER(type,a,i,j) {                          \
+        SGLIB_ARRAY_ELEMENTS_EXCHANGER(enum parse_numeric_types, field_types,i,j); \
+        SGLIB_ARRAY_ELEMENTS_EXCHANGER(int, matched_columns, i, j);     \
+        SGLIB_ARRAY_ELEMENTS_EXCHANGER(int64_t, base_ptr_idx, i, j);    \
+        SGLIB_ARRAY_ELEMENTS_EXCHANGER(size_t, dest_offset_to_element, i, j); \
+        SGLIB_CHAR_ARRAY_ELEMENTS_EXCHANGER(PARSE_CTREES_MAX_COLNAME_LEN, column_names, i, j); \
+    }
+        
+    SGLIB_ARRAY_QUICK_SORT(int, matched_columns, nfields, SGLIB_NUMERIC_COMPARATOR , MULTIPLE_ARRAY_EXCHANGER);
+#undef SGLIB_CHAR_ARRAY_ELEMENTS_EXCHANGER
+#undef MULTIPLE_ARRAY_EXCHANGER
+
+
+    /* now assign only the columns that were found
+       into the column_info struct */
+    column_info->ncols = 0;
+    column_info->nfilters = 0;
+    for(int i=0;i<nfields;i++) {
+        if(matched_columns[i] == -1) continue;
+
+        const int icol = column_info->ncols;
+        column_info->column_number[icol] = matched_columns[i];
+        column_info->field_types[icol] = field_types[i];
+        column_info->dest_offset_to_element[icol] = dest_offset_to_element[i];
+        column_info->base_ptr_idx[icol] = base_ptr_idx[i];
+        column_info->conversion_method[icol] = PARSE_CTREES_FAST_CONVERSION;
+        column_info->quant_lo[icol] = 0.0;
+        column_info->quant_hi[icol] = 0.0;
+        column_info->ncols++;
+    }
+    free(matched_columns);
+
+    return EXIT_SUCCESS;
+}
+
+
+static inline int parse_header_ctrees(char (*column_names)[PARSE_CTREES_MAX_COLNAME_LEN], enum parse_numeric_types *field_types,
+                                      int64_t *base_ptr_idx, size_t *dest_offset_to_element,
+                                      const int64_t nfields, const char *filename, struct ctrees_column_to_ptr *column_info)
+{
+    memset(column_info, 0, sizeof(*column_info));/* safe to free, even on failure */
+    char (*names)[PARSE_CTREES_MAX_COLNAME_LEN] = NULL;
+    int totncols = 0;
+    int status = read_header_column_names_ctrees(filename, &names, &totncols);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    status = match_header_columns_ctrees((const char (*)[PARSE_CTREES_MAX_COLNAME_LEN]) names, totncols, column_names, field_types,
+                                         base_ptr_idx, dest_offset_to_element, nfields, column_info);
+
+    /* do not need the actual names of every column in the ctrees file any longer -> free that memory */
+    free(names);
+    return status;
+}
+
+/* Checks the number of row ``filters`` and their operators */
+static inline int validate_filters_ctrees(const struct ctrees_filter *filters, const int64_t nfilters)
+{
+    if(nfilters > PARSE_CTREES_MAX_NFILTERS || nfilters < 0) {
+        fprintf(stderr,"Error: You have requested %"PRId64" filters but there is only space to store %"PRId64"\n",
+                nfilters, (int64_t) PARSE_CTREES_MAX_NFILTERS);
+        fprintf(stderr,"Please define the macro variable `PARSE_CTREES_MAX_NFILTERS' to be larger than %"PRId64" (before including the file `%s')\n",
+                nfilters, __FILE__);
+        return EXIT_FAILURE;
+    }
+    for(int64_t i=0;i<nfilters;i++) {
+        if(filters[i].op < PARSE_CTREES_FILTER_EQ || filters[i].op >= num_filter_ops) {
+            fprintf(stderr,"Error: Unknown value for filter operator = %d on column `%s'\n", filters[i].op, filters[i].column_name);
+            fprintf(stderr,"Known values are in the range : [%d, %d)\n", PARSE_CTREES_FILTER_EQ, num_filter_ops);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+
+/* Matches the columns of the (validated) row ``filters`` against the ``names`` of all the ``totncols`` columns in the
+   header of ``filename`` and stores the filters in ``column_info`` (see `parse_header_with_filters_ctrees`) */
+static inline int match_header_filters_ctrees(const char (*names)[PARSE_CTREES_MAX_COLNAME_LEN], const int totncols,
+                                              const struct ctrees_filter *filters, const int64_t nfilters,
+                                              const char *filename, struct ctrees_column_to_ptr *column_info)
+{
+    column_info->nfilters = 0;
+    if(nfilters == 0) {
+        return EXIT_SUCCESS;
+    }
+    char (*filter_names)[PARSE_CTREES_MAX_COLNAME_LEN] = calloc(nfilters, sizeof(*filter_names));
+    if(filter_names == NULL) {
+        fprintf(stderr,"Error: Could not allocate memory for the names of %"PRId64" filter columns\n", nfilters);
+        return EXIT_FAILURE;
+    }
+    for(int64_t i=0;i<nfilters;i++) {
+        memcpy(filter_names[i], filters[i].column_name, PARSE_CTREES_MAX_COLNAME_LEN);
+        filter_names[i][PARSE_CTREES_MAX_COLNAME_LEN - 1] = '\0';
+    }
+    int *matched_columns = match_column_name((const char (*)[PARSE_CTREES_MAX_COLNAME_LEN]) filter_names, nfilters, names, totncols);
+    if(matched_columns == NULL) {
+        free(filter_names);
+        return EXIT_FAILURE;
+    }
+
+    /* a filter on a missing column would silently keep every halo -> refuse */
+    for(int64_t i=0;i<nfilters;i++) {
+        if(matched_columns[i] == -1) {
+            fprintf(stderr,"Error: Could not locate the column `%s' (required for a filter) in the file `%s'\n",
+                    filter_names[i], filename);
+            free(filter_names);
+            free(matched_columns);
+            return EXIT_FAILURE;
+        }
+    }
+    free(filter_names);
+
+    /* store the filters sorted by column number (insertion sort -- there are only a handful of filters) */
+    for(int64_t i=0;i<nfilters;i++) {
+        int64_t j = column_info->nfilters;
+        while(j > 0 && column_info->filter_column_number[j-1] > matched_columns[i]) {
+            column_info->filter_column_number[j] = column_info->filter_column_number[j-1];
+            column_info->filter_op[j] = column_info->filter_op[j-1];
+            column_info->filter_lo[j] = column_info->filter_lo[j-1];
+            column_info->filter_hi[j] = column_info->filter_hi[j-1];
+            j--;
+        }
+        column_info->filter_column_number[j] = matched_columns[i];
+        column_info->filter_op[j] = filters[i].op;
+        column_info->filter_lo[j] = filters[i].lo;
+        column_info->filter_hi[j] = filters[i].hi;
+        column_info->nfilters++;
+    }
+    free(matched_columns);
+
+    return EXIT_SUCCESS;
+}
+
+
+/* Same as `parse_header_ctrees`, but also sets up the row ``filters`` (``nfilters`` elements). Every
+   filter column must exist in the file, but the column need not be one of the ``column_names``
+   that are stored. Only the halos that pass all the filters are stored by the readers */
+static inline int parse_header_with_filters_ctrees(char (*column_names)[PARSE_CTREES_MAX_COLNAME_LEN], enum parse_numeric_types *field_types,
+                                                   int64_t *base_ptr_idx, size_t *dest_offset_to_element, const int64_t nfields,
+                                                   const struct ctrees_filter *filters, const int64_t nfilters,
+                                                   const char *filename, struct ctrees_column_to_ptr *column_info)
+{
+    memset(column_info, 0, sizeof(*column_info));/* safe to free, even on failure */
+    int status = validate_filters_ctrees(filters, nfilters);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+
+    char (*names)[PARSE_CTREES_MAX_COLNAME_LEN] = NULL;
+    int totncols = 0;
+    status = read_header_column_names_ctrees(filename, &names, &totncols);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    status = match_header_columns_ctrees((const char (*)[PARSE_CTREES_MAX_COLNAME_LEN]) names, totncols, column_names, field_types,
+                                         base_ptr_idx, dest_offset_to_element, nfields, column_info);
+    if(status == EXIT_SUCCESS) {
+        status = match_header_filters_ctrees((const char (*)[PARSE_CTREES_MAX_COLNAME_LEN]) names, totncols, filters, nfilters,
+                                             filename, column_info);
+    }
+    free(names);
+    if(status != EXIT_SUCCESS) {
+        free_column_to_ptr_ctrees(column_info);
+    }
+    return status;
+}
+
+
+/* Sets the quantization range [lo, hi] for the fixed-point (Q16/Q32) column that is stored
+   at (``base_ptr_idx``, ``dest_offset_to_element``). Must be called after parsing the header
+   (which resets the ranges), and before reading any trees */
+static inline int set_column_quantization_ctrees(struct ctrees_column_to_ptr *column_info, const int64_t base_ptr_idx,
+                                                 const size_t dest_offset_to_element, const double lo, const double hi)
+{
+    /* x - x is NaN for both inf and NaN */
+    if(!(hi > lo) || lo - lo != 0.0 || hi - hi != 0.0) {
+        fprintf(stderr,"Error: The quantization range must be finite with lo < hi. Got [%g, %g] instead\n", lo, hi);
+        return EXIT_FAILURE;
+    }
+
+    int nfound = 0;
+    for(int64_t i=0;i<column_info->ncols;i++) {
+        if(column_info->base_ptr_idx[i] != base_ptr_idx || column_info->dest_offset_to_element[i] != dest_offset_to_element) continue;
+        if(column_info->field_types[i] != Q16 && column_info->field_types[i] != Q32) {
+            fprintf(stderr,"Error: The column number = %d (base_ptr_idx = %"PRId64", offset = %zu) has type = %d. "
+                    "Only the fixed-point types Q16/Q32 can be quantized\n",
+                    column_info->column_number[i], base_ptr_idx, dest_offset_to_element, column_info->field_types[i]);
+            return EXIT_FAILURE;
+        }
+        column_info->quant_lo[i] = lo;
+        column_info->quant_hi[i] = hi;
+        nfound++;
+    }
+    if(nfound == 0) {
+        fprintf(stderr,"Error: Could not find any requested column with base_ptr_idx = %"PRId64" and offset = %zu. "
+                "Perhaps the column is missing in the file?\n", base_ptr_idx, dest_offset_to_element);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+
+/* Appends ``nbytes`` from ``src`` to ``*dest`` (if not NULL) and advances ``*nbytes_total`` */
+static inline void append_request_bytes_ctrees(char **dest, size_t *nbytes_total, const void *src, const size_t nbytes)
+{
+    if(*dest != NULL) {
+        memcpy(*dest, src, nbytes);
+        *dest += nbytes;
+    }
+    *nbytes_total += nbytes;
+}
+
+
+/* Serializes everything that the result of `parse_header_with_filters_ctrees` depends on, other than the header itself,
+   into ``dest`` (if not NULL) and returns the number of bytes (call with a NULL ``dest`` to get the required size) */
+static inline size_t pack_header_request_ctrees(const char (*column_names)[PARSE_CTREES_MAX_COLNAME_LEN], const enum parse_numeric_types *field_types,
+                                                const int64_t *base_ptr_idx, const size_t *dest_offset_to_element, const int64_t nfields,
+                                                const struct ctrees_filter *filters, const int64_t nfilters, char *dest)
+{
+    size_t nbytes = 0;
+    append_request_bytes_ctrees(&dest, &nbytes, &nfields, sizeof(nfields));
+    for(int64_t i=0;i<nfields;i++) {
+        append_request_bytes_ctrees(&dest, &nbytes, column_names[i], strnlen(column_names[i], PARSE_CTREES_MAX_COLNAME_LEN) + 1);
+        append_request_bytes_ctrees(&dest, &nbytes, &(field_types[i]), sizeof(field_types[i]));
+        append_request_bytes_ctrees(&dest, &nbytes, &(base_ptr_idx[i]), sizeof(base_ptr_idx[i]));
+        append_request_bytes_ctrees(&dest, &nbytes, &(dest_offset_to_element[i]), sizeof(dest_offset_to_element[i]));
+    }
+    append_request_bytes_ctrees(&dest, &nbytes, &nfilters, sizeof(nfilters));
+    for(int64_t i=0;i<nfilters;i++) {
+        append_request_bytes_ctrees(&dest, &nbytes, filters[i].column_name, strnlen(filters[i].column_name, PARSE_CTREES_MAX_COLNAME_LEN) + 1);
+        append_request_bytes_ctrees(&dest, &nbytes, &(filters[i].op), sizeof(filters[i].op));
+        append_request_bytes_ctrees(&dest, &nbytes, &(filters[i].lo), sizeof(filters[i].lo));
+        append_request_bytes_ctrees(&dest, &nbytes, &(filters[i].hi), sizeof(filters[i].hi));
+    }
+    return nbytes;
+}
+
+
+static inline void free_header_cache_ctrees(struct ctrees_header_cache *cache)
+{
+    for(int64_t i=0;i<cache->nentries;i++) {
+        free(cache->entries[i].header);
+        free(cache->entries[i].request);
+        free_column_to_ptr_ctrees(&(cache->entries[i].column_info));
+    }
+    free(cache->entries);
+    cache->entries = NULL;
+    cache->nentries = 0;
+    cache->nallocated = 0;
+}
+
+
+/* Same as `parse_header_with_filters_ctrees`, but the result is looked up in (and otherwise stored into) the
+   user-owned ``cache``, keyed by the header line of ``filename`` and the requested columns/filters. Therefore, only
+   the first line of each file is read, and identical headers are matched only once. Unlike `parse_header_ctrees`,
+   the input arrays are never re-ordered */
+static inline int parse_header_cached_ctrees(struct ctrees_header_cache *cache, const char (*column_names)[PARSE_CTREES_MAX_COLNAME_LEN],
+                                             const enum parse_numeric_types *field_types, const int64_t *base_ptr_idx,
+                                             const size_t *dest_offset_to_element, const int64_t nfields,
+                                             const struct ctrees_filter *filters, const int64_t nfilters,
+                                             const char *filename, struct ctrees_column_to_ptr *column_info)
+{
+    memset(column_info, 0, sizeof(*column_info));/* safe to free, even on failure */
+    if(nfields < 0) {
+        fprintf(stderr,"Error: The number of requested columns must be non-negative. Got nfields = %"PRId64" instead\n", nfields);
+        return EXIT_FAILURE;
+    }
+    int status = validate_filters_ctrees(filters, nfilters);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    char *header = NULL;/* stored in the cache entry on a miss */
+    status = read_first_line_ctrees(filename, &header);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    const size_t header_len = strlen(header);
+    const uint64_t header_hash = fnv1a_hash_ctrees(header, header_len, PARSE_CTREES_FNV1A_OFFSET_BASIS);
+    const size_t request_len = pack_header_request_ctrees(column_names, field_types, base_ptr_idx, dest_offset_to_element, nfields,
+                                                          filters, nfilters, NULL);
+    char *request = malloc(request_len);/* stored in the cache entry on a miss */
+    if(request == NULL) {
+        fprintf(stderr,"Error: Could not allocate memory to cache the header of `%s'\n", filename);
+        free(header);
+        return EXIT_FAILURE;
+    }
+    pack_header_request_ctrees(column_names, field_types, base_ptr_idx, dest_offset_to_element, nfields, filters, nfilters, request);
+    const uint64_t request_hash = fnv1a_hash_ctrees(request, request_len, PARSE_CTREES_FNV1A_OFFSET_BASIS);
+    for(int64_t i=0;i<cache->nentries;i++) {
+        const struct ctrees_header_cache_entry *entry = &(cache->entries[i]);
+        if(entry->header_hash == header_hash && entry->request_hash == request_hash &&
+           entry->header_len == header_len && memcmp(entry->header, header, header_len) == 0 &&
+           entry->request_len == request_len && memcmp(entry->request, request, request_len) == 0) {
+            cache->nhits++;
+            free(header);
+            free(request);
+            return copy_column_to_ptr_ctrees(column_info, &(entry->column_info));
+        }
+    }
+
+    /* not in the cache -> match the header (on copies of the requested columns, since those get sorted) */
+    cache->nmisses++;
+    char (*names_copy)[PARSE_CTREES_MAX_COLNAME_LEN] = calloc(nfields + 1, sizeof(*names_copy));
+    enum parse_numeric_types *types_copy = calloc(nfields + 1, sizeof(*types_copy));
+    int64_t *base_ptr_idx_copy = calloc(nfields + 1, sizeof(*base_ptr_idx_copy));
+    size_t *dest_offset_copy = calloc(nfields + 1, sizeof(*dest_offset_copy));
+    if(names_copy == NULL || types_copy == NULL || base_ptr_idx_copy == NULL || dest_offset_copy == NULL) {
+        fprintf(stderr,"Error: Could not allocate memory to cache the header of `%s'\n", filename);
+        free(names_copy);
+        free(types_copy);
+        free(base_ptr_idx_copy);
+        free(dest_offset_copy);
+        free(header);
+        free(request);
+        return EXIT_FAILURE;
+    }
+    memcpy(names_copy, column_names, nfields * sizeof(*names_copy));
+    memcpy(types_copy, field_types, nfields * sizeof(*field_types));
+    memcpy(base_ptr_idx_copy, base_ptr_idx, nfields * sizeof(*base_ptr_idx));
+    memcpy(dest_offset_copy, dest_offset_to_element, nfields * sizeof(*dest_offset_to_element));
+
+    char (*names)[PARSE_CTREES_MAX_COLNAME_LEN] = NULL;
+    int totncols = 0;
+    status = split_header_line_ctrees(header, &names, &totncols);
+    if(status == EXIT_SUCCESS) {
+        status = match_header_columns_ctrees((const char (*)[PARSE_CTREES_MAX_COLNAME_LEN]) names, totncols, names_copy, types_copy,
+                                             base_ptr_idx_copy, dest_offset_copy, nfields, column_info);
+    }
+    if(status == EXIT_SUCCESS) {
+        status = match_header_filters_ctrees((const char (*)[PARSE_CTREES_MAX_COLNAME_LEN]) names, totncols, filters, nfilters,
+                                             filename, column_info);
+    }
+    free(names);
+    free(names_copy);
+    free(types_copy);
+    free(base_ptr_idx_copy);
+    free(dest_offset_copy);
+    if(status == EXIT_SUCCESS && cache->nentries == cache->nallocated) {
+        const int64_t new_N = (cache->nallocated < 8) ? 8 : 2*cache->nallocated;
+        struct ctrees_header_cache_entry *tmp = realloc(cache->entries, new_N * sizeof(*tmp));
+        if(tmp == NULL) {
+            fprintf(stderr,"Error: Could not allocate memory for %"PRId64" entries in the header cache\n", new_N);
+            status = EXIT_FAILURE;
+        } else {
+            cache->entries = tmp;
+            cache->nallocated = new_N;
+        }
+    }
+    struct ctrees_header_cache_entry *entry = (status == EXIT_SUCCESS) ? &(cache->entries[cache->nentries]) : NULL;
+    if(status == EXIT_SUCCESS) {
+        status = copy_column_to_ptr_ctrees(&(entry->column_info), column_info);
+    }
+    if(status != EXIT_SUCCESS) {
+        free_column_to_ptr_ctrees(column_info);
+        free(header);
+        free(request);
+        return status;
+    }
+    entry->header_hash = header_hash;
+    entry->request_hash = request_hash;
+    entry->header_len = header_len;
+    entry->header = header;
+    entry->request_len = request_len;
+    entry->request = request;
+    cache->nentries++;
+    return EXIT_SUCCESS;
+}
+
+/* Same as `grow_base_ptrs_ctrees` but with the allocator (and the counters) in ``alloc_context`` (may be NULL) */
+static inline int grow_base_ptrs_alloc_ctrees(struct base_ptr_info *base_ptr_info, struct ctrees_alloc_context *alloc_context)
+{
+    const double large_N_memory_increase_fac = 1.2;
+    const int64_t small_N_memory_increase_fac = 2;
+    /* double (:=`small_N_memory_increase_fac`) the memory requested for small numbers, otherwise increase by `large_N_memory_increase_fac` */
+    const int64_t thresh_N_for_large_memory = 1000000;/* small_N_memory_increase_fac * N, for N less than this threshold*/
+    const int64_t min_N = 16;/* otherwise, the growth can never start from N = 0 */
+    int64_t new_N = (base_ptr_info->N < thresh_N_for_large_memory) ? (base_ptr_info->N*small_N_memory_increase_fac): (base_ptr_info->N*large_N_memory_increase_fac);
+    if(new_N < min_N) new_N = min_N;
+    int status = reallocate_base_ptrs_alloc_ctrees(base_ptr_info, alloc_context, new_N);
+    if(status != EXIT_SUCCESS) return status;
+    PARSE_CTREES_XASSERT(base_ptr_info->nallocated > base_ptr_info->N,
+                         EXIT_FAILURE,
+                         "Error: Something went wrong while memory reallocation "
+                         "nallocated = %"PRId64" should have been larger than N = %"PRId64"\n",
+                         base_ptr_info->nallocated, base_ptr_info->N);
+
+    return EXIT_SUCCESS;
+}
+
+/* Increases the memory allocated for each of the base pointers. Called when
+   all the allocated elements have been used up (i.e., nallocated == N) */
+static inline int grow_base_ptrs_ctrees(struct base_ptr_info *base_ptr_info)
+{
+    return grow_base_ptrs_alloc_ctrees(base_ptr_info, NULL);
+}
+
+
+/* Rounds a double to the nearest IEEE 754 binary16 (ties to even) and returns the raw bits.
+   Values beyond the half-precision range become +/-inf; NaNs stay NaNs */
+static inline uint16_t double_to_half_ctrees(const double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign = (uint16_t) ((bits >> 48) & 0x8000u);
+    const int exponent = (int) ((bits >> 52) & 0x7ff);
+    uint64_t mantissa = bits & 0xFFFFFFFFFFFFFULL;
+
+    if(exponent == 0x7ff) {
+        return (uint16_t) (sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+    }
+
+    const int half_exponent = exponent - 1023 + 15;
+    if(half_exponent >= 31) {
+        return (uint16_t) (sign | 0x7c00u);
+    }
+
+    /* the number of low mantissa bits that are dropped, and the resulting half mantissa/exponent bits */
+    int shift = 42;
+    uint64_t half_bits;
+    if(half_exponent <= 0) {
+        /* sub-normal half (or underflow to zero) */
+        if(half_exponent < -10) return sign;
+        mantissa |= (1ULL << 52);
+        shift = 43 - half_exponent;
+        half_bits = mantissa >> shift;
+    } else {
+        half_bits = ((uint64_t) half_exponent << 10) | (mantissa >> shift);
+    }
+
+    /* round to nearest, ties to even -- a carry correctly propagates into the exponent (and to inf) */
+    const uint64_t remainder = mantissa & ((1ULL << shift) - 1);
+    const uint64_t halfway = 1ULL << (shift - 1);
+    if(remainder > halfway || (remainder == halfway && (half_bits & 1))) {
+        half_bits++;
+    }
+
+    return (uint16_t) (sign | half_bits);
+}
+
+
+/* Returns the value of the IEEE 754 binary16 stored in ``half`` (e.g., an F16 destination) */
+static inline float half_to_float_ctrees(const uint16_t half)
+{
+    const uint32_t sign = (uint32_t) (half & 0x8000u) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1f;
+    const uint32_t mantissa = half & 0x3ffu;
+
+    if(exponent == 0) {
+        /* zero or sub-normal -- exactly representable as a float */
+        const float value = (float) mantissa * (1.0f/16777216.0f);/* 2^-24 */
+        return sign ? -value:value;
+    }
+
+    uint32_t bits;
+    if(exponent == 0x1f) {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+
+/* Stores ``value`` as the fixed-point (Q16 or Q32) ``type`` at ``dest``, mapping [lo, hi]
+   linearly onto [0, 2^nbits - 1]. Values outside [lo, hi] (and NaNs) are errors */
+static inline int quantize_value_ctrees(const double value, const double lo, const double hi,
+                                        const enum parse_numeric_types type, void *dest)
+{
+    if(!(value >= lo && value <= hi)) {
+        fprintf(stderr,"Error: value = %g is outside the quantization range [%g, %g]\n", value, lo, hi);
+        return EXIT_FAILURE;
+    }
+
+    const double nlevels = (type == Q16) ? 65535.0:4294967295.0;
+    double scaled = (value - lo) / (hi - lo) * nlevels + 0.5;
+    if(scaled > nlevels) scaled = nlevels;
+    if(type == Q16) {
+        *((uint16_t *) dest) = (uint16_t) scaled;
+    } else {
+        *((uint32_t *) dest) = (uint32_t) scaled;
+    }
+    return EXIT_SUCCESS;
+}
+
+
+/* Returns the value stored in a Q16 destination that was quantized over [lo, hi] */
+static inline double dequantize_q16_ctrees(const uint16_t q, const double lo, const double hi)
+{
+    return lo + (double) q * ((hi - lo) / 65535.0);
+}
+
+
+/* Returns the value stored in a Q32 destination that was quantized over [lo, hi] */
+static inline double dequantize_q32_ctrees(const uint32_t q, const double lo, const double hi)
+{
+    return lo + (double) q * ((hi - lo) / 4294967295.0);
+}
+
+
+/* Stores the integer ``value`` into the narrow integer (or BOOL) ``type`` at ``dest``.
+   Returns EXIT_FAILURE if the value does not fit in the destination */
+static inline int store_narrow_integer_ctrees(const int64_t value, const enum parse_numeric_types type, void *dest)
+{
+    int64_t lo, hi;
+    switch(type) {
+    case I8:  lo = INT8_MIN;  hi = INT8_MAX; break;
+    case I16: lo = INT16_MIN; hi = INT16_MAX; break;
+    case U8:  lo = 0;         hi = UINT8_MAX; break;
+    case U16: lo = 0;         hi = UINT16_MAX; break;
+    case BOOL:
+        *((uint8_t *) dest) = (value != 0);
+        return EXIT_SUCCESS;
+    default:
+        fprintf(stderr,"Error: parse type = %d is not a narrow integer type\n", type);
+        return EXIT_FAILURE;
+    }
+    if(value < lo || value > hi) {
+        fprintf(stderr,"Error: value = %"PRId64" does not fit in the destination type (range [%"PRId64", %"PRId64"])\n",
+                value, lo, hi);
+        return EXIT_FAILURE;
+    }
+
+    switch(type) {
+    case I8:  *((int8_t *) dest) = (int8_t) value; break;
+    case I16: *((int16_t *) dest) = (int16_t) value; break;
+    case U8:  *((uint8_t *) dest) = (uint8_t) value; break;
+    default:  *((uint16_t *) dest) = (uint16_t) value; break;
+    }
+    return EXIT_SUCCESS;
+}
+
+
+/* Converts the ``toklen`` bytes starting at ``token`` (need not be NUL-terminated)
+   into the numeric ``type``, and stores the result at ``dest`` */
+static inline int convert_token_ctrees(const char *token, const size_t toklen, const enum parse_numeric_types type, void *dest)
+{
+    /* the libc conversion routines require a NUL-terminated string */
+    char tokenbuf[PARSE_CTREES_MAX_TOKEN_LEN];
+    if(toklen == 0 || toklen >= PARSE_CTREES_MAX_TOKEN_LEN) {
+        fprintf(stderr,"Error: token = `%.*s` has %zu characters but should have between [1, %d) characters\n",
+                (int) toklen, token, toklen, (int) PARSE_CTREES_MAX_TOKEN_LEN);
+        return EXIT_FAILURE;
+    }
+    memcpy(tokenbuf, token, toklen);
+    tokenbuf[toklen] = '\0';
+
+    switch(type) {
+    case F32:{
+        float tmp = strtof(tokenbuf, NULL);
+        /* fprintf(stderr,"[float] := %f\n", tmp); */
+        *((float *) dest) = tmp;
+        break;
+    }
+    case F64:{
+        double tmp = strtod(tokenbuf, NULL);
+        /* fprintf(stderr,"[double] := %lf\n", tmp); */
+        *((double *) dest) = tmp;
+        break;
+    }
+    case I32:{
+        int32_t tmp = (int32_t) strtol(tokenbuf, NULL, 10);
+        /* fprintf(stderr,"[int32_t] := %"PRId32"\n", tmp); */
+        *((int32_t *) dest) = tmp;
+        break;
+    }
+    case U32:{
+        uint32_t tmp = (uint32_t) strtoul(tokenbuf, NULL, 10);
+        /* fprintf(stderr,"[uint32_t] := %"PRIu32"\n", tmp); */
+        *((uint32_t *) dest) = tmp;
+        break;
+    }
+    case I64:{
+        int64_t tmp = (int64_t) strtoll(tokenbuf, NULL, 10);
+        /* fprintf(stderr,"[int64_t] := %"PRId64"\n", tmp); */
+        *((int64_t *) dest) = tmp;
+        break;
+    }
+
+    case U64:{
+         uint64_t tmp = (uint64_t) strtoull(tokenbuf, NULL, 10);
+         /* fprintf(stderr,"[uint64_t] := %"PRIu64"\n", tmp); */
+         *((uint64_t *) dest) = tmp;
+         break;
+    }
+    case I8:
+    case I16:
+    case U8:
+    case U16:{
+        char *end = NULL;
+        errno = 0;
+        long long tmp = strtoll(tokenbuf, &end, 10);
+        if(end == tokenbuf || errno == ERANGE) {
+            fprintf(stderr,"Error: Could not convert token = `%s` into an integer\n", tokenbuf);
+            return EXIT_FAILURE;
+        }
+        if(store_narrow_integer_ctrees((int64_t) tmp, type, dest) != EXIT_SUCCESS) {
+            fprintf(stderr,"Error: while converting token = `%s`\n", tokenbuf);
+            return EXIT_FAILURE;
+        }
+        break;
+    }
+    case BOOL:{
+        /* accepts '0'/'1' as well as floating-point flags */
+        double tmp = strtod(tokenbuf, NULL);
+        *((uint8_t *) dest) = (tmp != 0.0);
+        break;
+    }
+    case F16:{
+        double tmp = strtod(tokenbuf, NULL);
+        *((uint16_t *) dest) = double_to_half_ctrees(tmp);
+        break;
+    }
+    case Q16:
+    case Q32:
+        fprintf(stderr,"Error: The fixed-point types Q16/Q32 require a quantization range -- "
+                "please use `set_column_quantization_ctrees` after parsing the header\n");
+        return EXIT_FAILURE;
+    default:
+        fprintf(stderr,"Error: Unknown value for parse type = %d\n", type);
+        fprintf(stderr,"Known values are in the range : [%d, %d)\n", I32, num_numeric_types);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+/* Parses the ``toklen`` bytes at ``token`` as a (optionally signed) base-10 integer.
+   Returns 1 on success (with the result in ``value``), otherwise returns 0 and the token
+   should be converted by the libc routines instead.
+
+   At most 19 digits are converted -- i.e., the magnitude always fits within an uint64_t */
+static inline int fast_parse_integer_ctrees(const char *token, const size_t toklen, int *negative, uint64_t *value)
+{
+    const char *this = token;
+    const char *end = token + toklen;
+    *negative = 0;
+    if(this < end && (*this == '-' || *this == '+')) {
+        *negative = (*this == '-');
+        this++;
+    }
+    const size_t ndigits = end - this;
+    if(ndigits == 0 || ndigits > 19) return 0;
+
+    uint64_t result = 0;
+    for(;this < end;this++) {
+        const unsigned digit = (unsigned) (*this - '0');
+        if(digit > 9) return 0;
+        result = result*10 + digit;
+    }
+    *value = result;
+    return 1;
+}
+
+
+/* Parses the ``toklen`` bytes at ``token`` as a decimal floating point number, i.e.,
+   [+-]digits[.digits][(e|E)[+-]digits], into the decimal significand (``mantissa``) and
+   the base-10 exponent (``exp10``). Returns 1 on success, otherwise returns 0 (e.g., for more
+   than 19 significant digits, `nan`, `inf`, hex-floats etc) */
+static inline int fast_parse_decimal_ctrees(const char *token, const size_t toklen, int *negative, uint64_t *mantissa, int *exp10)
+{
+    const char *this = token;
+    const char *end = token + toklen;
+    *negative = 0;
+    if(this < end && (*this == '-' || *this == '+')) {
+        *negative = (*this == '-');
+        this++;
+    }
+
+    uint64_t m = 0;
+    int nsig = 0, ndigits = 0, e = 0;
+    for(;this < end;this++) {
+        const unsigned digit = (unsigned) (*this - '0');
+        if(digit > 9) break;
+        m = m*10 + digit;
+        nsig += (nsig > 0 || digit != 0);
+        ndigits++;
+    }
+    if(this < end && *this == '.') {
+        this++;
+        for(;this < end;this++) {
+            const unsigned digit = (unsigned) (*this - '0');
+            if(digit > 9) break;
+            m = m*10 + digit;
+            nsig += (nsig > 0 || digit != 0);
+            ndigits++;
+            e--;
+        }
+    }
+    /* leading zeros do not count towards the significant digits */
+    if(ndigits == 0 || nsig > 19) return 0;
+
+    if(this < end && (*this == 'e' || *this == 'E')) {
+        this++;
+        int exp_negative = 0;
+        if(this < end && (*this == '-' || *this == '+')) {
+            exp_negative = (*this == '-');
+            this++;
+        }
+        if(this == end) return 0;
+        int exp_value = 0;
+        for(;this < end;this++) {
+            const unsigned digit = (unsigned) (*this - '0');
+            if(digit > 9 || exp_value > 10000) return 0;
+            exp_value = exp_value*10 + (int) digit;
+        }
+        e += exp_negative ? -exp_value : exp_value;
+    }
+    /* the entire token must have been consumed */
+    if(this != end) return 0;
+
+    *mantissa = m;
+    *exp10 = e;
+    return 1;
+}
+
+
+/* Fast path for converting a decimal string into a double. Uses the classic
+   (Clinger) exact case -- when the significand fits within the 53 bits of a double
+   and the power of 10 is exactly representable, a single IEEE multiplication (or division)
+   produces the correctly rounded result, i.e., identical to `strtod`.
+
+   Returns 1 on success, otherwise returns 0 and the token must be converted with `strtod` */
+static inline int fast_strtod_ctrees(const char *token, const size_t toklen, double *result)
+{
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    static const double exact_powers_of_ten[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                                                 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    int negative, exp10;
+    uint64_t mantissa;
+    if(fast_parse_decimal_ctrees(token, toklen, &negative, &mantissa, &exp10) == 0) return 0;
+
+    if(mantissa == 0) {
+        *result = negative ? -0.0:0.0;
+        return 1;
+    }
+    /* absorb (some of) a large exponent into the mantissa as long as it is still exact */
+    while(exp10 > 22 && mantissa < (UINT64_C(1) << 53)/10) {
+        mantissa *= 10;
+        exp10--;
+    }
+    if(mantissa > (UINT64_C(1) << 53) || exp10 < -22 || exp10 > 22) return 0;
+
+    double value = (double) mantissa;
+    value = (exp10 < 0) ? value/exact_powers_of_ten[-exp10] : value*exact_powers_of_ten[exp10];
+    *result = negative ? -value:value;
+    return 1;
+#else
+    /* with excess precision in the floating point evaluation, the results
+       may be doubly-rounded -> always use the libc routines */
+    (void) token;
+    (void) toklen;
+    (void) result;
+    return 0;
+#endif
+}
+
+
+/* Same as `fast_strtod_ctrees` but for floats, i.e., identical to `strtof` */
+static inline int fast_strtof_ctrees(const char *token, const size_t toklen, float *result)
+{
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    static const float exact_powers_of_ten[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+    int negative, exp10;
+    uint64_t mantissa;
+    if(fast_parse_decimal_ctrees(token, toklen, &negative, &mantissa, &exp10) == 0) return 0;
+
+    if(mantissa == 0) {
+        *result = negative ? -0.0f:0.0f;
+        return 1;
+    }
+    while(exp10 > 10 && mantissa < (UINT64_C(1) << 24)/10) {
+        mantissa *= 10;
+        exp10--;
+    }
+    if(mantissa > (UINT64_C(1) << 24) || exp10 < -10 || exp10 > 10) return 0;
+
+    float value = (float) mantissa;
+    value = (exp10 < 0) ? value/exact_powers_of_ten[-exp10] : value*exact_powers_of_ten[exp10];
+    *result = negative ? -value:value;
+    return 1;
+#else
+    (void) token;
+    (void) toklen;
+    (void) result;
+    return 0;
+#endif
+}
+
+
+/* Same as `convert_token_ctrees` but uses the fast conversion routines. Any token that can not
+   be converted exactly by the fast routines is passed on to `convert_token_ctrees` (i.e., to libc) */
+static inline int convert_token_fast_ctrees(const char *token, const size_t toklen, const enum parse_numeric_types type, void *dest)
+{
+    switch(type) {
+    case F32:{
+        float tmp;
+        if(fast_strtof_ctrees(token, toklen, &tmp) == 0) break;
+        *((float *) dest) = tmp;
+        return EXIT_SUCCESS;
+    }
+    case F64:{
+        double tmp;
+        if(fast_strtod_ctrees(token, toklen, &tmp) == 0) break;
+        *((double *) dest) = tmp;
+        return EXIT_SUCCESS;
+    }
+    case I32:
+    case U32:
+    case I64:
+    case U64:{
+        int negative;
+        uint64_t magnitude;
+        if(fast_parse_integer_ctrees(token, toklen, &negative, &magnitude) == 0) break;
+        /* strtol & co saturate on overflow -> let libc handle anything that might overflow */
+        if(magnitude > (uint64_t) INT64_MAX) break;
+        const uint64_t value = negative ? (uint64_t) 0 - magnitude : magnitude;/* both strtoll and strtoull negate in this way */
+        if(type == I32) {
+            /* strtol would saturate (on platforms with 32-bit long) */
+            if(magnitude > (negative ? (uint64_t) INT32_MAX + 1 : (uint64_t) INT32_MAX)) break;
+            *((int32_t *) dest) = (int32_t) (int64_t) value;
+        } else if(type == U32) {
+            if(magnitude > (uint64_t) UINT32_MAX) break;
+            *((uint32_t *) dest) = (uint32_t) value;
+        } else if(type == I64) {
+            *((int64_t *) dest) = (int64_t) value;
+        } else {
+            *((uint64_t *) dest) = value;
+        }
+        return EXIT_SUCCESS;
+    }
+    case I8:
+    case I16:
+    case U8:
+    case U16:
+    case BOOL:{
+        int negative;
+        uint64_t magnitude;
+        if(fast_parse_integer_ctrees(token, toklen, &negative, &magnitude) == 0) break;
+        if(magnitude > (uint64_t) INT64_MAX) break;
+        const int64_t value = negative ? -(int64_t) magnitude : (int64_t) magnitude;
+        return store_narrow_integer_ctrees(value, type, dest);
+    }
+    case F16:{
+        double tmp;
+        if(fast_strtod_ctrees(token, toklen, &tmp) == 0) break;
+        *((uint16_t *) dest) = double_to_half_ctrees(tmp);
+        return EXIT_SUCCESS;
+    }
+    default:
+        break;
+    }
+
+    /* could not be converted via the fast path -> use the libc routines */
+    return convert_token_ctrees(token, toklen, type, dest);
+}
+
+
+/* Returns 1 if ``c`` separates two columns in the `tree_?_?_?.dat` file.
+   CTREES currently uses white-space but the comma is also accepted (i.e., if, in the future, the CTREES format changes
+   to using comma's, the code will still work) */
+static inline int is_column_delimiter_ctrees(const char c)
+{
+    return (c == ' ' || c == ',' || c == '\t' || c == '\r');
+}
+
+
+/* The different instruction sets for scanning the lines */
+enum parse_ctrees_simd_levels
+{
+    PARSE_CTREES_SCALAR = 0,
+    PARSE_CTREES_SSE2 = 1,
+    PARSE_CTREES_AVX2 = 2,
+    PARSE_CTREES_NEON = 3,
+    num_simd_levels
+};
+
+
+/* Returns the best instruction set available on the current cpu (checked at runtime, once) */
+static inline enum parse_ctrees_simd_levels get_simd_level_ctrees(void)
+{
+#if defined(PARSE_CTREES_USE_X86_SIMD)
+    static int simd_level = -1;
+    if(simd_level < 0) {
+        __builtin_cpu_init();
+        /* SSE2 is always available on x86_64 */
+        simd_level = (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) ? PARSE_CTREES_AVX2 : PARSE_CTREES_SSE2;
+    }
+    return (enum parse_ctrees_simd_levels) simd_level;
+#elif defined(PARSE_CTREES_USE_NEON_SIMD)
+    return PARSE_CTREES_NEON;
+#else
+    return PARSE_CTREES_SCALAR;
+#endif
+}
+
+
+/* Skips over ``ntokens`` columns, one byte at a time */
+static inline const char *skip_tokens_scalar_ctrees(const char *this, const char *end, int32_t ntokens, const char **token)
+{
+    for(;ntokens > 0;ntokens--) {
+        while(this < end && is_column_delimiter_ctrees(*this)) this++;
+        if(this == end) return NULL;
+        *token = this;
+        while(this < end && ! is_column_delimiter_ctrees(*this)) this++;
+    }
+    return this;
+}
+
+static inline const char *find_newline_scalar_ctrees(const char *this, const char *end)
+{
+    return memchr(this, '\n', end - this);
+}
+
+static inline int64_t count_newlines_scalar_ctrees(const char *this, const char *end)
+{
+    int64_t nlines = 0;
+    for(;this < end;this++) {
+        nlines += (*this == '\n');
+    }
+    return nlines;
+}
+
+
+/* The SIMD kernels below build bitmasks (1 bit per byte) over 64-byte blocks. For the
+   delimiter mask, a column starts wherever a non-delimiter byte follows a delimiter byte, i.e.,
+   starts = ~delims & ((delims << 1) | previous_byte_was_delimiter). Counting the bits in `starts`
+   then skips over all the columns in the block at once.
+
+   `this` is always either at the start of the line or just after a column, therefore the byte
+   before `this` can be treated as a delimiter. Only complete 64-byte blocks are processed with
+   SIMD -- the remainder of the line is processed with the scalar code */
+#define PARSE_CTREES_DEFINE_SIMD_SCANNERS(ISA, ATTRIBUTE)               \
+    ATTRIBUTE static inline const char *skip_tokens_##ISA##_ctrees(const char *this, const char *end, int32_t ntokens, const char **token) \
+    {                                                                   \
+        uint64_t prev_is_delim = 1;                                     \
+        while(end - this >= 64) {                                       \
+            const uint64_t delims = delimiter_mask_##ISA##_ctrees(this); \
+            uint64_t starts = ~delims & ((delims << 1) | prev_is_delim); \
+            const int32_t nstarts = (int32_t) __builtin_popcountll(starts); \
+            if(nstarts >= ntokens) {                                    \
+                for(int32_t k=1;k<ntokens;k++) starts &= starts - 1;    \
+                const int pos = __builtin_ctzll(starts);                \
+                *token = this + pos;                                    \
+                const uint64_t delims_after = delims >> pos;            \
+                if(delims_after != 0) return this + pos + __builtin_ctzll(delims_after); \
+                /* the column continues past this block */              \
+                const char *p = this + 64;                              \
+                while(p < end && ! is_column_delimiter_ctrees(*p)) p++; \
+                return p;                                               \
+            }                                                           \
+            ntokens -= nstarts;                                         \
+            prev_is_delim = delims >> 63;                               \
+            this += 64;                                                 \
+        }                                                               \
+        if(prev_is_delim == 0) {                                        \
+            /* still within a column that has already been counted */   \
+            while(this < end && ! is_column_delimiter_ctrees(*this)) this++; \
+        }                                                               \
+        return skip_tokens_scalar_ctrees(this, end, ntokens, token);    \
+    }                                                                   \
+                                                                        \
+    ATTRIBUTE static inline const char *find_newline_##ISA##_ctrees(const char *this, const char *end) \
+    {                                                                   \
+        while(end - this >= 64) {                                       \
+            const uint64_t newlines = newline_mask_##ISA##_ctrees(this); \
+            if(newlines != 0) return this + __builtin_ctzll(newlines);  \
+            this += 64;                                                 \
+        }                                                               \
+        return find_newline_scalar_ctrees(this, end);                   \
+    }                                                                   \
+                                                                        \
+    ATTRIBUTE static inline int64_t count_newlines_##ISA##_ctrees(const char *this, const char *end) \
+    {                                                                   \
+        int64_t nlines = 0;                                             \
+        while(end - this >= 64) {                                       \
+            nlines += __builtin_popcountll(newline_mask_##ISA##_ctrees(this)); \
+            this += 64;                                                 \
+        }                                                               \
+        return nlines + count_newlines_scalar_ctrees(this, end);        \
+    }
+
+#if defined(PARSE_CTREES_USE_X86_SIMD)
+__attribute__((target("sse2"))) static inline uint64_t delimiter_mask_sse2_ctrees(const char *p)
+{
+    const __m128i space = _mm_set1_epi8(' '), comma = _mm_set1_epi8(','), tab = _mm_set1_epi8('\t'), cr = _mm_set1_epi8('\r');
+    uint64_t mask = 0;
+    for(int i=0;i<4;i++) {
+        const __m128i v = _mm_loadu_si128((const __m128i *) (p + 16*i));
+        const __m128i d = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, comma)),
+                                       _mm_or_si128(_mm_cmpeq_epi8(v, tab), _mm_cmpeq_epi8(v, cr)));
+        mask |= ((uint64_t) (uint16_t) _mm_movemask_epi8(d)) << (16*i);
+    }
+    return mask;
+}
+
+__attribute__((target("sse2"))) static inline uint64_t newline_mask_sse2_ctrees(const char *p)
+{
+    const __m128i newline = _mm_set1_epi8('\n');
+    uint64_t mask = 0;
+    for(int i=0;i<4;i++) {
+        const __m128i v = _mm_loadu_si128((const __m128i *) (p + 16*i));
+        mask |= ((uint64_t) (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, newline))) << (16*i);
+    }
+    return mask;
+}
+
+__attribute__((target("avx2"))) static inline uint64_t delimiter_mask_avx2_ctrees(const char *p)
+{
+    const __m256i space = _mm256_set1_epi8(' '), comma = _mm256_set1_epi8(','), tab = _mm256_set1_epi8('\t'), cr = _mm256_set1_epi8('\r');
+    const __m256i lo = _mm256_loadu_si256((const __m256i *) p);
+    const __m256i hi = _mm256_loadu_si256((const __m256i *) (p + 32));
+    const __m256i dlo = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(lo, space), _mm256_cmpeq_epi8(lo, comma)),
+                                        _mm256_or_si256(_mm256_cmpeq_epi8(lo, tab), _mm256_cmpeq_epi8(lo, cr)));
+    const __m256i dhi = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(hi, space), _mm256_cmpeq_epi8(hi, comma)),
+                                        _mm256_or_si256(_mm256_cmpeq_epi8(hi, tab), _mm256_cmpeq_epi8(hi, cr)));
+    return ((uint64_t) (uint32_t) _mm256_movemask_epi8(dlo)) | (((uint64_t) (uint32_t) _mm256_movemask_epi8(dhi)) << 32);
+}
+
+__attribute__((target("avx2"))) static inline uint64_t newline_mask_avx2_ctrees(const char *p)
+{
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i lo = _mm256_loadu_si256((const __m256i *) p);
+    const __m256i hi = _mm256_loadu_si256((const __m256i *) (p + 32));
+    return ((uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, newline))) |
+        (((uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, newline))) << 32);
+}
+
+PARSE_CTREES_DEFINE_SIMD_SCANNERS(sse2, __attribute__((target("sse2"))))
+PARSE_CTREES_DEFINE_SIMD_SCANNERS(avx2, __attribute__((target("avx2,popcnt,bmi"))))
+#endif /* PARSE_CTREES_USE_X86_SIMD */
+
+#if defined(PARSE_CTREES_USE_NEON_SIMD)
+/* NEON does not have a movemask -> weight each (all-ones) byte by its bit position and sum the halves */
+static inline uint64_t movemask_neon_ctrees(const uint8x16_t v)
+{
+    static const uint8_t bit_weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t weighted = vandq_u8(v, vld1q_u8(bit_weights));
+    const uint64_t lo = vaddv_u8(vget_low_u8(weighted));
+    const uint64_t hi = vaddv_u8(vget_high_u8(weighted));
+    return lo | (hi << 8);
+}
+
+static inline uint64_t delimiter_mask_neon_ctrees(const char *p)
+{
+    const uint8x16_t space = vdupq_n_u8(' '), comma = vdupq_n_u8(','), tab = vdupq_n_u8('\t'), cr = vdupq_n_u8('\r');
+    uint64_t mask = 0;
+    for(int i=0;i<4;i++) {
+        const uint8x16_t v = vld1q_u8((const uint8_t *) (p + 16*i));
+        const uint8x16_t d = vorrq_u8(vorrq_u8(vceqq_u8(v, space), vceqq_u8(v, comma)),
+                                      vorrq_u8(vceqq_u8(v, tab), vceqq_u8(v, cr)));
+        mask |= movemask_neon_ctrees(d) << (16*i);
+    }
+    return mask;
+}
+
+static inline uint64_t newline_mask_neon_ctrees(const char *p)
+{
+    const uint8x16_t newline = vdupq_n_u8('\n');
+    uint64_t mask = 0;
+    for(int i=0;i<4;i++) {
+        const uint8x16_t v = vld1q_u8((const uint8_t *) (p + 16*i));
+        mask |= movemask_neon_ctrees(vceqq_u8(v, newline)) << (16*i);
+    }
+    return mask;
+}
+
+PARSE_CTREES_DEFINE_SIMD_SCANNERS(neon, )
+#endif /* PARSE_CTREES_USE_NEON_SIMD */
+
+#undef PARSE_CTREES_DEFINE_SIMD_SCANNERS
+
+
+/* Returns the token-skipping function for the instruction set available at runtime */
+static inline ctrees_skip_tokens_fn get_skip_tokens_fn_ctrees(void)
+{
+    switch(get_simd_level_ctrees()) {
+#if defined(PARSE_CTREES_USE_X86_SIMD)
+    case PARSE_CTREES_AVX2: return skip_tokens_avx2_ctrees;
+    case PARSE_CTREES_SSE2: return skip_tokens_sse2_ctrees;
+#endif
+#if defined(PARSE_CTREES_USE_NEON_SIMD)
+    case PARSE_CTREES_NEON: return skip_tokens_neon_ctrees;
+#endif
+    default: return skip_tokens_scalar_ctrees;
+    }
+}
+
+
+/* Returns the number of new-lines within [this, end) */
+static inline int64_t count_newlines_ctrees(const char *this, const char *end)
+{
+    switch(get_simd_level_ctrees()) {
+#if defined(PARSE_CTREES_USE_X86_SIMD)
+    case PARSE_CTREES_AVX2: return count_newlines_avx2_ctrees(this, end);
+    case PARSE_CTREES_SSE2: return count_newlines_sse2_ctrees(this, end);
+#endif
+#if defined(PARSE_CTREES_USE_NEON_SIMD)
+    case PARSE_CTREES_NEON: return count_newlines_neon_ctrees(this, end);
+#endif
+    default: return count_newlines_scalar_ctrees(this, end);
+    }
+}
+
+
+/* Returns the address of the first new-line within [this, end), or NULL if there is none */
+static inline const char *find_newline_ctrees(const char *this, const char *end)
+{
+    switch(get_simd_level_ctrees()) {
+#if defined(PARSE_CTREES_USE_X86_SIMD)
+    case PARSE_CTREES_AVX2: return find_newline_avx2_ctrees(this, end);
+    case PARSE_CTREES_SSE2: return find_newline_sse2_ctrees(this, end);
+#endif
+#if defined(PARSE_CTREES_USE_NEON_SIMD)
+    case PARSE_CTREES_NEON: return find_newline_neon_ctrees(this, end);
+#endif
+    default: return find_newline_scalar_ctrees(this, end);
+    }
+}
+
+
+/* Returns the size in bytes of each numeric type (0 for unknown types) */
+static inline size_t size_of_numeric_type_ctrees(const enum parse_numeric_types type)
+{
+    switch(type) {
+    case I32: return sizeof(int32_t);
+    case I64: return sizeof(int64_t);
+    case U32: return sizeof(uint32_t);
+    case U64: return sizeof(uint64_t);
+    case F32: return sizeof(float);
+    case F64: return sizeof(double);
+    case I8: return sizeof(int8_t);
+    case I16: return sizeof(int16_t);
+    case U8: return sizeof(uint8_t);
+    case U16: return sizeof(uint16_t);
+    case BOOL: return sizeof(uint8_t);
+    case F16: return sizeof(uint16_t);
+    case Q16: return sizeof(uint16_t);
+    case Q32: return sizeof(uint32_t);
+    default: return 0;
+    }
+}
+
+
+/* Same as `parse_line_ctrees` but the line does not need to be NUL-terminated.
+   Parses the ``linelen`` bytes starting at ``line``.
+
+   The line is tokenized in-place, i.e., no copies are made and only the bytes up to the
+   last requested column are scanned. The row filters (if any) are only applied by the readers,
+   i.e., the line is always stored */
+static inline int parse_line_with_length_ctrees(const char *line, const size_t linelen, const struct ctrees_column_to_ptr *column_info, struct base_ptr_info *base_ptr_info)
+{
+    if(base_ptr_info->nallocated == base_ptr_info->N) {
+        int status = grow_base_ptrs_ctrees(base_ptr_info);
+        if(status != EXIT_SUCCESS) return status;
+    }
+
+    const char *this = line;
+    const char *end = line + linelen;
+    const char *token = NULL;
+    size_t toklen = 0;
+    int icol = -1;
+    for(int i=0;i<column_info->ncols;i++) {
+        const int wanted_col = column_info->column_number[i];
+        const int64_t base_ptr_idx = column_info->base_ptr_idx[i];
+        PARSE_CTREES_XASSERT(base_ptr_idx < base_ptr_info->num_base_ptrs,
+                             EXIT_FAILURE,
+                             "Error: Valid values for base pointer index must be in range [0, %"PRId64"). Got %"PRId64" instead\n",
+                             base_ptr_info->num_base_ptrs, base_ptr_idx);
+        char *dest = *((char **) (base_ptr_info->base_ptrs[base_ptr_idx]));
+        const size_t base_ptr_stride = base_ptr_info->base_element_size[base_ptr_idx];
+        const size_t dest_offset = column_info->dest_offset_to_element[i];
+        /* this is the type for the destination (hence called 'field_types' rather than 'column_types') */
+        const enum parse_numeric_types wanted_type = column_info->field_types[i];
+        const size_t field_size = size_of_numeric_type_ctrees(wanted_type);
+        PARSE_CTREES_XASSERT(field_size > 0 && base_ptr_stride >= field_size,
+                             EXIT_FAILURE,
+                             "Error: Stride=%zu is expected in bytes and must be at least the size of the destination type "
+                             "(%zu bytes for type = %d).\n"
+                             "Perhaps you forgot to multiply by the sizeof(element)?\n",
+                             base_ptr_stride, field_size, wanted_type);
+        PARSE_CTREES_XASSERT(dest_offset <= base_ptr_stride - field_size,
+                             EXIT_FAILURE,
+                             "Error: The field must fit within each element of the base pointer\n"
+                             "In this case offset=%zu must be in the range [0, %zu] (stride = %zu bytes). Perhaps you mis-typed the offset?\n",
+                             dest_offset, base_ptr_stride - field_size, base_ptr_stride);
+        (void) field_size;/* only used within the checks (which are disabled with NDEBUG) */
+            
+        /* get to the starting offset for this N'th element */
+        dest += base_ptr_info->N * base_ptr_stride;
+
+        /* now get to this particular field */
+        dest += dest_offset;
+
+        /* there might be duplicate column numbers in matched_columns
+           then the following while loop should immediately exit (without
+           executing any lines within)
+           and we will re-use the previous parsed value of token */
+        while(icol < wanted_col && this < end) {
+            while(this < end && is_column_delimiter_ctrees(*this)) this++;
+            if(this == end) break;
+            token = this;
+            while(this < end && ! is_column_delimiter_ctrees(*this)) this++;
+            toklen = this - token;
+            icol++;
+        }
+        PARSE_CTREES_XASSERT(token != NULL && icol == wanted_col,
+                             EXIT_FAILURE,
+                             "Error: Could not locate the requested column = %d (only found %d columns) in the line `%.*s`\n",
+                             wanted_col, icol + 1, (int) linelen, line);
+
+        /* the fixed-point types are parsed as doubles and then quantized */
+        const int is_quantized = (wanted_type == Q16 || wanted_type == Q32);
+        double value;
+        const enum parse_numeric_types parse_type = is_quantized ? F64:wanted_type;
+        void *parse_dest = is_quantized ? (void *) &value:(void *) dest;
+        int status = (column_info->conversion_method[i] == PARSE_CTREES_LIBC_CONVERSION) ?
+            convert_token_ctrees(token, toklen, parse_type, parse_dest) : convert_token_fast_ctrees(token, toklen, parse_type, parse_dest);
+        if(status == EXIT_SUCCESS && is_quantized) {
+            PARSE_CTREES_XASSERT(column_info->quant_hi[i] > column_info->quant_lo[i],
+                                 EXIT_FAILURE,
+                                 "Error: Invalid quantization range [%g, %g] for column number = %d. "
+                                 "Please use `set_column_quantization_ctrees` after parsing the header\n",
+                                 column_info->quant_lo[i], column_info->quant_hi[i], wanted_col);
+            status = quantize_value_ctrees(value, column_info->quant_lo[i], column_info->quant_hi[i], wanted_type, dest);
+        }
+        if(status != EXIT_SUCCESS) {
+            return status;
+        }
+    }
+
+    base_ptr_info->N++;
+    /* fprintf(stderr,"parsed one line: base->N = %"PRId64" nallocated = %"PRId64" line = `%.*s'\n", base_ptr_info->N, base_ptr_info->nallocated, (int) linelen, line); */
+    
+    return EXIT_SUCCESS;
+}
+
+static inline int parse_line_ctrees(const char *linebuf, const struct ctrees_column_to_ptr *column_info, struct base_ptr_info *base_ptr_info)
+{
+    return parse_line_with_length_ctrees(linebuf, strlen(linebuf), column_info, base_ptr_info);
+}
+
+
+/* Type-specialized converters (with the type fixed at compile-time) for the column plan */
+#define PARSE_CTREES_DEFINE_CONVERTERS(TYPE, NAME)                      \
+    static inline int convert_##NAME##_fast_ctrees(const char *token, const size_t toklen, void *dest) \
+    {                                                                   \
+        return convert_token_fast_ctrees(token, toklen, TYPE, dest);    \
+    }                                                                   \
+    static inline int convert_##NAME##_libc_ctrees(const char *token, const size_t toklen, void *dest) \
+    {                                                                   \
+        return convert_token_ctrees(token, toklen, TYPE, dest);         \
+    }
+
+PARSE_CTREES_DEFINE_CONVERTERS(I32, i32)
+PARSE_CTREES_DEFINE_CONVERTERS(I64, i64)
+PARSE_CTREES_DEFINE_CONVERTERS(U32, u32)
+PARSE_CTREES_DEFINE_CONVERTERS(U64, u64)
+PARSE_CTREES_DEFINE_CONVERTERS(F32, f32)
+PARSE_CTREES_DEFINE_CONVERTERS(F64, f64)
+PARSE_CTREES_DEFINE_CONVERTERS(I8, i8)
+PARSE_CTREES_DEFINE_CONVERTERS(I16, i16)
+PARSE_CTREES_DEFINE_CONVERTERS(U8, u8)
+PARSE_CTREES_DEFINE_CONVERTERS(U16, u16)
+PARSE_CTREES_DEFINE_CONVERTERS(BOOL, bool)
+PARSE_CTREES_DEFINE_CONVERTERS(F16, f16)
+#undef PARSE_CTREES_DEFINE_CONVERTERS
+
+
+/* Returns the converter function for the requested type and conversion method (NULL for invalid inputs) */
+static inline ctrees_converter_fn get_converter_ctrees(const enum parse_numeric_types type, const enum parse_conversion_methods method)
+{
+    const int use_libc = (method == PARSE_CTREES_LIBC_CONVERSION);
+    switch(type) {
+    case I32: return use_libc ? convert_i32_libc_ctrees : convert_i32_fast_ctrees;
+    case I64: return use_libc ? convert_i64_libc_ctrees : convert_i64_fast_ctrees;
+    case U32: return use_libc ? convert_u32_libc_ctrees : convert_u32_fast_ctrees;
+    case U64: return use_libc ? convert_u64_libc_ctrees : convert_u64_fast_ctrees;
+    case F32: return use_libc ? convert_f32_libc_ctrees : convert_f32_fast_ctrees;
+    case F64: return use_libc ? convert_f64_libc_ctrees : convert_f64_fast_ctrees;
+    case I8: return use_libc ? convert_i8_libc_ctrees : convert_i8_fast_ctrees;
+    case I16: return use_libc ? convert_i16_libc_ctrees : convert_i16_fast_ctrees;
+    case U8: return use_libc ? convert_u8_libc_ctrees : convert_u8_fast_ctrees;
+    case U16: return use_libc ? convert_u16_libc_ctrees : convert_u16_fast_ctrees;
+    case BOOL: return use_libc ? convert_bool_libc_ctrees : convert_bool_fast_ctrees;
+    case F16: return use_libc ? convert_f16_libc_ctrees : convert_f16_fast_ctrees;
+    /* the fixed-point types are parsed as doubles, and quantized by the plan */
+    case Q16:
+    case Q32: return use_libc ? convert_f64_libc_ctrees : convert_f64_fast_ctrees;
+    default: return NULL;
+    }
+}
+
+
+static inline void free_column_plan_ctrees(struct ctrees_column_plan *plan)
+{
+    free(plan->storage);
+    plan->storage = NULL;
+    plan->ncols = 0;
+}
+
+
+/* Allocates the per-column arrays of the ``plan`` for ``ncols`` columns (one allocation) */
+static inline int alloc_column_plan_ctrees(struct ctrees_column_plan *plan, const int64_t ncols)
+{
+    const int64_t n = (ncols > 0) ? ncols:1;
+    /* the 8-byte elements first, so that every array is aligned */
+    const size_t nbytes_per_column = sizeof(*(plan->dest_base_ptr)) + sizeof(*(plan->dest_stride)) + sizeof(*(plan->dest_offset)) +
+        sizeof(*(plan->convert)) + sizeof(*(plan->quant_lo)) + sizeof(*(plan->quant_hi)) + sizeof(*(plan->column_number)) +
+        sizeof(*(plan->ncols_to_advance)) + sizeof(*(plan->quant_type)) + sizeof(*(plan->is_quantized));
+    char *storage = malloc(n * nbytes_per_column);
+    if(storage == NULL) {
+        fprintf(stderr,"Error: Could not allocate memory for the plan of %"PRId64" columns\n", ncols);
+        perror(NULL);
+        return EXIT_FAILURE;
+    }
+    plan->storage = storage;
+    plan->dest_base_ptr = (void ***) storage;
+    plan->dest_stride = (size_t *) (plan->dest_base_ptr + n);
+    plan->dest_offset = plan->dest_stride + n;
+    plan->convert = (ctrees_converter_fn *) (plan->dest_offset + n);
+    plan->quant_lo = (double *) (plan->convert + n);
+    plan->quant_hi = plan->quant_lo + n;
+    plan->column_number = (int32_t *) (plan->quant_hi + n);
+    plan->ncols_to_advance = plan->column_number + n;
+    plan->quant_type = (enum parse_numeric_types *) (plan->ncols_to_advance + n);
+    plan->is_quantized = (int8_t *) (plan->quant_type + n);
+    return EXIT_SUCCESS;
+}
+
+
+/* Validates ``column_info`` against ``base_ptr_info`` and populates the (already allocated) ``plan``. Used by `compile_column_plan_ctrees` */
+static inline int populate_column_plan_ctrees(const struct ctrees_column_to_ptr *column_info, const struct base_ptr_info *base_ptr_info,
+                                              struct ctrees_column_plan *plan)
+{
+    plan->ncols = column_info->ncols;
+    plan->skip_tokens = get_skip_tokens_fn_ctrees();
+    plan->perf = NULL;
+    plan->nlines_for_sampling = NULL;
+    plan->alloc_context = NULL;
+    plan->ntokens_skipped_per_line = 0;
+    plan->ntokens_converted_per_line = column_info->ncols;
+    plan->nfilter_tokens_skipped_per_line = 0;
+    plan->nfilter_tokens_converted_per_line = 0;
+    int32_t prev_col = -1;
+    for(int64_t i=0;i<column_info->ncols;i++) {
+        const int32_t wanted_col = column_info->column_number[i];
+        if(wanted_col < prev_col || wanted_col < 0) {
+            fprintf(stderr,"Error: The requested columns must be sorted in ascending order (as done by `parse_header_ctrees`)\n"
+                    "Found column number = %d after column number = %d\n", wanted_col, prev_col);
+            return EXIT_FAILURE;
+        }
+        const int64_t base_ptr_idx = column_info->base_ptr_idx[i];
+        if(base_ptr_idx < 0 || base_ptr_idx >= base_ptr_info->num_base_ptrs) {
+            fprintf(stderr,"Error: Valid values for base pointer index must be in range [0, %"PRId64"). Got %"PRId64" instead\n",
+                    base_ptr_info->num_base_ptrs, base_ptr_idx);
+            return EXIT_FAILURE;
+        }
+        const enum parse_numeric_types wanted_type = column_info->field_types[i];
+        const size_t field_size = size_of_numeric_type_ctrees(wanted_type);
+        ctrees_converter_fn convert = get_converter_ctrees(wanted_type, column_info->conversion_method[i]);
+        if(field_size == 0 || convert == NULL) {
+            fprintf(stderr,"Error: Unknown value for parse type = %d\n", wanted_type);
+            fprintf(stderr,"Known values are in the range : [%d, %d)\n", I32, num_numeric_types);
+            return EXIT_FAILURE;
+        }
+        const size_t base_ptr_stride = base_ptr_info->base_element_size[base_ptr_idx];
+        const size_t dest_offset = column_info->dest_offset_to_element[i];
+        if(base_ptr_stride < field_size) {
+            fprintf(stderr,"Error: Stride=%zu is expected in bytes and must be at least the size of the destination type (= %zu bytes).\n"
+                    "Perhaps you forgot to multiply by the sizeof(element)?\n",
+                    base_ptr_stride, field_size);
+            return EXIT_FAILURE;
+        }
+        if(dest_offset + field_size > base_ptr_stride) {
+            fprintf(stderr,"Error: The offset from the starting address of an element can be at most the total stride in bytes\n"
+                    "In this case offset=%zu (with field size = %zu bytes) must be within the stride = %zu. Perhaps you mis-typed the offset?\n",
+                    dest_offset, field_size, base_ptr_stride);
+            return EXIT_FAILURE;
+        }
+
+        plan->column_number[i] = wanted_col;
+        plan->ncols_to_advance[i] = wanted_col - prev_col;
+        plan->dest_base_ptr[i] = base_ptr_info->base_ptrs[base_ptr_idx];
+        plan->dest_stride[i] = base_ptr_stride;
+        plan->dest_offset[i] = dest_offset;
+        plan->convert[i] = convert;
+        plan->is_quantized[i] = (wanted_type == Q16 || wanted_type == Q32);
+        plan->quant_type[i] = wanted_type;
+        plan->quant_lo[i] = column_info->quant_lo[i];
+        plan->quant_hi[i] = column_info->quant_hi[i];
+        if(plan->is_quantized[i] && !(column_info->quant_hi[i] > column_info->quant_lo[i])) {
+            fprintf(stderr,"Error: Invalid quantization range [%g, %g] for column number = %d. "
+                    "Please use `set_column_quantization_ctrees` after parsing the header\n",
+                    column_info->quant_lo[i], column_info->quant_hi[i], wanted_col);
+            return EXIT_FAILURE;
+        }
+        if(wanted_col > prev_col) plan->ntokens_skipped_per_line += wanted_col - prev_col - 1;
+        prev_col = wanted_col;
+    }
+
+    if(column_info->nfilters > PARSE_CTREES_MAX_NFILTERS || column_info->nfilters < 0) {
+        fprintf(stderr,"Error: You have requested %"PRId64" filters but there is only space to store %"PRId64"\n",
+                column_info->nfilters, (int64_t) PARSE_CTREES_MAX_NFILTERS);
+        return EXIT_FAILURE;
+    }
+    plan->nfilters = column_info->nfilters;
+    prev_col = -1;
+    for(int64_t i=0;i<column_info->nfilters;i++) {
+        const int32_t filter_col = column_info->filter_column_number[i];
+        if(filter_col < prev_col || filter_col < 0) {
+            fprintf(stderr,"Error: The filter columns must be sorted in ascending order (as done by `parse_header_with_filters_ctrees`)\n"
+                    "Found column number = %d after column number = %d\n", filter_col, prev_col);
+            return EXIT_FAILURE;
+        }
+        const enum parse_ctrees_filter_ops op = column_info->filter_op[i];
+        if(op < PARSE_CTREES_FILTER_EQ || op >= num_filter_ops) {
+            fprintf(stderr,"Error: Unknown value for filter operator = %d\n", op);
+            fprintf(stderr,"Known values are in the range : [%d, %d)\n", PARSE_CTREES_FILTER_EQ, num_filter_ops);
+            return EXIT_FAILURE;
+        }
+        plan->filter_column_number[i] = filter_col;
+        plan->filter_ncols_to_advance[i] = filter_col - prev_col;
+        plan->filter_op[i] = op;
+        plan->filter_lo[i] = column_info->filter_lo[i];
+        plan->filter_hi[i] = column_info->filter_hi[i];
+        if(filter_col > prev_col) {
+            plan->nfilter_tokens_skipped_per_line += filter_col - prev_col - 1;
+            plan->nfilter_tokens_converted_per_line++;
+        }
+        prev_col = filter_col;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+/* Validates ``column_info`` against ``base_ptr_info`` and populates the ``plan`` (any previous contents are
+   discarded without being freed). All the checks that `parse_line_ctrees` performs on every line are done here, once.
+   The plan has to be released with `free_column_plan_ctrees` */
+static inline int compile_column_plan_ctrees(const struct ctrees_column_to_ptr *column_info, const struct base_ptr_info *base_ptr_info,
+                                             struct ctrees_column_plan *plan)
+{
+    plan->storage = NULL;
+    plan->ncols = 0;
+    if(column_info->ncols < 0) {
+        fprintf(stderr,"Error: The number of requested columns must be non-negative. Got ncols = %"PRId64" instead\n", column_info->ncols);
+        return EXIT_FAILURE;
+    }
+    int status = alloc_column_plan_ctrees(plan, column_info->ncols);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    status = populate_column_plan_ctrees(column_info, base_ptr_info, plan);
+    if(status != EXIT_SUCCESS) {
+        free_column_plan_ctrees(plan);
+    }
+    return status;
+}
+
+
+/* Evaluates the row filters in the ``plan`` on one line. Sets ``passes`` to 1 if the line satisfies
+   all the filters (or if there are no filters), and 0 otherwise. Only the filter columns are converted,
+   and the evaluation stops at the first filter that fails */
+static inline int evaluate_filters_plan_ctrees(const char *line, const size_t linelen, const struct ctrees_column_plan *plan, int *passes)
+{
+    const char *this = line;
+    const char *end = line + linelen;
+    const char *token = NULL;
+    double value = 0.0;
+    *passes = 1;
+    for(int64_t i=0;i<plan->nfilters;i++) {
+        /* multiple filters on the same column re-use the previous value */
+        const int32_t ncols_to_advance = plan->filter_ncols_to_advance[i];
+        if(ncols_to_advance > 0) {
+            this = (ncols_to_advance < PARSE_CTREES_SIMD_MIN_SKIP_NCOLS) ? skip_tokens_scalar_ctrees(this, end, ncols_to_advance, &token)
+                : plan->skip_tokens(this, end, ncols_to_advance, &token);
+            if(this == NULL) {
+                fprintf(stderr,"Error: Could not locate the filter column = %d in the line `%.*s`\n",
+                        plan->filter_column_number[i], (int) linelen, line);
+                return EXIT_FAILURE;
+            }
+            int status = convert_token_fast_ctrees(token, this - token, F64, &value);
+            if(status != EXIT_SUCCESS) {
+                return status;
+            }
+        }
+
+        const double lo = plan->filter_lo[i];
+        int match = 0;
+        switch(plan->filter_op[i]) {
+        case PARSE_CTREES_FILTER_EQ: match = (value == lo); break;
+        case PARSE_CTREES_FILTER_NE: match = (value != lo); break;
+        case PARSE_CTREES_FILTER_LT: match = (value < lo); break;
+        case PARSE_CTREES_FILTER_LE: match = (value <= lo); break;
+        case PARSE_CTREES_FILTER_GT: match = (value > lo); break;
+        case PARSE_CTREES_FILTER_GE: match = (value >= lo); break;
+        case PARSE_CTREES_FILTER_IN_RANGE: match = (value >= lo && value <= plan->filter_hi[i]); break;
+        default: match = 0; break;
+        }
+        if(match == 0) {
+            *passes = 0;
+            break;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+
+/* Parses one line (``linelen`` bytes at ``line``, need not be NUL-terminated) according to the
+   compiled ``plan`` and writes the values into the element ``row`` of each destination.
+
+   The caller is responsible for ensuring that ``row`` is within the allocated memory. The row
+   filters are *not* evaluated (see `evaluate_filters_plan_ctrees`) */
+static inline int parse_row_plan_ctrees(const char *line, const size_t linelen, const struct ctrees_column_plan *plan, const int64_t row)
+{
+    const char *this = line;
+    const char *end = line + linelen;
+    const char *token = NULL;
+    size_t toklen = 0;
+    for(int64_t i=0;i<plan->ncols;i++) {
+        /* duplicate columns have ncols_to_advance == 0 and re-use the previous token */
+        const int32_t ncols_to_advance = plan->ncols_to_advance[i];
+        if(ncols_to_advance > 0) {
+            this = (ncols_to_advance < PARSE_CTREES_SIMD_MIN_SKIP_NCOLS) ? skip_tokens_scalar_ctrees(this, end, ncols_to_advance, &token)
+                : plan->skip_tokens(this, end, ncols_to_advance, &token);
+            if(this == NULL) {
+                fprintf(stderr,"Error: Could not locate the requested column = %d in the line `%.*s`\n",
+                        plan->column_number[i], (int) linelen, line);
+                return EXIT_FAILURE;
+            }
+            toklen = this - token;
+        }
+
+        char *dest = *((char **) plan->dest_base_ptr[i]) + row * plan->dest_stride[i] + plan->dest_offset[i];
+        int status;
+        if(plan->is_quantized[i]) {
+            double value;
+            status = plan->convert[i](token, toklen, &value);
+            if(status == EXIT_SUCCESS) {
+                status = quantize_value_ctrees(value, plan->quant_lo[i], plan->quant_hi[i], plan->quant_type[i], dest);
+            }
+        } else {
+            status = plan->convert[i](token, toklen, dest);
+        }
+        if(status != EXIT_SUCCESS) {
+            return status;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+#ifdef PARSE_CTREES_USE_PERF_COUNTERS
+static inline double get_seconds_ctrees(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + 1e-9 * (double) ts.tv_nsec;
+}
+
+/* Same as `parse_row_plan_ctrees` but also estimates the time spent in tokenizing and in the conversion (into ``perf``,
+   scaled by PARSE_CTREES_PERF_SAMPLE_INTERVAL). The line is first only tokenized, and then parsed -- the difference
+   in the times is the conversion. Only called on the sampled lines */
+static inline int parse_row_plan_timed_ctrees(const char *line, const size_t linelen, const struct ctrees_column_plan *plan, const int64_t row,
+                                              struct ctrees_perf_counters *perf)
+{
+    const char *this = line;
+    const char *end = line + linelen;
+    const char *token = NULL;
+    const double t0 = get_seconds_ctrees();
+    for(int64_t i=0;i<plan->ncols && this != NULL;i++) {
+        const int32_t ncols_to_advance = plan->ncols_to_advance[i];
+        if(ncols_to_advance > 0) {
+            this = (ncols_to_advance < PARSE_CTREES_SIMD_MIN_SKIP_NCOLS) ? skip_tokens_scalar_ctrees(this, end, ncols_to_advance, &token)
+                : plan->skip_tokens(this, end, ncols_to_advance, &token);
+        }
+    }
+    const double t1 = get_seconds_ctrees();
+    const int status = parse_row_plan_ctrees(line, linelen, plan, row);
+    const double t2 = get_seconds_ctrees();
+
+    const double tokenize_seconds = t1 - t0;
+    const double convert_seconds = (t2 - t1 > tokenize_seconds) ? (t2 - t1) - tokenize_seconds : 0.0;
+    perf->tokenize_seconds += PARSE_CTREES_PERF_SAMPLE_INTERVAL * tokenize_seconds;
+    perf->convert_seconds += PARSE_CTREES_PERF_SAMPLE_INTERVAL * convert_seconds;
+    return status;
+}
+#endif /* PARSE_CTREES_USE_PERF_COUNTERS */
+
+
+/* Same as `parse_line_with_length_ctrees` but uses the compiled ``plan`` (no validation is performed per line).
+   The ``plan`` must have been compiled against ``base_ptr_info``. Lines rejected by the row filters
+   (if any) are skipped, i.e., ``base_ptr_info->N`` is not incremented */
+static inline int parse_line_plan_ctrees(const char *line, const size_t linelen, const struct ctrees_column_plan *plan, struct base_ptr_info *base_ptr_info)
+{
+#ifdef PARSE_CTREES_USE_PERF_COUNTERS
+    struct ctrees_perf_counters *perf = plan->perf;
+    if(perf != NULL) {
+        perf->nlines_parsed++;
+        perf->ntokens_skipped += plan->nfilter_tokens_skipped_per_line;
+        perf->ntokens_converted += plan->nfilter_tokens_converted_per_line;
+    }
+#endif
+    if(plan->nfilters > 0) {
+        int passes = 0;
+        int status = evaluate_filters_plan_ctrees(line, linelen, plan, &passes);
+        if(status != EXIT_SUCCESS) return status;
+        if(passes == 0) {
+#ifdef PARSE_CTREES_USE_PERF_COUNTERS
+            if(perf != NULL) perf->nlines_rejected++;
+#endif
+            return EXIT_SUCCESS;
+        }
+    }
+    if(base_ptr_info->nallocated == base_ptr_info->N) {
+        int status = grow_base_ptrs_alloc_ctrees(base_ptr_info, plan->alloc_context);
+        if(status != EXIT_SUCCESS) return status;
+    }
+#ifdef PARSE_CTREES_USE_PERF_COUNTERS
+    int status;
+    if(perf != NULL) {
+        perf->ntokens_skipped += plan->ntokens_skipped_per_line;
+        perf->ntokens_converted += plan->ntokens_converted_per_line;
+        const int64_t nlines_for_sampling = (plan->nlines_for_sampling != NULL) ? (*(plan->nlines_for_sampling))++ : perf->nlines_parsed;
+        status = (nlines_for_sampling % PARSE_CTREES_PERF_SAMPLE_INTERVAL == 0) ? parse_row_plan_timed_ctrees(line, linelen, plan, base_ptr_info->N, perf)
+            : parse_row_plan_ctrees(line, linelen, plan, base_ptr_info->N);
+    } else {
+        status = parse_row_plan_ctrees(line, linelen, plan, base_ptr_info->N);
+    }
+#else
+    int status = parse_row_plan_ctrees(line, linelen, plan, base_ptr_info->N);
+#endif
+    if(status != EXIT_SUCCESS) return status;
+
+    base_ptr_info->N++;
+    return EXIT_SUCCESS;
+}
+
+
+/* Returns 1 if the line starting at ``start`` is the `#tree <tree_id>` line at the beginning of a tree */
+static inline int is_tree_marker_ctrees(const char *start, const char *end)
+{
+    const char marker[] = "#tree";
+    const size_t marker_len = sizeof(marker) - 1;
+    return ((size_t) (end - start) >= marker_len && memcmp(start, marker, marker_len) == 0);
+}
+
+
+/* Allocates the re-usable buffer within ``reader``. If ``bufsize`` is 0, then
+   PARSE_CTREES_DEFAULT_READ_BUFSIZE bytes are allocated */
+static inline int init_buffered_reader_ctrees(struct ctrees_buffered_reader *reader, const size_t bufsize)
+{
+    const size_t size = (bufsize == 0) ? (size_t) PARSE_CTREES_DEFAULT_READ_BUFSIZE : bufsize;
+    PARSE_CTREES_XASSERT(size >= PARSE_CTREES_MAXBUFSIZE,
+                         EXIT_FAILURE,
+                         "Error: Buffer size = %zu bytes is too small. Please use at least %d bytes\n",
+                         size, PARSE_CTREES_MAXBUFSIZE);
+    reader->buffer = malloc(size);
+    if(reader->buffer == NULL) {
+        fprintf(stderr,"Error: Could not allocate memory for the read buffer (requested %zu bytes)\n", size);
+        perror(NULL);
+        reader->bufsize = 0;
+        return EXIT_FAILURE;
+    }
+    reader->bufsize = size;
+    reader->nbytes_parsed = 0;
+    reader->nrows_parsed = 0;
+    reader->perf = NULL;
+    reader->buffer_offset = 0;
+    reader->buffer_nbytes = 0;
+    memset(&(reader->buffer_source), 0, sizeof(reader->buffer_source));
+    return EXIT_SUCCESS;
+}
+
+static inline void free_buffered_reader_ctrees(struct ctrees_buffered_reader *reader)
+{
+    free(reader->buffer);
+    reader->buffer = NULL;
+    reader->bufsize = 0;
+    reader->buffer_nbytes = 0;
+}
+
+/* Discards the bytes kept in the buffer of ``reader`` (from the previous tree). Called by every reader that overwrites
+   the buffer with something else. Only needs to be called by the user if the contents of an input change (without
+   changing the size or the modification time of the file) while the ``reader`` is in use */
+static inline void invalidate_buffered_reader_ctrees(struct ctrees_buffered_reader *reader)
+{
+    reader->buffer_nbytes = 0;
+}
+
+/* Doubles the size of the read buffer within ``reader`` while preserving its contents. Called by the
+   buffered readers when a single line does not fit within the buffer, i.e., there is no limit on the
+   length of a line (other than the available memory). Any pointers into the old buffer are invalidated */
+static inline int grow_buffered_reader_ctrees(struct ctrees_buffered_reader *reader)
+{
+    const size_t newsize = 2 * reader->bufsize;
+    char *newbuf = realloc(reader->buffer, newsize);
+    if(newbuf == NULL) {
+        fprintf(stderr,"Error: Could not grow the read buffer from %zu bytes to %zu bytes\n", reader->bufsize, newsize);
+        perror(NULL);
+        return EXIT_FAILURE;
+    }
+    reader->buffer = newbuf;
+    reader->bufsize = newsize;
+    return EXIT_SUCCESS;
+}
+
+
+/* signature for the functions that are called on every (non-empty) halo line of a tree by
+   `visit_tree_lines_buffered_ctrees` and `visit_tree_lines_in_memory_ctrees`. The ``line`` is
+   ``linelen`` bytes long and is *not* NUL-terminated */
+typedef int (*ctrees_line_visitor_fn)(const char *line, const size_t linelen, void *data);
+
+
+/* Reads one tree (starting at ``offset``) from the input ``source`` through the (large) re-usable buffer contained
+   within ``reader`` and calls ``visit`` on every halo line. Only complete lines are visited -- the trailing partial
+   line is carried over to the front of the buffer and the next read appends to it.
+
+   If the tree starts within the bytes left in the buffer by the previous call (from the same ``source``), then the
+   tree is parsed from those bytes first, i.e., reading consecutive trees re-uses the rest of every read rather than
+   reading the following tree again.
+
+   Reading stops at EOF, at the first line beginning with '#' (i.e., the next tree) or if ``visit``
+   returns anything other than EXIT_SUCCESS */
+static inline int visit_tree_lines_source_ctrees(const struct ctrees_input_source *source, off_t offset, struct ctrees_buffered_reader *reader,
+                                                 ctrees_line_visitor_fn visit, void *data)
+{
+    PARSE_CTREES_XASSERT(reader->buffer != NULL && reader->bufsize > 1,
+                         EXIT_FAILURE,
+                         "Error: The read buffer has not been allocated. Please call `init_buffered_reader_ctrees` first\n");
+
+    struct ctrees_source_key key;
+    const int have_key = (get_source_key_ctrees(source, &key) == EXIT_SUCCESS);
+    size_t nvalid = 0;/* number of bytes in the buffer */
+    size_t pos = 0;/* the first byte (within the buffer) that has not been parsed yet */
+    if(have_key && reader->buffer_nbytes > 0 && memcmp(&key, &(reader->buffer_source), sizeof(key)) == 0 &&
+       offset >= reader->buffer_offset && offset < reader->buffer_offset + (off_t) reader->buffer_nbytes) {
+        nvalid = reader->buffer_nbytes;
+        pos = (size_t) (offset - reader->buffer_offset);
+    } else {
+        reader->buffer_offset = offset;
+    }
+    /* the buffer is only valid again once the tree has been read completely */
+    reader->buffer_nbytes = 0;
+
+    char *buffer = reader->buffer;
+    size_t capacity = reader->bufsize;
+    int done_reading_tree = 0;
+    int reached_eof = 0;
+    int at_first_line = 1;
+
+    while(1) {
+        char *start = buffer + pos;
+        char *end = buffer + nvalid;
+        while(start < end) {
+            if(*start == '#' && at_first_line == 0) {
+                /* we have encountered the beginning of a new tree (new line and begins with '#tree ')*/
+                done_reading_tree = 1;
+                break;
+            }
+            char *newline = (char *) find_newline_ctrees(start, end);
+            if(newline == NULL) {
+                /* partial line -> carry over to the next read, unless there is nothing more to read */
+                if(reached_eof == 0) break;
+                newline = end;/* the last line in the file does not have a new-line */
+            }
+            /* the offset may point to the `#tree <tree_id>` line (e.g., from `locations.dat`) -> skip that (complete) line */
+            const int skip_line = at_first_line && is_tree_marker_ctrees(start, newline);
+            if(*start == '#' && skip_line == 0) {
+                done_reading_tree = 1;
+                break;
+            }
+            at_first_line = 0;
+            if(newline > start && skip_line == 0) {
+                int status = visit(start, newline - start, data);
+                if(status != EXIT_SUCCESS) {
+                    return status;
+                }
+            }
+            start = newline + 1;/* might point beyond valid memory but should not get de-referenced */
+        }
+        if(reached_eof || done_reading_tree) {
+            pos = (start < end) ? (size_t) (start - buffer) : nvalid;
+            break;
+        }
+
+        /* move the partial line to the front and append the next read */
+        const size_t nleft = (start < end) ? (size_t) (end - start):0;
+        memmove(buffer, start, nleft);
+        reader->buffer_offset += (off_t) (nvalid - nleft);
+        nvalid = nleft;
+        pos = 0;
+        if(nleft == capacity) {
+            /* the buffer only contains a partial line -> make room for the rest of that line */
+            if(grow_buffered_reader_ctrees(reader) != EXIT_SUCCESS) {
+                return EXIT_FAILURE;
+            }
+            buffer = reader->buffer;
+            capacity = reader->bufsize;
+        }
+
+        const size_t to_read_bytes = capacity - nvalid;
+#ifdef PARSE_CTREES_USE_PERF_COUNTERS
+        const double t0 = (reader->perf != NULL) ? get_seconds_ctrees() : 0.0;
+#endif
+        ssize_t nbytes_read = source->pread(source->handle, buffer + nvalid, to_read_bytes, reader->buffer_offset + (off_t) nvalid);
+#ifdef PARSE_CTREES_USE_PERF_COUNTERS
+        if(reader->perf != NULL) {
+            reader->perf->io_seconds += get_seconds_ctrees() - t0;
+            reader->perf->nreads++;
+            if(nbytes_read > 0) reader->perf->nbytes_read += nbytes_read;
+        }
+#endif
+        if(nbytes_read < 0) {
+            fprintf(stderr,"Error: trying to read %zu bytes from file failed. Encountered negative bytes read \n", to_read_bytes);
+            perror(NULL);
+            return EXIT_FAILURE;
+        }
+        nvalid += nbytes_read;
+        reached_eof = (nbytes_read == 0);
+    }
+
+    /* keep the rest of the buffer (i.e., the following trees) for the next call */
+    if(have_key && pos < nvalid) {
+        reader->buffer_nbytes = nvalid;
+        reader->buffer_source = key;
+    }
+    return EXIT_SUCCESS;
+}
+
+
+/* Same as `visit_tree_lines_source_ctrees` for a (regular) file descriptor */
+static inline int visit_tree_lines_buffered_ctrees(int fd, off_t offset, struct ctrees_buffered_reader *reader,
+                                                   ctrees_line_visitor_fn visit, void *data)
+{
+    const struct ctrees_input_source source = get_fd_source_ctrees(&fd);
+    return visit_tree_lines_source_ctrees(&source, offset, reader, visit, data);
+}
+
+
+/* Calls ``visit`` on every halo line contained in the memory range [start, end). Stops at ``end``,
+   at the first line beginning with '#' (i.e., the next tree) or if ``visit`` returns anything other than EXIT_SUCCESS.
+
+   On success, the number of bytes processed is returned in ``nbytes_processed`` (if not NULL) */
+static inline int visit_tree_lines_in_memory_ctrees(const char *start, const char *end, ctrees_line_visitor_fn visit, void *data,
+                                                    size_t *nbytes_processed)
+{
+    const char *this = start;
+    while(this < end) {
+        if(*this == '#') {
+            /* we have encountered the beginning of a new tree (new line and begins with '#tree ')*/
+            break;
+        }
+        const char *newline = find_newline_ctrees(this, end);
+        if(newline == NULL) {
+            newline = end;/* the last line in the memory range does not have a new-line */
+        }
+        if(newline > this) {
+            int status = visit(this, newline - this, data);
+            if(status != EXIT_SUCCESS) {
+                return status;
+            }
+        }
+        this = newline + 1;
+    }
+    if(nbytes_processed != NULL) {
+        *nbytes_processed = (this < end) ? (size_t) (this - start) : (size_t) (end - start);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+/* The line-visitor used by all the readers that store the halos into the base pointers */
+struct ctrees_plan_visitor_data {
+    const struct ctrees_column_plan *plan;
+    struct base_ptr_info *base_ptr_info;
+};
+
+static inline int parse_line_plan_visitor_ctrees(const char *line, const size_t linelen, void *data)
+{
+    struct ctrees_plan_visitor_data *visitor_data = (struct ctrees_plan_visitor_data *) data;
+    return parse_line_plan_ctrees(line, linelen, visitor_data->plan, visitor_data->base_ptr_info);
+}
+
+
+/* Same as `read_single_tree_buffered_ctrees` but the base pointers are (re-)allocated with ``alloc_context`` (e.g.,
+   from a `struct ctrees_arena`, see `reallocate_base_ptrs_alloc_ctrees`) */
+static inline int read_single_tree_buffered_alloc_ctrees(int fd, off_t offset, const struct ctrees_column_to_ptr *column_info,
+                                                         struct base_ptr_info *base_ptr_info, struct ctrees_alloc_context *alloc_context,
+                                                         struct ctrees_buffered_reader *reader)
+{
+    struct ctrees_column_plan plan;
+    int status = compile_column_plan_ctrees(column_info, base_ptr_info, &plan);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    plan.alloc_context = alloc_context;
+
+    struct ctrees_plan_visitor_data visitor_data = {.plan = &plan, .base_ptr_info = base_ptr_info};
+    status = visit_tree_lines_buffered_ctrees(fd, offset, reader, parse_line_plan_visitor_ctrees, &visitor_data);
+    free_column_plan_ctrees(&plan);
+    return status;
+}
+
+/* Same as `read_single_tree_ctrees` but reads through the (large) re-usable buffer
+   contained within ``reader`` (see `visit_tree_lines_buffered_ctrees`).
+
+   Reading stops at EOF or at the first line beginning with '#' (i.e., the next tree) */
+static inline int read_single_tree_buffered_ctrees(int fd, off_t offset, const struct ctrees_column_to_ptr *column_info,
+                                                   struct base_ptr_info *base_ptr_info, struct ctrees_buffered_reader *reader)
+{
+    return read_single_tree_buffered_alloc_ctrees(fd, offset, column_info, base_ptr_info, NULL, reader);
+}
+
+/* Same as `read_single_tree_ctrees` but the base pointers are (re-)allocated with ``alloc_context`` */
+static inline int read_single_tree_alloc_ctrees(int fd, off_t offset, const struct ctrees_column_to_ptr *column_info, struct base_ptr_info *base_ptr_info,
+                                                struct ctrees_alloc_context *alloc_context)
+{
+    struct ctrees_buffered_reader reader;
+    int status = init_buffered_reader_ctrees(&reader, PARSE_CTREES_SINGLE_TREE_BUFSIZE);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    status = read_single_tree_buffered_alloc_ctrees(fd, offset, column_info, base_ptr_info, alloc_context, &reader);
+    free_buffered_reader_ctrees(&reader);
+    return status;
+}
+
+/* Reads the tree starting at ``offset`` (either the `#tree` line or the first halo) from the file descriptor ``fd``
+   and appends the halos to the base pointers. A (small) read buffer is allocated for every call, and grows to hold
+   the longest line in the tree -- use `read_single_tree_buffered_ctrees` to re-use the buffer between trees.
+
+   Reading stops at EOF or at the first line beginning with '#' (i.e., the next tree) */
+static inline int read_single_tree_ctrees(int fd, off_t offset, const struct ctrees_column_to_ptr *column_info, struct base_ptr_info *base_ptr_info)
+{
+    return read_single_tree_alloc_ctrees(fd, offset, column_info, base_ptr_info, NULL);
+}
+
+/* Same as `read_single_tree_buffered_ctrees` but reads from any input ``source``, e.g., a compressed
+   file (see `get_compressed_source_ctrees`). The ``offset`` is within the (uncompressed) contents of the source */
+static inline int read_single_tree_source_ctrees(const struct ctrees_input_source *source, off_t offset, const struct ctrees_column_to_ptr *column_info,
+                                                 struct base_ptr_info *base_ptr_info, struct ctrees_buffered_reader *reader)
+{
+    struct ctrees_column_plan plan;
+    int status = compile_column_plan_ctrees(column_info, base_ptr_info, &plan);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+
+    struct ctrees_plan_visitor_data visitor_data = {.plan = &plan, .base_ptr_info = base_ptr_info};
+    status = visit_tree_lines_source_ctrees(source, offset, reader, parse_line_plan_visitor_ctrees, &visitor_data);
+    free_column_plan_ctrees(&plan);
+    return status;
+}
+
+/* Reads the tree at the (uncompressed) ``offset`` from the compressed file ``cfile``. Only the frames
+   that contain the tree are decompressed (if not already cached from the previous trees) */
+static inline int read_single_tree_compressed_ctrees(struct ctrees_compressed_file *cfile, off_t offset, const struct ctrees_column_to_ptr *column_info,
+                                                     struct base_ptr_info *base_ptr_info, struct ctrees_buffered_reader *reader)
+{
+    const struct ctrees_input_source source = get_compressed_source_ctrees(cfile);
+    return read_single_tree_source_ctrees(&source, offset, column_info, base_ptr_info, reader);
+}
+
+#ifdef PARSE_CTREES_USE_PTHREADS
+/* The main loop of the I/O thread -- keeps every empty buffer filled with the next bytes of the source */
+static inline void *prefetch_thread_ctrees(void *arg)
+{
+    struct ctrees_prefetcher *prefetcher = (struct ctrees_prefetcher *) arg;
+    pthread_mutex_lock(&(prefetcher->lock));
+    while(prefetcher->stop == 0) {
+        struct ctrees_prefetch_block *block = NULL;
+        for(int i=0;i<prefetcher->nbuffers && prefetcher->reached_eof == 0 && prefetcher->io_error == 0;i++) {
+            if(prefetcher->blocks[i].state == 0) {
+                block = &(prefetcher->blocks[i]);
+                break;
+            }
+        }
+        if(block == NULL) {
+            pthread_cond_wait(&(prefetcher->cond), &(prefetcher->lock));
+            continue;
+        }
+
+        const uint64_t generation = prefetcher->generation;
+        const int64_t offset = prefetcher->next_offset;
+        block->state = 1;
+        block->offset = offset;
+        prefetcher->next_offset += prefetcher->bufsize;
+        pthread_mutex_unlock(&(prefetcher->lock));
+
+        /* read the entire buffer (the source may return short reads) */
+        int64_t nbytes = 0;
+        int io_error = 0;
+        while(nbytes < (int64_t) prefetcher->bufsize) {
+            ssize_t n = prefetcher->source.pread(prefetcher->source.handle, block->data + nbytes, prefetcher->bufsize - nbytes, offset + nbytes);
+            if(n < 0) {
+                io_error = 1;
+                break;
+            }
+            if(n == 0) break;
+            nbytes += n;
+        }
+
+        pthread_mutex_lock(&(prefetcher->lock));
+        if(generation != prefetcher->generation) {
+            /* the read-ahead was restarted while reading -> these bytes are not needed */
+            block->state = 0;
+        } else {
+            block->nbytes = nbytes;
+            block->state = 2;
+            prefetcher->io_error |= io_error;
+            if(nbytes < (int64_t) prefetcher->bufsize) {
+                prefetcher->reached_eof = 1;
+            }
+        }
+        pthread_cond_broadcast(&(prefetcher->cond));
+    }
+    pthread_mutex_unlock(&(prefetcher->lock));
+    return NULL;
+}
+
+
+/* Starts the I/O thread that reads ahead from ``source`` (starting at offset 0) into ``nbuffers``
+   buffers of ``bufsize`` bytes each (0 for the defaults of 3 buffers and PARSE_CTREES_DEFAULT_READ_BUFSIZE bytes) */
+static inline int init_prefetcher_ctrees(struct ctrees_prefetcher *prefetcher, const struct ctrees_input_source *source,
+                                         const int nbuffers, const size_t bufsize)
+{
+    memset(prefetcher, 0, sizeof(*prefetcher));
+    prefetcher->source = *source;
+    prefetcher->nbuffers = (nbuffers <= 0) ? 3:nbuffers;
+    prefetcher->bufsize = (bufsize == 0) ? (size_t) PARSE_CTREES_DEFAULT_READ_BUFSIZE : bufsize;
+    if(prefetcher->nbuffers > PARSE_CTREES_PREFETCH_MAX_NBUFFERS) {
+        fprintf(stderr,"Error: Requested %d buffers but there is only space for %d. Please define the macro variable "
+                "`PARSE_CTREES_PREFETCH_MAX_NBUFFERS' to be larger (before including the file `%s')\n",
+                prefetcher->nbuffers, PARSE_CTREES_PREFETCH_MAX_NBUFFERS, __FILE__);
+        return EXIT_FAILURE;
+    }
+    for(int i=0;i<prefetcher->nbuffers;i++) {
+        prefetcher->blocks[i].data = malloc(prefetcher->bufsize);
+        if(prefetcher->blocks[i].data == NULL) {
+            fprintf(stderr,"Error: Could not allocate memory for the read-ahead buffer (requested %zu bytes)\n", prefetcher->bufsize);
+            perror(NULL);
+            for(int j=0;j<i;j++) free(prefetcher->blocks[j].data);
+            return EXIT_FAILURE;
+        }
+    }
+    pthread_mutex_init(&(prefetcher->lock), NULL);
+    pthread_cond_init(&(prefetcher->cond), NULL);
+    if(pthread_create(&(prefetcher->thread), NULL, prefetch_thread_ctrees, prefetcher) != 0) {
+        fprintf(stderr,"Error: Could not create the I/O thread\n");
+        pthread_mutex_destroy(&(prefetcher->lock));
+        pthread_cond_destroy(&(prefetcher->cond));
+        for(int i=0;i<prefetcher->nbuffers;i++) free(prefetcher->blocks[i].data);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+
+/* Stops (and joins) the I/O thread and frees the buffers. The underlying source is not closed */
+static inline void free_prefetcher_ctrees(struct ctrees_prefetcher *prefetcher)
+{
+    pthread_mutex_lock(&(prefetcher->lock));
+    prefetcher->stop = 1;
+    pthread_cond_broadcast(&(prefetcher->cond));
+    pthread_mutex_unlock(&(prefetcher->lock));
+    pthread_join(prefetcher->thread, NULL);
+    pthread_mutex_destroy(&(prefetcher->lock));
+    pthread_cond_destroy(&(prefetcher->cond));
+    for(int i=0;i<prefetcher->nbuffers;i++) {
+        free(prefetcher->blocks[i].data);
+        prefetcher->blocks[i].data = NULL;
+    }
+    prefetcher->nbuffers = 0;
+}
+
+
+/* `pread` for the prefetcher (``handle`` points to a `struct ctrees_prefetcher`). Returns the bytes
+   from the read-ahead buffers (waiting for the I/O thread if necessary). The buffers that end before
+   ``offset`` are recycled, i.e., the read-ahead assumes that the reads move forward through the source */
+static inline ssize_t pread_prefetch_ctrees(void *handle, void *buf, size_t nbytes, off_t offset)
+{
+    struct ctrees_prefetcher *prefetcher = (struct ctrees_prefetcher *) handle;
+    const int64_t wanted = (int64_t) offset;
+    const int64_t bufsize = (int64_t) prefetcher->bufsize;
+    ssize_t nread = -1;
+    pthread_mutex_lock(&(prefetcher->lock));
+    while(prefetcher->io_error == 0) {
+        int pending = 0, at_eof = 0;
+        struct ctrees_prefetch_block *ready = NULL;
+        for(int i=0;i<prefetcher->nbuffers;i++) {
+            struct ctrees_prefetch_block *block = &(prefetcher->blocks[i]);
+            if(block->state == 2 && block->nbytes == bufsize && block->offset + bufsize <= wanted) {
+                /* already consumed -> recycle (the I/O thread is woken up below) */
+                block->state = 0;
+                pending = 1;
+                continue;
+            }
+            if(block->state == 1 && wanted >= block->offset && wanted < block->offset + bufsize) {
+                pending = 1;
+            } else if(block->state == 2 && wanted >= block->offset && wanted < block->offset + block->nbytes) {
+                ready = block;
+            } else if(block->state == 2 && block->nbytes < bufsize && wanted >= block->offset + block->nbytes) {
+                at_eof = (wanted >= block->offset);
+            }
+        }
+        if(ready != NULL) {
+            const int64_t navail = ready->offset + ready->nbytes - wanted;
+            const size_t ncopy = (navail < (int64_t) nbytes) ? (size_t) navail : nbytes;
+            memcpy(buf, ready->data + (wanted - ready->offset), ncopy);
+            nread = (ssize_t) ncopy;
+            break;
+        }
+        if(at_eof) {
+            nread = 0;
+            break;
+        }
+        if(pending == 0 && (prefetcher->next_offset != wanted || prefetcher->reached_eof)) {
+            /* not within the read-ahead window -> restart the read-ahead at this offset */
+            prefetcher->generation++;
+            prefetcher->nrestarts++;
+            for(int i=0;i<prefetcher->nbuffers;i++) {
+                if(prefetcher->blocks[i].state == 2) prefetcher->blocks[i].state = 0;
+            }
+            prefetcher->next_offset = wanted;
+            prefetcher->reached_eof = 0;
+        }
+        prefetcher->nwaits++;
+        pthread_cond_broadcast(&(prefetcher->cond));
+        pthread_cond_wait(&(prefetcher->cond), &(prefetcher->lock));
+    }
+    pthread_mutex_unlock(&(prefetcher->lock));
+    return nread;
+}
+
+static inline struct ctrees_input_source get_prefetch_source_ctrees(struct ctrees_prefetcher *prefetcher)
+{
+    struct ctrees_input_source source = {.pread = pread_prefetch_ctrees, .handle = prefetcher};
+    return source;
+}
+#endif /* PARSE_CTREES_USE_PTHREADS */
+
+
+/* Same as `parse_tree_from_memory_ctrees` but uses an already compiled ``plan`` */
+static inline int parse_tree_from_memory_plan_ctrees(const char *start, const char *end, const struct ctrees_column_plan *plan,
+                                                     struct base_ptr_info *base_ptr_info, size_t *nbytes_processed)
+{
+    struct ctrees_plan_visitor_data visitor_data = {.plan = plan, .base_ptr_info = base_ptr_info};
+    return visit_tree_lines_in_memory_ctrees(start, end, parse_line_plan_visitor_ctrees, &visitor_data, nbytes_processed);
+}
+
+
+/* Parses all the lines of one tree contained in the memory range [start, end).
+   Parsing stops at ``end`` or at the first line beginning with '#' (i.e., the next tree).
+   The lines are parsed in-place, i.e., the memory is never written to.
+
+   On success, the number of bytes processed is returned in ``nbytes_processed`` (if not NULL) */
+static inline int parse_tree_from_memory_ctrees(const char *start, const char *end, const struct ctrees_column_to_ptr *column_info,
+                                                struct base_ptr_info *base_ptr_info, size_t *nbytes_processed)
+{
+    struct ctrees_column_plan plan;
+    int status = compile_column_plan_ctrees(column_info, base_ptr_info, &plan);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    status = parse_tree_from_memory_plan_ctrees(start, end, &plan, base_ptr_info, nbytes_processed);
+    free_column_plan_ctrees(&plan);
+    return status;
+}
+
+
+/* Memory-maps the entire file (read-only). The kernel is advised that the
+   file will be accessed sequentially */
+static inline int open_mmap_file_ctrees(const char *filename, struct ctrees_mmap_file *mfile)
+{
+    mfile->fd = -1;
+    mfile->data = NULL;
+    mfile->size = 0;
+
+    int fd = open(filename, O_RDONLY);
+    if(fd < 0) {
+        fprintf(stderr,"Error: Could not open file `%s'\n", filename);
+        perror(NULL);
+        return EXIT_FAILURE;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        fprintf(stderr,"Error: Could not stat file `%s'\n", filename);
+        perror(NULL);
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    if(st.st_size == 0) {
+        fprintf(stderr,"Error: File `%s' is empty -- nothing to memory-map\n", filename);
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    void *data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(data == MAP_FAILED) {
+        fprintf(stderr,"Error: Could not memory-map file `%s' (size = %"PRId64" bytes)\n", filename, (int64_t) st.st_size);
+        perror(NULL);
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    /* the advice is only a hint -> failure is not an error */
+    madvise(data, (size_t) st.st_size, MADV_SEQUENTIAL);
+
+    mfile->fd = fd;
+    mfile->data = data;
+    mfile->size = (size_t) st.st_size;
+    return EXIT_SUCCESS;
+}
+
+static inline int close_mmap_file_ctrees(struct ctrees_mmap_file *mfile)
+{
+    int status = EXIT_SUCCESS;
+    if(mfile->data != NULL && munmap((void *) mfile->data, mfile->size) != 0) {
+        perror(NULL);
+        status = EXIT_FAILURE;
+    }
+    if(mfile->fd >= 0) {
+        close(mfile->fd);
+    }
+    mfile->fd = -1;
+    mfile->data = NULL;
+    mfile->size = 0;
+    return status;
+}
+
+
+/* Calls ``visit`` on every halo line of the tree starting at ``offset`` within the memory-mapped file.
+   The tree is visited in windows, and the kernel is asked to pre-fault each window before it is visited. If the
+   size of the tree is known (``nbytes`` > 0, e.g., from `struct ctrees_tree_index`), then only the tree itself is
+   pre-faulted (in windows of at most PARSE_CTREES_MMAP_WILLNEED_BYTES). Otherwise, the windows start at
+   PARSE_CTREES_MMAP_WILLNEED_MIN_BYTES and double up to PARSE_CTREES_MMAP_WILLNEED_BYTES, i.e., a small tree
+   only pre-faults a few pages */
+static inline int visit_tree_range_mmap_ctrees(const struct ctrees_mmap_file *mfile, off_t offset, const int64_t nbytes,
+                                               ctrees_line_visitor_fn visit, void *data)
+{
+    PARSE_CTREES_XASSERT(mfile->data != NULL,
+                         EXIT_FAILURE,
+                         "Error: The file has not been memory-mapped. Please call `open_mmap_file_ctrees` first\n");
+    PARSE_CTREES_XASSERT(offset >= 0 && (size_t) offset <= mfile->size,
+                         EXIT_FAILURE,
+                         "Error: offset = %"PRId64" must be within the file (size = %zu bytes)\n",
+                         (int64_t) offset, mfile->size);
+
+    const size_t pagesize = (size_t) sysconf(_SC_PAGESIZE);
+    const char *file_end = mfile->data + mfile->size;
+    const char *this = mfile->data + offset;
+    size_t window_nbytes = (size_t) PARSE_CTREES_MMAP_WILLNEED_MIN_BYTES;
+    if(nbytes > 0) {
+        window_nbytes = (size_t) nbytes;
+        if(window_nbytes > (size_t) (file_end - this)) window_nbytes = (size_t) (file_end - this);
+    }
+    if(window_nbytes > (size_t) PARSE_CTREES_MMAP_WILLNEED_BYTES) window_nbytes = (size_t) PARSE_CTREES_MMAP_WILLNEED_BYTES;
+
+    if(is_tree_marker_ctrees(this, file_end)) {
+        /* the offset points to the `#tree <tree_id>` line (e.g., from `locations.dat`) -> skip that line */
+        const char *newline = find_newline_ctrees(this, file_end);
+        this = (newline == NULL) ? file_end : newline + 1;
+    }
+    while(this < file_end) {
+        /* the window always ends on a line boundary (or at the end of the file) */
+        const char *window_end = file_end;
+        if((size_t) (file_end - this) > window_nbytes) {
+            /* searching from the last byte of the window -> a window that ends with a new-line is not extended */
+            const char *newline = find_newline_ctrees(this + window_nbytes - 1, file_end);
+            window_end = (newline == NULL) ? file_end : newline + 1;
+        }
+
+        /* madvise requires a page-aligned starting address */
+        const size_t page_offset = (size_t) (this - mfile->data) % pagesize;
+        madvise((void *) (this - page_offset), (size_t) (window_end - this) + page_offset, MADV_WILLNEED);
+
+        size_t nbytes_processed = 0;
+        int status = visit_tree_lines_in_memory_ctrees(this, window_end, visit, data, &nbytes_processed);
+        if(status != EXIT_SUCCESS) {
+            return status;
+        }
+        if(this + nbytes_processed < window_end) {
+            /* encountered the next tree */
+            break;
+        }
+        this = window_end;
+        if(window_nbytes < (size_t) PARSE_CTREES_MMAP_WILLNEED_BYTES) {
+            window_nbytes = (2*window_nbytes < (size_t) PARSE_CTREES_MMAP_WILLNEED_BYTES) ? 2*window_nbytes : (size_t) PARSE_CTREES_MMAP_WILLNEED_BYTES;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* Same as `visit_tree_range_mmap_ctrees` for a tree of unknown size */
+static inline int visit_tree_lines_mmap_ctrees(const struct ctrees_mmap_file *mfile, off_t offset, ctrees_line_visitor_fn visit, void *data)
+{
+    return visit_tree_range_mmap_ctrees(mfile, offset, -1, visit, data);
+}
+
+
+/* Same as `read_single_tree_mmap_ctrees` but the base pointers are (re-)allocated with ``alloc_context`` */
+static inline int read_single_tree_mmap_alloc_ctrees(const struct ctrees_mmap_file *mfile, off_t offset, const struct ctrees_column_to_ptr *column_info,
+                                                     struct base_ptr_info *base_ptr_info, struct ctrees_alloc_context *alloc_context)
+{
+    struct ctrees_column_plan plan;
+    int status = compile_column_plan_ctrees(column_info, base_ptr_info, &plan);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    plan.alloc_context = alloc_context;
+
+    struct ctrees_plan_visitor_data visitor_data = {.plan = &plan, .base_ptr_info = base_ptr_info};
+    status = visit_tree_lines_mmap_ctrees(mfile, offset, parse_line_plan_visitor_ctrees, &visitor_data);
+    free_column_plan_ctrees(&plan);
+    return status;
+}
+
+/* Same as `read_single_tree_ctrees` but parses the tree directly from the memory-mapped file
+   (no copies are made of the file contents, see `visit_tree_lines_mmap_ctrees`) */
+static inline int read_single_tree_mmap_ctrees(const struct ctrees_mmap_file *mfile, off_t offset, const struct ctrees_column_to_ptr *column_info,
+                                               struct base_ptr_info *base_ptr_info)
+{
+    return read_single_tree_mmap_alloc_ctrees(mfile, offset, column_info, base_ptr_info, NULL);
+}
+
+
+static inline void free_tree_ranges_ctrees(struct ctrees_tree_ranges *ranges)
+{
+    free(ranges->tree_id);
+    free(ranges->offset);
+    free(ranges->row_start);
+    free(ranges->nhalos);
+    memset(ranges, 0, sizeof(*ranges));
+}
+
+/* Makes space for (at least) ``ntrees`` trees in ``ranges`` */
+static inline int reserve_tree_ranges_ctrees(struct ctrees_tree_ranges *ranges, const int64_t ntrees)
+{
+    if(ntrees <= ranges->nallocated) {
+        return EXIT_SUCCESS;
+    }
+    int64_t **arrays[] = {&(ranges->tree_id), &(ranges->offset), &(ranges->row_start), &(ranges->nhalos)};
+    for(size_t i=0;i<sizeof(arrays)/sizeof(arrays[0]);i++) {
+        int64_t *tmp = realloc(*arrays[i], ntrees * sizeof(int64_t));
+        if(tmp == NULL) {
+            fprintf(stderr,"Error: Could not allocate memory for the row ranges of %"PRId64" trees\n", ntrees);
+            perror(NULL);
+            return EXIT_FAILURE;
+        }
+        *arrays[i] = tmp;
+    }
+    ranges->nallocated = ntrees;
+    return EXIT_SUCCESS;
+}
+
+
+/* Progress of the single-pass scan of an entire file (see `scan_line_ctrees`) */
+struct ctrees_scan_data {
+    const struct ctrees_column_plan *plan;
+    struct base_ptr_info *base_ptr_info;
+    struct ctrees_tree_ranges *ranges;
+    int64_t first_tree;/* the trees before this one in ``ranges`` were added by a previous scan */
+    int in_header;/* before the line with the number of trees, i.e., within the leading comment block */
+};
+
+/* Handles one line (at byte ``offset`` within the file) of the single-pass scan. The leading comment
+   block and the number of trees are only looked at, a `#tree <tree_id>` line starts the row range
+   of a new tree and every other (non-comment) line is parsed as a halo of the current tree */
+static inline int scan_line_ctrees(const char *line, const size_t linelen, const int64_t offset, struct ctrees_scan_data *scan)
+{
+    struct ctrees_tree_ranges *ranges = scan->ranges;
+    if(line[0] == '#') {
+        if(is_tree_marker_ctrees(line, line + linelen) == 0) {
+            return EXIT_SUCCESS;/* any other comment line */
+        }
+        scan->in_header = 0;
+        if(ranges->ntrees == ranges->nallocated) {
+            int status = reserve_tree_ranges_ctrees(ranges, ranges->nallocated < 1024 ? 1024 : 2*ranges->nallocated);
+            if(status != EXIT_SUCCESS) {
+                return status;
+            }
+        }
+        const char *token = line + 5;/* strlen("#tree") == 5 */
+        const char *end = line + linelen;
+        while(token < end && is_column_delimiter_ctrees(*token)) token++;
+        size_t toklen = 0;
+        while(token + toklen < end && is_column_delimiter_ctrees(token[toklen]) == 0) toklen++;
+
+        const int64_t itree = ranges->ntrees;
+        if(convert_token_fast_ctrees(token, toklen, I64, &(ranges->tree_id[itree])) != EXIT_SUCCESS) {
+            fprintf(stderr,"Error: Could not parse the tree id in the line `%.*s' (at offset = %"PRId64")\n",
+                    (int) linelen, line, offset);
+            return EXIT_FAILURE;
+        }
+        ranges->offset[itree] = offset;
+        ranges->row_start[itree] = scan->base_ptr_info->N;
+        ranges->nhalos[itree] = 0;
+        ranges->ntrees++;
+        return EXIT_SUCCESS;
+    }
+
+    if(scan->in_header) {
+        /* the number of trees in the file -> make space for all of them at once */
+        int64_t ntrees = 0;
+        scan->in_header = 0;
+        if(convert_token_fast_ctrees(line, linelen, I64, &ntrees) == EXIT_SUCCESS && ntrees > 0) {
+            return reserve_tree_ranges_ctrees(ranges, ranges->ntrees + ntrees);
+        }
+        return EXIT_SUCCESS;
+    }
+
+    PARSE_CTREES_XASSERT(ranges->ntrees > scan->first_tree,
+                         EXIT_FAILURE,
+                         "Error: Found a halo (at offset = %"PRId64") before the first `#tree' line\n",
+                         offset);
+    return parse_line_plan_ctrees(line, linelen, scan->plan, scan->base_ptr_info);
+}
+
+/* Sets the number of halos in every tree added by the scan */
+static inline void finalize_tree_ranges_ctrees(struct ctrees_scan_data *scan)
+{
+    struct ctrees_tree_ranges *ranges = scan->ranges;
+    for(int64_t i=scan->first_tree;i<ranges->ntrees;i++) {
+        const int64_t row_end = (i + 1 < ranges->ntrees) ? ranges->row_start[i + 1] : scan->base_ptr_info->N;
+        ranges->nhalos[i] = row_end - ranges->row_start[i];
+    }
+}
+
+
+/* Reads *every* tree in the input ``source`` with a single front-to-back pass through the (large) re-usable
+   buffer contained within ``reader``. The halos of all the trees are appended (one tree after the other) to the
+   base pointers, and the row range of each tree is appended to ``ranges`` (which must be zero-initialised before
+   the first call). The plan of the columns is compiled once, and the base pointers and the ``ranges`` only grow
+   geometrically, i.e., there is no per-tree setup.
+
+   The ``source`` must start at the beginning of the file (i.e., with the header) */
+static inline int scan_all_trees_source_ctrees(const struct ctrees_input_source *source, struct ctrees_buffered_reader *reader,
+                                               const struct ctrees_column_to_ptr *column_info, struct base_ptr_info *base_ptr_info,
+                                               struct ctrees_tree_ranges *ranges)
+{
+    PARSE_CTREES_XASSERT(reader->buffer != NULL && reader->bufsize > 1,
+                         EXIT_FAILURE,
+                         "Error: The read buffer has not been allocated. Please call `init_buffered_reader_ctrees` first\n");
+    invalidate_buffered_reader_ctrees(reader);
+    struct ctrees_column_plan plan;
+    int status = compile_column_plan_ctrees(column_info, base_ptr_info, &plan);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    plan.perf = reader->perf;
+
+    struct ctrees_scan_data scan = {.plan = &plan, .base_ptr_info = base_ptr_info, .ranges = ranges,
+                                    .first_tree = ranges->ntrees, .in_header = 1};
+    int64_t buffer_offset = 0;/* offset of reader->buffer[0] within the source */
+    size_t nleft = 0;/* bytes of the incomplete last line, carried over to the front of the buffer */
+    int at_eof = 0;
+    while(at_eof == 0 && status == EXIT_SUCCESS) {
+#ifdef PARSE_CTREES_USE_PERF_COUNTERS
+        const double t0 = (reader->perf != NULL) ? get_seconds_ctrees() : 0.0;
+#endif
+        const ssize_t nread = source->pread(source->handle, reader->buffer + nleft, reader->bufsize - nleft, buffer_offset + nleft);
+#ifdef PARSE_CTREES_USE_PERF_COUNTERS
+        if(reader->perf != NULL) {
+            reader->perf->io_seconds += get_seconds_ctrees() - t0;
+            reader->perf->nreads++;
+            if(nread > 0) reader->perf->nbytes_read += nread;
+        }
+#endif
+        if(nread < 0) {
+            fprintf(stderr,"Error: Could not read from the input at offset = %"PRId64"\n", buffer_offset + (int64_t) nleft);
+            perror(NULL);
+            status = EXIT_FAILURE;
+            break;
+        }
+        at_eof = (nread == 0);
+        const char *start = reader->buffer;
+        const char *end = reader->buffer + nleft + nread;
+        const char *this = start;
+        while(this < end) {
+            const char *newline = find_newline_ctrees(this, end);
+            if(newline == NULL) {
+                if(at_eof == 0) break;
+                newline = end;/* the last line in the file does not have a new-line */
+            }
+            if(newline > this) {
+                status = scan_line_ctrees(this, newline - this, buffer_offset + (this - start), &scan);
+                if(status != EXIT_SUCCESS) break;
+            }
+            this = newline + 1;
+        }
+        if(at_eof || status != EXIT_SUCCESS) break;
+
+        nleft = end - this;
+        memmove(reader->buffer, this, nleft);
+        buffer_offset += this - start;
+        if(nleft == reader->bufsize) {
+            status = grow_buffered_reader_ctrees(reader);
+        }
+    }
+    free_column_plan_ctrees(&plan);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+
+    finalize_tree_ranges_ctrees(&scan);
+    return EXIT_SUCCESS;
+}
+
+/* Same as `scan_all_trees_source_ctrees` but parses the entire memory-mapped file in-place */
+static inline int scan_all_trees_mmap_ctrees(const struct ctrees_mmap_file *mfile, const struct ctrees_column_to_ptr *column_info,
+                                             struct base_ptr_info *base_ptr_info, struct ctrees_tree_ranges *ranges)
+{
+    PARSE_CTREES_XASSERT(mfile->data != NULL,
+                         EXIT_FAILURE,
+                         "Error: The file has not been memory-mapped. Please call `open_mmap_file_ctrees` first\n");
+    struct ctrees_column_plan plan;
+    int status = compile_column_plan_ctrees(column_info, base_ptr_info, &plan);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+
+    struct ctrees_scan_data scan = {.plan = &plan, .base_ptr_info = base_ptr_info, .ranges = ranges,
+                                    .first_tree = ranges->ntrees, .in_header = 1};
+    const char *file_end = mfile->data + mfile->size;
+    const char *this = mfile->data;
+    while(this < file_end) {
+        const char *newline = find_newline_ctrees(this, file_end);
+        if(newline == NULL) {
+            newline = file_end;/* the last line in the file does not have a new-line */
+        }
+        if(newline > this) {
+            status = scan_line_ctrees(this, newline - this, this - mfile->data, &scan);
+            if(status != EXIT_SUCCESS) {
+                free_column_plan_ctrees(&plan);
+                return status;
+            }
+        }
+        this = newline + 1;
+    }
+    free_column_plan_ctrees(&plan);
+
+    finalize_tree_ranges_ctrees(&scan);
+    return EXIT_SUCCESS;
+}
+
+/* Reads every tree in ``filename`` (uncompressed, or compressed, see `open_compressed_file_ctrees`) with a single
+   pass (see `scan_all_trees_source_ctrees`), through a buffer of ``bufsize`` bytes (0 for the default). This is
+   meant for converting entire files, where reading the trees one at a time would restart the I/O at every tree */
+static inline int read_all_trees_ctrees(const char *filename, const struct ctrees_column_to_ptr *column_info,
+                                        struct base_ptr_info *base_ptr_info, struct ctrees_tree_ranges *ranges, const size_t bufsize)
+{
+    enum parse_ctrees_compression_formats format;
+    int status = get_compression_format_ctrees(filename, &format);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+
+    int fd = -1;
+    struct ctrees_compressed_file cfile;
+    struct ctrees_input_source source;
+    if(format == PARSE_CTREES_UNCOMPRESSED) {
+        fd = open(filename, O_RDONLY);
+        if(fd < 0) {
+            fprintf(stderr,"Error: Could not open file `%s'\n", filename);
+            perror(NULL);
+            return EXIT_FAILURE;
+        }
+        source = get_fd_source_ctrees(&fd);
+    } else {
+        status = open_compressed_file_ctrees(filename, &cfile);
+        if(status != EXIT_SUCCESS) {
+            return status;
+        }
+        source = get_compressed_source_ctrees(&cfile);
+    }
+
+    struct ctrees_buffered_reader reader;
+    status = init_buffered_reader_ctrees(&reader, bufsize);
+    if(status == EXIT_SUCCESS) {
+        status = scan_all_trees_source_ctrees(&source, &reader, column_info, base_ptr_info, ranges);
+        free_buffered_reader_ctrees(&reader);
+    }
+
+    if(format == PARSE_CTREES_UNCOMPRESSED) {
+        close(fd);
+    } else {
+        close_compressed_file_ctrees(&cfile);
+    }
+    return status;
+}
+
+/* magic bytes and version at the beginning of the binary tree-index written by `write_tree_index_ctrees` */
+#define PARSE_CTREES_TREE_INDEX_MAGIC    "CTREEIDX"
+#define PARSE_CTREES_TREE_INDEX_VERSION  1
+
+static inline void free_tree_index_ctrees(struct ctrees_tree_index *index)
+{
+    free(index->trees);
+    free(index->filenames);
+    index->trees = NULL;
+    index->filenames = NULL;
+    index->ntrees = 0;
+    index->nallocated = 0;
+    index->nfiles = 0;
+}
+
+
+/* Appends one tree to the index (the memory for the trees is grown as necessary) */
+static inline int add_tree_to_index_ctrees(struct ctrees_tree_index *index, const struct ctrees_tree_index_entry *tree)
+{
+    if(index->ntrees == index->nallocated) {
+        const int64_t new_N = (index->nallocated < 1024) ? 1024 : 2*index->nallocated;
+        struct ctrees_tree_index_entry *tmp = realloc(index->trees, new_N * sizeof(*tmp));
+        if(tmp == NULL) {
+            fprintf(stderr,"Error: Could not allocate memory for %"PRId64" trees in the tree index\n", new_N);
+            perror(NULL);
+            return EXIT_FAILURE;
+        }
+        index->trees = tmp;
+        index->nallocated = new_N;
+    }
+    index->trees[index->ntrees] = *tree;
+    index->ntrees++;
+    return EXIT_SUCCESS;
+}
+
+
+/* Stores the filename for ``file_id`` (the memory for the filenames is grown as necessary) */
+static inline int set_filename_in_index_ctrees(struct ctrees_tree_index *index, const int32_t file_id, const char *filename)
+{
+    PARSE_CTREES_XASSERT(file_id >= 0,
+                         EXIT_FAILURE,
+                         "Error: file id = %d must be non-negative\n", file_id);
+    if(strlen(filename) >= PARSE_CTREES_MAX_FILENAME_LEN) {
+        fprintf(stderr,"Error: filename `%s' is too long. Please define the macro variable `PARSE_CTREES_MAX_FILENAME_LEN' "
+                "to be larger than %zu (before including the file `%s')\n", filename, strlen(filename), __FILE__);
+        return EXIT_FAILURE;
+    }
+    if(file_id >= index->nfiles) {
+        char (*tmp)[PARSE_CTREES_MAX_FILENAME_LEN] = realloc(index->filenames, (file_id + 1) * sizeof(*tmp));
+        if(tmp == NULL) {
+            fprintf(stderr,"Error: Could not allocate memory for %d filenames in the tree index\n", file_id + 1);
+            perror(NULL);
+            return EXIT_FAILURE;
+        }
+        for(int32_t i=index->nfiles;i<=file_id;i++) {
+            tmp[i][0] = '\0';
+        }
+        index->filenames = tmp;
+        index->nfiles = file_id + 1;
+    }
+    strcpy(index->filenames[file_id], filename);
+    return EXIT_SUCCESS;
+}
+
+
+/* Sorts the trees by (file_id, offset) and fills in the number of bytes in each tree (if not known)
+   from the offset of the next tree in the same file. For the last tree in each file, the size
+   of the file is used (if that file can be found) */
+static inline void finalize_tree_index_ctrees(struct ctrees_tree_index *index)
+{
+#define PARSE_CTREES_TREE_LOCATION_COMPARATOR(x, y) (((x).file_id != (y).file_id) ? (((x).file_id < (y).file_id) ? -1:1) : \
+                                                     (((x).offset < (y).offset) ? -1 : ((x).offset > (y).offset)))
+    PARSE_CTREES_ARRAY_SINGLE_SORT(struct ctrees_tree_index_entry, index->trees, index->ntrees, PARSE_CTREES_TREE_LOCATION_COMPARATOR);
+#undef PARSE_CTREES_TREE_LOCATION_COMPARATOR
+
+    for(int64_t i=0;i<index->ntrees;i++) {
+        struct ctrees_tree_index_entry *tree = &(index->trees[i]);
+        if(tree->nbytes >= 0) continue;
+        if(i + 1 < index->ntrees && index->trees[i+1].file_id == tree->file_id) {
+            tree->nbytes = index->trees[i+1].offset - tree->offset;
+        } else if(tree->file_id < index->nfiles) {
+            struct stat st;
+            if(stat(index->filenames[tree->file_id], &st) == 0 && st.st_size >= tree->offset) {
+                tree->nbytes = st.st_size - tree->offset;
+            }
+        }
+    }
+}
+
+
+/* Reads the Consistent-Trees `locations.dat` file (columns: TreeRootID FileID Offset Filename) and
+   appends all the trees to ``index``. The filenames are stored relative to the directory containing
+   ``locations_file``. The forest ids are set to -1 (see `load_forests_ctrees`) */
+static inline int load_locations_ctrees(const char *locations_file, struct ctrees_tree_index *index)
+{
+    FILE *fp = fopen(locations_file, "rt");
+    if(fp == NULL) {
+        fprintf(stderr,"Error: Could not open file `%s'\n", locations_file);
+        perror(NULL);
+        return EXIT_FAILURE;
+    }
+
+    char dirbuf[PARSE_CTREES_MAX_FILENAME_LEN];
+    snprintf(dirbuf, sizeof(dirbuf), "%s", locations_file);
+    const char *dir = dirname(dirbuf);
+
+    char linebuf[PARSE_CTREES_MAXBUFSIZE];
+    char filename[PARSE_CTREES_MAX_FILENAME_LEN];
+    char fullpath[2*PARSE_CTREES_MAX_FILENAME_LEN];
+    int64_t lineno = 0;
+    while(fgets(linebuf, PARSE_CTREES_MAXBUFSIZE, fp) != NULL) {
+        lineno++;
+        if(linebuf[0] == '#' || linebuf[0] == '\n') continue;
+
+        struct ctrees_tree_index_entry tree = {.tree_id = -1, .forest_id = -1, .offset = -1, .nbytes = -1, .nhalos = -1, .file_id = -1};
+        int name_start = -1;
+        int nread = sscanf(linebuf, "%"SCNd64" %"SCNd32" %"SCNd64" %n", &tree.tree_id, &tree.file_id, &tree.offset, &name_start);
+        const size_t namelen = (nread == 3 && name_start > 0) ? strcspn(linebuf + name_start, " \t\r\n") : 0;
+        if(namelen == 0 || tree.file_id < 0 || tree.offset < 0) {
+            fprintf(stderr,"Error: Could not parse line # %"PRId64" = `%s' in the file `%s'\n"
+                    "Expected 4 columns: TreeRootID FileID Offset Filename\n", lineno, linebuf, locations_file);
+            fclose(fp);
+            return EXIT_FAILURE;
+        }
+        /* the filename is copied (rather than scanned with a fixed width) -> any PARSE_CTREES_MAX_FILENAME_LEN is safe */
+        if(namelen >= sizeof(filename)) {
+            fprintf(stderr,"Error: The filename on line # %"PRId64" in the file `%s' is too long (%zu characters). Please define the "
+                    "macro variable `PARSE_CTREES_MAX_FILENAME_LEN' to be larger than %zu\n", lineno, locations_file, namelen, sizeof(filename));
+            fclose(fp);
+            return EXIT_FAILURE;
+        }
+        memcpy(filename, linebuf + name_start, namelen);
+        filename[namelen] = '\0';
+        if(tree.file_id >= index->nfiles || index->filenames[tree.file_id][0] == '\0') {
+            snprintf(fullpath, sizeof(fullpath), "%s/%s", dir, filename);
+            if(set_filename_in_index_ctrees(index, tree.file_id, fullpath) != EXIT_SUCCESS) {
+                fclose(fp);
+                return EXIT_FAILURE;
+            }
+        }
+        if(add_tree_to_index_ctrees(index, &tree) != EXIT_SUCCESS) {
+            fclose(fp);
+            return EXIT_FAILURE;
+        }
+    }
+    fclose(fp);
+
+    finalize_tree_index_ctrees(index);
+    return EXIT_SUCCESS;
+}
+
+
+/* Reads the Consistent-Trees `forests.list` file (columns: TreeRootID ForestID) and assigns
+   the forest id to every tree in ``index``. Trees not listed in ``forests_file`` retain a forest id of -1 */
+static inline int load_forests_ctrees(const char *forests_file, struct ctrees_tree_index *index)
+{
+    FILE *fp = fopen(forests_file, "rt");
+    if(fp == NULL) {
+        fprintf(stderr,"Error: Could not open file `%s'\n", forests_file);
+        perror(NULL);
+        return EXIT_FAILURE;
+    }
+
+    int64_t nforests = 0, nallocated = 0;
+    int64_t (*pairs)[2] = NULL;/* (tree_id, forest_id) */
+    char linebuf[PARSE_CTREES_MAXBUFSIZE];
+    while(fgets(linebuf, PARSE_CTREES_MAXBUFSIZE, fp) != NULL) {
+        if(linebuf[0] == '#' || linebuf[0] == '\n') continue;
+        if(nforests == nallocated) {
+            nallocated = (nallocated < 1024) ? 1024 : 2*nallocated;
+            int64_t (*tmp)[2] = realloc(pairs, nallocated * sizeof(*tmp));
+            if(tmp == NULL) {
+                fprintf(stderr,"Error: Could not allocate memory for %"PRId64" (tree, forest) pairs\n", nallocated);
+                perror(NULL);
+                free(pairs);
+                fclose(fp);
+                return EXIT_FAILURE;
+            }
+            pairs = tmp;
+        }
+        if(sscanf(linebuf, "%"SCNd64" %"SCNd64, &pairs[nforests][0], &pairs[nforests][1]) != 2) {
+            fprintf(stderr,"Error: Could not parse line = `%s' in the file `%s'\n"
+                    "Expected 2 columns: TreeRootID ForestID\n", linebuf, forests_file);
+            free(pairs);
+            fclose(fp);
+            return EXIT_FAILURE;
+        }
+        nforests++;
+    }
+    fclose(fp);
+
+#define PARSE_CTREES_PAIR_COMPARATOR(x, y) (((x)[0] < (y)[0]) ? -1 : ((x)[0] > (y)[0]))
+    /* sort by tree id (the 2-element rows can not be directly assigned -> exchange both elements) */
+#define PARSE_CTREES_PAIR_EXCHANGER(type, a, i, j) {                    \
+        int64_t _tmp0_ = (a)[i][0], _tmp1_ = (a)[i][1];                 \
+        (a)[i][0] = (a)[j][0]; (a)[i][1] = (a)[j][1];                   \
+        (a)[j][0] = _tmp0_; (a)[j][1] = _tmp1_;                         \
+    }
+    PARSE_CTREES_ARRAY_SORT(int64_t *, pairs, nforests, PARSE_CTREES_PAIR_COMPARATOR, PARSE_CTREES_PAIR_EXCHANGER);
+#undef PARSE_CTREES_PAIR_EXCHANGER
+#undef PARSE_CTREES_PAIR_COMPARATOR
+
+    for(int64_t i=0;i<index->ntrees;i++) {
+        const int64_t tree_id = index->trees[i].tree_id;
+        int64_t lo = 0, hi = nforests - 1;
+        while(lo <= hi) {
+            const int64_t mid = lo + (hi - lo)/2;
+            if(pairs[mid][0] == tree_id) {
+                index->trees[i].forest_id = pairs[mid][1];
+                break;
+            }
+            if(pairs[mid][0] < tree_id) lo = mid + 1;
+            else hi = mid - 1;
+        }
+    }
+    free(pairs);
+
+    return EXIT_SUCCESS;
+}
+
+
+/* Builds the index of all trees in one `tree_?_?_?.dat` file with a single scan of the file (via mmap),
+   recording the offset, number of bytes and the number of halos of every tree. The trees are
+   appended to ``index`` with the next available file id */
+static inline int build_tree_index_ctrees(const char *filename, struct ctrees_tree_index *index)
+{
+    struct ctrees_mmap_file mfile;
+    int status = open_mmap_file_ctrees(filename, &mfile);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    const int32_t file_id = index->nfiles;
+    status = set_filename_in_index_ctrees(index, file_id, filename);
+    if(status != EXIT_SUCCESS) {
+        close_mmap_file_ctrees(&mfile);
+        return status;
+    }
+
+    const char *start = mfile.data;
+    const char *end = mfile.data + mfile.size;
+    const char *this = start;
+    struct ctrees_tree_index_entry tree = {.tree_id = -1, .forest_id = -1, .offset = -1, .nbytes = -1, .nhalos = -1, .file_id = file_id};
+    while(this < end) {
+        const char *newline = find_newline_ctrees(this, end);
+        if(newline == NULL) newline = end;
+        if(*this == '#') {
+            if(is_tree_marker_ctrees(this, newline)) {
+                if(tree.offset >= 0) {
+                    tree.nbytes = (this - start) - tree.offset;
+                    status = add_tree_to_index_ctrees(index, &tree);
+                    if(status != EXIT_SUCCESS) break;
+                }
+                tree.tree_id = strtoll(this + 5, NULL, 10);/* strlen("#tree") == 5 */
+                tree.offset = this - start;
+                tree.nhalos = 0;
+            }
+        } else if(tree.offset >= 0 && newline > this) {
+            /* before the first tree, the (only) non-comment line is the number of trees */
+            tree.nhalos++;
+        }
+        this = newline + 1;
+    }
+    if(status == EXIT_SUCCESS && tree.offset >= 0) {
+        tree.nbytes = (int64_t) mfile.size - tree.offset;
+        status = add_tree_to_index_ctrees(index, &tree);
+    }
+    close_mmap_file_ctrees(&mfile);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+
+    finalize_tree_index_ctrees(index);
+    return EXIT_SUCCESS;
+}
+
+
+/* Same as `build_tree_index_ctrees` but scans any input ``source`` (e.g., a compressed file, see `get_compressed_source_ctrees`)
+   through the read buffer of ``reader``. The offsets are within the (uncompressed) contents of the source, and ``filename``
+   is only stored in the index */
+static inline int build_tree_index_source_ctrees(const char *filename, const struct ctrees_input_source *source,
+                                                 struct ctrees_buffered_reader *reader, struct ctrees_tree_index *index)
+{
+    PARSE_CTREES_XASSERT(reader->buffer != NULL && reader->bufsize > 1,
+                         EXIT_FAILURE,
+                         "Error: The read buffer has not been allocated. Please call `init_buffered_reader_ctrees` first\n");
+    invalidate_buffered_reader_ctrees(reader);
+    const int32_t file_id = index->nfiles;
+    int status = set_filename_in_index_ctrees(index, file_id, filename);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+
+    struct ctrees_tree_index_entry tree = {.tree_id = -1, .forest_id = -1, .offset = -1, .nbytes = -1, .nhalos = -1, .file_id = file_id};
+    int64_t buffer_offset = 0;/* offset of reader->buffer[0] within the source */
+    size_t nleft = 0;/* bytes of the incomplete last line, carried over to the front of the buffer */
+    int at_eof = 0;
+    while(at_eof == 0 && status == EXIT_SUCCESS) {
+        const ssize_t nread = source->pread(source->handle, reader->buffer + nleft, reader->bufsize - nleft, buffer_offset + nleft);
+        if(nread < 0) {
+            fprintf(stderr,"Error: Could not read from `%s' at offset = %"PRId64"\n", filename, buffer_offset + (int64_t) nleft);
+            perror(NULL);
+            return EXIT_FAILURE;
+        }
+        at_eof = (nread == 0);
+        const char *start = reader->buffer;
+        const char *end = reader->buffer + nleft + nread;
+        const char *this = start;
+        while(this < end) {
+            const char *newline = find_newline_ctrees(this, end);
+            if(newline == NULL) {
+                if(at_eof == 0) break;
+                newline = end;
+            }
+            if(*this == '#') {
+                if(is_tree_marker_ctrees(this, newline)) {
+                    const int64_t offset = buffer_offset + (this - start);
+                    if(tree.offset >= 0) {
+                        tree.nbytes = offset - tree.offset;
+                        status = add_tree_to_index_ctrees(index, &tree);
+                        if(status != EXIT_SUCCESS) break;
+                    }
+                    tree.tree_id = strtoll(this + 5, NULL, 10);/* strlen("#tree") == 5 */
+                    tree.offset = offset;
+                    tree.nhalos = 0;
+                }
+            } else if(tree.offset >= 0 && newline > this) {
+                tree.nhalos++;
+            }
+            this = newline + 1;
+        }
+        if(at_eof) {
+            /* the size of the (uncompressed) contents -> the number of bytes in the last tree */
+            if(status == EXIT_SUCCESS && tree.offset >= 0) {
+                tree.nbytes = buffer_offset + (end - start) - tree.offset;
+                status = add_tree_to_index_ctrees(index, &tree);
+            }
+            break;
+        }
+        nleft = end - this;
+        memmove(reader->buffer, this, nleft);
+        buffer_offset += this - start;
+        if(nleft == reader->bufsize && grow_buffered_reader_ctrees(reader) != EXIT_SUCCESS) {
+            return EXIT_FAILURE;
+        }
+    }
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+
+    finalize_tree_index_ctrees(index);
+    return EXIT_SUCCESS;
+}
+
+
+/* Writes ``index`` into the binary file ``index_file``, together with the size and the modification time of
+   ``source_file`` (i.e., the `tree_?_?_?.dat` or `locations.dat` file that the index was generated from).
+   The data are written in the native byte order */
+static inline int write_tree_index_ctrees(const char *index_file, const char *source_file, const struct ctrees_tree_index *index)
+{
+    struct stat st;
+    if(stat(source_file, &st) != 0) {
+        fprintf(stderr,"Error: Could not stat file `%s'\n", source_file);
+        perror(NULL);
+        return EXIT_FAILURE;
+    }
+    FILE *fp = fopen(index_file, "wb");
+    if(fp == NULL) {
+        fprintf(stderr,"Error: Could not open file `%s' for writing\n", index_file);
+        perror(NULL);
+        return EXIT_FAILURE;
+    }
+
+    const uint32_t version = PARSE_CTREES_TREE_INDEX_VERSION;
+    const int64_t source_size = st.st_size, mtime_sec = st.st_mtim.tv_sec, mtime_nsec = st.st_mtim.tv_nsec;
+    int nfailed = 0;
+    nfailed += fwrite(PARSE_CTREES_TREE_INDEX_MAGIC, 8, 1, fp) != 1;
+    nfailed += fwrite(&version, sizeof(version), 1, fp) != 1;
+    nfailed += fwrite(&source_size, sizeof(source_size), 1, fp) != 1;
+    nfailed += fwrite(&mtime_sec, sizeof(mtime_sec), 1, fp) != 1;
+    nfailed += fwrite(&mtime_nsec, sizeof(mtime_nsec), 1, fp) != 1;
+    nfailed += fwrite(&(index->nfiles), sizeof(index->nfiles), 1, fp) != 1;
+    nfailed += fwrite(&(index->ntrees), sizeof(index->ntrees), 1, fp) != 1;
+    for(int32_t i=0;i<index->nfiles;i++) {
+        const uint32_t len = (uint32_t) strlen(index->filenames[i]);
+        nfailed += fwrite(&len, sizeof(len), 1, fp) != 1;
+        nfailed += (len > 0 && fwrite(index->filenames[i], len, 1, fp) != 1);
+    }
+    for(int64_t i=0;i<index->ntrees;i++) {
+        const struct ctrees_tree_index_entry *tree = &(index->trees[i]);
+        const int64_t fields[] = {tree->tree_id, tree->forest_id, tree->offset, tree->nbytes, tree->nhalos, tree->file_id};
+        nfailed += fwrite(fields, sizeof(fields), 1, fp) != 1;
+    }
+    nfailed += fclose(fp) != 0;
+    if(nfailed > 0) {
+        fprintf(stderr,"Error: Could not write the tree index to file `%s'\n", index_file);
+        perror(NULL);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+
+/* Reads the binary tree index written by `write_tree_index_ctrees` into ``index`` (which should be empty).
+   Returns EXIT_FAILURE (without any error messages) if the ``index_file`` does not exist, or if it is
+   stale, i.e., the size or modification time of ``source_file`` has changed since the index was written */
+static inline int read_tree_index_ctrees(const char *index_file, const char *source_file, struct ctrees_tree_index *index)
+{
+    struct stat st;
+    if(stat(source_file, &st) != 0) {
+        fprintf(stderr,"Error: Could not stat file `%s'\n", source_file);
+        perror(NULL);
+        return EXIT_FAILURE;
+    }
+    FILE *fp = fopen(index_file, "rb");
+    if(fp == NULL) {
+        return EXIT_FAILURE;
+    }
+
+    char magic[8];
+    uint32_t version;
+    int64_t source_size, mtime_sec, mtime_nsec, ntrees;
+    int32_t nfiles;
+    int nfailed = 0;
+    nfailed += fread(magic, sizeof(magic), 1, fp) != 1;
+    nfailed += fread(&version, sizeof(version), 1, fp) != 1;
+    nfailed += fread(&source_size, sizeof(source_size), 1, fp) != 1;
+    nfailed += fread(&mtime_sec, sizeof(mtime_sec), 1, fp) != 1;
+    nfailed += fread(&mtime_nsec, sizeof(mtime_nsec), 1, fp) != 1;
+    nfailed += fread(&nfiles, sizeof(nfiles), 1, fp) != 1;
+    nfailed += fread(&ntrees, sizeof(ntrees), 1, fp) != 1;
+    if(nfailed > 0 || memcmp(magic, PARSE_CTREES_TREE_INDEX_MAGIC, sizeof(magic)) != 0 || version != PARSE_CTREES_TREE_INDEX_VERSION) {
+        PARSE_CTREES_LOG(PARSE_CTREES_LOG_WARNING, "Warning: File `%s' is not a valid tree index (or was written by a different version)\n", index_file);
+        fclose(fp);
+        return EXIT_FAILURE;
+    }
+    if(source_size != (int64_t) st.st_size || mtime_sec != (int64_t) st.st_mtim.tv_sec || mtime_nsec != (int64_t) st.st_mtim.tv_nsec) {
+        /* stale index */
+        fclose(fp);
+        return EXIT_FAILURE;
+    }
+
+    char filename[PARSE_CTREES_MAX_FILENAME_LEN];
+    for(int32_t i=0;i<nfiles && nfailed == 0;i++) {
+        uint32_t len;
+        nfailed += fread(&len, sizeof(len), 1, fp) != 1;
+        if(nfailed > 0 || len >= PARSE_CTREES_MAX_FILENAME_LEN) {
+            nfailed++;
+            break;
+        }
+        nfailed += (len > 0 && fread(filename, len, 1, fp) != 1);
+        filename[len] = '\0';
+        nfailed += set_filename_in_index_ctrees(index, i, filename) != EXIT_SUCCESS;
+    }
+    for(int64_t i=0;i<ntrees && nfailed == 0;i++) {
+        int64_t fields[6];
+        nfailed += fread(fields, sizeof(fields), 1, fp) != 1;
+        const struct ctrees_tree_index_entry tree = {.tree_id = fields[0], .forest_id = fields[1], .offset = fields[2],
+                                                     .nbytes = fields[3], .nhalos = fields[4], .file_id = (int32_t) fields[5]};
+        nfailed += (nfailed == 0 && add_tree_to_index_ctrees(index, &tree) != EXIT_SUCCESS);
+    }
+    fclose(fp);
+    if(nfailed > 0) {
+        fprintf(stderr,"Error: Could not read the tree index from file `%s'\n", index_file);
+        free_tree_index_ctrees(index);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+
+/* Populates ``index`` for the `tree_?_?_?.dat` file ``filename`` from the binary ``index_file``, if
+   that exists and is up-to-date. Otherwise, the index is built by scanning ``filename`` and then
+   written to ``index_file`` (if ``index_file`` is not NULL), so that subsequent calls are instant */
+static inline int load_or_build_tree_index_ctrees(const char *filename, const char *index_file, struct ctrees_tree_index *index)
+{
+    if(index_file != NULL && read_tree_index_ctrees(index_file, filename, index) == EXIT_SUCCESS) {
+        return EXIT_SUCCESS;
+    }
+    int status = build_tree_index_ctrees(filename, index);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    if(index_file != NULL) {
+        /* failing to write the cache is not fatal */
+        if(write_tree_index_ctrees(index_file, filename, index) != EXIT_SUCCESS) {
+            PARSE_CTREES_LOG(PARSE_CTREES_LOG_WARNING, "Warning: Could not cache the tree index for `%s' into `%s'\n", filename, index_file);
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+/* Returns the (exact) number of halos in the tree contained in the memory range [start, end), where
+   ``start`` is the beginning of the `#tree` line (or the first halo). Comment lines are assumed to only
+   occur at the start of the tree */
+static inline int64_t count_halos_in_memory_ctrees(const char *start, const char *end)
+{
+    if(start >= end) return 0;
+    int64_t nlines = count_newlines_ctrees(start, end);
+    if(*(end - 1) != '\n') nlines++;/* the last line does not have a new-line */
+    if(is_tree_marker_ctrees(start, end)) nlines--;
+    return nlines;
+}
+
+
+/* Reads the tree described by ``tree`` (i.e., from `struct ctrees_tree_index`) via the buffered ``reader``.
+   The base pointers are allocated only once:
+   - if the number of halos is known (e.g., from `build_tree_index_ctrees`), exactly that many extra elements
+     are reserved
+   - if only the number of bytes is known, and the entire tree fits within the read buffer, then the
+     tree is read with a single `pread` and the halos are counted before being parsed
+   - otherwise, the number of halos is estimated from the average number of bytes per halo in
+     the previous trees (read with this ``reader``)
+
+   Use `shrink_base_ptrs_to_fit_ctrees` afterwards to release any over-allocated memory */
+static inline int read_tree_from_index_ctrees(int fd, const struct ctrees_tree_index_entry *tree, const struct ctrees_column_to_ptr *column_info,
+                                              struct base_ptr_info *base_ptr_info, struct ctrees_buffered_reader *reader)
+{
+    const int64_t N_start = base_ptr_info->N;
+    int status;
+    if(tree->nhalos >= 0) {
+        status = reserve_base_ptrs_ctrees(base_ptr_info, N_start + tree->nhalos);
+        if(status != EXIT_SUCCESS) return status;
+    } else if(tree->nbytes > 0 && (size_t) tree->nbytes <= reader->bufsize) {
+        invalidate_buffered_reader_ctrees(reader);
+        ssize_t nbytes_read = pread(fd, reader->buffer, tree->nbytes, tree->offset);
+        if(nbytes_read != tree->nbytes) {
+            fprintf(stderr,"Error: trying to read %"PRId64" bytes (for tree id = %"PRId64") from file failed. Only read %zd bytes\n",
+                    tree->nbytes, tree->tree_id, nbytes_read);
+            perror(NULL);
+            return EXIT_FAILURE;
+        }
+        const char *start = reader->buffer, *end = reader->buffer + nbytes_read;
+        status = reserve_base_ptrs_ctrees(base_ptr_info, N_start + count_halos_in_memory_ctrees(start, end));
+        if(status != EXIT_SUCCESS) return status;
+
+        if(is_tree_marker_ctrees(start, end)) {
+            const char *newline = find_newline_ctrees(start, end);
+            start = (newline == NULL) ? end : newline + 1;
+        }
+        struct ctrees_column_plan plan;
+        status = compile_column_plan_ctrees(column_info, base_ptr_info, &plan);
+        if(status != EXIT_SUCCESS) return status;
+        status = parse_tree_from_memory_plan_ctrees(start, end, &plan, base_ptr_info, NULL);
+        free_column_plan_ctrees(&plan);
+        if(status != EXIT_SUCCESS) return status;
+
+        reader->nbytes_parsed += tree->nbytes;
+        reader->nrows_parsed += base_ptr_info->N - N_start;
+        return EXIT_SUCCESS;
+    } else if(tree->nbytes > 0 && reader->nrows_parsed > 0) {
+        /* over-estimate by a few percent -> rather than re-allocate near the end */
+        const double bytes_per_row = (double) reader->nbytes_parsed / (double) reader->nrows_parsed;
+        const int64_t nhalos_estimate = (int64_t) (1.05 * tree->nbytes / bytes_per_row) + 1;
+        status = reserve_base_ptrs_ctrees(base_ptr_info, N_start + nhalos_estimate);
+        if(status != EXIT_SUCCESS) return status;
+    }
+
+    status = read_single_tree_buffered_ctrees(fd, tree->offset, column_info, base_ptr_info, reader);
+    if(status != EXIT_SUCCESS) return status;
+    if(tree->nbytes > 0) {
+        reader->nbytes_parsed += tree->nbytes;
+        reader->nrows_parsed += base_ptr_info->N - N_start;
+    }
+    return EXIT_SUCCESS;
+}
+
+
+/* Same as `read_tree_from_index_ctrees` but parses the tree from the memory-mapped file. If the number of halos is
+   not known but the number of bytes is, then the halos are counted (a fast scan for new-lines) before parsing */
+static inline int read_tree_from_index_mmap_ctrees(const struct ctrees_mmap_file *mfile, const struct ctrees_tree_index_entry *tree,
+                                                   const struct ctrees_column_to_ptr *column_info, struct base_ptr_info *base_ptr_info)
+{
+    int64_t nhalos = tree->nhalos;
+    if(nhalos < 0 && tree->nbytes > 0 && (size_t) (tree->offset + tree->nbytes) <= mfile->size) {
+        const char *start = mfile->data + tree->offset;
+        nhalos = count_halos_in_memory_ctrees(start, start + tree->nbytes);
+    }
+    if(nhalos >= 0) {
+        int status = reserve_base_ptrs_ctrees(base_ptr_info, base_ptr_info->N + nhalos);
+        if(status != EXIT_SUCCESS) return status;
+    }
+    return read_single_tree_mmap_ctrees(mfile, tree->offset, column_info, base_ptr_info);
+}
+
+/* Parses a sysfs list of ids (e.g., "0-3,8,10-11") into ``*ids`` (allocated, ``*nids`` elements). An empty list is valid */
+static inline int parse_id_list_ctrees(const char *list, int32_t **ids, int32_t *nids)
+{
+    int32_t n = 0, nallocated = 0;
+    int32_t *out = NULL;
+    const char *this = list;
+    while(*this != '\0' && *this != '\n') {
+        char *end = NULL;
+        const long first = strtol(this, &end, 10);
+        long last = first;
+        if(end == this || first < 0) {
+            fprintf(stderr,"Error: Could not parse the list of ids `%s'\n", list);
+            free(out);
+            return EXIT_FAILURE;
+        }
+        this = end;
+        if(*this == '-') {
+            const char *range_start = this + 1;
+            last = strtol(range_start, &end, 10);
+            if(end == range_start || last < first) {
+                fprintf(stderr,"Error: Could not parse the list of ids `%s'\n", list);
+                free(out);
+                return EXIT_FAILURE;
+            }
+            this = end;
+        }
+        for(long id=first;id<=last;id++) {
+            if(n == nallocated) {
+                nallocated = (nallocated < 16) ? 16 : 2*nallocated;
+                int32_t *tmp = realloc(out, nallocated * sizeof(*tmp));
+                if(tmp == NULL) {
+                    fprintf(stderr,"Error: Could not allocate memory for %d ids\n", nallocated);
+                    free(out);
+                    return EXIT_FAILURE;
+                }
+                out = tmp;
+            }
+            out[n++] = (int32_t) id;
+        }
+        if(*this == ',') this++;
+    }
+    *ids = out;
+    *nids = n;
+    return EXIT_SUCCESS;
+}
+
+/* Reads (and parses) the list of ids in the sysfs file ``path`` (see `parse_id_list_ctrees`) */
+static inline int read_id_list_ctrees(const char *path, int32_t **ids, int32_t *nids)
+{
+    FILE *fp = fopen(path, "r");
+    if(fp == NULL) {
+        return EXIT_FAILURE;/* no message -> the caller falls back to a single node */
+    }
+    size_t bufsize = 256, nread = 0;
+    char *buf = malloc(bufsize);
+    while(buf != NULL) {
+        nread += fread(buf + nread, 1, bufsize - 1 - nread, fp);
+        if(nread < bufsize - 1) break;
+        bufsize *= 2;
+        char *tmp = realloc(buf, bufsize);
+        if(tmp == NULL) free(buf);
+        buf = tmp;
+    }
+    fclose(fp);
+    if(buf == NULL) {
+        fprintf(stderr,"Error: Could not allocate memory to read `%s'\n", path);
+        return EXIT_FAILURE;
+    }
+    buf[nread] = '\0';
+    const int status = parse_id_list_ctrees(buf, ids, nids);
+    free(buf);
+    return status;
+}
+
+/* Number of 64-bit words in the CPU masks passed to the `sched_{get,set}affinity` system calls (at least 1024 CPUs,
+   the same as the default `cpu_set_t`) */
+static inline size_t get_cpu_mask_nwords_ctrees(const int32_t max_cpu)
+{
+    const size_t min_nwords = 1024/64;
+    const size_t nwords = (size_t) (max_cpu < 0 ? 0 : max_cpu)/64 + 1;
+    return (nwords < min_nwords) ? min_nwords : nwords;
+}
+
+/* Gets (``set`` == 0) or sets (``set`` == 1) the CPU affinity ``mask`` of the calling thread */
+static inline int cpu_affinity_ctrees(uint64_t *mask, const size_t nwords, const int set)
+{
+#if defined(__linux__) && defined(SYS_sched_getaffinity) && defined(SYS_sched_setaffinity)
+    const long ret = set ? syscall(SYS_sched_setaffinity, 0, nwords * sizeof(*mask), mask)
+                         : syscall(SYS_sched_getaffinity, 0, nwords * sizeof(*mask), mask);
+    if(ret < 0) {
+        fprintf(stderr,"Error: Could not %s the CPU affinity of the thread\n", set ? "set" : "get");
+        perror(NULL);
+        return EXIT_FAILURE;
+    }
+    if(set == 0) {
+        /* the kernel only writes ``ret`` bytes */
+        memset((char *) mask + ret, 0, nwords * sizeof(*mask) - ret);
+    }
+#else
+    if(set == 0) {
+        memset(mask, 0xff, nwords * sizeof(*mask));
+    }
+#endif
+    return EXIT_SUCCESS;
+}
+
+static inline void free_numa_topology_ctrees(struct ctrees_numa_topology *topology)
+{
+    free(topology->node_id);
+    free(topology->cpu_start);
+    free(topology->cpus);
+    memset(topology, 0, sizeof(*topology));
+}
+
+/* Reads the NUMA nodes, and the CPUs of each node, from `/sys/devices/system/node`. Only the CPUs that the calling
+   thread is allowed to run on are kept (e.g., within a cgroup cpuset), and nodes without any such CPUs (e.g.,
+   memory-only nodes) are dropped. If the topology is not available, then all the CPUs are on one node (with id 0) */
+static inline int init_numa_topology_ctrees(struct ctrees_numa_topology *topology)
+{
+    memset(topology, 0, sizeof(*topology));
+    int32_t *nodes = NULL, nnodes = 0;
+    if(read_id_list_ctrees("/sys/devices/system/node/online", &nodes, &nnodes) != EXIT_SUCCESS || nnodes == 0) {
+        free(nodes);
+        nnodes = 1;
+        nodes = NULL;
+    }
+
+    /* the CPUs of every node, one after the other */
+    int32_t **node_cpus = calloc(nnodes, sizeof(*node_cpus));
+    int32_t *node_ncpus = calloc(nnodes, sizeof(*node_ncpus));
+    int status = (node_cpus == NULL || node_ncpus == NULL) ? EXIT_FAILURE : EXIT_SUCCESS;
+    if(status != EXIT_SUCCESS) {
+        fprintf(stderr,"Error: Could not allocate memory for the CPUs of %d NUMA nodes\n", nnodes);
+    }
+    int32_t max_cpu = -1;
+    for(int32_t i=0;i<nnodes && status == EXIT_SUCCESS;i++) {
+        if(nodes == NULL) {
+            /* no topology -> every online CPU */
+            const long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+            char list[64];
+            snprintf(list, sizeof(list), "0-%ld", (ncpus > 0) ? ncpus - 1 : 0);
+            status = parse_id_list_ctrees(list, &(node_cpus[i]), &(node_ncpus[i]));
+        } else {
+            char path[256];
+            snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", nodes[i]);
+            if(read_id_list_ctrees(path, &(node_cpus[i]), &(node_ncpus[i])) != EXIT_SUCCESS) {
+                node_ncpus[i] = 0;/* e.g., the node went offline */
+            }
+        }
+        for(int32_t j=0;j<node_ncpus[i];j++) {
+            if(node_cpus[i][j] > max_cpu) max_cpu = node_cpus[i][j];
+        }
+    }
+
+    /* only keep the CPUs in the affinity mask of this thread */
+    const size_t nwords = get_cpu_mask_nwords_ctrees(max_cpu);
+    uint64_t *allowed = calloc(nwords, sizeof(*allowed));
+    if(status == EXIT_SUCCESS) {
+        status = (allowed == NULL) ? EXIT_FAILURE : cpu_affinity_ctrees(allowed, nwords, 0);
+    }
+    int32_t total_ncpus = 0, nkept = 0;
+    for(int32_t i=0;i<nnodes && status == EXIT_SUCCESS;i++) {
+        int32_t n = 0;
+        for(int32_t j=0;j<node_ncpus[i];j++) {
+            const int32_t cpu = node_cpus[i][j];
+            if((allowed[cpu/64] >> (cpu % 64)) & 1) node_cpus[i][n++] = cpu;
+        }
+        node_ncpus[i] = n;
+        total_ncpus += n;
+        nkept += (n > 0);
+    }
+    if(status == EXIT_SUCCESS && nkept == 0) {
+        fprintf(stderr,"Error: Could not find any CPU (that this thread may run on) on any of the %d NUMA nodes\n", nnodes);
+        status = EXIT_FAILURE;
+    }
+
+    if(status == EXIT_SUCCESS) {
+        topology->node_id = malloc(nkept * sizeof(*(topology->node_id)));
+        topology->cpu_start = malloc((nkept + 1) * sizeof(*(topology->cpu_start)));
+        topology->cpus = malloc(total_ncpus * sizeof(*(topology->cpus)));
+        if(topology->node_id == NULL || topology->cpu_start == NULL || topology->cpus == NULL) {
+            fprintf(stderr,"Error: Could not allocate memory for the NUMA topology (%d nodes and %d CPUs)\n", nkept, total_ncpus);
+            status = EXIT_FAILURE;
+        }
+    }
+    if(status == EXIT_SUCCESS) {
+        topology->cpu_start[0] = 0;
+        topology->max_cpu = -1;
+        for(int32_t i=0;i<nnodes;i++) {
+            if(node_ncpus[i] == 0) continue;
+            const int32_t inode = topology->nnodes;
+            topology->node_id[inode] = (nodes == NULL) ? 0 : nodes[i];
+            memcpy(&(topology->cpus[topology->cpu_start[inode]]), node_cpus[i], node_ncpus[i] * sizeof(*(topology->cpus)));
+            topology->cpu_start[inode + 1] = topology->cpu_start[inode] + node_ncpus[i];
+            for(int32_t j=0;j<node_ncpus[i];j++) {
+                if(node_cpus[i][j] > topology->max_cpu) topology->max_cpu = node_cpus[i][j];
+            }
+            topology->nnodes++;
+        }
+    }
+
+    for(int32_t i=0;node_cpus != NULL && i<nnodes;i++) {
+        free(node_cpus[i]);
+    }
+    free(node_cpus);
+    free(node_ncpus);
+    free(nodes);
+    free(allowed);
+    if(status != EXIT_SUCCESS) {
+        free_numa_topology_ctrees(topology);
+    }
+    return status;
+}
+
+/* The node (i.e., the position within ``topology``, the OS id is topology->node_id[node]) that the reader thread
+   ``thread_id`` is pinned to by `read_trees_parallel_numa_ctrees`. The threads are spread round-robin over the nodes */
+static inline int32_t get_numa_node_of_thread_ctrees(const struct ctrees_numa_topology *topology, const int thread_id)
+{
+    return (int32_t) (thread_id % topology->nnodes);
+}
+
+/* Restricts the calling thread to the CPUs of ``node`` (the position within ``topology``). With the default (first-touch)
+   memory policy of Linux, the memory that the thread then writes to first is placed on that node */
+static inline int pin_thread_to_numa_node_ctrees(const struct ctrees_numa_topology *topology, const int32_t node)
+{
+    PARSE_CTREES_XASSERT(node >= 0 && node < topology->nnodes,
+                         EXIT_FAILURE,
+                         "Error: NUMA node = %d must be in the range [0, %d)\n",
+                         node, topology->nnodes);
+    const size_t nwords = get_cpu_mask_nwords_ctrees(topology->max_cpu);
+    uint64_t *mask = calloc(nwords, sizeof(*mask));
+    if(mask == NULL) {
+        fprintf(stderr,"Error: Could not allocate memory for the CPU mask (%zu words)\n", nwords);
+        return EXIT_FAILURE;
+    }
+    for(int32_t j=topology->cpu_start[node];j<topology->cpu_start[node + 1];j++) {
+        const int32_t cpu = topology->cpus[j];
+        mask[cpu/64] |= (uint64_t) 1 << (cpu % 64);
+    }
+    const int status = cpu_affinity_ctrees(mask, nwords, 1);
+    free(mask);
+    return status;
+}
+
+
+/* Same as `read_trees_parallel_ctrees`, but (if ``topology`` is not NULL) every thread is first pinned to the CPUs of one
+   NUMA node (see `get_numa_node_of_thread_ctrees`), and only then allocates its read buffer and calls `init_base_ptrs`.
+   Therefore, the base pointers allocated within the callback (or the slabs of a per-thread arena), and the halos parsed
+   into them, are first-touched (and placed) on the node of the thread. The previous CPU affinity of every thread is
+   restored before returning.
+
+   If ``node_of_tree`` is not NULL, then node_of_tree[i] is set to the node (the position within ``topology``) of the
+   thread that read index->trees[i], or to -1 if that tree was not read (``node_of_tree`` has index->ntrees elements) */
+static inline int read_trees_parallel_numa_ctrees(const struct ctrees_tree_index *index, const int64_t *tree_indices, const int64_t ntrees,
+                                                  const struct ctrees_column_to_ptr *column_info, const struct ctrees_parallel_callbacks *callbacks,
+                                                  const struct ctrees_numa_topology *topology, int32_t *node_of_tree,
+                                                  const int nthreads, const size_t bufsize)
+{
+    PARSE_CTREES_XASSERT(callbacks->init_base_ptrs != NULL,
+                         EXIT_FAILURE,
+                         "Error: The callback to initialize the base pointers must be set\n");
+    if(node_of_tree != NULL) {
+        for(int64_t i=0;i<index->ntrees;i++) {
+            node_of_tree[i] = -1;
+        }
+    }
+
+    if(ntrees <= 0) {
+        return EXIT_SUCCESS;
+    }
+    /* checked before anything is allocated */
+    for(int64_t i=0;i<ntrees;i++) {
+        const int64_t itree = (tree_indices == NULL) ? i : tree_indices[i];
+        if(itree < 0 || itree >= index->ntrees) {
+            fprintf(stderr,"Error: tree index = %"PRId64" must be in the range [0, %"PRId64")\n", itree, index->ntrees);
+            return EXIT_FAILURE;
+        }
+    }
+
+    int64_t *order = malloc(ntrees * sizeof(*order));
+    int *fds = malloc(index->nfiles * sizeof(*fds));
+    if(order == NULL || fds == NULL) {
+        fprintf(stderr,"Error: Could not allocate memory for scheduling %"PRId64" trees over %d files\n", ntrees, index->nfiles);
+        free(order);
+        free(fds);
+        return EXIT_FAILURE;
+    }
+    for(int64_t i=0;i<ntrees;i++) {
+        order[i] = (tree_indices == NULL) ? i : tree_indices[i];
+    }
+
+    /* largest trees first */
+#define PARSE_CTREES_NBYTES_DESCENDING_COMPARATOR(x, y) ((index->trees[(y)].nbytes < index->trees[(x)].nbytes) ? -1 : \
+                                                          (index->trees[(y)].nbytes > index->trees[(x)].nbytes) ? 1 : ((x) < (y) ? -1 : ((x) > (y))))
+    PARSE_CTREES_ARRAY_SINGLE_SORT(int64_t, order, ntrees, PARSE_CTREES_NBYTES_DESCENDING_COMPARATOR);
+#undef PARSE_CTREES_NBYTES_DESCENDING_COMPARATOR
+
+    /* only open the files that contain (at least) one of the requested trees */
+    int status = EXIT_SUCCESS;
+    for(int32_t i=0;i<index->nfiles;i++) {
+        fds[i] = -1;
+    }
+    for(int64_t i=0;i<ntrees;i++) {
+        const int32_t file_id = index->trees[order[i]].file_id;
+        if(file_id >= 0 && file_id < index->nfiles) fds[file_id] = 0;
+    }
+    for(int32_t i=0;i<index->nfiles;i++) {
+        if(fds[i] < 0) continue;
+        fds[i] = (index->filenames[i][0] == '\0') ? -1 : open(index->filenames[i], O_RDONLY);
+        if(fds[i] < 0 && index->filenames[i][0] != '\0') {
+            fprintf(stderr,"Error: Could not open file `%s'\n", index->filenames[i]);
+            perror(NULL);
+            status = EXIT_FAILURE;
+        }
+    }
+
+#ifdef _OPENMP
+    const int numthreads = (nthreads > 0) ? nthreads : omp_get_max_threads();
+#pragma omp parallel num_threads(numthreads) shared(status)
+#else
+    (void) nthreads;
+#endif
+    {
+#ifdef _OPENMP
+        const int thread_id = omp_get_thread_num();
+#else
+        const int thread_id = 0;
+#endif
+        /* pin first -> everything this thread allocates (and touches) below is on its node */
+        int thread_status = EXIT_SUCCESS;
+        const int32_t node = (topology != NULL) ? get_numa_node_of_thread_ctrees(topology, thread_id) : -1;
+        const size_t nwords = (topology != NULL) ? get_cpu_mask_nwords_ctrees(topology->max_cpu) : 0;
+        uint64_t *saved_mask = (topology != NULL) ? calloc(nwords, sizeof(*saved_mask)) : NULL;
+        if(topology != NULL) {
+            thread_status = (saved_mask == NULL) ? EXIT_FAILURE : cpu_affinity_ctrees(saved_mask, nwords, 0);
+            if(thread_status == EXIT_SUCCESS) {
+                thread_status = pin_thread_to_numa_node_ctrees(topology, node);
+            }
+        }
+
+        struct base_ptr_info base_ptr_info;
+        init_base_ptr_info_ctrees(&base_ptr_info);
+        struct ctrees_buffered_reader reader;
+        memset(&reader, 0, sizeof(reader));
+        if(thread_status == EXIT_SUCCESS) {
+            thread_status = init_buffered_reader_ctrees(&reader, bufsize);
+        }
+        if(thread_status != EXIT_SUCCESS) {
+#ifdef _OPENMP
+#pragma omp atomic write
+#endif
+            status = thread_status;
+        }
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 1)
+#endif
+        for(int64_t i=0;i<ntrees;i++) {
+            int current_status;
+#ifdef _OPENMP
+#pragma omp atomic read
+#endif
+            current_status = status;
+            if(current_status != EXIT_SUCCESS) continue;
+
+            const struct ctrees_tree_index_entry *tree = &(index->trees[order[i]]);
+            if(tree->file_id < 0 || tree->file_id >= index->nfiles || fds[tree->file_id] < 0) {
+                fprintf(stderr,"Error: Invalid file id = %d for tree id = %"PRId64"\n", tree->file_id, tree->tree_id);
+                thread_status = EXIT_FAILURE;
+            }
+            if(thread_status == EXIT_SUCCESS) {
+                base_ptr_info.N = 0;
+                thread_status = callbacks->init_base_ptrs(tree, &base_ptr_info, thread_id, callbacks->userdata);
+            }
+            if(thread_status == EXIT_SUCCESS) {
+                thread_status = read_tree_from_index_ctrees(fds[tree->file_id], tree, column_info, &base_ptr_info, &reader);
+            }
+            if(thread_status == EXIT_SUCCESS && node_of_tree != NULL) {
+                node_of_tree[order[i]] = node;
+            }
+            if(thread_status == EXIT_SUCCESS && callbacks->process_tree != NULL) {
+                thread_status = callbacks->process_tree(tree, &base_ptr_info, thread_id, callbacks->userdata);
+            }
+            if(thread_status != EXIT_SUCCESS) {
+#ifdef _OPENMP
+#pragma omp atomic write
+#endif
+                status = thread_status;
+            }
+        }
+        free_buffered_reader_ctrees(&reader);
+        if(saved_mask != NULL) {
+            /* the (OpenMP) threads are re-used later -> undo the pinning */
+            if(cpu_affinity_ctrees(saved_mask, nwords, 1) != EXIT_SUCCESS) {
+#ifdef _OPENMP
+#pragma omp atomic write
+#endif
+                status = EXIT_FAILURE;
+            }
+            free(saved_mask);
+        }
+    }
+
+    for(int32_t i=0;i<index->nfiles;i++) {
+        if(fds[i] >= 0) close(fds[i]);
+    }
+    free(fds);
+    free(order);
+    return status;
+}
+
+/* Reads ``ntrees`` trees from ``index`` in parallel (with OpenMP, otherwise serially). The trees to
+   read are specified via their position within index->trees (``tree_indices``, or all the trees if NULL).
+
+   Since the trees span many orders of magnitude in size, the trees are handed out dynamically,
+   largest (in bytes) first. Every thread uses its own read buffer (of ``bufsize`` bytes, 0 for the default),
+   and `pread`s from one shared file descriptor per file (only the files that contain a requested tree are opened).
+   See `read_trees_parallel_numa_ctrees` to pin the threads (and their memory) to the NUMA nodes.
+
+   ``nthreads`` <= 0 uses the default number of OpenMP threads */
+static inline int read_trees_parallel_ctrees(const struct ctrees_tree_index *index, const int64_t *tree_indices, const int64_t ntrees,
+                                             const struct ctrees_column_to_ptr *column_info, const struct ctrees_parallel_callbacks *callbacks,
+                                             const int nthreads, const size_t bufsize)
+{
+    return read_trees_parallel_numa_ctrees(index, tree_indices, ntrees, column_info, callbacks, NULL, NULL, nthreads, bufsize);
+}
+
+
+/* The (estimated) cost of reading a tree -- the number of bytes, or the number of halos if the bytes are not known */
+static inline int64_t get_tree_cost_ctrees(const struct ctrees_tree_index_entry *tree)
+{
+    if(tree->nbytes > 0) return tree->nbytes;
+    return (tree->nhalos > 0) ? tree->nhalos : 1;
+}
+
+/* Assigns every tree in ``index`` to one of ``nranks`` ranks (or any other kind of worker), such that the total cost
+   (see `get_tree_cost_ctrees`) is balanced across the ranks. The trees are assigned largest first, each to the rank with
+   the lowest total so far (i.e., the "longest processing time first" schedule), with ties broken by the position in the index
+   and by the rank. The assignment therefore only depends on the index, and every rank computes the same assignment
+   without any communication.
+
+   On success, ``rank_of_tree[i]`` contains the rank that reads index->trees[i] */
+static inline int assign_trees_to_ranks_ctrees(const struct ctrees_tree_index *index, const int nranks, int *rank_of_tree)
+{
+    PARSE_CTREES_XASSERT(nranks > 0,
+                         EXIT_FAILURE,
+                         "Error: The number of ranks = %d must be positive\n",
+                         nranks);
+    if(index->ntrees <= 0) {
+        return EXIT_SUCCESS;
+    }
+
+    int64_t *order = malloc(index->ntrees * sizeof(*order));
+    int64_t *load = calloc(nranks, sizeof(*load));
+    int *heap = malloc(nranks * sizeof(*heap));/* min-heap of the ranks, keyed on the load */
+    if(order == NULL || load == NULL || heap == NULL) {
+        fprintf(stderr,"Error: Could not allocate memory for assigning %"PRId64" trees to %d ranks\n", index->ntrees, nranks);
+        free(order);
+        free(load);
+        free(heap);
+        return EXIT_FAILURE;
+    }
+    for(int64_t i=0;i<index->ntrees;i++) {
+        order[i] = i;
+    }
+    const struct ctrees_tree_index_entry *trees = index->trees;
+#define PARSE_CTREES_COST_DESCENDING_COMPARATOR(x, y) ((get_tree_cost_ctrees(&trees[(y)]) < get_tree_cost_ctrees(&trees[(x)])) ? -1 : \
+                                                        (get_tree_cost_ctrees(&trees[(y)]) > get_tree_cost_ctrees(&trees[(x)])) ? 1 : \
+                                                        ((x) < (y) ? -1 : ((x) > (y))))
+    PARSE_CTREES_ARRAY_SINGLE_SORT(int64_t, order, index->ntrees, PARSE_CTREES_COST_DESCENDING_COMPARATOR);
+#undef PARSE_CTREES_COST_DESCENDING_COMPARATOR
+
+    /* all the loads are 0 -> the ranks in increasing order form a valid heap */
+    for(int r=0;r<nranks;r++) {
+        heap[r] = r;
+    }
+#define PARSE_CTREES_RANK_IS_LESS(a, b) ((load[(a)] < load[(b)]) || (load[(a)] == load[(b)] && (a) < (b)))
+    for(int64_t i=0;i<index->ntrees;i++) {
+        const int rank = heap[0];
+        rank_of_tree[order[i]] = rank;
+        load[rank] += get_tree_cost_ctrees(&trees[order[i]]);
+
+        /* the load of the rank at the top of the heap has increased -> sift down */
+        int pos = 0;
+        while(1) {
+            int child = 2*pos + 1;
+            if(child >= nranks) break;
+            if(child + 1 < nranks && PARSE_CTREES_RANK_IS_LESS(heap[child + 1], heap[child])) child++;
+            if(PARSE_CTREES_RANK_IS_LESS(heap[child], heap[pos]) == 0) break;
+            const int tmp = heap[pos];
+            heap[pos] = heap[child];
+            heap[child] = tmp;
+            pos = child;
+        }
+    }
+#undef PARSE_CTREES_RANK_IS_LESS
+
+    free(order);
+    free(load);
+    free(heap);
+    return EXIT_SUCCESS;
+}
+
+/* Returns the positions (within index->trees) of the trees that are assigned to ``rank`` by `assign_trees_to_ranks_ctrees`,
+   in the order that they appear on disk. The caller is responsible for freeing ``*tree_indices`` */
+static inline int get_trees_of_rank_ctrees(const struct ctrees_tree_index *index, const int nranks, const int rank,
+                                           int64_t **tree_indices, int64_t *ntrees)
+{
+    *tree_indices = NULL;
+    *ntrees = 0;
+    PARSE_CTREES_XASSERT(rank >= 0 && rank < nranks,
+                         EXIT_FAILURE,
+                         "Error: rank = %d must be in the range [0, %d)\n",
+                         rank, nranks);
+    int *rank_of_tree = malloc((index->ntrees > 0 ? index->ntrees : 1) * sizeof(*rank_of_tree));
+    if(rank_of_tree == NULL) {
+        fprintf(stderr,"Error: Could not allocate memory for the ranks of %"PRId64" trees\n", index->ntrees);
+        return EXIT_FAILURE;
+    }
+    int status = assign_trees_to_ranks_ctrees(index, nranks, rank_of_tree);
+    if(status != EXIT_SUCCESS) {
+        free(rank_of_tree);
+        return status;
+    }
+
+    int64_t n = 0;
+    for(int64_t i=0;i<index->ntrees;i++) {
+        n += (rank_of_tree[i] == rank);
+    }
+    int64_t *indices = malloc((n > 0 ? n : 1) * sizeof(*indices));
+    if(indices == NULL) {
+        fprintf(stderr,"Error: Could not allocate memory for the %"PRId64" trees of rank = %d\n", n, rank);
+        free(rank_of_tree);
+        return EXIT_FAILURE;
+    }
+    n = 0;
+    for(int64_t i=0;i<index->ntrees;i++) {
+        if(rank_of_tree[i] == rank) indices[n++] = i;
+    }
+    free(rank_of_tree);
+
+    *tree_indices = indices;
+    *ntrees = n;
+    return EXIT_SUCCESS;
+}
+
+
+#ifdef PARSE_CTREES_USE_MPI
+/* `MPI_Bcast` of ``nbytes`` bytes, in chunks that fit within the (int) count of MPI */
+static inline int bcast_bytes_mpi_ctrees(void *buf, const size_t nbytes, const int root, MPI_Comm comm)
+{
+    const size_t max_chunk = (size_t) 1 << 30;
+    size_t done = 0;
+    while(done < nbytes) {
+        const size_t n = (nbytes - done < max_chunk) ? nbytes - done : max_chunk;
+        if(MPI_Bcast((char *) buf + done, (int) n, MPI_BYTE, root, comm) != MPI_SUCCESS) {
+            fprintf(stderr,"Error: Could not broadcast %zu bytes\n", n);
+            return EXIT_FAILURE;
+        }
+        done += n;
+    }
+    return EXIT_SUCCESS;
+}
+
+/* Returns EXIT_SUCCESS only if ``status`` is EXIT_SUCCESS on every rank in ``comm``. Collective */
+static inline int agree_on_status_mpi_ctrees(const int status, MPI_Comm comm)
+{
+    int failed = (status != EXIT_SUCCESS), any_failed = 1;
+    if(MPI_Allreduce(&failed, &any_failed, 1, MPI_INT, MPI_LOR, comm) != MPI_SUCCESS) {
+        fprintf(stderr,"Error: Could not combine the status across the ranks\n");
+        return EXIT_FAILURE;
+    }
+    return any_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* Broadcasts the ``column_info`` on the ``root`` rank to all the other ranks in ``comm``, which allocate their own
+   per-column arrays (released with `free_column_to_ptr_ctrees`). Collective */
+static inline int bcast_column_to_ptr_mpi_ctrees(struct ctrees_column_to_ptr *column_info, const int root, MPI_Comm comm)
+{
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    int64_t ncols = column_info->ncols;
+    if(bcast_bytes_mpi_ctrees(&ncols, sizeof(ncols), root, comm) != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    int status = (rank == root) ? EXIT_SUCCESS : alloc_column_to_ptr_ctrees(column_info, ncols);
+    if(agree_on_status_mpi_ctrees(status, comm) != EXIT_SUCCESS) {
+        if(rank != root) free_column_to_ptr_ctrees(column_info);
+        return EXIT_FAILURE;
+    }
+    column_info->ncols = ncols;
+
+    struct {
+        void *buf;
+        size_t nbytes;
+    } arrays[] = {
+        {&(column_info->nfilters), sizeof(column_info->nfilters)},
+        {column_info->filter_column_number, sizeof(column_info->filter_column_number)},
+        {column_info->filter_op, sizeof(column_info->filter_op)},
+        {column_info->filter_lo, sizeof(column_info->filter_lo)},
+        {column_info->filter_hi, sizeof(column_info->filter_hi)},
+        {column_info->column_number, ncols * sizeof(*(column_info->column_number))},
+        {column_info->field_types, ncols * sizeof(*(column_info->field_types))},
+        {column_info->base_ptr_idx, ncols * sizeof(*(column_info->base_ptr_idx))},
+        {column_info->dest_offset_to_element, ncols * sizeof(*(column_info->dest_offset_to_element))},
+        {column_info->conversion_method, ncols * sizeof(*(column_info->conversion_method))},
+        {column_info->quant_lo, ncols * sizeof(*(column_info->quant_lo))},
+        {column_info->quant_hi, ncols * sizeof(*(column_info->quant_hi))},
+    };
+    for(size_t i=0;i<sizeof(arrays)/sizeof(arrays[0]);i++) {
+        if(bcast_bytes_mpi_ctrees(arrays[i].buf, arrays[i].nbytes, root, comm) != EXIT_SUCCESS) {
+            if(rank != root) free_column_to_ptr_ctrees(column_info);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+/* Broadcasts the tree ``index`` from the ``root`` rank (e.g., after `load_locations_ctrees` or `build_tree_index_ctrees`)
+   to every other rank in ``comm``, so that only one rank scans (or reads) the files. On the other ranks, ``index`` must be
+   zero-initialised (or freed) and is replaced. Collective */
+static inline int bcast_tree_index_ctrees(struct ctrees_tree_index *index, const int root, MPI_Comm comm)
+{
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    int64_t sizes[] = {index->ntrees, index->nfiles};
+    if(MPI_Bcast(sizes, 2, MPI_INT64_T, root, comm) != MPI_SUCCESS) {
+        fprintf(stderr,"Error: Could not broadcast the size of the tree index\n");
+        return EXIT_FAILURE;
+    }
+
+    int status = EXIT_SUCCESS;
+    if(rank != root) {
+        free_tree_index_ctrees(index);
+        index->trees = malloc((sizes[0] > 0 ? sizes[0] : 1) * sizeof(*(index->trees)));
+        index->filenames = calloc(sizes[1] > 0 ? sizes[1] : 1, sizeof(*(index->filenames)));
+        if(index->trees == NULL || index->filenames == NULL) {
+            fprintf(stderr,"Error: Could not allocate memory for a tree index with %"PRId64" trees in %"PRId64" files\n",
+                    sizes[0], sizes[1]);
+            free_tree_index_ctrees(index);
+            status = EXIT_FAILURE;
+        } else {
+            index->ntrees = sizes[0];
+            index->nallocated = sizes[0];
+            index->nfiles = (int32_t) sizes[1];
+        }
+    }
+    status = agree_on_status_mpi_ctrees(status, comm);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+
+    status = bcast_bytes_mpi_ctrees(index->trees, sizes[0] * sizeof(*(index->trees)), root, comm);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    return bcast_bytes_mpi_ctrees(index->filenames, sizes[1] * sizeof(*(index->filenames)), root, comm);
+}
+
+/* Same as `parse_header_with_filters_ctrees`, but only the ``root`` rank reads the header of ``filename`` and the
+   resulting ``column_info`` is broadcast to every other rank in ``comm``. All the `tree_?_?_?.dat` files of one simulation
+   have the same header, so the ``column_info`` applies to every file. The input arrays are only (re-)ordered on ``root``.
+   Collective */
+static inline int parse_header_mpi_ctrees(char (*column_names)[PARSE_CTREES_MAX_COLNAME_LEN], enum parse_numeric_types *field_types,
+                                          int64_t *base_ptr_idx, size_t *dest_offset_to_element, const int64_t nfields,
+                                          const struct ctrees_filter *filters, const int64_t nfilters,
+                                          const char *filename, struct ctrees_column_to_ptr *column_info, const int root, MPI_Comm comm)
+{
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    int status = EXIT_SUCCESS;
+    if(rank == root) {
+        status = parse_header_with_filters_ctrees(column_names, field_types, base_ptr_idx, dest_offset_to_element, nfields,
+                                                  filters, nfilters, filename, column_info);
+    }
+    if(MPI_Bcast(&status, 1, MPI_INT, root, comm) != MPI_SUCCESS) {
+        fprintf(stderr,"Error: Could not broadcast the status of parsing the header\n");
+        return EXIT_FAILURE;
+    }
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    return bcast_column_to_ptr_mpi_ctrees(column_info, root, comm);
+}
+
+
+/* Parses one tree (``nbytes`` bytes at ``start``, beginning with the `#tree` line) that has already been read into
+   memory, with the same callbacks as `read_trees_parallel_ctrees` */
+static inline int parse_tree_with_callbacks_ctrees(const char *start, const int64_t nbytes, const struct ctrees_tree_index_entry *tree,
+                                                   const struct ctrees_column_to_ptr *column_info, const struct ctrees_parallel_callbacks *callbacks,
+                                                   struct base_ptr_info *base_ptr_info)
+{
+    const char *end = start + nbytes;
+    base_ptr_info->N = 0;
+    int status = callbacks->init_base_ptrs(tree, base_ptr_info, 0, callbacks->userdata);
+    if(status != EXIT_SUCCESS) return status;
+
+    const int64_t nhalos = (tree->nhalos >= 0) ? tree->nhalos : count_halos_in_memory_ctrees(start, end);
+    status = reserve_base_ptrs_ctrees(base_ptr_info, base_ptr_info->N + nhalos);
+    if(status != EXIT_SUCCESS) return status;
+
+    if(is_tree_marker_ctrees(start, end)) {
+        const char *newline = find_newline_ctrees(start, end);
+        start = (newline == NULL) ? end : newline + 1;
+    }
+    struct ctrees_column_plan plan;
+    status = compile_column_plan_ctrees(column_info, base_ptr_info, &plan);
+    if(status != EXIT_SUCCESS) return status;
+    status = parse_tree_from_memory_plan_ctrees(start, end, &plan, base_ptr_info, NULL);
+    free_column_plan_ctrees(&plan);
+    if(status != EXIT_SUCCESS) return status;
+
+    return (callbacks->process_tree != NULL) ? callbacks->process_tree(tree, base_ptr_info, 0, callbacks->userdata) : EXIT_SUCCESS;
+}
+
+/* The collective-I/O part of `read_trees_mpi_ctrees`. The ``tree_indices`` must be in the order that they appear on disk */
+static inline int read_trees_collective_mpi_ctrees(const struct ctrees_tree_index *index, const int64_t *tree_indices, const int64_t ntrees,
+                                                   const struct ctrees_column_to_ptr *column_info, const struct ctrees_parallel_callbacks *callbacks,
+                                                   MPI_Comm comm)
+{
+    const int64_t max_round_bytes = (PARSE_CTREES_MPI_COLLECTIVE_BUFSIZE < INT32_MAX) ? (int64_t) PARSE_CTREES_MPI_COLLECTIVE_BUFSIZE : (int64_t) INT32_MAX;
+    int status = EXIT_SUCCESS;
+    for(int64_t i=0;i<ntrees && status == EXIT_SUCCESS;i++) {
+        const struct ctrees_tree_index_entry *tree = &(index->trees[tree_indices[i]]);
+        if(tree->nbytes <= 0 || tree->nbytes > INT32_MAX) {
+            fprintf(stderr,"Error: The collective reads require the size of every tree to be known and less than 2 GB. "
+                    "Tree id = %"PRId64" has %"PRId64" bytes\n", tree->tree_id, tree->nbytes);
+            status = EXIT_FAILURE;
+        }
+    }
+    int *blocklens = malloc((ntrees > 0 ? ntrees : 1) * sizeof(*blocklens));
+    MPI_Aint *displacements = malloc((ntrees > 0 ? ntrees : 1) * sizeof(*displacements));
+    if(blocklens == NULL || displacements == NULL) {
+        fprintf(stderr,"Error: Could not allocate memory for the file view of %"PRId64" trees\n", ntrees);
+        status = EXIT_FAILURE;
+    }
+    if(callbacks->init_base_ptrs == NULL) {
+        fprintf(stderr,"Error: The callback to initialize the base pointers must be set\n");
+        status = EXIT_FAILURE;
+    }
+    status = agree_on_status_mpi_ctrees(status, comm);
+
+    struct base_ptr_info base_ptr_info;
+    init_base_ptr_info_ctrees(&base_ptr_info);
+    char *buffer = NULL;
+    int64_t buffer_size = 0;
+    int64_t next = 0;
+    for(int32_t file_id=0;file_id<index->nfiles && status == EXIT_SUCCESS;file_id++) {
+        /* every rank knows whether any rank has a tree in this file */
+        int file_has_trees = 0;
+        for(int64_t i=0;i<index->ntrees && file_has_trees == 0;i++) {
+            file_has_trees = (index->trees[i].file_id == file_id);
+        }
+        if(file_has_trees == 0) continue;
+
+        MPI_File fh;
+        int open_status = EXIT_SUCCESS;
+        if(MPI_File_open(comm, index->filenames[file_id], MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+            fprintf(stderr,"Error: Could not open file `%s' with MPI-IO\n", index->filenames[file_id]);
+            open_status = EXIT_FAILURE;
+        }
+        /* the open may fail on only some of the ranks -> agree before any of the collective reads from this file,
+           so that every rank skips the rounds (and leaves the loop) together */
+        if(agree_on_status_mpi_ctrees(open_status, comm) != EXIT_SUCCESS) {
+            if(open_status == EXIT_SUCCESS) {
+                MPI_File_close(&fh);
+            }
+            status = EXIT_FAILURE;
+            break;
+        }
+
+        /* the trees of this rank within this file are read in rounds of (at most) max_round_bytes, except
+           when a single tree is larger. Every rank takes part in every round (possibly reading nothing) */
+        const int64_t first = next;
+        while(next < ntrees && index->trees[tree_indices[next]].file_id == file_id) next++;
+        int64_t nrounds = 0, max_nrounds = 0;
+        for(int64_t i=first, nbytes=0;i<next;i++) {
+            const int64_t tree_nbytes = index->trees[tree_indices[i]].nbytes;
+            if(i == first || nbytes + tree_nbytes > max_round_bytes) {
+                nrounds++;
+                nbytes = 0;
+            }
+            nbytes += tree_nbytes;
+        }
+        if(MPI_Allreduce(&nrounds, &max_nrounds, 1, MPI_INT64_T, MPI_MAX, comm) != MPI_SUCCESS) {
+            fprintf(stderr,"Error: Could not combine the number of collective reads across the ranks\n");
+            status = EXIT_FAILURE;
+        }
+
+        /* a rank that fails (e.g., while parsing) still takes part in the remaining rounds -> the status is combined
+           across the ranks after every file */
+        int64_t pos = first;
+        for(int64_t iround=0;iround<max_nrounds;iround++) {
+            const int64_t round_start = pos;
+            int ntrees_in_round = 0;
+            int64_t nbytes = 0;
+            while(pos < next) {
+                const struct ctrees_tree_index_entry *tree = &(index->trees[tree_indices[pos]]);
+                if(ntrees_in_round > 0 && nbytes + tree->nbytes > max_round_bytes) break;
+                blocklens[ntrees_in_round] = (int) tree->nbytes;
+                displacements[ntrees_in_round] = (MPI_Aint) tree->offset;
+                nbytes += tree->nbytes;
+                ntrees_in_round++;
+                pos++;
+            }
+            if(nbytes > buffer_size) {
+                char *tmp = realloc(buffer, nbytes);
+                if(tmp == NULL) {
+                    fprintf(stderr,"Error: Could not allocate memory for the collective read of %"PRId64" bytes\n", nbytes);
+                    ntrees_in_round = 0;/* still take part in the collective read */
+                    nbytes = 0;
+                    status = EXIT_FAILURE;
+                } else {
+                    buffer = tmp;
+                    buffer_size = nbytes;
+                }
+            }
+
+            MPI_Datatype filetype = MPI_BYTE;
+            if(ntrees_in_round > 0) {
+                MPI_Type_create_hindexed(ntrees_in_round, blocklens, displacements, MPI_BYTE, &filetype);
+                MPI_Type_commit(&filetype);
+            }
+            MPI_Status mpi_status;
+            int mpi_err = MPI_File_set_view(fh, 0, MPI_BYTE, filetype, "native", MPI_INFO_NULL);
+            if(mpi_err == MPI_SUCCESS) {
+                mpi_err = MPI_File_read_all(fh, buffer, (int) nbytes, MPI_BYTE, &mpi_status);
+            }
+            if(ntrees_in_round > 0) {
+                MPI_Type_free(&filetype);
+            }
+            int nbytes_read = 0;
+            if(mpi_err != MPI_SUCCESS || MPI_Get_count(&mpi_status, MPI_BYTE, &nbytes_read) != MPI_SUCCESS || nbytes_read != nbytes) {
+                fprintf(stderr,"Error: The collective read of %"PRId64" bytes from `%s' failed (read %d bytes)\n",
+                        nbytes, index->filenames[file_id], nbytes_read);
+                status = EXIT_FAILURE;
+            }
+
+            const char *start = buffer;
+            for(int i=0;i<ntrees_in_round && status == EXIT_SUCCESS;i++) {
+                status = parse_tree_with_callbacks_ctrees(start, blocklens[i], &(index->trees[tree_indices[round_start + i]]),
+                                                          column_info, callbacks, &base_ptr_info);
+                start += blocklens[i];
+            }
+        }
+        MPI_File_close(&fh);
+        status = agree_on_status_mpi_ctrees(status, comm);
+    }
+
+    free(buffer);
+    free(blocklens);
+    free(displacements);
+    return status;
+}
+
+/* Reads the trees that are assigned to this rank (see `assign_trees_to_ranks_ctrees`) out of all the trees in ``index``,
+   which must be identical on every rank in ``comm`` (e.g., via `bcast_tree_index_ctrees`). Each rank only reads the
+   byte ranges of its own trees, and the ``callbacks`` are the same as in `read_trees_parallel_ctrees`. Collective.
+
+   With ``use_collective_io`` = 0, every rank `pread`s its trees with ``nthreads`` OpenMP threads, through read buffers of
+   ``bufsize`` bytes (see `read_trees_parallel_ctrees`).
+
+   Otherwise, the files are read with the MPI-IO collective reads (`MPI_File_read_all`), which allows the MPI library to
+   aggregate the (many, small) requests of all the ranks into large contiguous reads on parallel file-systems. Each rank
+   reads (up to PARSE_CTREES_MPI_COLLECTIVE_BUFSIZE bytes of) its trees in a file with one collective read, and then parses
+   the trees from memory (serially, i.e., with ``thread_id`` = 0 in the callbacks). This requires the number of bytes of
+   every tree in the index.
+
+   Returns EXIT_SUCCESS only if every rank succeeded */
+static inline int read_trees_mpi_ctrees(const struct ctrees_tree_index *index, const struct ctrees_column_to_ptr *column_info,
+                                        const struct ctrees_parallel_callbacks *callbacks, const int use_collective_io,
+                                        const int nthreads, const size_t bufsize, MPI_Comm comm)
+{
+    int rank, nranks;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nranks);
+
+    int64_t *tree_indices = NULL, ntrees = 0;
+    int status = get_trees_of_rank_ctrees(index, nranks, rank, &tree_indices, &ntrees);
+    if(use_collective_io) {
+        status = agree_on_status_mpi_ctrees(status, comm);
+        if(status == EXIT_SUCCESS) {
+            status = read_trees_collective_mpi_ctrees(index, tree_indices, ntrees, column_info, callbacks, comm);
+        }
+    } else if(status == EXIT_SUCCESS) {
+        status = read_trees_parallel_ctrees(index, tree_indices, ntrees, column_info, callbacks, nthreads, bufsize);
+    }
+    free(tree_indices);
+
+    return agree_on_status_mpi_ctrees(status, comm);
+}
+#endif /* PARSE_CTREES_USE_MPI */
+
+/* Returns the number of non-empty lines in [start, end) that pass the row filters in the ``plan``
+   (-1 if the filters could not be evaluated) */
+static inline int64_t count_accepted_lines_ctrees(const char *start, const char *end, const struct ctrees_column_plan *plan)
+{
+    int64_t nlines = 0;
+    const char *this = start;
+    while(this < end) {
+        const char *newline = find_newline_ctrees(this, end);
+        if(newline == NULL) newline = end;
+        if(newline > this) {
+            int passes = 1;
+            if(plan->nfilters > 0 && evaluate_filters_plan_ctrees(this, newline - this, plan, &passes) != EXIT_SUCCESS) {
+                return -1;
+            }
+            nlines += passes;
+        }
+        this = newline + 1;
+    }
+    return nlines;
+}
+
+
+/* Parses the tree contained in the memory range [start, end) with ``nthreads`` threads (OpenMP). The range must
+   only contain the halos of one tree (optionally preceded by the `#tree` line), e.g., from the tree index.
+
+   The range is split into chunks at new-line boundaries. A first (parallel) pass counts the halos (that pass the row filters) in each chunk,
+   and then each chunk is parsed (in parallel) directly into its own range of rows within the base pointers --
+   i.e., the halos are stored in exactly the same order as with the serial readers. The base pointers are allocated only once.
+
+   ``nthreads`` <= 0 uses the default number of OpenMP threads */
+static inline int parse_tree_from_memory_parallel_ctrees(const char *start, const char *end, const struct ctrees_column_to_ptr *column_info,
+                                                         struct base_ptr_info *base_ptr_info, const int nthreads)
+{
+    if(is_tree_marker_ctrees(start, end)) {
+        const char *newline = find_newline_ctrees(start, end);
+        start = (newline == NULL) ? end : newline + 1;
+    }
+    if(start >= end) {
+        return EXIT_SUCCESS;
+    }
+
+    struct ctrees_column_plan plan;
+    int status = compile_column_plan_ctrees(column_info, base_ptr_info, &plan);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+
+#ifdef _OPENMP
+    const int numthreads = (nthreads > 0) ? nthreads : omp_get_max_threads();
+#else
+    const int numthreads = 1;
+    (void) nthreads;
+#endif
+    /* a few chunks per thread to balance out any variations in the line lengths */
+    const int64_t min_chunk_bytes = 64*1024;
+    int64_t nchunks = 4*(int64_t) numthreads;
+    if((end - start)/nchunks < min_chunk_bytes) {
+        nchunks = (end - start)/min_chunk_bytes + 1;
+    }
+
+    const char **chunk_start = malloc((nchunks + 1) * sizeof(*chunk_start));
+    int64_t *chunk_row = malloc((nchunks + 1) * sizeof(*chunk_row));
+    if(chunk_start == NULL || chunk_row == NULL) {
+        fprintf(stderr,"Error: Could not allocate memory for %"PRId64" chunks\n", nchunks);
+        free(chunk_start);
+        free(chunk_row);
+        free_column_plan_ctrees(&plan);
+        return EXIT_FAILURE;
+    }
+    /* every chunk begins at the start of a line */
+    chunk_start[0] = start;
+    for(int64_t i=1;i<nchunks;i++) {
+        const char *boundary = start + (end - start)*i/nchunks;
+        if(boundary < chunk_start[i-1]) boundary = chunk_start[i-1];
+        const char *newline = find_newline_ctrees(boundary, end);
+        chunk_start[i] = (newline == NULL) ? end : newline + 1;
+    }
+    chunk_start[nchunks] = end;
+
+    /* first pass: count the halos per chunk */
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(numthreads) schedule(dynamic, 1)
+#endif
+    for(int64_t i=0;i<nchunks;i++) {
+        chunk_row[i+1] = count_accepted_lines_ctrees(chunk_start[i], chunk_start[i+1], &plan);
+    }
+    chunk_row[0] = base_ptr_info->N;
+    for(int64_t i=0;i<nchunks;i++) {
+        if(chunk_row[i+1] < 0) {
+            free(chunk_start);
+            free(chunk_row);
+            free_column_plan_ctrees(&plan);
+            return EXIT_FAILURE;
+        }
+        chunk_row[i+1] += chunk_row[i];
+    }
+    status = reserve_base_ptrs_ctrees(base_ptr_info, chunk_row[nchunks]);
+    if(status != EXIT_SUCCESS) {
+        free(chunk_start);
+        free(chunk_row);
+        free_column_plan_ctrees(&plan);
+        return status;
+    }
+
+    /* second pass: parse each chunk into its own rows */
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(numthreads) schedule(dynamic, 1) shared(status)
+#endif
+    for(int64_t i=0;i<nchunks;i++) {
+        int64_t row = chunk_row[i];
+        const char *this = chunk_start[i];
+        const char *chunk_end = chunk_start[i+1];
+        int chunk_status = EXIT_SUCCESS;
+        while(this < chunk_end && chunk_status == EXIT_SUCCESS) {
+            const char *newline = find_newline_ctrees(this, chunk_end);
+            if(newline == NULL) newline = chunk_end;
+            int passes = (newline > this);
+            if(passes && plan.nfilters > 0) {
+                chunk_status = evaluate_filters_plan_ctrees(this, newline - this, &plan, &passes);
+            }
+            if(passes && chunk_status == EXIT_SUCCESS) {
+                chunk_status = parse_row_plan_ctrees(this, newline - this, &plan, row);
+                row++;
+            }
+            this = newline + 1;
+        }
+        if(chunk_status != EXIT_SUCCESS) {
+#ifdef _OPENMP
+#pragma omp atomic write
+#endif
+            status = chunk_status;
+        }
+    }
+
+    if(status == EXIT_SUCCESS) {
+        base_ptr_info->N = chunk_row[nchunks];
+    }
+    free(chunk_start);
+    free(chunk_row);
+    free_column_plan_ctrees(&plan);
+    return status;
+}
+
+
+/* Same as `read_tree_from_index_mmap_ctrees` but parses the tree with ``nthreads`` threads
+   (see `parse_tree_from_memory_parallel_ctrees`). Intended for the (few) trees that contain millions of halos.
+   If the number of bytes in the tree is not known, then the end of the tree is located first (with a
+   serial scan for the next `#tree` line) */
+static inline int read_tree_from_index_parallel_mmap_ctrees(const struct ctrees_mmap_file *mfile, const struct ctrees_tree_index_entry *tree,
+                                                            const struct ctrees_column_to_ptr *column_info, struct base_ptr_info *base_ptr_info,
+                                                            const int nthreads)
+{
+    PARSE_CTREES_XASSERT(mfile->data != NULL,
+                         EXIT_FAILURE,
+                         "Error: The file has not been memory-mapped. Please call `open_mmap_file_ctrees` first\n");
+    PARSE_CTREES_XASSERT(tree->offset >= 0 && (size_t) tree->offset <= mfile->size,
+                         EXIT_FAILURE,
+                         "Error: offset = %"PRId64" must be within the file (size = %zu bytes)\n",
+                         tree->offset, mfile->size);
+    const char *file_end = mfile->data + mfile->size;
+    const char *start = mfile->data + tree->offset;
+    const char *end = file_end;
+    if(tree->nbytes >= 0 && (size_t) (tree->offset + tree->nbytes) <= mfile->size) {
+        end = start + tree->nbytes;
+    } else {
+        const char *this = start;
+        if(is_tree_marker_ctrees(this, file_end)) {
+            const char *newline = find_newline_ctrees(this, file_end);
+            this = (newline == NULL) ? file_end : newline + 1;
+        }
+        while(this < file_end && *this != '#') {
+            const char *newline = find_newline_ctrees(this, file_end);
+            this = (newline == NULL) ? file_end : newline + 1;
+        }
+        end = this;
+    }
+
+    return parse_tree_from_memory_parallel_ctrees(start, end, column_info, base_ptr_info, nthreads);
+}
+
+static inline void free_batch_ctrees(struct ctrees_batch *batch)
+{
+    for(int64_t i=0;i<PARSE_CTREES_MAX_NCOLS;i++) {
+        free(batch->columns[i]);
+        batch->columns[i] = NULL;
+    }
+    free_column_plan_ctrees(&(batch->plan));
+    batch->ncols = 0;
+    batch->nrows = 0;
+    batch->batch_rows = 0;
+}
+
+
+/* Allocates a ``batch`` of ``batch_rows`` rows, for all the columns in ``column_info`` */
+static inline int init_batch_ctrees(struct ctrees_batch *batch, const struct ctrees_column_to_ptr *column_info, const int64_t batch_rows)
+{
+    memset(batch, 0, sizeof(*batch));
+    if(batch_rows <= 0) {
+        fprintf(stderr,"Error: The number of rows in a batch must be positive. Got batch_rows = %"PRId64" instead\n", batch_rows);
+        return EXIT_FAILURE;
+    }
+    if(column_info->ncols > PARSE_CTREES_MAX_NCOLS || column_info->ncols < 0) {
+        fprintf(stderr,"Error: A batch stores every column in its own base pointer, and can hold at most %"PRId64" columns. "
+                "Got ncols = %"PRId64" instead (increase PARSE_CTREES_MAX_NCOLS)\n",
+                (int64_t) PARSE_CTREES_MAX_NCOLS, column_info->ncols);
+        return EXIT_FAILURE;
+    }
+
+    /* route every column to its own (SOA) base pointer */
+    struct ctrees_column_to_ptr batch_column_info;
+    if(copy_column_to_ptr_ctrees(&batch_column_info, column_info) != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    batch->ncols = column_info->ncols;
+    batch->batch_rows = batch_rows;
+    batch->base_ptr_info.num_base_ptrs = column_info->ncols;
+    for(int64_t i=0;i<column_info->ncols;i++) {
+        const size_t field_size = size_of_numeric_type_ctrees(column_info->field_types[i]);
+        if(field_size == 0) {
+            fprintf(stderr,"Error: Unknown value for parse type = %d\n", column_info->field_types[i]);
+            free_column_to_ptr_ctrees(&batch_column_info);
+            free_batch_ctrees(batch);
+            return EXIT_FAILURE;
+        }
+        batch->column_number[i] = column_info->column_number[i];
+        batch->field_types[i] = column_info->field_types[i];
+        batch->base_ptr_idx[i] = column_info->base_ptr_idx[i];
+        batch->dest_offset_to_element[i] = column_info->dest_offset_to_element[i];
+        batch->columns[i] = malloc(batch_rows * field_size);
+        if(batch->columns[i] == NULL) {
+            fprintf(stderr,"Error: Could not allocate memory for %"PRId64" rows of column number = %d\n",
+                    batch_rows, column_info->column_number[i]);
+            perror(NULL);
+            free_column_to_ptr_ctrees(&batch_column_info);
+            free_batch_ctrees(batch);
+            return EXIT_FAILURE;
+        }
+        batch->base_ptr_info.base_ptrs[i] = &(batch->columns[i]);
+        batch->base_ptr_info.base_element_size[i] = field_size;
+        batch_column_info.base_ptr_idx[i] = i;
+        batch_column_info.dest_offset_to_element[i] = 0;
+    }
+    batch->base_ptr_info.nallocated = batch_rows;
+
+    int status = compile_column_plan_ctrees(&batch_column_info, &(batch->base_ptr_info), &(batch->plan));
+    free_column_to_ptr_ctrees(&batch_column_info);
+    if(status != EXIT_SUCCESS) {
+        free_batch_ctrees(batch);
+    }
+    return status;
+}
+
+
+/* Returns the index (within ``batch->columns``) of the column that was requested with the
+   (``base_ptr_idx``, ``dest_offset_to_element``) pair, or -1 if no such column exists */
+static inline int64_t find_batch_column_ctrees(const struct ctrees_batch *batch, const int64_t base_ptr_idx, const size_t dest_offset_to_element)
+{
+    for(int64_t i=0;i<batch->ncols;i++) {
+        if(batch->base_ptr_idx[i] == base_ptr_idx && batch->dest_offset_to_element[i] == dest_offset_to_element) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+/* The line-visitor used by the streaming readers */
+struct ctrees_batch_visitor_data {
+    struct ctrees_batch *batch;
+    ctrees_batch_callback_fn callback;
+    void *userdata;
+};
+
+static inline int flush_batch_ctrees(struct ctrees_batch_visitor_data *visitor_data)
+{
+    struct ctrees_batch *batch = visitor_data->batch;
+    if(batch->nrows == 0) {
+        return EXIT_SUCCESS;
+    }
+    int status = visitor_data->callback(batch, visitor_data->userdata);
+    batch->first_row += batch->nrows;
+    batch->nrows = 0;
+    return status;
+}
+
+static inline int parse_line_batch_visitor_ctrees(const char *line, const size_t linelen, void *data)
+{
+    struct ctrees_batch_visitor_data *visitor_data = (struct ctrees_batch_visitor_data *) data;
+    struct ctrees_batch *batch = visitor_data->batch;
+    if(batch->plan.nfilters > 0) {
+        int passes = 0;
+        int status = evaluate_filters_plan_ctrees(line, linelen, &(batch->plan), &passes);
+        if(status != EXIT_SUCCESS || passes == 0) return status;
+    }
+    int status = parse_row_plan_ctrees(line, linelen, &(batch->plan), batch->nrows);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    batch->nrows++;
+    if(batch->nrows == batch->batch_rows) {
+        return flush_batch_ctrees(visitor_data);
+    }
+    return EXIT_SUCCESS;
+}
+
+
+/* Same as `stream_single_tree_buffered_ctrees` but reads from any input ``source`` (e.g., a compressed file) */
+static inline int stream_single_tree_source_ctrees(const struct ctrees_input_source *source, off_t offset, struct ctrees_batch *batch,
+                                                   ctrees_batch_callback_fn callback, void *userdata, struct ctrees_buffered_reader *reader)
+{
+    batch->nrows = 0;
+    batch->first_row = 0;
+    struct ctrees_batch_visitor_data visitor_data = {.batch = batch, .callback = callback, .userdata = userdata};
+    int status = visit_tree_lines_source_ctrees(source, offset, reader, parse_line_batch_visitor_ctrees, &visitor_data);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    return flush_batch_ctrees(&visitor_data);
+}
+
+/* Streaming version of `read_single_tree_buffered_ctrees`. The halos are parsed into
+   the ``batch`` (instead of the base pointers) and ``callback`` is called every time
+   the batch is full, and once more for the remaining halos at the end of the tree. The memory use is
+   therefore bounded by the batch size, regardless of the number of halos in the tree */
+static inline int stream_single_tree_buffered_ctrees(int fd, off_t offset, struct ctrees_batch *batch, ctrees_batch_callback_fn callback,
+                                                     void *userdata, struct ctrees_buffered_reader *reader)
+{
+    const struct ctrees_input_source source = get_fd_source_ctrees(&fd);
+    return stream_single_tree_source_ctrees(&source, offset, batch, callback, userdata, reader);
+}
+
+
+/* Same as `stream_single_tree_buffered_ctrees` but parses directly from the memory-mapped file */
+static inline int stream_single_tree_mmap_ctrees(const struct ctrees_mmap_file *mfile, off_t offset, struct ctrees_batch *batch,
+                                                 ctrees_batch_callback_fn callback, void *userdata)
+{
+    batch->nrows = 0;
+    batch->first_row = 0;
+    struct ctrees_batch_visitor_data visitor_data = {.batch = batch, .callback = callback, .userdata = userdata};
+    int status = visit_tree_lines_mmap_ctrees(mfile, offset, parse_line_batch_visitor_ctrees, &visitor_data);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    return flush_batch_ctrees(&visitor_data);
+}
+
+
+/* magic bytes and version at the beginning of the columnar cache written by `write_columnar_cache_ctrees` */
+#define PARSE_CTREES_COLUMNAR_CACHE_MAGIC    "CTREECOL"
+#define PARSE_CTREES_COLUMNAR_CACHE_VERSION  2
+
+/* Returns the hash of the row filters in ``column_info`` (identical for all column_info's without any filters) */
+static inline uint64_t hash_filters_ctrees(const struct ctrees_column_to_ptr *column_info)
+{
+    uint64_t hash = fnv1a_hash_ctrees(&(column_info->nfilters), sizeof(column_info->nfilters), PARSE_CTREES_FNV1A_OFFSET_BASIS);
+    for(int64_t i=0;i<column_info->nfilters;i++) {
+        const int64_t fields[] = {column_info->filter_column_number[i], column_info->filter_op[i]};
+        hash = fnv1a_hash_ctrees(fields, sizeof(fields), hash);
+        hash = fnv1a_hash_ctrees(&(column_info->filter_lo[i]), sizeof(column_info->filter_lo[i]), hash);
+        hash = fnv1a_hash_ctrees(&(column_info->filter_hi[i]), sizeof(column_info->filter_hi[i]), hash);
+    }
+    return hash;
+}
+
+/* Hashes the first line (i.e., the header) of the file ``filename`` */
+static inline int hash_file_header_ctrees(const char *filename, uint64_t *hash)
+{
+    char *linebuf = NULL;
+    if(read_first_line_ctrees(filename, &linebuf) != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    *hash = fnv1a_hash_ctrees(linebuf, strlen(linebuf), PARSE_CTREES_FNV1A_OFFSET_BASIS);
+    free(linebuf);
+    return EXIT_SUCCESS;
+}
+
+
+/* The batch callback used to write the column data into the cache */
+struct ctrees_cache_writer_data {
+    int fd;
+    const struct ctrees_cache_column *columns;
+    int64_t row_start;/* of the current tree */
+};
+
+static inline int write_batch_to_cache_ctrees(const struct ctrees_batch *batch, void *userdata)
+{
+    const struct ctrees_cache_writer_data *writer = (const struct ctrees_cache_writer_data *) userdata;
+    for(int64_t i=0;i<batch->ncols;i++) {
+        const size_t nbytes = batch->nrows * writer->columns[i].element_size;
+        const off_t offset = writer->columns[i].data_offset + (writer->row_start + batch->first_row) * writer->columns[i].element_size;
+        const char *buf = (const char *) batch->columns[i];
+        size_t nwritten = 0;
+        while(nwritten < nbytes) {
+            ssize_t n = pwrite(writer->fd, buf + nwritten, nbytes - nwritten, offset + nwritten);
+            if(n <= 0) {
+                fprintf(stderr,"Error: Could not write %zu bytes into the columnar cache\n", nbytes - nwritten);
+                perror(NULL);
+                return EXIT_FAILURE;
+            }
+            nwritten += n;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+
+/* Computes the layout of the columnar cache (i.e., the number of rows in every tree and the offset of every
+   column) and then writes the cache into ``cache_file``. Used by `write_columnar_cache_ctrees` */
+static inline int fill_columnar_cache_ctrees(const char *cache_file, const struct ctrees_column_to_ptr *column_info, const struct ctrees_tree_index *index,
+                                             const struct ctrees_mmap_file *mfile, struct ctrees_batch *batch,
+                                             struct ctrees_cache_file_header *header, struct ctrees_cache_column *columns, struct ctrees_cache_tree *trees)
+{
+    /* first pass: the number of rows in every tree (counted, unless known from the index) */
+    for(int64_t i=0;i<index->ntrees;i++) {
+        const struct ctrees_tree_index_entry *entry = &(index->trees[i]);
+        if(entry->offset < 0 || entry->nbytes < 0 || (size_t) (entry->offset + entry->nbytes) > mfile->size) {
+            fprintf(stderr,"Error: The location of tree # %"PRId64" (tree id = %"PRId64") is not known\n", i, entry->tree_id);
+            return EXIT_FAILURE;
+        }
+        const char *start = mfile->data + entry->offset;
+        const char *end = start + entry->nbytes;
+        if(is_tree_marker_ctrees(start, end)) {
+            const char *newline = find_newline_ctrees(start, end);
+            start = (newline == NULL) ? end : newline + 1;
+        }
+        struct ctrees_cache_tree *tree = &(trees[i]);
+        tree->tree_id = entry->tree_id;
+        tree->forest_id = entry->forest_id;
+        tree->offset = entry->offset;
+        tree->data_offset = start - mfile->data;
+        tree->nbytes = entry->nbytes;
+        tree->row_start = header->nrows;
+        tree->nrows = (column_info->nfilters == 0 && entry->nhalos >= 0) ? entry->nhalos : count_accepted_lines_ctrees(start, end, &(batch->plan));
+        if(tree->nrows < 0) {
+            return EXIT_FAILURE;
+        }
+        header->nrows += tree->nrows;
+    }
+
+    /* the layout of the column data */
+    int64_t file_offset = sizeof(*header) + header->ncols * sizeof(*columns) + header->ntrees * sizeof(*trees);
+    for(int64_t i=0;i<header->ncols;i++) {
+        file_offset = (file_offset + 63) & ~((int64_t) 63);
+        columns[i].column_number = column_info->column_number[i];
+        columns[i].field_type = column_info->field_types[i];
+        columns[i].element_size = size_of_numeric_type_ctrees(column_info->field_types[i]);
+        const int is_quantized = (column_info->field_types[i] == Q16 || column_info->field_types[i] == Q32);
+        columns[i].quant_lo = is_quantized ? column_info->quant_lo[i]:0.0;
+        columns[i].quant_hi = is_quantized ? column_info->quant_hi[i]:0.0;
+        columns[i].data_offset = file_offset;
+        file_offset += header->nrows * columns[i].element_size;
+    }
+
+    int fd = open(cache_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) {
+        fprintf(stderr,"Error: Could not open file `%s' for writing\n", cache_file);
+        perror(NULL);
+        return EXIT_FAILURE;
+    }
+    int status = EXIT_SUCCESS;
+    if(ftruncate(fd, file_offset) != 0) {
+        fprintf(stderr,"Error: Could not resize the columnar cache `%s' to %"PRId64" bytes\n", cache_file, file_offset);
+        perror(NULL);
+        status = EXIT_FAILURE;
+    }
+
+    /* second pass: parse every tree and write the columns */
+    struct ctrees_cache_writer_data writer = {.fd = fd, .columns = columns, .row_start = 0};
+    for(int64_t i=0;i<header->ntrees && status == EXIT_SUCCESS;i++) {
+        writer.row_start = trees[i].row_start;
+        status = stream_single_tree_mmap_ctrees(mfile, trees[i].offset, batch, write_batch_to_cache_ctrees, &writer);
+        if(status == EXIT_SUCCESS && batch->first_row != trees[i].nrows) {
+            fprintf(stderr,"Error: Expected %"PRId64" rows in tree id = %"PRId64" but parsed %"PRId64" rows\n",
+                    trees[i].nrows, trees[i].tree_id, batch->first_row);
+            status = EXIT_FAILURE;
+        }
+    }
+
+    if(status == EXIT_SUCCESS) {
+        const size_t columns_nbytes = header->ncols * sizeof(*columns);
+        const size_t trees_nbytes = header->ntrees * sizeof(*trees);
+        memcpy(header->magic, PARSE_CTREES_COLUMNAR_CACHE_MAGIC, sizeof(header->magic));
+        if(pwrite(fd, columns, columns_nbytes, sizeof(*header)) != (ssize_t) columns_nbytes ||
+           pwrite(fd, trees, trees_nbytes, sizeof(*header) + columns_nbytes) != (ssize_t) trees_nbytes ||
+           pwrite(fd, header, sizeof(*header), 0) != (ssize_t) sizeof(*header)) {
+            fprintf(stderr,"Error: Could not write the header into the columnar cache `%s'\n", cache_file);
+            perror(NULL);
+            status = EXIT_FAILURE;
+        }
+    }
+    if(close(fd) != 0) {
+        perror(NULL);
+        status = EXIT_FAILURE;
+    }
+    if(status != EXIT_SUCCESS) {
+        unlink(cache_file);
+    }
+    return status;
+}
+
+
+/* Parses every tree in ``source_file`` (with the columns and the row filters in ``column_info``) and writes
+   the values into the columnar binary cache ``cache_file``. The trees are located with ``index`` (if not NULL, must
+   only contain the trees from ``source_file``), otherwise the index is built by scanning ``source_file``.
+
+   The header of the cache is written last, i.e., an incomplete cache is never considered valid */
+static inline int write_columnar_cache_ctrees(const char *cache_file, const char *source_file, const struct ctrees_column_to_ptr *column_info,
+                                              const struct ctrees_tree_index *index)
+{
+    struct ctrees_tree_index local_index = {0};
+    if(index == NULL) {
+        int status = build_tree_index_ctrees(source_file, &local_index);
+        if(status != EXIT_SUCCESS) {
+            return status;
+        }
+        index = &local_index;
+    }
+    if(index->nfiles > 1) {
+        fprintf(stderr,"Error: The tree index must only contain the trees from `%s' (found %d files in the index)\n",
+                source_file, index->nfiles);
+        free_tree_index_ctrees(&local_index);
+        return EXIT_FAILURE;
+    }
+
+    struct stat st;
+    struct ctrees_cache_file_header header;
+    memset(&header, 0, sizeof(header));
+    if(hash_file_header_ctrees(source_file, &header.header_hash) != EXIT_SUCCESS || stat(source_file, &st) != 0) {
+        fprintf(stderr,"Error: Could not stat/read the header of the file `%s'\n", source_file);
+        free_tree_index_ctrees(&local_index);
+        return EXIT_FAILURE;
+    }
+    header.version = PARSE_CTREES_COLUMNAR_CACHE_VERSION;
+    header.source_size = st.st_size;
+    header.source_mtime_sec = st.st_mtim.tv_sec;
+    header.source_mtime_nsec = st.st_mtim.tv_nsec;
+    header.filter_hash = hash_filters_ctrees(column_info);
+    header.ncols = column_info->ncols;
+    header.ntrees = index->ntrees;
+
+    struct ctrees_mmap_file mfile;
+    int status = open_mmap_file_ctrees(source_file, &mfile);
+    if(status != EXIT_SUCCESS) {
+        free_tree_index_ctrees(&local_index);
+        return status;
+    }
+    struct ctrees_batch batch;
+    status = init_batch_ctrees(&batch, column_info, 65536);
+    struct ctrees_cache_column *columns = calloc(header.ncols + 1, sizeof(*columns));
+    struct ctrees_cache_tree *trees = calloc(header.ntrees + 1, sizeof(*trees));
+    if(columns == NULL || trees == NULL) {
+        fprintf(stderr,"Error: Could not allocate memory for the columnar cache of %"PRId64" trees\n", header.ntrees);
+        status = EXIT_FAILURE;
+    }
+    if(status == EXIT_SUCCESS) {
+        status = fill_columnar_cache_ctrees(cache_file, column_info, index, &mfile, &batch, &header, columns, trees);
+    }
+
+    free(columns);
+    free(trees);
+    free_batch_ctrees(&batch);
+    close_mmap_file_ctrees(&mfile);
+    free_tree_index_ctrees(&local_index);
+    return status;
+}
+
+
+static inline int close_columnar_cache_ctrees(struct ctrees_columnar_cache *cache)
+{
+    cache->header = NULL;
+    cache->columns = NULL;
+    cache->trees = NULL;
+    return close_mmap_file_ctrees(&(cache->mfile));
+}
+
+
+/* Memory-maps the columnar ``cache_file`` built from ``source_file``. Returns EXIT_FAILURE (without any
+   error messages) if the ``cache_file`` does not exist, or if it is stale (see `struct ctrees_cache_file_header`) */
+static inline int open_columnar_cache_ctrees(const char *cache_file, const char *source_file, struct ctrees_columnar_cache *cache)
+{
+    memset(cache, 0, sizeof(*cache));
+    cache->mfile.fd = -1;
+    struct stat st;
+    uint64_t header_hash = 0;
+    if(stat(cache_file, &st) != 0) {
+        return EXIT_FAILURE;
+    }
+    if(stat(source_file, &st) != 0 || hash_file_header_ctrees(source_file, &header_hash) != EXIT_SUCCESS) {
+        fprintf(stderr,"Error: Could not stat/read the header of the file `%s'\n", source_file);
+        return EXIT_FAILURE;
+    }
+    int status = open_mmap_file_ctrees(cache_file, &(cache->mfile));
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+
+    const struct ctrees_cache_file_header *header = (const struct ctrees_cache_file_header *) cache->mfile.data;
+    if(cache->mfile.size < sizeof(*header) || memcmp(header->magic, PARSE_CTREES_COLUMNAR_CACHE_MAGIC, sizeof(header->magic)) != 0 ||
+       header->version != PARSE_CTREES_COLUMNAR_CACHE_VERSION || header->ncols < 0 || header->ntrees < 0 ||
+       sizeof(*header) + header->ncols * sizeof(*(cache->columns)) + header->ntrees * sizeof(*(cache->trees)) > cache->mfile.size) {
+        PARSE_CTREES_LOG(PARSE_CTREES_LOG_WARNING, "Warning: File `%s' is not a valid columnar cache (or was written by a different version)\n", cache_file);
+        close_columnar_cache_ctrees(cache);
+        return EXIT_FAILURE;
+    }
+    if(header->source_size != (int64_t) st.st_size || header->source_mtime_sec != (int64_t) st.st_mtim.tv_sec ||
+       header->source_mtime_nsec != (int64_t) st.st_mtim.tv_nsec || header->header_hash != header_hash) {
+        /* stale cache */
+        close_columnar_cache_ctrees(cache);
+        return EXIT_FAILURE;
+    }
+    cache->header = header;
+    cache->columns = (const struct ctrees_cache_column *) (cache->mfile.data + sizeof(*header));
+    cache->trees = (const struct ctrees_cache_tree *) (cache->columns + header->ncols);
+    for(int64_t i=0;i<header->ncols;i++) {
+        if(cache->columns[i].data_offset < 0 ||
+           (size_t) (cache->columns[i].data_offset + header->nrows * cache->columns[i].element_size) > cache->mfile.size) {
+            PARSE_CTREES_LOG(PARSE_CTREES_LOG_WARNING, "Warning: File `%s' is truncated (column # %"PRId64" extends beyond the end of the file)\n", cache_file, i);
+            close_columnar_cache_ctrees(cache);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+
+/* Returns the index (within ``cache->columns``) of the column with the same column number and type
+   (and quantization range) as the column ``icol`` in ``column_info``, or -1 if the cache does not contain that column */
+static inline int64_t find_cache_column_ctrees(const struct ctrees_columnar_cache *cache, const struct ctrees_column_to_ptr *column_info, const int64_t icol)
+{
+    const enum parse_numeric_types type = column_info->field_types[icol];
+    const int is_quantized = (type == Q16 || type == Q32);
+    for(int64_t j=0;j<cache->header->ncols;j++) {
+        if(cache->columns[j].column_number == column_info->column_number[icol] &&
+           cache->columns[j].field_type == (int64_t) type &&
+           (!is_quantized || (cache->columns[j].quant_lo == column_info->quant_lo[icol] &&
+                              cache->columns[j].quant_hi == column_info->quant_hi[icol]))) {
+            return j;
+        }
+    }
+    return -1;
+}
+
+
+/* Returns 1 if every column (and the row filters) in ``column_info`` can be served from the ``cache`` */
+static inline int columnar_cache_has_columns_ctrees(const struct ctrees_columnar_cache *cache, const struct ctrees_column_to_ptr *column_info)
+{
+    if(cache->header == NULL || cache->header->filter_hash != hash_filters_ctrees(column_info)) {
+        return 0;
+    }
+    for(int64_t i=0;i<column_info->ncols;i++) {
+        if(find_cache_column_ctrees(cache, column_info, i) < 0) return 0;
+    }
+    return 1;
+}
+
+
+/* Same as `read_single_tree_cache_ctrees` but the base pointers are (re-)allocated with ``alloc_context`` */
+static inline int read_single_tree_cache_alloc_ctrees(const struct ctrees_columnar_cache *cache, const off_t offset, const struct ctrees_column_to_ptr *column_info,
+                                                      struct base_ptr_info *base_ptr_info, struct ctrees_alloc_context *alloc_context)
+{
+    PARSE_CTREES_XASSERT(cache->header != NULL,
+                         EXIT_FAILURE,
+                         "Error: The columnar cache has not been opened. Please call `open_columnar_cache_ctrees` first\n");
+    if(cache->header->filter_hash != hash_filters_ctrees(column_info)) {
+        fprintf(stderr,"Error: The columnar cache was built with a different set of row filters\n");
+        return EXIT_FAILURE;
+    }
+
+    /* the trees are sorted by offset */
+    const struct ctrees_cache_tree *tree = NULL;
+    int64_t lo = 0, hi = cache->header->ntrees - 1;
+    while(lo <= hi) {
+        const int64_t mid = lo + (hi - lo)/2;
+        const struct ctrees_cache_tree *this = &(cache->trees[mid]);
+        if(this->offset == (int64_t) offset || this->data_offset == (int64_t) offset) {
+            tree = this;
+            break;
+        }
+        if(this->offset < (int64_t) offset) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    if(tree == NULL) {
+        fprintf(stderr,"Error: Could not locate a tree at offset = %"PRId64" in the columnar cache\n", (int64_t) offset);
+        return EXIT_FAILURE;
+    }
+
+    struct ctrees_column_plan plan;
+    int status = compile_column_plan_ctrees(column_info, base_ptr_info, &plan);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    for(int64_t i=0;i<column_info->ncols;i++) {
+        if(find_cache_column_ctrees(cache, column_info, i) < 0) {
+            fprintf(stderr,"Error: Column number = %d (with type = %d) is not present in the columnar cache\n",
+                    column_info->column_number[i], column_info->field_types[i]);
+            free_column_plan_ctrees(&plan);
+            return EXIT_FAILURE;
+        }
+    }
+
+    status = reserve_base_ptrs_alloc_ctrees(base_ptr_info, alloc_context, base_ptr_info->N + tree->nrows);
+    if(status != EXIT_SUCCESS) {
+        free_column_plan_ctrees(&plan);
+        return status;
+    }
+    for(int64_t i=0;i<column_info->ncols;i++) {
+        const struct ctrees_cache_column *column = &(cache->columns[find_cache_column_ctrees(cache, column_info, i)]);
+        const size_t element_size = column->element_size;
+        const char *src = cache->mfile.data + column->data_offset + tree->row_start * element_size;
+        char *dest = *((char **) plan.dest_base_ptr[i]) + base_ptr_info->N * plan.dest_stride[i] + plan.dest_offset[i];
+        if(plan.dest_stride[i] == element_size) {
+            memcpy(dest, src, tree->nrows * element_size);
+        } else {
+            for(int64_t j=0;j<tree->nrows;j++) {
+                memcpy(dest + j * plan.dest_stride[i], src + j * element_size, element_size);
+            }
+        }
+    }
+    base_ptr_info->N += tree->nrows;
+    free_column_plan_ctrees(&plan);
+
+    return EXIT_SUCCESS;
+}
+
+/* Same as `read_single_tree_ctrees` but copies the (already parsed) halos from the columnar ``cache``.
+   The tree is located by the ``offset`` within the source file (either the offset of the `#tree` line, as in
+   the tree index, or of the first halo). The requested columns must all be present in the cache, with the same types */
+static inline int read_single_tree_cache_ctrees(const struct ctrees_columnar_cache *cache, const off_t offset, const struct ctrees_column_to_ptr *column_info,
+                                                struct base_ptr_info *base_ptr_info)
+{
+    return read_single_tree_cache_alloc_ctrees(cache, offset, column_info, base_ptr_info, NULL);
+}
+
+
+/* Opens the columnar ``cache_file`` for ``source_file`` if that exists, is up-to-date and contains all the columns in
+   ``column_info``. Otherwise, the cache is (re-)built first (see `write_columnar_cache_ctrees`), i.e., the ASCII
+   parsing is only ever done once */
+static inline int load_or_build_columnar_cache_ctrees(const char *source_file, const char *cache_file, const struct ctrees_column_to_ptr *column_info,
+                                                      const struct ctrees_tree_index *index, struct ctrees_columnar_cache *cache)
+{
+    if(open_columnar_cache_ctrees(cache_file, source_file, cache) == EXIT_SUCCESS) {
+        if(columnar_cache_has_columns_ctrees(cache, column_info)) {
+            return EXIT_SUCCESS;
+        }
+        close_columnar_cache_ctrees(cache);
+    }
+    int status = write_columnar_cache_ctrees(cache_file, source_file, column_info, index);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    return open_columnar_cache_ctrees(cache_file, source_file, cache);
+}
+
+
+/* magic bytes and version at the beginning of the binary forest file written by `struct ctrees_forest_writer` */
+#define PARSE_CTREES_FOREST_FILE_MAGIC    "CTFOREST"
+#define PARSE_CTREES_FOREST_FILE_VERSION  2
+
+/* Returns the offset (in bytes, from chunk->data_offset) of the column ``icol`` within the ``chunk`` */
+static inline int64_t get_forest_column_offset_ctrees(const struct ctrees_forest_column *columns, const int64_t icol, const int64_t nrows)
+{
+    int64_t offset = 0;
+    for(int64_t i=0;i<icol;i++) {
+        offset += (nrows * columns[i].element_size + 63) & ~((int64_t) 63);
+    }
+    return offset;
+}
+
+#ifdef PARSE_CTREES_USE_HDF5
+/* The HDF5 (memory and file) type for the values of ``type``. The half-precision and the fixed-point
+   values are stored as their raw bits (with the `field_type` and the quantization range as attributes) */
+static inline hid_t get_hdf5_type_ctrees(const enum parse_numeric_types type)
+{
+    switch(type) {
+    case I32: return H5T_NATIVE_INT32;
+    case I64: return H5T_NATIVE_INT64;
+    case U32: return H5T_NATIVE_UINT32;
+    case U64: return H5T_NATIVE_UINT64;
+    case F32: return H5T_NATIVE_FLOAT;
+    case F64: return H5T_NATIVE_DOUBLE;
+    case I8: return H5T_NATIVE_INT8;
+    case I16: return H5T_NATIVE_INT16;
+    case U8: return H5T_NATIVE_UINT8;
+    case U16: return H5T_NATIVE_UINT16;
+    case BOOL: return H5T_NATIVE_UINT8;
+    case F16: return H5T_NATIVE_UINT16;
+    case Q16: return H5T_NATIVE_UINT16;
+    case Q32: return H5T_NATIVE_UINT32;
+    default: return -1;
+    }
+}
+
+static inline int write_hdf5_attribute_ctrees(const hid_t object, const char *name, const hid_t type, const void *value)
+{
+    const hid_t space = H5Screate(H5S_SCALAR);
+    const hid_t attr = (space < 0) ? -1 : H5Acreate2(object, name, type, space, H5P_DEFAULT, H5P_DEFAULT);
+    const herr_t err = (attr < 0) ? -1 : H5Awrite(attr, type, value);
+    if(attr >= 0) H5Aclose(attr);
+    if(space >= 0) H5Sclose(space);
+    if(err < 0) {
+        fprintf(stderr,"Error: Could not write the HDF5 attribute `%s'\n", name);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/* Writes the ``n`` values in ``data`` as the (1-D) dataset ``name`` within ``group`` */
+static inline int write_hdf5_dataset_ctrees(const hid_t group, const char *name, const hid_t type, const int64_t n, const void *data)
+{
+    const hsize_t dims[1] = {(hsize_t) n};
+    const hid_t space = H5Screate_simple(1, dims, NULL);
+    const hid_t dataset = (space < 0) ? -1 : H5Dcreate2(group, name, type, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    const herr_t err = (dataset < 0) ? -1 : ((n > 0) ? H5Dwrite(dataset, type, H5S_ALL, H5S_ALL, H5P_DEFAULT, data) : 0);
+    if(dataset >= 0) H5Dclose(dataset);
+    if(space >= 0) H5Sclose(space);
+    if(err < 0) {
+        fprintf(stderr,"Error: Could not write the HDF5 dataset `%s'\n", name);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+#endif /* PARSE_CTREES_USE_HDF5 */
+
+
+/* Writes the batch held in ``slot`` into the output. Called by the writer thread (if any), otherwise by the parser */
+static inline int write_forest_slot_ctrees(struct ctrees_forest_writer *writer, const struct ctrees_forest_slot *slot)
+{
+    if(writer->format == PARSE_CTREES_FOREST_BINARY) {
+        size_t nwritten = 0;
+        while(nwritten < slot->nbytes) {
+            ssize_t n = pwrite(writer->fd, slot->data + nwritten, slot->nbytes - nwritten, slot->chunk.data_offset + nwritten);
+            if(n <= 0) {
+                fprintf(stderr,"Error: Could not write %zu bytes into `%s'\n", slot->nbytes - nwritten, writer->filename);
+                perror(NULL);
+                return EXIT_FAILURE;
+            }
+            nwritten += n;
+        }
+        return EXIT_SUCCESS;
+    }
+
+#ifdef PARSE_CTREES_USE_HDF5
+    /* append the rows to every (extendible) dataset */
+    const hsize_t start[1] = {(hsize_t) slot->chunk.row_start}, count[1] = {(hsize_t) slot->chunk.nrows};
+    const hsize_t new_dims[1] = {(hsize_t) (slot->chunk.row_start + slot->chunk.nrows)};
+    for(int64_t i=0;i<writer->ncols;i++) {
+        const hid_t type = get_hdf5_type_ctrees((enum parse_numeric_types) writer->columns[i].field_type);
+        const char *data = slot->data + get_forest_column_offset_ctrees(writer->columns, i, slot->chunk.nrows);
+        herr_t err = H5Dset_extent(writer->h5_datasets[i], new_dims);
+        const hid_t filespace = (err < 0) ? -1 : H5Dget_space(writer->h5_datasets[i]);
+        const hid_t memspace = H5Screate_simple(1, count, NULL);
+        if(filespace < 0 || memspace < 0 || H5Sselect_hyperslab(filespace, H5S_SELECT_SET, start, NULL, count, NULL) < 0) {
+            err = -1;
+        } else {
+            err = H5Dwrite(writer->h5_datasets[i], type, memspace, filespace, H5P_DEFAULT, data);
+        }
+        if(filespace >= 0) H5Sclose(filespace);
+        if(memspace >= 0) H5Sclose(memspace);
+        if(err < 0) {
+            fprintf(stderr,"Error: Could not write %"PRId64" rows of the column `%s' into `%s'\n",
+                    slot->chunk.nrows, writer->columns[i].name, writer->filename);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+#else
+    fprintf(stderr,"Error: Writing HDF5 requires the macro variable `PARSE_CTREES_USE_HDF5' to be defined\n");
+    return EXIT_FAILURE;
+#endif
+}
+
+#ifdef PARSE_CTREES_USE_PTHREADS
+/* The main loop of the writer thread -- writes the queued batches in the order they were queued */
+static inline void *forest_writer_thread_ctrees(void *arg)
+{
+    struct ctrees_forest_writer *writer = (struct ctrees_forest_writer *) arg;
+    pthread_mutex_lock(&(writer->lock));
+    while(1) {
+        struct ctrees_forest_slot *slot = &(writer->slots[writer->next_write_slot]);
+        if(slot->state != 1) {
+            /* nothing queued -> done only once the parser has stopped */
+            if(writer->stop) break;
+            pthread_cond_wait(&(writer->cond), &(writer->lock));
+            continue;
+        }
+        slot->state = 2;
+        const int io_error = writer->io_error;
+        pthread_mutex_unlock(&(writer->lock));
+
+        /* after an error, the rest of the batches are only discarded */
+        const int status = io_error ? EXIT_FAILURE : write_forest_slot_ctrees(writer, slot);
+
+        pthread_mutex_lock(&(writer->lock));
+        writer->io_error |= (status != EXIT_SUCCESS);
+        slot->state = 0;
+        writer->next_write_slot = (writer->next_write_slot + 1) % writer->nslots;
+        pthread_cond_broadcast(&(writer->cond));
+    }
+    pthread_mutex_unlock(&(writer->lock));
+    return NULL;
+}
+#endif /* PARSE_CTREES_USE_PTHREADS */
+
+
+static inline void free_forest_writer_ctrees(struct ctrees_forest_writer *writer)
+{
+    for(int i=0;i<PARSE_CTREES_FOREST_MAX_NSLOTS;i++) {
+        free(writer->slots[i].data);
+        writer->slots[i].data = NULL;
+    }
+    free(writer->trees);
+    free(writer->chunks);
+    writer->trees = NULL;
+    writer->chunks = NULL;
+    writer->ntrees = writer->ntrees_allocated = 0;
+    writer->nchunks = writer->nchunks_allocated = 0;
+    writer->nslots = 0;
+}
+
+/* Creates the output ``filename`` (in the ``format``, see `enum parse_ctrees_forest_formats`) for the columns in
+   ``column_info``, written in chunks of (at most) ``batch_rows`` rows. The datasets (HDF5), and the column names
+   stored in the binary file, are named after ``column_names`` (in the same order as the columns in ``column_info``,
+   may be NULL for `column_<column number>`).
+
+   With PARSE_CTREES_USE_PTHREADS, up to ``nslots`` batches (0 for the default of 2) are queued for the writer thread.
+   Otherwise, every batch is written before the parsing resumes */
+static inline int init_forest_writer_ctrees(struct ctrees_forest_writer *writer, const char *filename, const int format,
+                                            const struct ctrees_column_to_ptr *column_info, const char (*column_names)[PARSE_CTREES_MAX_COLNAME_LEN],
+                                            const int64_t batch_rows, const int nslots)
+{
+    memset(writer, 0, sizeof(*writer));
+    writer->fd = -1;
+    writer->format = format;
+    if(format < 0 || format >= num_forest_formats) {
+        fprintf(stderr,"Error: Unknown output format = %d\n", format);
+        return EXIT_FAILURE;
+    }
+#ifndef PARSE_CTREES_USE_HDF5
+    if(format == PARSE_CTREES_FOREST_HDF5) {
+        fprintf(stderr,"Error: Writing HDF5 requires the macro variable `PARSE_CTREES_USE_HDF5' to be defined (before including the file `%s')\n",
+                __FILE__);
+        return EXIT_FAILURE;
+    }
+#endif
+    if(batch_rows <= 0 || column_info->ncols <= 0 || column_info->ncols > PARSE_CTREES_MAX_NCOLS) {
+        fprintf(stderr,"Error: Need a positive number of rows per batch (got %"PRId64") and between 1 and %d columns (got %"PRId64")\n",
+                batch_rows, PARSE_CTREES_MAX_NCOLS, column_info->ncols);
+        return EXIT_FAILURE;
+    }
+    if(strlen(filename) >= PARSE_CTREES_MAX_FILENAME_LEN) {
+        fprintf(stderr,"Error: The filename `%s' is too long. Please define the macro variable `PARSE_CTREES_MAX_FILENAME_LEN' "
+                "to be larger than %d\n", filename, PARSE_CTREES_MAX_FILENAME_LEN);
+        return EXIT_FAILURE;
+    }
+    strcpy(writer->filename, filename);
+
+    writer->ncols = column_info->ncols;
+    writer->batch_rows = batch_rows;
+    for(int64_t i=0;i<writer->ncols;i++) {
+        struct ctrees_forest_column *column = &(writer->columns[i]);
+        const enum parse_numeric_types type = column_info->field_types[i];
+        const int is_quantized = (type == Q16 || type == Q32);
+        column->column_number = column_info->column_number[i];
+        column->field_type = type;
+        column->element_size = size_of_numeric_type_ctrees(type);
+        column->quant_lo = is_quantized ? column_info->quant_lo[i]:0.0;
+        column->quant_hi = is_quantized ? column_info->quant_hi[i]:0.0;
+        if(column_names != NULL) {
+            snprintf(column->name, sizeof(column->name), "%s", column_names[i]);
+        } else {
+            snprintf(column->name, sizeof(column->name), "column_%d", column_info->column_number[i]);
+        }
+        /* the same column may be requested more than once (e.g., with different types) -> the names must be unique */
+        for(int64_t j=0;j<i;j++) {
+            if(strcmp(writer->columns[j].name, column->name) == 0) {
+                char name[PARSE_CTREES_MAX_COLNAME_LEN];
+                snprintf(name, sizeof(name), "%.*s_%"PRId64, PARSE_CTREES_MAX_COLNAME_LEN - 24, column->name, i);
+                memcpy(column->name, name, sizeof(name));
+                break;
+            }
+        }
+        writer->slot_nbytes += (batch_rows * column->element_size + 63) & ~((int64_t) 63);
+    }
+
+#ifdef PARSE_CTREES_USE_PTHREADS
+    writer->nslots = (nslots <= 0) ? 2:nslots;
+    writer->use_thread = 1;
+#else
+    (void) nslots;
+    writer->nslots = 1;
+#endif
+    if(writer->nslots > PARSE_CTREES_FOREST_MAX_NSLOTS) {
+        fprintf(stderr,"Error: Requested %d slots but there is only space for %d. Please define the macro variable "
+                "`PARSE_CTREES_FOREST_MAX_NSLOTS' to be larger (before including the file `%s')\n",
+                writer->nslots, PARSE_CTREES_FOREST_MAX_NSLOTS, __FILE__);
+        return EXIT_FAILURE;
+    }
+    for(int i=0;i<writer->nslots;i++) {
+        writer->slots[i].data = malloc(writer->slot_nbytes);
+        if(writer->slots[i].data == NULL) {
+            fprintf(stderr,"Error: Could not allocate memory for the output batches (requested %zu bytes)\n", writer->slot_nbytes);
+            perror(NULL);
+            free_forest_writer_ctrees(writer);
+            return EXIT_FAILURE;
+        }
+    }
+
+    int status = EXIT_SUCCESS;
+    if(format == PARSE_CTREES_FOREST_BINARY) {
+        writer->fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(writer->fd < 0) {
+            fprintf(stderr,"Error: Could not open file `%s' for writing\n", filename);
+            perror(NULL);
+            status = EXIT_FAILURE;
+        }
+        /* the header is only written by `close_forest_writer_ctrees` */
+        writer->file_offset = 64;
+    }
+#ifdef PARSE_CTREES_USE_HDF5
+    for(int64_t i=0;i<PARSE_CTREES_MAX_NCOLS;i++) {
+        writer->h5_datasets[i] = -1;
+    }
+    writer->h5_file = -1;
+    if(format == PARSE_CTREES_FOREST_HDF5) {
+        writer->h5_file = H5Fcreate(filename, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+        if(writer->h5_file < 0) {
+            fprintf(stderr,"Error: Could not create the HDF5 file `%s'\n", filename);
+            status = EXIT_FAILURE;
+        }
+        /* every dataset starts empty, grows (without limit) in chunks of one batch */
+        const hsize_t dims[1] = {0}, maxdims[1] = {H5S_UNLIMITED}, chunk_dims[1] = {(hsize_t) batch_rows};
+        for(int64_t i=0;i<writer->ncols && status == EXIT_SUCCESS;i++) {
+            const struct ctrees_forest_column *column = &(writer->columns[i]);
+            const hid_t type = get_hdf5_type_ctrees((enum parse_numeric_types) column->field_type);
+            const hid_t space = H5Screate_simple(1, dims, maxdims);
+            const hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+            if(space >= 0 && dcpl >= 0 && H5Pset_chunk(dcpl, 1, chunk_dims) >= 0) {
+                writer->h5_datasets[i] = H5Dcreate2(writer->h5_file, column->name, type, space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+            }
+            if(dcpl >= 0) H5Pclose(dcpl);
+            if(space >= 0) H5Sclose(space);
+            if(writer->h5_datasets[i] < 0) {
+                fprintf(stderr,"Error: Could not create the HDF5 dataset `%s' in `%s'\n", column->name, filename);
+                status = EXIT_FAILURE;
+                break;
+            }
+            status = write_hdf5_attribute_ctrees(writer->h5_datasets[i], "column_number", H5T_NATIVE_INT64, &(column->column_number));
+            if(status == EXIT_SUCCESS) {
+                status = write_hdf5_attribute_ctrees(writer->h5_datasets[i], "field_type", H5T_NATIVE_INT64, &(column->field_type));
+            }
+            if(status == EXIT_SUCCESS && (column->field_type == Q16 || column->field_type == Q32)) {
+                status = write_hdf5_attribute_ctrees(writer->h5_datasets[i], "quant_lo", H5T_NATIVE_DOUBLE, &(column->quant_lo));
+                if(status == EXIT_SUCCESS) {
+                    status = write_hdf5_attribute_ctrees(writer->h5_datasets[i], "quant_hi", H5T_NATIVE_DOUBLE, &(column->quant_hi));
+                }
+            }
+        }
+    }
+#endif
+
+#ifdef PARSE_CTREES_USE_PTHREADS
+    if(status == EXIT_SUCCESS) {
+        pthread_mutex_init(&(writer->lock), NULL);
+        pthread_cond_init(&(writer->cond), NULL);
+        if(pthread_create(&(writer->thread), NULL, forest_writer_thread_ctrees, writer) != 0) {
+            fprintf(stderr,"Error: Could not create the writer thread\n");
+            pthread_mutex_destroy(&(writer->lock));
+            pthread_cond_destroy(&(writer->cond));
+            writer->use_thread = 0;
+            status = EXIT_FAILURE;
+        }
+    } else {
+        writer->use_thread = 0;
+    }
+#endif
+    if(status != EXIT_SUCCESS) {
+        if(writer->fd >= 0) close(writer->fd);
+#ifdef PARSE_CTREES_USE_HDF5
+        for(int64_t i=0;i<writer->ncols;i++) {
+            if(writer->h5_datasets[i] >= 0) H5Dclose(writer->h5_datasets[i]);
+        }
+        if(writer->h5_file >= 0) H5Fclose(writer->h5_file);
+#endif
+        unlink(filename);
+        free_forest_writer_ctrees(writer);
+    }
+    return status;
+}
+
+
+/* Starts a new tree in the output. All the batches passed to `write_batch_to_forest_ctrees` (until the next call)
+   belong to this tree */
+static inline int begin_forest_tree_ctrees(struct ctrees_forest_writer *writer, const int64_t tree_id, const int64_t forest_id)
+{
+    if(writer->ntrees == writer->ntrees_allocated) {
+        const int64_t new_N = (writer->ntrees_allocated < 1024) ? 1024 : 2*writer->ntrees_allocated;
+        struct ctrees_forest_tree *tmp = realloc(writer->trees, new_N * sizeof(*tmp));
+        if(tmp == NULL) {
+            fprintf(stderr,"Error: Could not allocate memory for %"PRId64" trees in the output\n", new_N);
+            return EXIT_FAILURE;
+        }
+        writer->trees = tmp;
+        writer->ntrees_allocated = new_N;
+    }
+    struct ctrees_forest_tree *tree = &(writer->trees[writer->ntrees]);
+    tree->tree_id = tree_id;
+    tree->forest_id = forest_id;
+    tree->row_start = writer->nrows;
+    tree->nrows = 0;
+    tree->first_chunk = writer->nchunks;
+    tree->nchunks = 0;
+    writer->ntrees++;
+    return EXIT_SUCCESS;
+}
+
+
+/* Queues the chunk being filled (in ``writer->slots[writer->next_slot]``) to be written, after packing its columns
+   from ``batch_rows`` to ``nrows`` rows apart. Does nothing if the chunk is empty */
+static inline int flush_forest_chunk_ctrees(struct ctrees_forest_writer *writer)
+{
+    struct ctrees_forest_chunk *chunk = &(writer->pending_chunk);
+    if(chunk->nrows == 0) {
+        return EXIT_SUCCESS;
+    }
+    if(writer->nchunks == writer->nchunks_allocated) {
+        const int64_t new_N = (writer->nchunks_allocated < 1024) ? 1024 : 2*writer->nchunks_allocated;
+        struct ctrees_forest_chunk *tmp = realloc(writer->chunks, new_N * sizeof(*tmp));
+        if(tmp == NULL) {
+            fprintf(stderr,"Error: Could not allocate memory for %"PRId64" chunks in the output\n", new_N);
+            return EXIT_FAILURE;
+        }
+        writer->chunks = tmp;
+        writer->nchunks_allocated = new_N;
+    }
+
+    /* every column only moves towards the beginning of the slot, and its padding ends before the next column */
+    struct ctrees_forest_slot *slot = &(writer->slots[writer->next_slot]);
+    size_t nbytes = 0;
+    for(int64_t i=0;i<writer->ncols;i++) {
+        const size_t column_nbytes = chunk->nrows * writer->columns[i].element_size;
+        const size_t padded_nbytes = (column_nbytes + 63) & ~((size_t) 63);
+        memmove(slot->data + nbytes, slot->data + get_forest_column_offset_ctrees(writer->columns, i, writer->batch_rows), column_nbytes);
+        memset(slot->data + nbytes + column_nbytes, 0, padded_nbytes - column_nbytes);
+        nbytes += padded_nbytes;
+    }
+    chunk->data_offset = writer->file_offset;
+    slot->nbytes = nbytes;
+    slot->chunk = *chunk;
+    writer->chunks[writer->nchunks] = *chunk;
+    writer->nchunks++;
+    writer->file_offset += nbytes;
+    writer->next_slot = (writer->next_slot + 1) % writer->nslots;
+    memset(chunk, 0, sizeof(*chunk));
+
+#ifdef PARSE_CTREES_USE_PTHREADS
+    if(writer->use_thread) {
+        pthread_mutex_lock(&(writer->lock));
+        slot->state = 1;
+        pthread_cond_broadcast(&(writer->cond));
+        pthread_mutex_unlock(&(writer->lock));
+        return EXIT_SUCCESS;
+    }
+#endif
+    const int status = write_forest_slot_ctrees(writer, slot);
+    writer->io_error |= (status != EXIT_SUCCESS);
+    return status;
+}
+
+
+/* The batch callback (see `ctrees_batch_callback_fn`) that writes the ``batch`` into the output of the writer
+   (``userdata`` must point to a `struct ctrees_forest_writer`). The batch is appended to the chunk being filled (after
+   the chunk with the previous batches has been queued, if the batch would not fit), i.e., the batch can then be re-used
+   for parsing immediately. A full chunk is queued for the writer thread straight away */
+static inline int write_batch_to_forest_ctrees(const struct ctrees_batch *batch, void *userdata)
+{
+    struct ctrees_forest_writer *writer = (struct ctrees_forest_writer *) userdata;
+    if(writer->ntrees == 0 || batch->ncols != writer->ncols || batch->nrows > writer->batch_rows) {
+        fprintf(stderr,"Error: The batch (with %"PRId64" columns) does not match the writer (%"PRId64" columns), or "
+                "`begin_forest_tree_ctrees' was not called before the first batch (%"PRId64" trees)\n",
+                batch->ncols, writer->ncols, writer->ntrees);
+        return EXIT_FAILURE;
+    }
+    struct ctrees_forest_chunk *chunk = &(writer->pending_chunk);
+    if(chunk->nrows + batch->nrows > writer->batch_rows) {
+        const int status = flush_forest_chunk_ctrees(writer);
+        if(status != EXIT_SUCCESS) {
+            return status;
+        }
+    }
+
+    struct ctrees_forest_slot *slot = &(writer->slots[writer->next_slot]);
+    const int64_t itree = writer->ntrees - 1;
+    if(chunk->nrows == 0) {
+#ifdef PARSE_CTREES_USE_PTHREADS
+        if(writer->use_thread) {
+            pthread_mutex_lock(&(writer->lock));
+            if(slot->state != 0) writer->nwaits++;
+            while(slot->state != 0 && writer->io_error == 0) {
+                pthread_cond_wait(&(writer->cond), &(writer->lock));
+            }
+            const int io_error = writer->io_error;
+            pthread_mutex_unlock(&(writer->lock));
+            if(io_error) {
+                return EXIT_FAILURE;
+            }
+        }
+#endif
+        /* the slot is now owned by the parser until the chunk is queued */
+        chunk->first_tree = itree;
+        chunk->row_start = writer->nrows;
+    }
+
+    for(int64_t i=0;i<writer->ncols;i++) {
+        const size_t element_size = writer->columns[i].element_size;
+        char *dest = slot->data + get_forest_column_offset_ctrees(writer->columns, i, writer->batch_rows) + chunk->nrows * element_size;
+        memcpy(dest, batch->columns[i], batch->nrows * element_size);
+    }
+
+    /* the chunk being filled gets the index writer->nchunks once it is queued */
+    struct ctrees_forest_tree *tree = &(writer->trees[itree]);
+    if(tree->nchunks == 0) {
+        tree->first_chunk = writer->nchunks;
+    }
+    tree->nchunks = writer->nchunks - tree->first_chunk + 1;
+    tree->nrows += batch->nrows;
+    chunk->ntrees = itree - chunk->first_tree + 1;
+    chunk->nrows += batch->nrows;
+    writer->nrows += batch->nrows;
+
+    return (chunk->nrows == writer->batch_rows) ? flush_forest_chunk_ctrees(writer) : EXIT_SUCCESS;
+}
+
+
+/* Queues the last (partially filled) chunk, waits for all the queued chunks to be written, writes the table of the trees
+   and the chunks (and, for the binary format, the header) and closes the output. If ``status`` (i.e., of the conversion
+   so far) is not EXIT_SUCCESS, or if anything could not be written, then the output file is removed. The writer is freed
+   in either case */
+static inline int close_forest_writer_ctrees(struct ctrees_forest_writer *writer, int status)
+{
+    if(status == EXIT_SUCCESS) {
+        status = flush_forest_chunk_ctrees(writer);
+    }
+#ifdef PARSE_CTREES_USE_PTHREADS
+    if(writer->use_thread) {
+        pthread_mutex_lock(&(writer->lock));
+        writer->stop = 1;
+        pthread_cond_broadcast(&(writer->cond));
+        pthread_mutex_unlock(&(writer->lock));
+        pthread_join(writer->thread, NULL);
+        pthread_mutex_destroy(&(writer->lock));
+        pthread_cond_destroy(&(writer->cond));
+        writer->use_thread = 0;
+    }
+#endif
+    if(writer->io_error) {
+        status = EXIT_FAILURE;
+    }
+
+    if(writer->format == PARSE_CTREES_FOREST_BINARY && writer->fd >= 0) {
+        if(status == EXIT_SUCCESS) {
+            struct ctrees_forest_file_header header;
+            memset(&header, 0, sizeof(header));
+            memcpy(header.magic, PARSE_CTREES_FOREST_FILE_MAGIC, sizeof(header.magic));
+            header.version = PARSE_CTREES_FOREST_FILE_VERSION;
+            header.ncols = writer->ncols;
+            header.ntrees = writer->ntrees;
+            header.nchunks = writer->nchunks;
+            header.nrows = writer->nrows;
+            header.footer_offset = writer->file_offset;
+            const size_t columns_nbytes = header.ncols * sizeof(*(writer->columns));
+            const size_t trees_nbytes = header.ntrees * sizeof(*(writer->trees));
+            const size_t chunks_nbytes = header.nchunks * sizeof(*(writer->chunks));
+            const off_t footer_offset = header.footer_offset;
+            if(pwrite(writer->fd, writer->columns, columns_nbytes, footer_offset) != (ssize_t) columns_nbytes ||
+               (trees_nbytes > 0 && pwrite(writer->fd, writer->trees, trees_nbytes, footer_offset + columns_nbytes) != (ssize_t) trees_nbytes) ||
+               (chunks_nbytes > 0 && pwrite(writer->fd, writer->chunks, chunks_nbytes, footer_offset + columns_nbytes + trees_nbytes) != (ssize_t) chunks_nbytes) ||
+               pwrite(writer->fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header)) {
+                fprintf(stderr,"Error: Could not write the tables of the trees and the chunks into `%s'\n", writer->filename);
+                perror(NULL);
+                status = EXIT_FAILURE;
+            }
+        }
+        if(close(writer->fd) != 0) {
+            perror(NULL);
+            status = EXIT_FAILURE;
+        }
+        writer->fd = -1;
+    }
+
+#ifdef PARSE_CTREES_USE_HDF5
+    if(writer->format == PARSE_CTREES_FOREST_HDF5 && writer->h5_file >= 0) {
+        if(status == EXIT_SUCCESS) {
+            /* the offsets table, i.e., the rows [RowStart[i], RowStart[i] + NRows[i]) of every dataset belong to the i'th tree */
+            int64_t *values = malloc((writer->ntrees + 1) * sizeof(*values));
+            const hid_t group = H5Gcreate2(writer->h5_file, "TreeInfo", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+            if(values == NULL || group < 0) {
+                fprintf(stderr,"Error: Could not create the table of the trees in `%s'\n", writer->filename);
+                status = EXIT_FAILURE;
+            }
+            const char *names[] = {"TreeID", "ForestID", "RowStart", "NRows"};
+            for(int k=0;k<4 && status == EXIT_SUCCESS;k++) {
+                for(int64_t i=0;i<writer->ntrees;i++) {
+                    const struct ctrees_forest_tree *tree = &(writer->trees[i]);
+                    values[i] = (k == 0) ? tree->tree_id : (k == 1) ? tree->forest_id : (k == 2) ? tree->row_start : tree->nrows;
+                }
+                status = write_hdf5_dataset_ctrees(group, names[k], H5T_NATIVE_INT64, writer->ntrees, values);
+            }
+            if(group >= 0) H5Gclose(group);
+            free(values);
+        }
+        for(int64_t i=0;i<writer->ncols;i++) {
+            if(writer->h5_datasets[i] >= 0 && H5Dclose(writer->h5_datasets[i]) < 0) status = EXIT_FAILURE;
+            writer->h5_datasets[i] = -1;
+        }
+        if(H5Fclose(writer->h5_file) < 0) {
+            fprintf(stderr,"Error: Could not close the HDF5 file `%s'\n", writer->filename);
+            status = EXIT_FAILURE;
+        }
+        writer->h5_file = -1;
+    }
+#endif
+
+    if(status != EXIT_SUCCESS) {
+        unlink(writer->filename);
+    }
+    free_forest_writer_ctrees(writer);
+    return status;
+}
+
+
+/* Converts every tree in ``source_file`` (with the columns and the row filters in ``column_info``) into the output
+   ``output_file`` (in the ``format``, see `enum parse_ctrees_forest_formats`). The trees are located with ``index``
+   (if not NULL, must only contain the trees from ``source_file``), otherwise the index is built by scanning ``source_file``.
+   The columns in the output are named after the header of ``source_file``.
+
+   Every tree is streamed in batches of ``batch_rows`` rows (0 for 65536), i.e., the peak memory use is a few batches
+   (plus the read buffer of ``bufsize`` bytes, 0 for PARSE_CTREES_DEFAULT_READ_BUFSIZE), rather than the largest tree */
+static inline int write_forest_file_ctrees(const char *output_file, const int format, const char *source_file,
+                                           const struct ctrees_column_to_ptr *column_info, const struct ctrees_tree_index *index,
+                                           const int64_t batch_rows, const size_t bufsize)
+{
+    struct ctrees_tree_index local_index = {0};
+    if(index == NULL) {
+        int status = build_tree_index_ctrees(source_file, &local_index);
+        if(status != EXIT_SUCCESS) {
+            return status;
+        }
+        index = &local_index;
+    }
+    if(index->nfiles > 1) {
+        fprintf(stderr,"Error: The tree index must only contain the trees from `%s' (found %d files in the index)\n",
+                source_file, index->nfiles);
+        free_tree_index_ctrees(&local_index);
+        return EXIT_FAILURE;
+    }
+
+    /* name the output columns after the header */
+    char (*names_in_file)[PARSE_CTREES_MAX_COLNAME_LEN] = NULL;
+    int totncols = 0;
+    char (*names)[PARSE_CTREES_MAX_COLNAME_LEN] = calloc(column_info->ncols + 1, sizeof(*names));
+    int status = (names == NULL) ? EXIT_FAILURE : read_header_column_names_ctrees(source_file, &names_in_file, &totncols);
+    for(int64_t i=0;i<column_info->ncols && status == EXIT_SUCCESS;i++) {
+        const int32_t col = column_info->column_number[i];
+        if(col < 0 || col >= totncols) {
+            fprintf(stderr,"Error: Column number = %d is not in the header of `%s' (with %d columns)\n", col, source_file, totncols);
+            status = EXIT_FAILURE;
+            break;
+        }
+        memcpy(names[i], names_in_file[col], sizeof(names[i]));
+    }
+    free(names_in_file);
+
+    const int64_t nrows_per_batch = (batch_rows <= 0) ? 65536 : batch_rows;
+    struct ctrees_batch batch;
+    struct ctrees_buffered_reader reader;
+    struct ctrees_forest_writer writer;
+    memset(&batch, 0, sizeof(batch));
+    memset(&reader, 0, sizeof(reader));
+    int fd = -1;
+    int writer_is_open = 0;
+    if(status == EXIT_SUCCESS) {
+        fd = open(source_file, O_RDONLY);
+        if(fd < 0) {
+            fprintf(stderr,"Error: Could not open file `%s'\n", source_file);
+            perror(NULL);
+            status = EXIT_FAILURE;
+        }
+    }
+    if(status == EXIT_SUCCESS) {
+        status = init_batch_ctrees(&batch, column_info, nrows_per_batch);
+    }
+    if(status == EXIT_SUCCESS) {
+        status = init_buffered_reader_ctrees(&reader, bufsize);
+    }
+    if(status == EXIT_SUCCESS) {
+        status = init_forest_writer_ctrees(&writer, output_file, format, column_info, (const char (*)[PARSE_CTREES_MAX_COLNAME_LEN]) names,
+                                           nrows_per_batch, 0);
+        writer_is_open = (status == EXIT_SUCCESS);
+    }
+
+    for(int64_t i=0;i<index->ntrees && status == EXIT_SUCCESS;i++) {
+        const struct ctrees_tree_index_entry *tree = &(index->trees[i]);
+        status = begin_forest_tree_ctrees(&writer, tree->tree_id, tree->forest_id);
+        if(status == EXIT_SUCCESS) {
+            status = stream_single_tree_buffered_ctrees(fd, tree->offset, &batch, write_batch_to_forest_ctrees, &writer, &reader);
+        }
+    }
+    if(writer_is_open) {
+        status = close_forest_writer_ctrees(&writer, status);
+    }
+
+    if(fd >= 0) close(fd);
+    free_buffered_reader_ctrees(&reader);
+    free_batch_ctrees(&batch);
+    free(names);
+    free_tree_index_ctrees(&local_index);
+    return status;
+}
+
+
+static inline int close_forest_file_ctrees(struct ctrees_forest_file *forest)
+{
+    forest->header = NULL;
+    forest->columns = NULL;
+    forest->trees = NULL;
+    forest->chunks = NULL;
+    return close_mmap_file_ctrees(&(forest->mfile));
+}
+
+/* Memory-maps the binary forest file ``filename`` (written by `struct ctrees_forest_writer`). The values of the column
+   ``icol`` in the chunk ``ichunk`` are at `get_forest_column_data_ctrees` */
+static inline int open_forest_file_ctrees(const char *filename, struct ctrees_forest_file *forest)
+{
+    memset(forest, 0, sizeof(*forest));
+    int status = open_mmap_file_ctrees(filename, &(forest->mfile));
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    const struct ctrees_forest_file_header *header = (const struct ctrees_forest_file_header *) forest->mfile.data;
+    if(forest->mfile.size < sizeof(*header) || memcmp(header->magic, PARSE_CTREES_FOREST_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+       header->version != PARSE_CTREES_FOREST_FILE_VERSION || header->ncols <= 0 || header->ntrees < 0 || header->nchunks < 0 ||
+       header->footer_offset < (int64_t) sizeof(*header) ||
+       (size_t) header->footer_offset + header->ncols * sizeof(*(forest->columns)) + header->ntrees * sizeof(*(forest->trees)) +
+       header->nchunks * sizeof(*(forest->chunks)) > forest->mfile.size) {
+        fprintf(stderr,"Error: File `%s' is not a valid (or a complete) forest file\n", filename);
+        close_forest_file_ctrees(forest);
+        return EXIT_FAILURE;
+    }
+    forest->header = header;
+    forest->columns = (const struct ctrees_forest_column *) (forest->mfile.data + header->footer_offset);
+    forest->trees = (const struct ctrees_forest_tree *) (forest->columns + header->ncols);
+    forest->chunks = (const struct ctrees_forest_chunk *) (forest->trees + header->ntrees);
+    return EXIT_SUCCESS;
+}
+
+/* Returns the address of the values of the column ``icol`` in the chunk ``ichunk`` of the (open) ``forest`` */
+static inline const void *get_forest_column_data_ctrees(const struct ctrees_forest_file *forest, const int64_t ichunk, const int64_t icol)
+{
+    const struct ctrees_forest_chunk *chunk = &(forest->chunks[ichunk]);
+    return forest->mfile.data + chunk->data_offset + get_forest_column_offset_ctrees(forest->columns, icol, chunk->nrows);
+}
+
+
+/* Adds the counters in ``src`` to ``dst`` */
+static inline void add_perf_counters_ctrees(struct ctrees_perf_counters *dst, const struct ctrees_perf_counters *src)
+{
+    dst->ntrees += src->ntrees;
+    dst->nbytes_read += src->nbytes_read;
+    dst->nreads += src->nreads;
+    dst->nlines_parsed += src->nlines_parsed;
+    dst->nlines_rejected += src->nlines_rejected;
+    dst->ntokens_skipped += src->ntokens_skipped;
+    dst->ntokens_converted += src->ntokens_converted;
+    dst->nreallocations += src->nreallocations;
+    dst->nbytes_reallocated += src->nbytes_reallocated;
+    dst->io_seconds += src->io_seconds;
+    dst->tokenize_seconds += src->tokenize_seconds;
+    dst->convert_seconds += src->convert_seconds;
+    dst->total_seconds += src->total_seconds;
+}
+
+
+/* Writes the counters in ``perf`` as one JSON object (followed by a new-line) to ``fp`` */
+static inline int write_perf_counters_json_ctrees(FILE *fp, const struct ctrees_perf_counters *perf)
+{
+    const int nwritten = fprintf(fp, "{\"ntrees\": %"PRId64", \"nbytes_read\": %"PRId64", \"nreads\": %"PRId64", "
+                                 "\"nlines_parsed\": %"PRId64", \"nlines_rejected\": %"PRId64", "
+                                 "\"ntokens_skipped\": %"PRId64", \"ntokens_converted\": %"PRId64", "
+                                 "\"nreallocations\": %"PRId64", \"nbytes_reallocated\": %"PRId64", "
+                                 "\"io_seconds\": %.9g, \"tokenize_seconds\": %.9g, \"convert_seconds\": %.9g, \"total_seconds\": %.9g}\n",
+                                 perf->ntrees, perf->nbytes_read, perf->nreads, perf->nlines_parsed, perf->nlines_rejected,
+                                 perf->ntokens_skipped, perf->ntokens_converted, perf->nreallocations, perf->nbytes_reallocated,
+                                 perf->io_seconds, perf->tokenize_seconds, perf->convert_seconds, perf->total_seconds);
+    if(nwritten < 0) {
+        fprintf(stderr,"Error: Could not write the performance counters\n");
+        perror(NULL);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+
+/* Releases all the resources held by ``reader`` (also safe to call on a partially opened reader) */
+static inline int close_reader_ctrees(struct ctrees_reader *reader)
+{
+    int status = EXIT_SUCCESS;
+#ifdef PARSE_CTREES_USE_PTHREADS
+    if(reader->use_prefetch) {
+        free_prefetcher_ctrees(&(reader->prefetcher));
+        reader->use_prefetch = 0;
+    }
+#endif
+    if(reader->use_cache) {
+        close_columnar_cache_ctrees(&(reader->cache));
+        reader->use_cache = 0;
+    }
+    if(reader->use_mmap) {
+        status = close_mmap_file_ctrees(&(reader->mfile));
+        reader->use_mmap = 0;
+    }
+    if(reader->cfile_is_open) {
+        close_compressed_file_ctrees(&(reader->cfile));
+        reader->cfile_is_open = 0;
+    }
+    if(reader->fd >= 0) {
+        close(reader->fd);
+        reader->fd = -1;
+    }
+    free_buffered_reader_ctrees(&(reader->buffered_reader));
+    free_tree_index_ctrees(&(reader->index));
+    free(reader->tree_order_by_id);
+    reader->tree_order_by_id = NULL;
+    reader->plan_is_valid = 0;
+    free_column_plan_ctrees(&(reader->plan));
+    free_column_to_ptr_ctrees(&(reader->column_info));
+    return status;
+}
+
+
+/* Opens the file, loads (or builds) the tree index and sets up the optional memory-map, columnar cache and read-ahead
+   thread for an (already zeroed) ``reader`` with a parsed header. Called from `open_reader_ctrees` */
+static inline int open_reader_files_ctrees(struct ctrees_reader *reader, const struct ctrees_reader_options *options)
+{
+    const char *filename = reader->filename;
+    if(reader->format == PARSE_CTREES_UNCOMPRESSED) {
+        reader->fd = open(filename, O_RDONLY);
+        if(reader->fd < 0) {
+            fprintf(stderr,"Error: Could not open file `%s'\n", filename);
+            perror(NULL);
+            return EXIT_FAILURE;
+        }
+        reader->source = get_fd_source_ctrees(&(reader->fd));
+    } else {
+        if(options->use_mmap || options->cache_file != NULL) {
+            fprintf(stderr,"Error: The memory-map and the columnar cache are only supported for uncompressed files (file = `%s')\n", filename);
+            return EXIT_FAILURE;
+        }
+        int status = open_compressed_file_ctrees(filename, &(reader->cfile));
+        if(status != EXIT_SUCCESS) {
+            return status;
+        }
+        reader->cfile_is_open = 1;
+        reader->source = get_compressed_source_ctrees(&(reader->cfile));
+    }
+    int status = init_buffered_reader_ctrees(&(reader->buffered_reader), options->bufsize);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+
+    if(reader->format == PARSE_CTREES_UNCOMPRESSED) {
+        status = load_or_build_tree_index_ctrees(filename, options->index_file, &(reader->index));
+    } else if(options->index_file == NULL || read_tree_index_ctrees(options->index_file, filename, &(reader->index)) != EXIT_SUCCESS) {
+        status = build_tree_index_source_ctrees(filename, &(reader->source), &(reader->buffered_reader), &(reader->index));
+        if(status == EXIT_SUCCESS && options->index_file != NULL &&
+           write_tree_index_ctrees(options->index_file, filename, &(reader->index)) != EXIT_SUCCESS) {
+            /* failing to write the cache is not fatal */
+            PARSE_CTREES_LOG(PARSE_CTREES_LOG_WARNING, "Warning: Could not cache the tree index for `%s' into `%s'\n", filename, options->index_file);
+        }
+    }
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+
+    if(options->use_mmap) {
+        status = open_mmap_file_ctrees(filename, &(reader->mfile));
+        if(status != EXIT_SUCCESS) {
+            return status;
+        }
+        reader->use_mmap = 1;
+    }
+    if(options->cache_file != NULL) {
+        status = load_or_build_columnar_cache_ctrees(filename, options->cache_file, &(reader->column_info), &(reader->index), &(reader->cache));
+        if(status != EXIT_SUCCESS) {
+            return status;
+        }
+        reader->use_cache = 1;
+    }
+
+    /* the read-ahead is only useful when the trees are actually read from the source */
+    if(options->prefetch_nbuffers > 0 && reader->use_mmap == 0 && reader->use_cache == 0) {
+#ifdef PARSE_CTREES_USE_PTHREADS
+        status = init_prefetcher_ctrees(&(reader->prefetcher), &(reader->source), options->prefetch_nbuffers, 0);
+        if(status != EXIT_SUCCESS) {
+            return status;
+        }
+        reader->use_prefetch = 1;
+        reader->source = get_prefetch_source_ctrees(&(reader->prefetcher));
+#else
+        fprintf(stderr,"Error: The read-ahead thread requires the library to be compiled with `-DPARSE_CTREES_USE_PTHREADS'\n");
+        return EXIT_FAILURE;
+#endif
+    }
+    return EXIT_SUCCESS;
+}
+
+
+/* Opens ``filename`` for reading many trees with the same columns (and row filters). The arguments ``column_names``
+   through ``nfilters`` are the same as for `parse_header_with_filters_ctrees` (``filters`` may be NULL with ``nfilters`` = 0),
+   and ``options`` may be NULL for the defaults (plain `pread`s, with the tree index built by scanning the file) */
+static inline int open_reader_ctrees(const char *filename, char (*column_names)[PARSE_CTREES_MAX_COLNAME_LEN], enum parse_numeric_types *field_types,
+                                     int64_t *base_ptr_idx, size_t *dest_offset_to_element, const int64_t nfields,
+                                     const struct ctrees_filter *filters, const int64_t nfilters,
+                                     const struct ctrees_reader_options *options, struct ctrees_reader *reader)
+{
+    struct ctrees_reader_options default_options;
+    memset(&default_options, 0, sizeof(default_options));
+    if(options == NULL) {
+        options = &default_options;
+    }
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = -1;
+    reader->alloc_context.allocator = options->allocator;
+    if(strlen(filename) >= PARSE_CTREES_MAX_FILENAME_LEN) {
+        fprintf(stderr,"Error: filename `%s' is too long. Please define the macro variable `PARSE_CTREES_MAX_FILENAME_LEN' "
+                "to be larger than %zu (before including the file `%s')\n", filename, strlen(filename), __FILE__);
+        return EXIT_FAILURE;
+    }
+    strcpy(reader->filename, filename);
+
+    int status;
+    if(options->header_cache != NULL) {
+        status = parse_header_cached_ctrees(options->header_cache, (const char (*)[PARSE_CTREES_MAX_COLNAME_LEN]) column_names, field_types,
+                                            base_ptr_idx, dest_offset_to_element, nfields, filters, nfilters, filename, &(reader->column_info));
+    } else {
+        status = parse_header_with_filters_ctrees(column_names, field_types, base_ptr_idx, dest_offset_to_element, nfields,
+                                                  filters, nfilters, filename, &(reader->column_info));
+    }
+    if(status == EXIT_SUCCESS) {
+        status = get_compression_format_ctrees(filename, &(reader->format));
+    }
+    if(status == EXIT_SUCCESS) {
+        status = open_reader_files_ctrees(reader, options);
+    }
+    if(status != EXIT_SUCCESS) {
+        close_reader_ctrees(reader);
+    }
+    return status;
+}
+
+
+/* (Re-)compiles the column plan of the ``reader``, unless the plan was compiled for the same base pointers */
+static inline int update_reader_plan_ctrees(struct ctrees_reader *reader, const struct base_ptr_info *base_ptr_info)
+{
+    const int64_t n = base_ptr_info->num_base_ptrs;
+    if(reader->plan_is_valid && reader->plan_num_base_ptrs == n && n >= 0 && n <= PARSE_CTREES_MAX_NCOLS &&
+       memcmp(reader->plan_base_ptrs, base_ptr_info->base_ptrs, n * sizeof(base_ptr_info->base_ptrs[0])) == 0 &&
+       memcmp(reader->plan_base_element_size, base_ptr_info->base_element_size, n * sizeof(base_ptr_info->base_element_size[0])) == 0) {
+        return EXIT_SUCCESS;
+    }
+    reader->plan_is_valid = 0;
+    free_column_plan_ctrees(&(reader->plan));
+    int status = compile_column_plan_ctrees(&(reader->column_info), base_ptr_info, &(reader->plan));
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    reader->plan_num_base_ptrs = n;
+    memcpy(reader->plan_base_ptrs, base_ptr_info->base_ptrs, n * sizeof(base_ptr_info->base_ptrs[0]));
+    memcpy(reader->plan_base_element_size, base_ptr_info->base_element_size, n * sizeof(base_ptr_info->base_element_size[0]));
+    reader->plan_is_valid = 1;
+    reader->stats.nplans_compiled++;
+    return EXIT_SUCCESS;
+}
+
+
+/* Reads the tree at position ``itree`` within ``reader->index.trees`` (see `find_tree_in_reader_ctrees` to locate a tree by
+   its id). The halos are appended to the base pointers (i.e., starting at ``base_ptr_info->N``), which are grown as needed.
+   The tree is copied from the columnar cache, parsed from the memory-map or read from the file (via the read-ahead thread),
+   depending on the options passed to `open_reader_ctrees` */
+static inline int read_tree_with_reader_ctrees(struct ctrees_reader *reader, const int64_t itree, struct base_ptr_info *base_ptr_info)
+{
+    PARSE_CTREES_XASSERT(itree >= 0 && itree < reader->index.ntrees,
+                         EXIT_FAILURE,
+                         "Error: tree index = %"PRId64" must be in the range [0, %"PRId64")\n",
+                         itree, reader->index.ntrees);
+    const struct ctrees_tree_index_entry *tree = &(reader->index.trees[itree]);
+    const int64_t N_start = base_ptr_info->N;
+#ifdef PARSE_CTREES_USE_PERF_COUNTERS
+    struct ctrees_perf_counters *perf = &(reader->tree_perf);
+    memset(perf, 0, sizeof(*perf));
+    const double t_start = get_seconds_ctrees();
+    const int64_t nreallocations_start = reader->alloc_context.nreallocations;
+    const int64_t nbytes_reallocated_start = reader->alloc_context.nbytes_reallocated;
+#endif
+    int status;
+    if(reader->use_cache) {
+        status = read_single_tree_cache_alloc_ctrees(&(reader->cache), tree->offset, &(reader->column_info), base_ptr_info, &(reader->alloc_context));
+        if(status == EXIT_SUCCESS) {
+            reader->stats.ntrees_from_cache++;
+        }
+    } else {
+        status = update_reader_plan_ctrees(reader, base_ptr_info);
+        reader->plan.alloc_context = &(reader->alloc_context);
+#ifdef PARSE_CTREES_USE_PERF_COUNTERS
+        reader->plan.perf = perf;
+        reader->plan.nlines_for_sampling = &(reader->nlines_for_sampling);
+        reader->buffered_reader.perf = perf;
+        if(reader->use_mmap && tree->nbytes > 0) {
+            perf->nbytes_read += tree->nbytes;
+        }
+#endif
+        if(status == EXIT_SUCCESS && tree->nhalos >= 0) {
+            status = reserve_base_ptrs_alloc_ctrees(base_ptr_info, &(reader->alloc_context), N_start + tree->nhalos);
+        }
+        struct ctrees_plan_visitor_data visitor_data = {.plan = &(reader->plan), .base_ptr_info = base_ptr_info};
+        if(status == EXIT_SUCCESS && reader->use_mmap) {
+            status = visit_tree_range_mmap_ctrees(&(reader->mfile), tree->offset, tree->nbytes, parse_line_plan_visitor_ctrees,
+                                                  &visitor_data);
+        } else if(status == EXIT_SUCCESS) {
+            status = visit_tree_lines_source_ctrees(&(reader->source), tree->offset, &(reader->buffered_reader),
+                                                    parse_line_plan_visitor_ctrees, &visitor_data);
+        }
+    }
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+
+#ifdef PARSE_CTREES_USE_PERF_COUNTERS
+    perf->ntrees = 1;
+    perf->nreallocations = reader->alloc_context.nreallocations - nreallocations_start;
+    perf->nbytes_reallocated = reader->alloc_context.nbytes_reallocated - nbytes_reallocated_start;
+    perf->total_seconds = get_seconds_ctrees() - t_start;
+    add_perf_counters_ctrees(&(reader->total_perf), perf);
+#endif
+    reader->next_tree = itree + 1;
+    reader->stats.ntrees_read++;
+    reader->stats.nhalos_read += base_ptr_info->N - N_start;
+    if(tree->nbytes > 0) {
+        reader->stats.nbytes_read += tree->nbytes;
     }
-        
-    /* do not need the actual names of every column in the ctrees file any longer -> free that memory */
-    free(names);
+    return EXIT_SUCCESS;
+}
 
-        
-    /* now sort the matched columns */
-#define SGLIB_CHAR_ARRAY_ELEMENTS_EXCHANGER(maxlen, a, i, j) {char _sgl_aee_tmp_[maxlen]; memmove(_sgl_aee_tmp_, (a)[(i)], maxlen);memmove((a)[(i)], (a)[(j)], maxlen); memmove((a)[(j)], _sgl_aee_tmp_, maxlen);}
-        
-    /* sort the matched_columns in ascending order */
-#define MULTIPLE_ARRAY_EXCHANGER(type,a,i,j) {                          \
-        SGLIB_ARRAY_ELEMENTS_EXCHANGER(enum parse_numeric_types, field_types,i,j); \
-        SGLIB_ARRAY_ELEMENTS_EXCHANGER(int, matched_columns, i, j);     \
-        SGLIB_ARRAY_ELEMENTS_EXCHANGER(int64_t, base_ptr_idx, i, j);    \
-        SGLIB_ARRAY_ELEMENTS_EXCHANGER(size_t, dest_offset_to_element, i, j); \
-        SGLIB_CHAR_ARRAY_ELEMENTS_EXCHANGER(PARSE_CTREES_MAX_COLNAME_LEN, column_names, i, j); \
+
+/* Reads the tree that follows the previously read tree (in the order of the file, starting with the first tree) and
+   sets ``*tree`` to its entry within the index. After the last tree, ``*tree`` is set to NULL (and EXIT_SUCCESS is returned) */
+static inline int read_next_tree_ctrees(struct ctrees_reader *reader, struct base_ptr_info *base_ptr_info, const struct ctrees_tree_index_entry **tree)
+{
+    *tree = NULL;
+    if(reader->next_tree >= reader->index.ntrees) {
+        return EXIT_SUCCESS;
     }
-        
-    SGLIB_ARRAY_QUICK_SORT(int, matched_columns, nfields, SGLIB_NUMERIC_COMPARATOR , MULTIPLE_ARRAY_EXCHANGER);
-#undef SGLIB_CHAR_ARRAY_ELEMENTS_EXCHANGER
-#undef MULTIPLE_ARRAY_EXCHANGER
+    const int64_t itree = reader->next_tree;
+    int status = read_tree_with_reader_ctrees(reader, itree, base_ptr_info);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    *tree = &(reader->index.trees[itree]);
+    return EXIT_SUCCESS;
+}
 
 
-    /* now assign only the columns that were found
-       into the column_info struct */
-    column_info->ncols = 0;
-    for(int i=0;i<nfields;i++) {
-        if(matched_columns[i] == -1) continue;
+/* Returns the position (within ``reader->index.trees``) of the tree with the (root) id ``tree_id``, or -1 if the tree
+   does not exist (or on error). The trees are sorted by id on the first call */
+static inline int64_t find_tree_in_reader_ctrees(struct ctrees_reader *reader, const int64_t tree_id)
+{
+    const struct ctrees_tree_index_entry *trees = reader->index.trees;
+    if(reader->tree_order_by_id == NULL) {
+        int64_t *order = malloc((reader->index.ntrees + 1) * sizeof(*order));
+        if(order == NULL) {
+            fprintf(stderr,"Error: Could not allocate memory to sort %"PRId64" trees by their id\n", reader->index.ntrees);
+            perror(NULL);
+            return -1;
+        }
+        for(int64_t i=0;i<reader->index.ntrees;i++) {
+            order[i] = i;
+        }
+#define PARSE_CTREES_TREE_ID_COMPARATOR(x, y) ((trees[(x)].tree_id < trees[(y)].tree_id) ? -1 : \
+                                               (trees[(x)].tree_id > trees[(y)].tree_id) ? 1 : ((x) < (y) ? -1 : ((x) > (y))))
+        PARSE_CTREES_ARRAY_SINGLE_SORT(int64_t, order, reader->index.ntrees, PARSE_CTREES_TREE_ID_COMPARATOR);
+#undef PARSE_CTREES_TREE_ID_COMPARATOR
+        reader->tree_order_by_id = order;
+    }
 
-        const int icol = column_info->ncols;
-        column_info->column_number[icol] = matched_columns[i];
-        column_info->field_types[icol] = field_types[i];
-        column_info->dest_offset_to_element[icol] = dest_offset_to_element[i];
-        column_info->base_ptr_idx[icol] = base_ptr_idx[i];
-        column_info->ncols++;
+    int64_t lo = 0, hi = reader->index.ntrees - 1;
+    while(lo <= hi) {
+        const int64_t mid = lo + (hi - lo)/2;
+        const int64_t this_id = trees[reader->tree_order_by_id[mid]].tree_id;
+        if(this_id == tree_id) {
+            return reader->tree_order_by_id[mid];
+        }
+        if(this_id < tree_id) lo = mid + 1;
+        else hi = mid - 1;
     }
-    free(matched_columns);
+    return -1;
+}
+
+
+static inline void free_line_index_ctrees(struct ctrees_line_index *line_index)
+{
+    free(line_index->offset);
+    free(line_index->length);
+    memset(line_index, 0, sizeof(*line_index));
+}
 
+static inline int grow_line_index_ctrees(struct ctrees_line_index *line_index)
+{
+    const int64_t min_nallocated = 1024;
+    int64_t nallocated = 2 * line_index->nallocated;
+    if(nallocated < min_nallocated) nallocated = min_nallocated;
+    int64_t *offset = realloc(line_index->offset, nallocated * sizeof(*offset));
+    if(offset == NULL) {
+        fprintf(stderr,"Error: Could not allocate memory for the line index of %"PRId64" rows\n", nallocated);
+        perror(NULL);
+        return EXIT_FAILURE;
+    }
+    line_index->offset = offset;
+    uint32_t *length = realloc(line_index->length, nallocated * sizeof(*length));
+    if(length == NULL) {
+        fprintf(stderr,"Error: Could not allocate memory for the line index of %"PRId64" rows\n", nallocated);
+        perror(NULL);
+        return EXIT_FAILURE;
+    }
+    line_index->length = length;
+    line_index->nallocated = nallocated;
     return EXIT_SUCCESS;
 }
 
-static inline int parse_line_ctrees(const char *linebuf, const struct ctrees_column_to_ptr *column_info, struct base_ptr_info *base_ptr_info)
+
+/* The line-visitor used by the indexed readers -- parses the line (as `parse_line_plan_visitor_ctrees`) and
+   records the location of every line that is stored */
+struct ctrees_indexed_visitor_data {
+    const struct ctrees_column_plan *plan;
+    struct base_ptr_info *base_ptr_info;
+    struct ctrees_line_index *line_index;
+    const char *const *base;/* points to the address of the byte at ``*base_offset`` within the source (the read buffer may grow) */
+    const off_t *base_offset;
+};
+
+static inline int parse_line_indexed_visitor_ctrees(const char *line, const size_t linelen, void *data)
 {
-    if(base_ptr_info->nallocated == base_ptr_info->N) {
-        const double large_N_memory_increase_fac = 1.2;
-        const int64_t small_N_memory_increase_fac = 2;
-        /* double (:=`small_N_memory_increase_fac`) the memory requested for small numbers, otherwise increase by `large_N_memory_increase_fac` */
-        const int64_t thresh_N_for_large_memory = 1000000;/* small_N_memory_increase_fac * N, for N less than this threshold*/
-        const int64_t new_N = (base_ptr_info->N < thresh_N_for_large_memory) ? (base_ptr_info->N*small_N_memory_increase_fac): (base_ptr_info->N*large_N_memory_increase_fac);
-        int status = reallocate_base_ptrs(base_ptr_info, new_N);
+    struct ctrees_indexed_visitor_data *visitor_data = (struct ctrees_indexed_visitor_data *) data;
+    const int64_t N = visitor_data->base_ptr_info->N;
+    int status = parse_line_plan_ctrees(line, linelen, visitor_data->plan, visitor_data->base_ptr_info);
+    if(status != EXIT_SUCCESS || visitor_data->base_ptr_info->N == N) {
+        /* error, or the line was rejected by the row filters */
+        return status;
+    }
+
+    struct ctrees_line_index *line_index = visitor_data->line_index;
+    if(line_index->nrows == line_index->nallocated) {
+        status = grow_line_index_ctrees(line_index);
         if(status != EXIT_SUCCESS) return status;
-        XASSERT(base_ptr_info->nallocated > base_ptr_info->N,
-                EXIT_FAILURE,
-                "Error: Something went wrong while memory reallocation "
-                "nallocated = %"PRId64" should have been larger than N = %"PRId64"\n",
-                base_ptr_info->nallocated, base_ptr_info->N);
     }
+    line_index->offset[line_index->nrows] = (int64_t) *(visitor_data->base_offset) + (int64_t) (line - *(visitor_data->base));
+    line_index->length[line_index->nrows] = (uint32_t) linelen;
+    line_index->nrows++;
+    return EXIT_SUCCESS;
+}
+
+static inline int check_line_index_rows_ctrees(const struct ctrees_line_index *line_index, const struct base_ptr_info *base_ptr_info)
+{
+    if(line_index->nrows != base_ptr_info->N) {
+        fprintf(stderr,"Error: The line index has %"PRId64" rows but the base pointers contain %"PRId64" rows. Row i of the line "
+                "index must be row i of the base pointers (i.e., reset both at the same time)\n", line_index->nrows, base_ptr_info->N);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
 
-    int icol = -1;
-    char *tofree, *string;
-    /* fprintf(stderr,"in %s>linebuf = `%s`\n\n", __FUNCTION__, linebuf); */
-    tofree = string = strdup(linebuf);
-    char *token = NULL;
-    for(int i=0;i<column_info->ncols;i++) {
-        const int wanted_col = column_info->column_number[i];
-        const int64_t base_ptr_idx = column_info->base_ptr_idx[i];
-        PARSE_CTREES_XASSERT(base_ptr_idx < base_ptr_info->num_base_ptrs,
-                             EXIT_FAILURE,
-                             "Error: Valid values for base pointer index must be in range [0, %"PRId64"). Got %"PRId64" instead\n",
-                             base_ptr_info->num_base_ptrs, base_ptr_idx);
-        char *dest = *((char **) (base_ptr_info->base_ptrs[base_ptr_idx]));
-        const size_t base_ptr_stride = base_ptr_info->base_element_size[base_ptr_idx];
-        const size_t dest_offset = column_info->dest_offset_to_element[i];
-        PARSE_CTREES_XASSERT(base_ptr_stride >= 4,
-                             EXIT_FAILURE,
-                             "Error: Stride=%zu is expected in bytes with a minimum of 4 bytes since that's "
-                             "the smallest data-type supported (corresponding to float or int32_t).\n"
-                             "Perhaps you forgot to multiply by the sizeof(element)?\n",
-                             base_ptr_stride);
-        PARSE_CTREES_XASSERT(dest_offset < base_ptr_stride,
-                             EXIT_FAILURE,
-                             "Error: The offset from the starting address of an element can be at most the total stride in bytes\n"
-                             "In this case offset=%zu must in the half-open range [0, %zu). Perhaps you mis-typed the offset?\n",
-                             dest_offset, base_ptr_stride);
-            
-        /* get to the starting offset for this N'th element */
-        dest += base_ptr_info->N * base_ptr_stride;
 
-        /* now get to this particular field */
-        dest += dest_offset;
+/* Same as `read_single_tree_source_ctrees` but also records the location of every stored line in ``line_index`` */
+static inline int read_single_tree_indexed_source_ctrees(const struct ctrees_input_source *source, off_t offset, const struct ctrees_column_to_ptr *column_info,
+                                                         struct base_ptr_info *base_ptr_info, struct ctrees_buffered_reader *reader,
+                                                         struct ctrees_line_index *line_index)
+{
+    int status = check_line_index_rows_ctrees(line_index, base_ptr_info);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    struct ctrees_column_plan plan;
+    status = compile_column_plan_ctrees(column_info, base_ptr_info, &plan);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
 
-        /* this is the type for the destination (hence called 'field_types' rather than 'column_types') */
-        const enum parse_numeric_types wanted_type = column_info->field_types[i];
+    struct ctrees_indexed_visitor_data visitor_data = {.plan = &plan, .base_ptr_info = base_ptr_info, .line_index = line_index,
+                                                       .base = (const char *const *) &(reader->buffer), .base_offset = &(reader->buffer_offset)};
+    status = visit_tree_lines_source_ctrees(source, offset, reader, parse_line_indexed_visitor_ctrees, &visitor_data);
+    free_column_plan_ctrees(&plan);
+    return status;
+}
 
-        /* there might be duplicate column numbers in matched_columns
-           then the following while loop should immediately exit (without
-           executing any lines within)
-           and we will re-use the previous parsed value of token */
-        while(icol < wanted_col || token == NULL) {
-            token = strsep(&string, " ,");
-            if(token != NULL && ((token[0] == '\0') || (token[0] == ' '))) {
-                continue;
+/* Same as `read_single_tree_buffered_ctrees` but also records the location of every stored line in ``line_index`` */
+static inline int read_single_tree_indexed_ctrees(int fd, off_t offset, const struct ctrees_column_to_ptr *column_info,
+                                                  struct base_ptr_info *base_ptr_info, struct ctrees_buffered_reader *reader,
+                                                  struct ctrees_line_index *line_index)
+{
+    const struct ctrees_input_source source = get_fd_source_ctrees(&fd);
+    return read_single_tree_indexed_source_ctrees(&source, offset, column_info, base_ptr_info, reader, line_index);
+}
+
+/* Same as `read_single_tree_mmap_ctrees` but also records the location of every stored line in ``line_index`` */
+static inline int read_single_tree_indexed_mmap_ctrees(const struct ctrees_mmap_file *mfile, off_t offset, const struct ctrees_column_to_ptr *column_info,
+                                                       struct base_ptr_info *base_ptr_info, struct ctrees_line_index *line_index)
+{
+    int status = check_line_index_rows_ctrees(line_index, base_ptr_info);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    struct ctrees_column_plan plan;
+    status = compile_column_plan_ctrees(column_info, base_ptr_info, &plan);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+
+    const off_t zero_offset = 0;
+    const char *data = mfile->data;
+    struct ctrees_indexed_visitor_data visitor_data = {.plan = &plan, .base_ptr_info = base_ptr_info, .line_index = line_index,
+                                                       .base = &data, .base_offset = &zero_offset};
+    status = visit_tree_lines_mmap_ctrees(mfile, offset, parse_line_indexed_visitor_ctrees, &visitor_data);
+    free_column_plan_ctrees(&plan);
+    return status;
+}
+
+
+/* Copies the column ``isrc`` of ``src`` into the column ``idst`` of ``dst`` */
+static inline void copy_column_ctrees(struct ctrees_column_to_ptr *dst, const int64_t idst, const struct ctrees_column_to_ptr *src, const int64_t isrc)
+{
+    dst->column_number[idst] = src->column_number[isrc];
+    dst->field_types[idst] = src->field_types[isrc];
+    dst->base_ptr_idx[idst] = src->base_ptr_idx[isrc];
+    dst->dest_offset_to_element[idst] = src->dest_offset_to_element[isrc];
+    dst->conversion_method[idst] = src->conversion_method[isrc];
+    dst->quant_lo[idst] = src->quant_lo[isrc];
+    dst->quant_hi[idst] = src->quant_hi[isrc];
+}
+
+
+/* Adds more columns to an existing ``column_info`` (e.g., after some trees have been read). The columns are requested
+   exactly as for `parse_header_ctrees`, and ``added_columns`` is populated with only the new columns -- use it with
+   `read_rows_ctrees` to fill in the new columns for the rows that have already been read. The merged ``column_info``
+   (which retains its row filters) then reads all the columns from any tree that is read afterwards.
+
+   A new column must not have the same destination (base_ptr_idx and offset) as any existing column. On success,
+   ``added_columns`` has to be released (with `free_column_to_ptr_ctrees`) by the caller; on failure, ``column_info``
+   is unchanged and ``added_columns`` has already been released */
+static inline int add_columns_ctrees(char (*column_names)[PARSE_CTREES_MAX_COLNAME_LEN], enum parse_numeric_types *field_types,
+                                     int64_t *base_ptr_idx, size_t *dest_offset_to_element, const int64_t nfields, const char *filename,
+                                     struct ctrees_column_to_ptr *column_info, struct ctrees_column_to_ptr *added_columns)
+{
+    int status = parse_header_ctrees(column_names, field_types, base_ptr_idx, dest_offset_to_element, nfields, filename, added_columns);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    for(int64_t i=0;i<added_columns->ncols;i++) {
+        for(int64_t j=0;j<column_info->ncols;j++) {
+            if(added_columns->base_ptr_idx[i] == column_info->base_ptr_idx[j] &&
+               added_columns->dest_offset_to_element[i] == column_info->dest_offset_to_element[j]) {
+                fprintf(stderr,"Error: The added column number = %d has the same destination (base_ptr_idx = %"PRId64", offset = %zu) "
+                        "as the existing column number = %d\n", added_columns->column_number[i], added_columns->base_ptr_idx[i],
+                        added_columns->dest_offset_to_element[i], column_info->column_number[j]);
+                free_column_to_ptr_ctrees(added_columns);
+                return EXIT_FAILURE;
             }
-            icol++;
         }
-        PARSE_CTREES_XASSERT(token != NULL && token[0] != '\0' && icol == wanted_col,
-                             EXIT_FAILURE,
-                             "Error: token=`%s` should have valid non-zero numeric value at this stage.\n"
-                             "And the parsed col = %d should be equal to the requested column = %d\n",
-                             token, icol, wanted_col);
-
-        switch(wanted_type) {
-        case F32:{
-            float tmp = strtof(token, NULL);
-            /* fprintf(stderr,"[float] := %f (col #%d)\n", tmp, wanted_col); */
-            *((float *) dest) = tmp;
-            break;
+    }
+
+    /* both sets of columns are sorted by the column number -> merge */
+    struct ctrees_column_to_ptr merged;
+    if(alloc_column_to_ptr_ctrees(&merged, column_info->ncols + added_columns->ncols) != EXIT_SUCCESS) {
+        free_column_to_ptr_ctrees(added_columns);
+        return EXIT_FAILURE;
+    }
+    merged.nfilters = column_info->nfilters;
+    memcpy(merged.filter_column_number, column_info->filter_column_number, sizeof(column_info->filter_column_number));
+    memcpy(merged.filter_op, column_info->filter_op, sizeof(column_info->filter_op));
+    memcpy(merged.filter_lo, column_info->filter_lo, sizeof(column_info->filter_lo));
+    memcpy(merged.filter_hi, column_info->filter_hi, sizeof(column_info->filter_hi));
+    int64_t i = 0, j = 0;
+    for(int64_t k=0;k<column_info->ncols + added_columns->ncols;k++) {
+        if(j == added_columns->ncols ||
+           (i < column_info->ncols && column_info->column_number[i] <= added_columns->column_number[j])) {
+            copy_column_ctrees(&merged, k, column_info, i++);
+        } else {
+            copy_column_ctrees(&merged, k, added_columns, j++);
         }
-        case F64:{
-            double tmp = strtod(token, NULL);
-            /* fprintf(stderr,"[double] := %lf (col #%d)\n", tmp, wanted_col); */
-            *((double *) dest) = tmp;
+    }
+    merged.ncols = column_info->ncols + added_columns->ncols;
+    free_column_to_ptr_ctrees(column_info);
+    *column_info = merged;
+    return EXIT_SUCCESS;
+}
+
+
+static inline int64_t get_requested_row_ctrees(const int64_t *rows, const int64_t first_row, const int64_t k)
+{
+    return (rows != NULL) ? rows[k] : first_row + k;
+}
+
+static inline int check_requested_row_ctrees(const int64_t row, const struct ctrees_line_index *line_index, const struct base_ptr_info *base_ptr_info)
+{
+    if(row < 0 || row >= line_index->nrows || row >= base_ptr_info->nallocated) {
+        fprintf(stderr,"Error: Requested row = %"PRId64" must be within the line index (%"PRId64" rows) and within the "
+                "allocated base pointers (%"PRId64" rows)\n", row, line_index->nrows, base_ptr_info->nallocated);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+
+/* Parses the columns in ``column_info`` (e.g., the ``added_columns`` from `add_columns_ctrees`) for the ``nrows`` selected
+   rows of the ``line_index``, re-reading only those lines from the input ``source``. The selected rows are ``rows[0..nrows)``,
+   or the range [first_row, first_row + nrows) if ``rows`` is NULL (e.g., the rows of one tree). Each value is stored at
+   its row within the base pointers (which must already be allocated for those rows), and ``base_ptr_info->N`` is not changed.
+
+   Lines that are close together (within PARSE_CTREES_ROWS_MAX_GAP_BYTES, with increasing offsets) are fetched with a
+   single `pread` into the ``reader`` buffer. The row filters (if any) are not applied */
+static inline int read_rows_source_ctrees(const struct ctrees_input_source *source, const struct ctrees_line_index *line_index,
+                                          const int64_t *rows, const int64_t first_row, const int64_t nrows,
+                                          const struct ctrees_column_to_ptr *column_info, struct base_ptr_info *base_ptr_info,
+                                          struct ctrees_buffered_reader *reader)
+{
+    PARSE_CTREES_XASSERT(reader->buffer != NULL && reader->bufsize > 1,
+                         EXIT_FAILURE,
+                         "Error: The read buffer has not been allocated. Please call `init_buffered_reader_ctrees` first\n");
+    invalidate_buffered_reader_ctrees(reader);
+    struct ctrees_column_plan plan;
+    int status = compile_column_plan_ctrees(column_info, base_ptr_info, &plan);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+
+    int64_t k = 0;
+    while(k < nrows) {
+        const int64_t row = get_requested_row_ctrees(rows, first_row, k);
+        status = check_requested_row_ctrees(row, line_index, base_ptr_info);
+        if(status != EXIT_SUCCESS) {
             break;
         }
-        case I32:{
-            int32_t tmp = (int32_t) strtol(token, NULL, 10);
-            /* fprintf(stderr,"[int32_t] := %"PRId32" (col #%d)\n", tmp, wanted_col); */
-            *((int32_t *) dest) = tmp;
+        const int64_t start = line_index->offset[row];
+        int64_t end = start + line_index->length[row];
+        while((size_t) (end - start) > reader->bufsize) {
+            /* a (very) long line -> grow the buffer to fit it */
+            status = grow_buffered_reader_ctrees(reader);
+            if(status != EXIT_SUCCESS) {
+                break;
+            }
+        }
+        if(status != EXIT_SUCCESS) {
             break;
         }
-        case U32:{
-            uint32_t tmp = (uint32_t) strtoul(token, NULL, 10);
-            /* fprintf(stderr,"[uint32_t] := %"PRIu32" (col #%d)\n", tmp, wanted_col); */
-            *((uint32_t *) dest) = tmp;
+
+        /* extend the read to the following lines as long as they are close by and fit in the buffer */
+        int64_t next = k + 1;
+        for(;next < nrows;next++) {
+            const int64_t next_row = get_requested_row_ctrees(rows, first_row, next);
+            if(next_row < 0 || next_row >= line_index->nrows) break;
+            const int64_t next_start = line_index->offset[next_row];
+            const int64_t next_end = next_start + line_index->length[next_row];
+            if(next_start < end || next_start - end > PARSE_CTREES_ROWS_MAX_GAP_BYTES || (size_t) (next_end - start) > reader->bufsize) break;
+            end = next_end;
+        }
+
+        size_t nread = 0;
+        while(nread < (size_t) (end - start)) {
+            ssize_t n = source->pread(source->handle, reader->buffer + nread, (end - start) - nread, start + nread);
+            if(n <= 0) {
+                fprintf(stderr,"Error: Could not read %"PRId64" bytes at offset = %"PRId64" (for row = %"PRId64")\n",
+                        end - start, start, row);
+                perror(NULL);
+                status = EXIT_FAILURE;
+                break;
+            }
+            nread += n;
+        }
+        if(status != EXIT_SUCCESS) {
             break;
         }
-        case I64:{
-            int64_t tmp = (int64_t) strtoll(token, NULL, 10);
-            /* fprintf(stderr,"[int64_t] := %"PRId64" (col #%d)\n", tmp, wanted_col); */
-            *((int64_t *) dest) = tmp;
+#ifdef PARSE_CTREES_USE_PERF_COUNTERS
+        if(reader->perf != NULL) {
+            reader->perf->nreads++;
+            reader->perf->nbytes_read += nread;
+        }
+#endif
+
+        for(;k < next;k++) {
+            const int64_t this_row = get_requested_row_ctrees(rows, first_row, k);
+            const char *line = reader->buffer + (line_index->offset[this_row] - start);
+            status = parse_row_plan_ctrees(line, line_index->length[this_row], &plan, this_row);
+            if(status != EXIT_SUCCESS) {
+                break;
+            }
+        }
+        if(status != EXIT_SUCCESS) {
             break;
         }
+    }
+
+    free_column_plan_ctrees(&plan);
+    return status;
+}
+
+/* Same as `read_rows_source_ctrees` for a (regular) file descriptor */
+static inline int read_rows_ctrees(int fd, const struct ctrees_line_index *line_index, const int64_t *rows, const int64_t first_row, const int64_t nrows,
+                                   const struct ctrees_column_to_ptr *column_info, struct base_ptr_info *base_ptr_info,
+                                   struct ctrees_buffered_reader *reader)
+{
+    const struct ctrees_input_source source = get_fd_source_ctrees(&fd);
+    return read_rows_source_ctrees(&source, line_index, rows, first_row, nrows, column_info, base_ptr_info, reader);
+}
 
-        case U64:{
-             uint64_t tmp = (uint64_t) strtoull(token, NULL, 10);
-             /* fprintf(stderr,"[uint64_t] := %"PRIu64" (col #%d)\n", tmp, wanted_col); */
-             *((uint64_t *) dest) = tmp;
-             break;
+/* Same as `read_rows_source_ctrees` but parses the lines directly from the memory-mapped file */
+static inline int read_rows_mmap_ctrees(const struct ctrees_mmap_file *mfile, const struct ctrees_line_index *line_index,
+                                        const int64_t *rows, const int64_t first_row, const int64_t nrows,
+                                        const struct ctrees_column_to_ptr *column_info, struct base_ptr_info *base_ptr_info)
+{
+    struct ctrees_column_plan plan;
+    int status = compile_column_plan_ctrees(column_info, base_ptr_info, &plan);
+    if(status != EXIT_SUCCESS) {
+        return status;
+    }
+    for(int64_t k=0;k<nrows;k++) {
+        const int64_t row = get_requested_row_ctrees(rows, first_row, k);
+        status = check_requested_row_ctrees(row, line_index, base_ptr_info);
+        if(status != EXIT_SUCCESS) {
+            break;
         }
-        default:
-            fprintf(stderr,"Error: Unknown value for parse type = %d\n", wanted_type);
-            fprintf(stderr,"Known values are in the range : [%d, %d)\n", I32, num_numeric_types);
-            return EXIT_FAILURE;
+        if(line_index->offset[row] < 0 || (size_t) line_index->offset[row] + line_index->length[row] > mfile->size) {
+            fprintf(stderr,"Error: The line for row = %"PRId64" (offset = %"PRId64") lies beyond the end of the file (size = %zu bytes)\n",
+                    row, line_index->offset[row], mfile->size);
+            status = EXIT_FAILURE;
+            break;
+        }
+        status = parse_row_plan_ctrees(mfile->data + line_index->offset[row], line_index->length[row], &plan, row);
+        if(status != EXIT_SUCCESS) {
+            break;
         }
     }
-    free(tofree);
+    free_column_plan_ctrees(&plan);
+    return status;
+}
 
-    base_ptr_info->N++;
-    /* fprintf(stderr,"parsed one line: base->N = %"PRId64" nallocated = %"PRId64" linebuf = `%s'\n", base_ptr_info->N, base_ptr_info->nallocated, linebuf); */
-    
-    return EXIT_SUCCESS;
+
+static inline void free_tree_links_ctrees(struct ctrees_tree_links *links)
+{
+    free(links->descendant);
+    free(links->first_progenitor);
+    free(links->next_progenitor);
+    free(links->host);
+    free(links->fof_host);
+    memset(links, 0, sizeof(*links));
 }
 
 
-static inline int read_single_tree_ctrees(int fd, off_t offset, const struct ctrees_column_to_ptr *column_info, struct base_ptr_info *base_ptr_info)
+/* Returns the ``i``'th value of the (strided) column */
+static inline int64_t get_link_id_ctrees(const int64_t *column, const size_t stride, const int64_t i)
 {
-    /* Because the struct elements (of column_info) are stored on the stack,
-       need to check that nfields can fit */
-    if(column_info->ncols  > PARSE_CTREES_MAX_NCOLS) {
-        fprintf(stderr,"Error: You have requested %"PRId64" columns but there is only space to store %"PRId64"\n",
-                column_info->ncols, (int64_t) PARSE_CTREES_MAX_NCOLS);
-        fprintf(stderr,"Please define the macro variable `PARSE_CTREES_MAX_NCOLS' to be larger than %"PRId64" (before including the file `%s')\n",
-                column_info->ncols, __FILE__);
-                
-        return EXIT_FAILURE;
-    } 
+    int64_t value;
+    memcpy(&value, (const char *) column + i * stride, sizeof(value));
+    return value;
+}
 
-    char read_buffer[PARSE_CTREES_MAXBUFSIZE];
-    const size_t to_read_bytes = PARSE_CTREES_MAXBUFSIZE - 1;
-    read_buffer[PARSE_CTREES_MAXBUFSIZE - 1] = '\0';
-    int done_reading_tree = 0;
+static inline double get_link_mass_ctrees(const double *column, const size_t stride, const int64_t i)
+{
+    double value;
+    memcpy(&value, (const char *) column + i * stride, sizeof(value));
+    return value;
+}
 
-    /* two things can happen while reading -> EOF or I reach the next tree */
-    while(done_reading_tree == 0) {
-        ssize_t nbytes_read = pread(fd, read_buffer, to_read_bytes, offset);
-        if(nbytes_read == 0) {
-            done_reading_tree = 1;/* we have reached end of file */
-        } else if(nbytes_read < 0) {
-            fprintf(stderr,"Error: trying to read %zu bytes from file failed. Encountered negative bytes read \n", to_read_bytes);
-            perror(NULL);
-            return EXIT_FAILURE;
-        } else {
-            const off_t start_offset = offset;
-            if(read_buffer[0] == '#') {
-                done_reading_tree = 1;
+
+/* Fibonacci hashing of a halo id into a table with 2^nbits slots */
+static inline uint64_t hash_halo_id_ctrees(const int64_t id, const int nbits)
+{
+    return ((uint64_t) id * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - nbits);
+}
+
+
+/* Returns the row of the halo with ``id`` from the (open addressing) hash ``table``, or -1 if there is no such halo */
+static inline int64_t find_halo_row_ctrees(const int64_t *table, const int nbits, const int64_t *ids, const size_t stride, const int64_t id)
+{
+    const uint64_t mask = (UINT64_C(1) << nbits) - 1;
+    uint64_t slot = hash_halo_id_ctrees(id, nbits);
+    while(table[slot] >= 0) {
+        if(get_link_id_ctrees(ids, stride, table[slot]) == id) {
+            return table[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+
+/* Converts the id columns (id, desc_id, pid and upid) of ``columns->nhalos`` halos into row indices (see `struct ctrees_tree_links`),
+   e.g., for the halos of one tree as read by `read_single_tree_ctrees`, or for all the halos read by `read_all_trees_ctrees`
+   (the ids are unique across the trees of a file).
+
+   The ids are joined through a hash table (id -> row) that is built and probed in parallel, and the progenitors are grouped by
+   their descendant with a counting sort. The ordering of the progenitors of each halo is fixed (by mass or by row, see
+   `struct ctrees_link_columns`), so the links do not depend on the number of threads. Trees with fewer than
+   PARSE_CTREES_LINKS_MIN_PARALLEL_NHALOS halos are processed serially; ``nthreads`` <= 0 uses all the available threads.
+
+   Duplicate ids are an error. Ids that do not match any halo (e.g., the descendant lies in a different set of halos) result
+   in a missing link, and are counted in ``links->nunmatched`` */
+static inline int build_tree_links_ctrees(const struct ctrees_link_columns *columns, struct ctrees_tree_links *links, const int nthreads)
+{
+    memset(links, 0, sizeof(*links));
+    const int64_t nhalos = columns->nhalos;
+    const size_t stride = (columns->stride == 0) ? sizeof(int64_t) : columns->stride;
+    PARSE_CTREES_XASSERT(nhalos >= 0 && columns->id != NULL,
+                         EXIT_FAILURE,
+                         "Error: The id column is required (got %p) and the number of halos = %"PRId64" must not be negative\n",
+                         (const void *) columns->id, nhalos);
+    links->nhalos = nhalos;
+
+#ifdef _OPENMP
+    const int numthreads = (nthreads > 0) ? nthreads : omp_get_max_threads();
+    const int use_threads = (nhalos >= PARSE_CTREES_LINKS_MIN_PARALLEL_NHALOS && numthreads > 1);
+#else
+    (void) nthreads;
+#endif
+
+    /* the hash table has at least twice as many slots as the halos (i.e., is at most half full) */
+    int nbits = 4;
+    while(nbits < 62 && (INT64_C(1) << nbits) < 2 * nhalos) nbits++;
+    const int64_t tablesize = INT64_C(1) << nbits;
+    const uint64_t mask = (uint64_t) tablesize - 1;
+
+    const int need_progenitors = (columns->desc_id != NULL);
+    int64_t *table = malloc(tablesize * sizeof(*table));
+    int64_t *order = need_progenitors ? malloc((nhalos + 1) * sizeof(*order)) : NULL;
+    int64_t *group_start = need_progenitors ? calloc(nhalos + 1, sizeof(*group_start)) : NULL;
+    const size_t nbytes = (nhalos + 1) * sizeof(int64_t);
+    if(need_progenitors) {
+        links->descendant = malloc(nbytes);
+        links->first_progenitor = malloc(nbytes);
+        links->next_progenitor = malloc(nbytes);
+    }
+    if(columns->pid != NULL) links->host = malloc(nbytes);
+    if(columns->upid != NULL) links->fof_host = malloc(nbytes);
+    if(table == NULL || (need_progenitors && (order == NULL || group_start == NULL || links->descendant == NULL ||
+                                              links->first_progenitor == NULL || links->next_progenitor == NULL)) ||
+       (columns->pid != NULL && links->host == NULL) || (columns->upid != NULL && links->fof_host == NULL)) {
+        fprintf(stderr,"Error: Could not allocate memory to link %"PRId64" halos\n", nhalos);
+        perror(NULL);
+        free(table);
+        free(order);
+        free(group_start);
+        free_tree_links_ctrees(links);
+        return EXIT_FAILURE;
+    }
+
+    /* build the hash table (id -> row). Each slot is claimed with an atomic compare-and-swap */
+    for(int64_t i=0;i<tablesize;i++) {
+        table[i] = -1;
+    }
+    int64_t nduplicates = 0;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(numthreads) if(use_threads) schedule(static) reduction(+:nduplicates)
+#endif
+    for(int64_t i=0;i<nhalos;i++) {
+        const int64_t id = get_link_id_ctrees(columns->id, stride, i);
+        uint64_t slot = hash_halo_id_ctrees(id, nbits);
+        while(1) {
+            int64_t occupant = -1;
+            if(__atomic_compare_exchange_n(&table[slot], &occupant, i, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+            if(get_link_id_ctrees(columns->id, stride, occupant) == id) {
+                nduplicates++;
                 break;
             }
+            slot = (slot + 1) & mask;
+        }
+    }
+    if(nduplicates > 0) {
+        fprintf(stderr,"Error: Found %"PRId64" duplicate halo ids (out of %"PRId64" halos) -- can not link the halos\n",
+                nduplicates, nhalos);
+        free(table);
+        free(order);
+        free(group_start);
+        free_tree_links_ctrees(links);
+        return EXIT_FAILURE;
+    }
 
-            if(nbytes_read < (ssize_t) to_read_bytes) {
-                done_reading_tree = 1;/* we have reached end of file but this read buffer needs to be processed*/
+    /* probe the hash table for every descendant/host, and count the progenitors of every halo */
+    int64_t nunmatched = 0;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(numthreads) if(use_threads) schedule(static) reduction(+:nunmatched)
+#endif
+    for(int64_t i=0;i<nhalos;i++) {
+        if(need_progenitors) {
+            const int64_t desc_id = get_link_id_ctrees(columns->desc_id, stride, i);
+            const int64_t row = (desc_id >= 0) ? find_halo_row_ctrees(table, nbits, columns->id, stride, desc_id) : -1;
+            nunmatched += (desc_id >= 0 && row < 0);
+            links->descendant[i] = row;
+            links->first_progenitor[i] = -1;
+            links->next_progenitor[i] = -1;
+            if(row >= 0) {
+                __atomic_fetch_add(&group_start[row + 1], 1, __ATOMIC_RELAXED);
             }
-            
-            /* some bytes were read -> now let's parse one line at a time */
-            char *start = &(read_buffer[0]);
-            const char *end = read_buffer + nbytes_read;
-            char *this = start;
-            while(this < end) {
-                if(*this == '\n') {
-                    *this = '\0';
-
-                    PARSE_CTREES_XASSERT(this >= start && this - start < PARSE_CTREES_MAXBUFSIZE,
-                                         EXIT_FAILURE,
-                                         "Error: Possible bug in code or mal-formed input\n"
-                                         "Current position = %p starting position = %p difference = %"PRId64" should be in range[0, %d)\n",
-                                         this, start, (int64_t) (this - start), PARSE_CTREES_MAXBUFSIZE);
-                    
-                    char linebuf[PARSE_CTREES_MAXBUFSIZE];
-                    memmove(linebuf, start, this - start + 1);
-
-                    offset += (this - start + 1);
-                    start = this + 1;/* might point beyond valid memory but should not get de-referenced */
-
-                    /* fprintf(stderr,"calling parse_line with `%s`\n\n", linebuf); */
-                    int status = parse_line_ctrees(linebuf, column_info, base_ptr_info);
-                    if(status != EXIT_SUCCESS) {
-                        return status; 
-                    }
-                    /* fprintf(stderr,"parsed one line. bytes processed = %"PRId64" nbytes_read = %zd this = %p strlen(linebuf) = %zu\n", */
-                    /*         offset - start_offset, nbytes_read, this, strlen(linebuf)); */
-                }
-                this++;
-                if(this < end && *this == '#') {
-                    /* fprintf(stderr,"encountered '#'...stopping parsing\n"); */
-                    /* we have encountered the beginning of a new tree (new line and begins with '#tree ')*/
-                    done_reading_tree = 1;
-                    this = (char *) end;/* casting, otherwise compiler complains */
-                    break;
-                }
+        }
+        if(columns->pid != NULL) {
+            const int64_t pid = get_link_id_ctrees(columns->pid, stride, i);
+            const int64_t row = (pid >= 0) ? find_halo_row_ctrees(table, nbits, columns->id, stride, pid) : -1;
+            nunmatched += (pid >= 0 && row < 0);
+            links->host[i] = row;
+        }
+        if(columns->upid != NULL) {
+            const int64_t upid = get_link_id_ctrees(columns->upid, stride, i);
+            const int64_t row = (upid >= 0) ? find_halo_row_ctrees(table, nbits, columns->id, stride, upid) : i;
+            nunmatched += (upid >= 0 && row < 0);
+            links->fof_host[i] = row;
+        }
+    }
+    links->nunmatched = nunmatched;
+
+    if(need_progenitors) {
+        /* counting sort of the progenitors by their descendant -- the hash table is no longer
+           required and is re-used for the insertion positions of every group */
+        for(int64_t i=0;i<nhalos;i++) {
+            group_start[i + 1] += group_start[i];
+        }
+        int64_t *position = table;
+        memcpy(position, group_start, nhalos * sizeof(*position));
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(numthreads) if(use_threads) schedule(static)
+#endif
+        for(int64_t i=0;i<nhalos;i++) {
+            const int64_t row = links->descendant[i];
+            if(row < 0) continue;
+            order[__atomic_fetch_add(&position[row], 1, __ATOMIC_RELAXED)] = i;
+        }
+
+        /* order the progenitors within every group (the rows were inserted in an arbitrary order by the threads) and chain them.
+           With one thread (or without masses) the groups are already sorted -> checked first, otherwise a heap sort */
+        const double *mass = columns->mass;
+#define PARSE_CTREES_PROGENITOR_COMPARATOR(x, y)                        \
+        ((mass != NULL && get_link_mass_ctrees(mass, stride, (x)) != get_link_mass_ctrees(mass, stride, (y))) ? \
+         ((get_link_mass_ctrees(mass, stride, (x)) > get_link_mass_ctrees(mass, stride, (y))) ? -1 : 1) : \
+         (((x) < (y)) ? -1 : ((x) > (y))))
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(numthreads) if(use_threads) schedule(dynamic, 1024)
+#endif
+        for(int64_t i=0;i<nhalos;i++) {
+            int64_t *group = order + group_start[i];
+            const int64_t nprogs = group_start[i + 1] - group_start[i];
+            if(nprogs == 0) continue;
+            if(nprogs > 1) {
+                PARSE_CTREES_ARRAY_SINGLE_SORT(int64_t, group, nprogs, PARSE_CTREES_PROGENITOR_COMPARATOR);
+            }
+            links->first_progenitor[i] = group[0];
+            for(int64_t k=0;k<nprogs-1;k++) {
+                links->next_progenitor[group[k]] = group[k + 1];
             }
-            PARSE_CTREES_XASSERT(offset - start_offset <= nbytes_read,
-                                 EXIT_FAILURE,
-                                 "Error: bytes processed = %"PRId64" should be at most num bytes read = %zd\n",
-                                 offset - start_offset, nbytes_read);
         }
+#undef PARSE_CTREES_PROGENITOR_COMPARATOR
     }
 
+    free(table);
+    free(order);
+    free(group_start);
     return EXIT_SUCCESS;
 }
 
-/* these two macros are for internal use only
+
+/* Compile-time schemas -- for a fixed set of columns (with the column numbers known at compile-time), this generates
+   a destination struct and a fully unrolled line parser that writes directly into that struct. The generic
+   `base_ptr_idx`/`dest_offset_to_element` indirection (and the per-column function pointers) of the column plan
+   are replaced by straight-line code with the number of tokens to skip and the destination types fixed at compile-time.
+
+   The schema is an X-macro with one X(field, "column name", column number, type) entry per column, with the
+   column numbers in ascending order (a column number may be repeated to store the same column twice). All of the
+   destination types are supported except for the fixed-point Q16/Q32 (which need a run-time range), e.g.,
+
+       #define HALO_SCHEMA(X)                  \
+           X(scale,   "scale",    0, F32)      \
+           X(id,      "id",       1, I64)      \
+           X(mmp,     "mmp?",    14, BOOL)     \
+           X(vmax,    "vmax",    16, F32)      \
+           X(x,       "x",       17, F64)
+       PARSE_CTREES_DEFINE_SCHEMA(halo, HALO_SCHEMA)
+
+   generates (for the schema name `halo`):
+     - `struct halo` with the fields `scale`, `id`, `mmp`, `vmax` and `x`
+     - `check_header_halo_ctrees(filename)` -- verifies that the header of the file has every column at the
+       expected column number (must be called on every file before reading it)
+     - `parse_line_halo_ctrees(line, linelen, &halo)` -- parses one line (need not be NUL-terminated)
+     - `init_base_ptr_info_halo_ctrees(&base_ptr_info, &halos)` -- sets up a base_ptr_info with the single
+       array-of-structures ``halos`` (that is grown as required, as with all the other readers)
+     - `read_single_tree_halo_buffered_ctrees`, `read_single_tree_halo_source_ctrees` and
+       `read_single_tree_halo_mmap_ctrees` -- same as their generic counterparts (but without the row filters) */
+#define PARSE_CTREES_SCHEMA_CTYPE_I32   int32_t
+#define PARSE_CTREES_SCHEMA_CTYPE_I64   int64_t
+#define PARSE_CTREES_SCHEMA_CTYPE_U32   uint32_t
+#define PARSE_CTREES_SCHEMA_CTYPE_U64   uint64_t
+#define PARSE_CTREES_SCHEMA_CTYPE_F32   float
+#define PARSE_CTREES_SCHEMA_CTYPE_F64   double
+#define PARSE_CTREES_SCHEMA_CTYPE_I8    int8_t
+#define PARSE_CTREES_SCHEMA_CTYPE_I16   int16_t
+#define PARSE_CTREES_SCHEMA_CTYPE_U8    uint8_t
+#define PARSE_CTREES_SCHEMA_CTYPE_U16   uint16_t
+#define PARSE_CTREES_SCHEMA_CTYPE_BOOL  uint8_t
+#define PARSE_CTREES_SCHEMA_CTYPE_F16   uint16_t
+
+#define PARSE_CTREES_SCHEMA_FIELD(FIELD, COLNAME, COLNUM, TYPE)  PARSE_CTREES_SCHEMA_CTYPE_##TYPE FIELD;
+#define PARSE_CTREES_SCHEMA_NAME(FIELD, COLNAME, COLNUM, TYPE)   COLNAME,
+#define PARSE_CTREES_SCHEMA_COLNUM(FIELD, COLNAME, COLNUM, TYPE) (COLNUM),
+
+/* the ``icol`` (the column of the current token) is a compile-time constant after every field, so the
+   number of tokens to skip, and the branch, are resolved at compile-time */
+#define PARSE_CTREES_SCHEMA_PARSE_FIELD(FIELD, COLNAME, COLNUM, TYPE)                                   \
+    if((COLNUM) > icol) {                                                                               \
+        const int32_t ntokens = (COLNUM) - icol;                                                        \
+        this = (ntokens < PARSE_CTREES_SIMD_MIN_SKIP_NCOLS) ? skip_tokens_scalar_ctrees(this, end, ntokens, &token) \
+            : skip_tokens(this, end, ntokens, &token);                                                  \
+        if(this == NULL) {                                                                              \
+            fprintf(stderr,"Error: Could not locate the column `%s' (column number = %d) in the line `%.*s`\n", \
+                    COLNAME, (int) (COLNUM), (int) linelen, line);                                      \
+            return EXIT_FAILURE;                                                                        \
+        }                                                                                               \
+        toklen = this - token;                                                                          \
+        icol = (COLNUM);                                                                                \
+    }                                                                                                   \
+    if(convert_token_fast_ctrees(token, toklen, TYPE, &(dest->FIELD)) != EXIT_SUCCESS) {                \
+        fprintf(stderr,"Error: Could not convert the column `%s' in the line `%.*s`\n",                 \
+                COLNAME, (int) linelen, line);                                                          \
+        return EXIT_FAILURE;                                                                            \
+    }
+
+#define PARSE_CTREES_DEFINE_SCHEMA(NAME, SCHEMA)                                                        \
+    struct NAME {                                                                                       \
+        SCHEMA(PARSE_CTREES_SCHEMA_FIELD)                                                               \
+    };                                                                                                  \
+                                                                                                        \
+    static inline int check_header_##NAME##_ctrees(const char *filename)                                \
+    {                                                                                                   \
+        static const char wanted_names[][PARSE_CTREES_MAX_COLNAME_LEN] = {SCHEMA(PARSE_CTREES_SCHEMA_NAME)}; \
+        static const int32_t wanted_columns[] = {SCHEMA(PARSE_CTREES_SCHEMA_COLNUM)};                   \
+        const int nwanted = (int) (sizeof(wanted_columns)/sizeof(wanted_columns[0]));                   \
+        for(int i=1;i<nwanted;i++) {                                                                    \
+            if(wanted_columns[i] < wanted_columns[i-1]) {                                               \
+                fprintf(stderr,"Error: The columns in the schema `%s' must be in ascending order. Found column `%s' " \
+                        "(column number = %d) after column number = %d\n",                              \
+                        #NAME, wanted_names[i], wanted_columns[i], wanted_columns[i-1]);                \
+                return EXIT_FAILURE;                                                                    \
+            }                                                                                           \
+        }                                                                                               \
+        char (*names)[PARSE_CTREES_MAX_COLNAME_LEN] = NULL;                                             \
+        int totncols = 0;                                                                               \
+        int status = read_header_column_names_ctrees(filename, &names, &totncols);                      \
+        if(status != EXIT_SUCCESS) {                                                                    \
+            return status;                                                                              \
+        }                                                                                               \
+        int *matched_columns = match_column_name(wanted_names, nwanted,                                 \
+                                                 (const char (*)[PARSE_CTREES_MAX_COLNAME_LEN]) names, totncols); \
+        free(names);                                                                                    \
+        if(matched_columns == NULL) {                                                                   \
+            return EXIT_FAILURE;                                                                        \
+        }                                                                                               \
+        for(int i=0;i<nwanted;i++) {                                                                    \
+            if(matched_columns[i] != wanted_columns[i]) {                                               \
+                fprintf(stderr,"Error: The schema `%s' expects the column `%s' at column number = %d but the file `%s' " \
+                        "has it at column number = %d\n",                                               \
+                        #NAME, wanted_names[i], wanted_columns[i], filename, matched_columns[i]);       \
+                status = EXIT_FAILURE;                                                                  \
+            }                                                                                           \
+        }                                                                                               \
+        free(matched_columns);                                                                          \
+        return status;                                                                                  \
+    }                                                                                                   \
+                                                                                                        \
+    static inline int parse_line_##NAME##_ctrees(const char *line, const size_t linelen, struct NAME *dest) \
+    {                                                                                                   \
+        const ctrees_skip_tokens_fn skip_tokens = get_skip_tokens_fn_ctrees();                         \
+        const char *this = line;                                                                        \
+        const char *end = line + linelen;                                                               \
+        const char *token = NULL;                                                                       \
+        size_t toklen = 0;                                                                              \
+        int32_t icol = -1;                                                                              \
+        SCHEMA(PARSE_CTREES_SCHEMA_PARSE_FIELD)                                                         \
+        (void) skip_tokens;                                                                             \
+        return EXIT_SUCCESS;                                                                            \
+    }                                                                                                   \
+                                                                                                        \
+    static inline void init_base_ptr_info_##NAME##_ctrees(struct base_ptr_info *base_ptr_info, struct NAME **halos) \
+    {                                                                                                   \
+        init_base_ptr_info_ctrees(base_ptr_info);                                                       \
+        *halos = NULL;                                                                                  \
+        base_ptr_info->num_base_ptrs = 1;                                                               \
+        base_ptr_info->base_ptrs[0] = (void **) halos;                                                  \
+        base_ptr_info->base_element_size[0] = sizeof(struct NAME);                                      \
+    }                                                                                                   \
+                                                                                                        \
+    static inline int parse_line_##NAME##_visitor_ctrees(const char *line, const size_t linelen, void *data) \
+    {                                                                                                   \
+        struct base_ptr_info *base_ptr_info = (struct base_ptr_info *) data;                            \
+        if(base_ptr_info->nallocated == base_ptr_info->N) {                                             \
+            int status = grow_base_ptrs_ctrees(base_ptr_info);                                          \
+            if(status != EXIT_SUCCESS) return status;                                                   \
+        }                                                                                               \
+        struct NAME *halos = *((struct NAME **) base_ptr_info->base_ptrs[0]);                          \
+        int status = parse_line_##NAME##_ctrees(line, linelen, &(halos[base_ptr_info->N]));             \
+        if(status != EXIT_SUCCESS) return status;                                                       \
+        base_ptr_info->N++;                                                                             \
+        return EXIT_SUCCESS;                                                                            \
+    }                                                                                                   \
+                                                                                                        \
+    static inline int check_base_ptr_info_##NAME##_ctrees(const struct base_ptr_info *base_ptr_info)    \
+    {                                                                                                   \
+        if(base_ptr_info->num_base_ptrs != 1 || base_ptr_info->base_element_size[0] != sizeof(struct NAME)) { \
+            fprintf(stderr,"Error: The schema `%s' requires a single base pointer with elements of %zu bytes. " \
+                    "Please use `init_base_ptr_info_%s_ctrees`\n", #NAME, sizeof(struct NAME), #NAME);  \
+            return EXIT_FAILURE;                                                                        \
+        }                                                                                               \
+        return EXIT_SUCCESS;                                                                            \
+    }                                                                                                   \
+                                                                                                        \
+    static inline int read_single_tree_##NAME##_source_ctrees(const struct ctrees_input_source *source, off_t offset, \
+                                                              struct base_ptr_info *base_ptr_info, struct ctrees_buffered_reader *reader) \
+    {                                                                                                   \
+        int status = check_base_ptr_info_##NAME##_ctrees(base_ptr_info);                                \
+        if(status != EXIT_SUCCESS) return status;                                                       \
+        return visit_tree_lines_source_ctrees(source, offset, reader, parse_line_##NAME##_visitor_ctrees, base_ptr_info); \
+    }                                                                                                   \
+                                                                                                        \
+    static inline int read_single_tree_##NAME##_buffered_ctrees(int fd, off_t offset, struct base_ptr_info *base_ptr_info, \
+                                                                struct ctrees_buffered_reader *reader)  \
+    {                                                                                                   \
+        const struct ctrees_input_source source = get_fd_source_ctrees(&fd);                            \
+        return read_single_tree_##NAME##_source_ctrees(&source, offset, base_ptr_info, reader);         \
+    }                                                                                                   \
+                                                                                                        \
+    static inline int read_single_tree_##NAME##_mmap_ctrees(const struct ctrees_mmap_file *mfile, off_t offset, \
+                                                            struct base_ptr_info *base_ptr_info)        \
+    {                                                                                                   \
+        int status = check_base_ptr_info_##NAME##_ctrees(base_ptr_info);                                \
+        if(status != EXIT_SUCCESS) return status;                                                       \
+        return visit_tree_lines_mmap_ctrees(mfile, offset, parse_line_##NAME##_visitor_ctrees, base_ptr_info); \
+    }
+
+
+/* these macros are for internal use only
    and can therefor be undefined */
 #undef PARSE_CTREES_MAXBUFSIZE
 #undef PARSE_CTREES_XASSERT
+#undef PARSE_CTREES_LOG
+#undef PARSE_CTREES_ARRAY_SORT
+#undef PARSE_CTREES_ARRAY_SINGLE_SORT
 
 
 #if 0